@@ -0,0 +1,24 @@
+-- Results of operations submitted with an idempotency key.
+--
+-- createOrder, addOrderItems, generateBill and processPayment accept a key
+-- chosen by the caller (include/IdempotencyStore.h). The first call claims
+-- the key here and stores its result; a retry with the same key, from this
+-- till or another, gets that result back by primary key instead of running
+-- the operation again. Request_hash guards against a key reused for a
+-- different request. Rows older than a day are deleted by the application.
+--
+-- Run once against an existing restaurant_management database:
+--
+--   mysql -u root restaurant_management < database/idempotency_keys.sql
+--
+-- Without this table keys are only remembered by the process that saw them.
+
+CREATE TABLE IF NOT EXISTS Idempotency_Keys (
+    Idem_key VARCHAR(64) NOT NULL,
+    Operation VARCHAR(32) NOT NULL,
+    Request_hash CHAR(16) NOT NULL,
+    Result VARCHAR(20) NULL,
+    Created_at DATETIME NOT NULL DEFAULT CURRENT_TIMESTAMP,
+    PRIMARY KEY (Idem_key),
+    INDEX idx_idempotency_created (Created_at)
+);
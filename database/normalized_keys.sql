@@ -0,0 +1,36 @@
+-- Normalized uniqueness keys for Menu, Tables and Staff.
+--
+-- Each key is a stored generated column holding the same canonical form the
+-- application uses (normalizeKey in include/NormalizedKeyIndex.h): blanks
+-- trimmed, inner whitespace collapsed to one space, lowercased. The unique
+-- index on it makes duplicate checks an index lookup instead of a
+-- LOWER(column) scan, and rejects duplicates (error 1062) even when two
+-- terminals insert at the same time.
+--
+-- Requires MySQL 8.0+ or MariaDB 10.2+. Run once against an existing
+-- restaurant_management database:
+--
+--   mysql -u root restaurant_management < database/normalized_keys.sql
+--
+-- The unique indexes cannot be created while duplicates exist. List them
+-- first with:
+--
+--   SELECT LOWER(TRIM(REGEXP_REPLACE(Menu_name, '[[:space:]]+', ' '))) AS k, COUNT(*)
+--   FROM Menu GROUP BY k HAVING COUNT(*) > 1;
+--
+-- (and the same for Tables.Table_number and Staff.Email).
+
+ALTER TABLE Menu
+    ADD COLUMN Menu_name_key VARCHAR(255)
+        AS (LOWER(TRIM(REGEXP_REPLACE(Menu_name, '[[:space:]]+', ' ')))) STORED,
+    ADD UNIQUE INDEX uq_menu_name_key (Menu_name_key);
+
+ALTER TABLE Tables
+    ADD COLUMN Table_number_key VARCHAR(255)
+        AS (LOWER(TRIM(REGEXP_REPLACE(Table_number, '[[:space:]]+', ' ')))) STORED,
+    ADD UNIQUE INDEX uq_table_number_key (Table_number_key);
+
+ALTER TABLE Staff
+    ADD COLUMN Email_key VARCHAR(255)
+        AS (LOWER(TRIM(REGEXP_REPLACE(Email, '[[:space:]]+', ' ')))) STORED,
+    ADD UNIQUE INDEX uq_staff_email_key (Email_key);
@@ -0,0 +1,24 @@
+-- Records of the offline order journal that have reached the database.
+--
+-- A till that loses its connection keeps taking orders, items, bills and
+-- payments into a local journal (include/OrderJournal.h) and replays them
+-- when the connection returns. Each replayed record inserts its terminal ID
+-- and sequence number here in the same transaction as the change itself,
+-- so a record is applied at most once even if the till crashes after the
+-- commit and replays it again. Result_id is the ID the record created
+-- (OrderID or BillID), if any.
+--
+-- Run once against an existing restaurant_management database:
+--
+--   mysql -u root restaurant_management < database/offline_journal.sql
+--
+-- Without this table the journal is disabled and the POS behaves as before
+-- when the database is unreachable.
+
+CREATE TABLE IF NOT EXISTS Journal_Applied (
+    Terminal VARCHAR(64) NOT NULL,
+    Seq BIGINT UNSIGNED NOT NULL,
+    Result_id VARCHAR(20) NULL,
+    Applied_at DATETIME NOT NULL DEFAULT CURRENT_TIMESTAMP,
+    PRIMARY KEY (Terminal, Seq)
+);
@@ -0,0 +1,42 @@
+-- History tables for finished orders, and views over hot and history rows.
+--
+-- `RestaurantManagementSystem --archive` (include/OrderArchive.h) moves
+-- Completed and Cancelled orders older than a number of days (90 by
+-- default), with their items and bills, from Orders, Order_Item and Bill
+-- into the *_History tables, in small batches that do not hold up service.
+-- The hot tables then only hold recent orders, so the active-order lookups
+-- and the ID generators scan a small table however long the restaurant has
+-- been open.
+--
+-- Reports (order and bill lists, daily sales) read through the All_* views
+-- so archived rows still count. Archived IDs are never handed out again.
+--
+-- Run once against an existing restaurant_management database, after
+-- row_versions.sql if that is used (the history tables copy the columns the
+-- hot tables have when this runs):
+--
+--   mysql -u root restaurant_management < database/order_archive.sql
+--
+-- Without these tables nothing is archived and reports read the hot tables
+-- as before.
+
+-- Same columns and indexes; no foreign keys, so history rows do not hold
+-- up deleting a staff member or table
+CREATE TABLE IF NOT EXISTS Orders_History LIKE Orders;
+CREATE TABLE IF NOT EXISTS Order_Item_History LIKE Order_Item;
+CREATE TABLE IF NOT EXISTS Bill_History LIKE Bill;
+
+CREATE OR REPLACE VIEW All_Orders AS
+    SELECT OrderID, TableID, StaffID, Order_date, Total_amount, Order_status FROM Orders
+    UNION ALL
+    SELECT OrderID, TableID, StaffID, Order_date, Total_amount, Order_status FROM Orders_History;
+
+CREATE OR REPLACE VIEW All_Order_Items AS
+    SELECT Order_itemID, OrderID, MenuID, Quantity, Unit_price, Total FROM Order_Item
+    UNION ALL
+    SELECT Order_itemID, OrderID, MenuID, Quantity, Unit_price, Total FROM Order_Item_History;
+
+CREATE OR REPLACE VIEW All_Bills AS
+    SELECT BillID, OrderID, StaffID, Total, Payment_method, Payment_status, Bill_date FROM Bill
+    UNION ALL
+    SELECT BillID, OrderID, StaffID, Total, Payment_method, Payment_status, Bill_date FROM Bill_History;
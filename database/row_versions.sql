@@ -0,0 +1,20 @@
+-- Version columns for optimistic checks on orders and bills.
+--
+-- Every write to an order (items added or removed, bill generated,
+-- cancelled) or a bill (paid) raises its Version by one in the same
+-- statement that locks the row (include/RowVersion.h). A terminal that
+-- shows an order and waits for the cashier passes the version it showed
+-- back with generateBill or cancelOrder; if another terminal changed the
+-- order in between, the write is refused as a conflict and the order is
+-- shown again, instead of billing items nobody looked at. No lock is held
+-- while the cashier decides.
+--
+-- Run once against an existing restaurant_management database:
+--
+--   mysql -u root restaurant_management < database/row_versions.sql
+--
+-- Without these columns writes are not checked against what was shown and
+-- behave as before.
+
+ALTER TABLE Orders ADD COLUMN Version INT UNSIGNED NOT NULL DEFAULT 0;
+ALTER TABLE Bill ADD COLUMN Version INT UNSIGNED NOT NULL DEFAULT 0;
@@ -1,8 +1,15 @@
 #pragma once
 #include "DatabaseConnection.h"
+#include "ConsoleRenderer.h"
+#include "QueryPool.h"
+#include "OrderArchive.h"
+#include "SalesSeries.h"
 #include <string>
 #include <iostream>
 #include <iomanip>
+#include <vector>
+#include <optional>
+#include <future>
 
 using namespace std;
 
@@ -12,12 +19,79 @@ private:
     string currentAdminID;
     string currentAdminName;
     bool isLoggedIn;
+    QueryPool* pool = nullptr;
+    ArchiveSchema archive{ db };
+    SalesSeries* sales = nullptr;
+
+    // Store the paid total for date (YYYY-MM-DD) in Daily_Sells, computed
+    // by MySQL from bills (the table or view holding them) so it does not
+    // depend on a summary read first. Returns rows
+    // affected, or -1 if the statement could not be prepared. Cancelling
+    // stops it; the time limit does not apply to writes. The SELECT locks
+    // the day's Bill rows, so it can lose a deadlock to a payment and is
+    // run as a transaction that retries.
+    static int saveDailyTotal(DatabaseConnection& conn, const string& bills, const string& date,
+        const QueryOptions& options) {
+        int affected = -1;
+        conn.transaction("saveDailyTotal", [&]() {
+            auto pstmt = conn.prepareStatement(
+                "INSERT INTO Daily_Sells (SalesID, Sales_date, Daily_total) "
+                "SELECT ?, ?, COALESCE(SUM(Total), 0) "
+                "FROM " + bills + " WHERE DATE(Bill_date) = ? AND Payment_status = 'Paid' "
+                "ON DUPLICATE KEY UPDATE Daily_total = VALUES(Daily_total)");
+            if (!pstmt) return false;
+            pstmt->setString(1, "SAL" + date.substr(0, 4) + date.substr(5, 2) + date.substr(8, 2));
+            pstmt->setString(2, date);
+            pstmt->setString(3, date);
+            CancelScope scope(conn, options.cancel);
+            affected = pstmt->executeUpdate();
+            return true;
+        });
+        return affected;
+    }
+
+    // Count and total of one day's paid bills, read from bills (the table
+    // or view holding them); throws sql::SQLException
+    static optional<DailySalesSummary> querySalesSummary(DatabaseConnection& conn, const string& bills,
+        const string& date, const QueryOptions& options) {
+        auto pstmt = conn.prepareStatement(conn.withTimeLimit(
+            "SELECT COUNT(BillID) as TotalBills, "
+            "COALESCE(SUM(Total), 0) as TotalRevenue "
+            "FROM " + bills + " WHERE DATE(Bill_date) = ? AND Payment_status = 'Paid'", options.timeout));
+        if (!pstmt) return nullopt;
+        pstmt->setString(1, date);
+        CancelScope scope(conn, options.cancel);
+        unique_ptr<sql::ResultSet> res(pstmt->executeQuery());
+        if (!res->next()) return nullopt;
+
+        DailySalesSummary summary;
+        summary.date = date;
+        summary.totalBills = res->getInt("TotalBills");
+        summary.totalRevenue = res->getDouble("TotalRevenue");
+        return summary;
+    }
+
+    // Days since 1970-01-01 for a YYYY-MM-DD date (nullopt if malformed)
+    static optional<long long> parseDay(const string& date) {
+        int year = 0, month = 0, day = 0;
+        if (date.size() != 10 || sscanf(date.c_str(), "%d-%d-%d", &year, &month, &day) != 3
+            || month < 1 || month > 12 || day < 1 || day > 31) return nullopt;
+        return daysFromCivil(year, (unsigned)month, (unsigned)day);
+    }
 
 public:
     AdminModule(DatabaseConnection& database) : db(database), isLoggedIn(false) {}
 
+    // Run the independent statements of a report concurrently on pool
+    // (nullptr sends every query through db, one after another)
+    void useQueryPool(QueryPool* queryPool) { pool = queryPool; }
+
+    // Read sales trends from series (nullptr: no trends)
+    void useSalesSeries(SalesSeries* series) { sales = series; }
+
     // Admin Login
     bool login(const string& email, const string& password) {
+        MODULE_SPAN("AdminModule", "login");
         try {
             auto pstmt = db.prepareStatement(
                 "SELECT AdminID, Name FROM Admin WHERE Email = ? AND Password = ?");
@@ -44,6 +118,7 @@ public:
     }
 
     void logout() {
+        MODULE_SPAN("AdminModule", "logout");
         currentAdminID = "";
         currentAdminName = "";
         isLoggedIn = false;
@@ -54,95 +129,185 @@ public:
     string getAdminID() const { return currentAdminID; }
     string getAdminName() const { return currentAdminName; }
 
+    // All admins by name (nullopt if the query failed)
+    optional<vector<AdminRow>> listAdmins() {
+        MODULE_SPAN("AdminModule", "listAdmins");
+        auto res = db.executeQuery(selectRows<AdminRow>("FROM Admin ORDER BY Name"));
+        if (!res) return nullopt;
+        return fetchRows<AdminRow>(res.get());
+    }
+
     // View all admins
     void viewAllAdmins() {
-        auto res = db.executeQuery("SELECT AdminID, Name, Email, Address FROM Admin ORDER BY Name");
-        if (res) {
-            cout << "\n" << string(80, '=') << endl;
-            cout << "ADMIN LIST" << endl;
-            cout << string(80, '=') << endl;
-            cout << left << setw(12) << "Admin ID"
-                << setw(25) << "Name"
-                << setw(30) << "Email"
-                << "Address" << endl;
-            cout << string(80, '-') << endl;
-
-            while (res->next()) {
-                cout << left << setw(12) << res->getString("AdminID")
-                    << setw(25) << res->getString("Name")
-                    << setw(30) << res->getString("Email")
-                    << res->getString("Address") << endl;
+        MODULE_SPAN("AdminModule", "viewAllAdmins");
+        if (auto admins = listAdmins()) ConsoleRenderer::admins(*admins);
+    }
+
+    // Paid bills and revenue for one day (YYYY-MM-DD), archived bills
+    // included, read from the report replica when there is one; nullopt if
+    // the query failed, timed out or was cancelled
+    optional<DailySalesSummary> summarizeDailySales(const string& date, const QueryOptions& options = QueryOptions()) {
+        MODULE_SPAN("AdminModule", "summarizeDailySales");
+        string bills = archive.allRows("Bill");
+        DatabaseConnection& reader = db.reportConnection();
+        if (&reader != &db) {
+            try {
+                if (auto summary = querySalesSummary(reader, bills, date, options)) return summary;
             }
-            cout << string(80, '=') << endl;
+            catch (sql::SQLException& e) {
+                if (DatabaseConnection::isInterrupted(e)) {
+                    DatabaseConnection::reportInterrupted(e);
+                    return nullopt;
+                }
+                cerr << "[WARNING] Replica read failed: " << e.what() << endl;
+            }
+            // Fall through to the primary
+        }
+        try {
+            return querySalesSummary(db, bills, date, options);
+        }
+        catch (sql::SQLException& e) {
+            if (DatabaseConnection::isInterrupted(e)) {
+                DatabaseConnection::reportInterrupted(e);
+                return nullopt;
+            }
+            cerr << "Error generating report: " << e.what() << endl;
+            return nullopt;
         }
     }
 
-    // Generate Daily Sales Report
-    void generateDailySalesReport(const string& date) {
-        try {
-            string query = "SELECT COUNT(BillID) as TotalBills, "
-                "COALESCE(SUM(Total), 0) as TotalRevenue "
-                "FROM Bill WHERE DATE(Bill_date) = ? AND Payment_status = 'Paid'";
+    // Generate Daily Sales Report (options bound the summary query, and
+    // cancelling also stops the save)
+    void generateDailySalesReport(const string& date, const QueryOptions& options = QueryOptions()) {
+        MODULE_SPAN("AdminModule", "generateDailySalesReport");
+        if (date.size() != 10) {
+            cout << "[FAILED] Date must be YYYY-MM-DD!" << endl;
+            return;
+        }
 
-            auto pstmt = db.prepareStatement(query);
-            if (pstmt) {
-                pstmt->setString(1, date);
-                auto res = pstmt->executeQuery();
+        // With a pool the total is saved while the summary is read and
+        // shown. The save has its own token, cancelled with the caller's or
+        // when the summary fails, and is always waited for here.
+        string bills = archive.allRows("Bill");
+        QueryOptions saveOptions = options;
+        saveOptions.cancel = CancellationToken();
+        CancellationToken saveCancel = saveOptions.cancel;
+        CancellationToken callerCancel = options.cancel;
+        CancellationToken::Registration forward = callerCancel.onCancel([saveCancel]() mutable { saveCancel.cancel(); });
+        if (callerCancel.isCancelled()) saveCancel.cancel();
+        future<int> pendingSave;
+        if (pool) {
+            pendingSave = pool->submit(WorkClass::Report, [bills, date, saveOptions](DatabaseConnection& conn) {
+                return saveDailyTotal(conn, bills, date, saveOptions);
+            });
+        }
 
-                if (res->next()) {
-                    int totalBills = res->getInt("TotalBills");
-                    double totalRevenue = res->getDouble("TotalRevenue");
-
-                    cout << "\n" << string(50, '=') << endl;
-                    cout << "DAILY SALES REPORT - " << date << endl;
-                    cout << string(50, '=') << endl;
-                    cout << "Total Bills Processed: " << totalBills << endl;
-                    cout << "Total Revenue: RM " << fixed << setprecision(2)
-                        << totalRevenue << endl;
-                    cout << string(50, '=') << endl;
-
-                    // Save to Daily_Sells table
-                    string salesID = "SAL" + date.substr(0, 4) + date.substr(5, 2) + date.substr(8, 2);
-                    string insertQuery = "INSERT INTO Daily_Sells (SalesID, Sales_date, Daily_total) "
-                        "VALUES ('" + salesID + "', '" + date + "', " +
-                        to_string(totalRevenue) + ") "
-                        "ON DUPLICATE KEY UPDATE Daily_total = " + to_string(totalRevenue);
-                    db.executeUpdate(insertQuery);
-                    cout << "[INFO] Report saved to Daily_Sells table." << endl;
-                }
+        optional<DailySalesSummary> summary = summarizeDailySales(date, options);
+        if (!summary) {
+            if (!pendingSave.valid()) return;
+            // Nothing was shown, so stop the save if it has not finished
+            saveCancel.cancel();
+        }
+        else {
+            ConsoleRenderer::dailySalesReport(*summary);
+        }
+
+        // Save to Daily_Sells table
+        try {
+            int saved = pendingSave.valid() ? pendingSave.get() : saveDailyTotal(db, bills, date, saveOptions);
+            if (saved >= 0) {
+                cout << "[INFO] Report saved to Daily_Sells table." << endl;
             }
         }
         catch (sql::SQLException& e) {
-            cerr << "Error generating report: " << e.what() << endl;
+            if (DatabaseConnection::isInterrupted(e)) {
+                // Stopped here when the summary failed, which was reported
+                if (summary) DatabaseConnection::reportInterrupted(e);
+                return;
+            }
+            cerr << "Error saving report: " << e.what() << endl;
         }
     }
 
+    // Saved daily totals, newest first, read from the report replica when
+    // there is one (nullopt if the query failed, timed out or was cancelled)
+    optional<vector<DailySalesRow>> listDailySales(const QueryOptions& options = QueryOptions()) {
+        MODULE_SPAN("AdminModule", "listDailySales");
+        auto res = db.executeReport(
+            selectRows<DailySalesRow>("FROM Daily_Sells ORDER BY Sales_date DESC"), options);
+        if (!res) return nullopt;
+        return fetchRows<DailySalesRow>(res.get());
+    }
+
     // View all daily sales
-    void viewAllDailySales() {
+    void viewAllDailySales(const QueryOptions& options = QueryOptions()) {
+        MODULE_SPAN("AdminModule", "viewAllDailySales");
+        if (auto days = listDailySales(options)) ConsoleRenderer::dailySales(*days);
+    }
+
+    // Paid sales per period of bucketMinutes over the days fromDate to
+    // toDate (YYYY-MM-DD, both included), read from the sales series
+    // without querying the database (nullopt if the series is off, a date
+    // is malformed or the range has too many periods)
+    optional<vector<SalesBucket>> salesTrend(const string& fromDate, const string& toDate, int bucketMinutes) {
+        MODULE_SPAN("AdminModule", "salesTrend");
+        optional<long long> from = parseDay(fromDate);
+        optional<long long> to = parseDay(toDate);
+        if (!sales || !from || !to || *to < *from) return nullopt;
+        vector<SalesBucket> buckets = sales->query(DateTime(chrono::seconds(*from * 86400)),
+            DateTime(chrono::seconds((*to + 1) * 86400)), bucketMinutes);
+        if (buckets.empty()) return nullopt;
+        return buckets;
+    }
+
+    // View sales trend
+    void viewSalesTrend(const string& fromDate, const string& toDate, int bucketMinutes) {
+        MODULE_SPAN("AdminModule", "viewSalesTrend");
+        if (!sales) {
+            cout << "[FAILED] Sales series is off." << endl;
+            return;
+        }
+        if (!parseDay(fromDate) || !parseDay(toDate) || toDate < fromDate) {
+            cout << "[FAILED] Dates must be YYYY-MM-DD, the first not after the second!" << endl;
+            return;
+        }
+        if (auto buckets = salesTrend(fromDate, toDate, bucketMinutes)) {
+            ConsoleRenderer::salesTrend(*buckets, bucketMinutes);
+        }
+        else {
+            cout << "[FAILED] Too many periods; choose a shorter range or a coarser period." << endl;
+        }
+    }
+
+    // Replace the sales series with every paid bill, archived ones
+    // included, counted at the minute of its bill date. Returns the number
+    // of bills recorded, or -1 if the series is off or the query failed.
+    long long rebuildSalesSeries() {
+        MODULE_SPAN("AdminModule", "rebuildSalesSeries");
+        if (!sales) {
+            cout << "[FAILED] Sales series is off." << endl;
+            return -1;
+        }
         auto res = db.executeQuery(
-            "SELECT SalesID, Sales_date, Daily_total FROM Daily_Sells ORDER BY Sales_date DESC");
-        if (res) {
-            cout << "\n" << string(50, '=') << endl;
-            cout << "DAILY SALES HISTORY" << endl;
-            cout << string(50, '=') << endl;
-            cout << left << setw(15) << "Sales ID"
-                << setw(15) << "Date"
-                << "Total (RM)" << endl;
-            cout << string(50, '-') << endl;
-
-            double grandTotal = 0;
-            while (res->next()) {
-                double total = res->getDouble("Daily_total");
-                grandTotal += total;
-                cout << left << setw(15) << res->getString("SalesID")
-                    << setw(15) << res->getString("Sales_date")
-                    << fixed << setprecision(2) << total << endl;
-            }
-            cout << string(50, '-') << endl;
-            cout << left << setw(30) << "GRAND TOTAL:"
-                << fixed << setprecision(2) << grandTotal << endl;
-            cout << string(50, '=') << endl;
+            "SELECT FLOOR((TO_SECONDS(b.Bill_date) - 62167219200) / 60) AS Minute, "
+            "SUM(ROUND(b.Total * 100)) AS Cents, COUNT(*) AS Bills, COALESCE(SUM(i.Units), 0) AS Units "
+            "FROM " + archive.allRows("Bill") + " b "
+            "LEFT JOIN (SELECT OrderID, SUM(Quantity) AS Units FROM " + archive.allRows("Order_Item")
+            + " GROUP BY OrderID) i ON i.OrderID = b.OrderID "
+            "WHERE b.Payment_status = 'Paid' GROUP BY Minute ORDER BY Minute");
+        if (!res) return -1;
+
+        sales->clear();
+        long long bills = 0;
+        while (res->next()) {
+            unsigned count = (unsigned)res->getInt("Bills");
+            sales->record(DateTime(chrono::seconds((long long)res->getInt64("Minute") * 60)),
+                (long long)res->getInt64("Cents"), count, (unsigned)res->getInt("Units"));
+            bills += count;
         }
+        sales->flush();
+        cout << "[SUCCESS] Sales series rebuilt from " << bills << " paid bill(s)." << endl;
+        return bills;
     }
 };
 
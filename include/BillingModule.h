@@ -1,386 +1,451 @@
 #pragma once
 #include "DatabaseConnection.h"
+#include "ConsoleRenderer.h"
+#include "OrderAggregateCache.h"
+#include "OrderJournal.h"
+#include "IdempotencyStore.h"
+#include "RowVersion.h"
+#include "OrderArchive.h"
+#include "SalesSeries.h"
 #include <string>
 #include <iostream>
 #include <iomanip>
+#include <array>
+#include <vector>
+#include <optional>
 
 using namespace std;
 
 class BillingModule {
 private:
     DatabaseConnection& db;
+    OrderJournal* journal = nullptr;
+    IdempotencyStore idempotency{ db };
+    VersionColumn orderVersions{ db, "Orders", "OrderID" };
+    VersionColumn billVersions{ db, "Bill", "BillID" };
+    ArchiveSchema archive{ db };
+    SalesSeries* sales = nullptr;
 
     string generateBillID() {
-        // Find the smallest missing ID (reuses deleted IDs)
+        // Find the smallest missing ID (reuses deleted IDs, but none at or
+        // below the highest archived one)
         auto res = db.executeQuery(
             "SELECT t1.num + 1 AS gap "
             "FROM (SELECT CAST(SUBSTRING(BillID, 4) AS UNSIGNED) AS num FROM Bill) t1 "
             "LEFT JOIN (SELECT CAST(SUBSTRING(BillID, 4) AS UNSIGNED) AS num FROM Bill) t2 "
             "ON t1.num + 1 = t2.num "
             "WHERE t2.num IS NULL "
+            "AND t1.num >= " + archive.highWater("Bill", "BillID") + " "
             "ORDER BY gap LIMIT 1");
         
         if (res && res->next()) {
             int gapID = res->getInt("gap");
             char buffer[15];
-            sprintf_s(buffer, "BIL%06d", gapID);
+            snprintf(buffer, sizeof(buffer), "BIL%06d", gapID);
             return string(buffer);
         }
         
         // If no gaps found, get max + 1 (or start with BIL000001 if table is empty)
         auto maxRes = db.executeQuery(
-            "SELECT COALESCE(MAX(CAST(SUBSTRING(BillID, 4) AS UNSIGNED)), 0) as MaxID FROM Bill");
+            "SELECT GREATEST(COALESCE(MAX(CAST(SUBSTRING(BillID, 4) AS UNSIGNED)), 0), "
+            + archive.highWater("Bill", "BillID") + ") as MaxID FROM Bill");
         if (maxRes && maxRes->next()) {
             int maxID = maxRes->getInt("MaxID");
             char buffer[15];
-            sprintf_s(buffer, "BIL%06d", maxID + 1);
+            snprintf(buffer, sizeof(buffer), "BIL%06d", maxID + 1);
             return string(buffer);
         }
         return "BIL000001";
     }
 
+    // The journal to use instead of the database while it is unreachable
+    OrderJournal* offline() {
+        return journal && !journal->online() ? journal : nullptr;
+    }
+
+    // Checkout counters by payment method; the order leaves the active set
+    static void recordCheckout(PaymentMethod paymentMethod, double total) {
+        static const array<Counter*, enumCount<PaymentMethod>()> checkouts = [] {
+            array<Counter*, enumCount<PaymentMethod>()> counters{};
+            for (size_t i = 1; i < counters.size(); i++) {
+                counters[i] = &Metrics::instance().counter("restaurant_checkouts_total", "Payments processed",
+                    string("method=\"") + toString((PaymentMethod)i) + "\"");
+            }
+            return counters;
+        }();
+        static Counter& revenueCents = Metrics::instance().counter(
+            "restaurant_checkout_revenue_cents_total", "Revenue of processed payments in cents");
+        static Gauge& activeOrders = Metrics::instance().gauge(
+            "restaurant_active_orders", "Orders currently active");
+
+        if (paymentMethod == PaymentMethod::Unknown) paymentMethod = PaymentMethod::Cash;
+        checkouts[(size_t)paymentMethod]->inc();
+        revenueCents.inc((uint64_t)(total * 100 + 0.5));
+        activeOrders.dec();
+    }
+
 public:
     BillingModule(DatabaseConnection& database) : db(database) {}
 
+    // Take bills and payments into journal while the database is
+    // unreachable (nullptr: fail as before)
+    void useJournal(OrderJournal* orderJournal) { journal = orderJournal; }
+
+    // Record each payment taken in series (nullptr: record none)
+    void useSalesSeries(SalesSeries* series) { sales = series; }
+
     // Generate bill for order
     string generateBill(const string& orderID, const string& staffID,
-        const string& paymentMethod) {
+        PaymentMethod paymentMethod) {
+        return generateBill(orderID, staffID, paymentMethod, nullopt).id;
+    }
+
+    // Generate bill for order if the order is still at expectedOrderVersion
+    // (any version if not set), so the bill matches the items the cashier
+    // was shown; otherwise the result is a Conflict with the current version
+    WriteResult generateBill(const string& orderID, const string& staffID,
+        PaymentMethod paymentMethod, const optional<RowVersion>& expectedOrderVersion) {
+        MODULE_SPAN("BillingModule", "generateBill");
+        WriteResult result;
+        if (OrderJournal* j = offline()) {
+            result.id = j->generateBill(orderID, staffID, paymentMethod);
+            if (!result.id.empty()) result.status = WriteStatus::Done;
+            return result;
+        }
         try {
             // Validate payment method
-            if (paymentMethod != "Cash" && paymentMethod != "Card" && paymentMethod != "E-Wallet") {
+            if (paymentMethod == PaymentMethod::Unknown) {
                 cout << "[FAILED] Invalid payment method! Use 'Cash', 'Card', or 'E-Wallet'." << endl;
-                return "";
+                return result;
             }
 
-            // Check if order exists and is active
-            auto checkOrder = db.prepareStatement(
-                "SELECT Order_status, Total_amount FROM Orders WHERE OrderID = ?");
-            double totalAmount = 0;
-            if (checkOrder) {
-                checkOrder->setString(1, orderID);
-                auto res = checkOrder->executeQuery();
-                if (res->next()) {
-                    string status = res->getString("Order_status");
-                    if (status != "Active") {
-                        cout << "[FAILED] Order is not active! Status: " << status << endl;
-                        return "";
-                    }
-                    totalAmount = res->getDouble("Total_amount");
-                    if (totalAmount <= 0) {
-                        cout << "[FAILED] Order has no items!" << endl;
-                        return "";
+            string billID;
+            bool generated = db.transaction("generateBill", [&]() {
+                // New version for the order; the row stays locked so no item
+                // is added to it while the bill is written
+                if (!orderVersions.update(orderID, "", "Order_status = 'Active'", expectedOrderVersion)) {
+                    // Not updated: say why (without versions, lock and check here)
+                    auto checkOrder = db.prepareStatement(
+                        "SELECT " + sqlField<OrderStatus>("Order_status") + " AS Order_status" + orderVersions.column()
+                        + " FROM Orders WHERE OrderID = ? FOR UPDATE");
+                    if (checkOrder) {
+                        checkOrder->setString(1, orderID);
+                        auto res = checkOrder->executeQuery();
+                        if (!res->next()) {
+                            cout << "[FAILED] Order not found!" << endl;
+                            return false;
+                        }
+                        OrderStatus status = getEnum<OrderStatus>(*res, "Order_status");
+                        if (status != OrderStatus::Active) {
+                            cout << "[FAILED] Order is not active! Status: " << toString(status) << endl;
+                            return false;
+                        }
+                        if (orderVersions.available()) {
+                            result.status = WriteStatus::Conflict;
+                            result.version = res->getUInt64("Version");
+                            cout << "[FAILED] Order was changed on another terminal!" << endl;
+                            return false;
+                        }
                     }
                 }
-                else {
-                    cout << "[FAILED] Order not found!" << endl;
-                    return "";
-                }
-            }
 
-            // Check if bill already exists for this order
-            auto checkBill = db.prepareStatement("SELECT BillID FROM Bill WHERE OrderID = ?");
-            if (checkBill) {
-                checkBill->setString(1, orderID);
-                auto res = checkBill->executeQuery();
-                if (res->next()) {
-                    cout << "[FAILED] Bill already exists for this order!" << endl;
-                    cout << "[INFO] Bill ID: " << res->getString("BillID") << endl;
-                    return "";
+                // Order total, and the bill if one was already generated
+                auto checkBill = db.prepareStatement(
+                    "SELECT o.Total_amount, b.BillID FROM Orders o "
+                    "LEFT JOIN Bill b ON b.OrderID = o.OrderID WHERE o.OrderID = ?");
+                double totalAmount = 0;
+                if (checkBill) {
+                    checkBill->setString(1, orderID);
+                    auto res = checkBill->executeQuery();
+                    if (res->next()) {
+                        totalAmount = res->getDouble("Total_amount");
+                        if (totalAmount <= 0) {
+                            cout << "[FAILED] Order has no items!" << endl;
+                            return false;
+                        }
+                        if (!res->isNull("BillID")) {
+                            cout << "[FAILED] Bill already exists for this order!" << endl;
+                            cout << "[INFO] Bill ID: " << res->getString("BillID") << endl;
+                            return false;
+                        }
+                    }
                 }
-            }
 
-            // Check if staff is active
-            auto checkStaff = db.prepareStatement(
-                "SELECT Status FROM Staff WHERE StaffID = ?");
-            if (checkStaff) {
-                checkStaff->setString(1, staffID);
-                auto res = checkStaff->executeQuery();
-                if (res->next()) {
-                    if (res->getString("Status") != "Active") {
-                        cout << "[FAILED] Staff is not active!" << endl;
-                        return "";
+                // Check if staff is active
+                auto checkStaff = db.prepareStatement(
+                    "SELECT " + sqlField<StaffStatus>("Status") + " AS Status FROM Staff WHERE StaffID = ?");
+                if (checkStaff) {
+                    checkStaff->setString(1, staffID);
+                    auto res = checkStaff->executeQuery();
+                    if (res->next()) {
+                        if (getEnum<StaffStatus>(*res, "Status") != StaffStatus::Active) {
+                            cout << "[FAILED] Staff is not active!" << endl;
+                            return false;
+                        }
+                    }
+                    else {
+                        cout << "[FAILED] Staff not found!" << endl;
+                        return false;
                     }
                 }
-                else {
-                    cout << "[FAILED] Staff not found!" << endl;
-                    return "";
-                }
-            }
 
-            string billID = generateBillID();
-            auto pstmt = db.prepareStatement(
-                "INSERT INTO Bill (BillID, OrderID, StaffID, Total, Payment_method, Payment_status) "
-                "VALUES (?, ?, ?, ?, ?, 'Unpaid')");
-            if (pstmt) {
-                pstmt->setString(1, billID);
-                pstmt->setString(2, orderID);
-                pstmt->setString(3, staffID);
-                pstmt->setDouble(4, totalAmount);
-                pstmt->setString(5, paymentMethod);
-                pstmt->executeUpdate();
-
-                cout << "[SUCCESS] Bill generated with ID: " << billID << endl;
-                return billID;
+                billID = generateBillID();
+                auto pstmt = db.prepareStatement(
+                    "INSERT INTO Bill (BillID, OrderID, StaffID, Total, Payment_method, Payment_status) "
+                    "VALUES (?, ?, ?, ?, ?, 'Unpaid')");
+                if (pstmt) {
+                    pstmt->setString(1, billID);
+                    pstmt->setString(2, orderID);
+                    pstmt->setString(3, staffID);
+                    pstmt->setDouble(4, totalAmount);
+                    pstmt->setString(5, toString(paymentMethod));
+                    pstmt->executeUpdate();
+                    return true;
+                }
+                return false;
+            });
+
+            // A conflict means the cached order is out of date as well
+            if (generated || result.conflict()) OrderAggregateCache::forget(orderID);
+            if (generated) {
+                static Counter& billsGenerated = Metrics::instance().counter(
+                    "restaurant_bills_generated_total", "Bills generated");
+                db.afterCommit([billID]() {
+                    billsGenerated.inc();
+                    cout << "[SUCCESS] Bill generated with ID: " << billID << endl;
+                });
+                result.status = WriteStatus::Done;
+                result.id = billID;
+                result.version = 0;
             }
-            return "";
+            return result;
         }
         catch (sql::SQLException& e) {
             cerr << "Error generating bill: " << e.what() << endl;
-            return "";
+            return result;
         }
     }
 
+    // Generate bill with the payment method given as text (case-insensitive)
+    string generateBill(const string& orderID, const string& staffID,
+        const string& paymentMethod) {
+        return generateBill(orderID, staffID, parseEnum<PaymentMethod>(paymentMethod));
+    }
+
+    // generateBill at most once per idempotencyKey: a retry with the same
+    // key returns the first call's bill ID without running it again
+    string generateBill(const string& orderID, const string& staffID,
+        PaymentMethod paymentMethod, const string& idempotencyKey) {
+        return idempotency.run(idempotencyKey,
+            "generateBill " + orderID + " " + staffID + " " + toString(paymentMethod),
+            [&]() { return generateBill(orderID, staffID, paymentMethod); });
+    }
+
+    // processPayment at most once per idempotencyKey
+    bool processPayment(const string& billID, const string& idempotencyKey) {
+        return !idempotency.run(idempotencyKey, "processPayment " + billID,
+            [&]() { return processPayment(billID) ? billID : string(); }).empty();
+    }
+
     // Process payment
     bool processPayment(const string& billID) {
+        return (bool)processPayment(billID, nullopt);
+    }
+
+    // Process payment if the bill is still at expectedVersion (any version
+    // if not set); otherwise the result is a Conflict with the current
+    // version. A bill that is already paid counts as Done.
+    WriteResult processPayment(const string& billID, const optional<RowVersion>& expectedVersion) {
+        MODULE_SPAN("BillingModule", "processPayment");
+        WriteResult result;
+        result.id = billID;
+        if (OrderJournal* j = offline()) {
+            if (j->processPayment(billID)) result.status = WriteStatus::Done;
+            return result;
+        }
         try {
-            // Check if bill exists and is unpaid
-            auto checkBill = db.prepareStatement(
-                "SELECT Payment_status, OrderID FROM Bill WHERE BillID = ?");
             string orderID;
-            if (checkBill) {
-                checkBill->setString(1, billID);
-                auto res = checkBill->executeQuery();
-                if (res->next()) {
-                    if (res->getString("Payment_status") == "Paid") {
+            PaymentMethod paymentMethod = PaymentMethod::Unknown;
+            double total = 0;
+            int units = 0;
+            bool alreadyPaid = false;
+            bool paid = db.transaction("processPayment", [&]() {
+                // Paid and given a new version in one statement; the trigger
+                // will set table to Vacant and order to Completed
+                bool updated = billVersions.update(billID, "Payment_status = 'Paid'",
+                    "Payment_status <> 'Paid'", expectedVersion);
+
+                // What was paid (and, if nothing was, why); locked so two
+                // tills cannot both take the payment
+                auto checkBill = db.prepareStatement(
+                    "SELECT " + sqlField<PaymentStatus>("Payment_status") + " AS Payment_status, OrderID, "
+                    + sqlField<PaymentMethod>("Payment_method") + " AS Payment_method, Total, "
+                    "(SELECT COALESCE(SUM(Quantity), 0) FROM Order_Item oi WHERE oi.OrderID = Bill.OrderID) AS Units"
+                    + billVersions.column() + " FROM Bill WHERE BillID = ? FOR UPDATE");
+                if (checkBill) {
+                    checkBill->setString(1, billID);
+                    auto res = checkBill->executeQuery();
+                    if (!res->next()) {
+                        cout << "[FAILED] Bill not found!" << endl;
+                        return false;
+                    }
+                    orderID = res->getString("OrderID");
+                    paymentMethod = getEnum<PaymentMethod>(*res, "Payment_method");
+                    total = res->getDouble("Total");
+                    units = res->getInt("Units");
+                    if (updated) return true;
+
+                    if (getEnum<PaymentStatus>(*res, "Payment_status") == PaymentStatus::Paid) {
                         cout << "[INFO] Bill is already paid!" << endl;
+                        alreadyPaid = true;
                         return true;
                     }
-                    orderID = res->getString("OrderID");
-                }
-                else {
-                    cout << "[FAILED] Bill not found!" << endl;
-                    return false;
+                    if (billVersions.available()) {
+                        result.status = WriteStatus::Conflict;
+                        result.version = res->getUInt64("Version");
+                        cout << "[FAILED] Bill was changed on another terminal!" << endl;
+                        return false;
+                    }
                 }
-            }
 
-            // Update bill status to Paid
-            auto pstmt = db.prepareStatement(
-                "UPDATE Bill SET Payment_status = 'Paid' WHERE BillID = ?");
-            if (pstmt) {
-                pstmt->setString(1, billID);
-                pstmt->executeUpdate();
-
-                // The trigger will set table to Vacant and order to Completed
-                cout << "[SUCCESS] Payment processed successfully!" << endl;
-                return true;
+                // Update bill status to Paid
+                auto pstmt = db.prepareStatement(
+                    "UPDATE Bill SET Payment_status = 'Paid' WHERE BillID = ?");
+                if (pstmt) {
+                    pstmt->setString(1, billID);
+                    pstmt->executeUpdate();
+                    return true;
+                }
+                return false;
+            });
+
+            if (paid && !alreadyPaid) {
+                OrderAggregateCache::paid(orderID);
+                SalesSeries* series = sales;
+                db.afterCommit([paymentMethod, total, units, series]() {
+                    recordCheckout(paymentMethod, total);
+                    if (series) series->record(localNow(), (long long)(total * 100 + 0.5), 1, (unsigned)units);
+                    cout << "[SUCCESS] Payment processed successfully!" << endl;
+                });
+                // The write bumped Version only if the table has one
+                if (expectedVersion && billVersions.available()) result.version = *expectedVersion + 1;
             }
-            return false;
+            if (paid) result.status = WriteStatus::Done;
+            return result;
         }
         catch (sql::SQLException& e) {
             cerr << "Error processing payment: " << e.what() << endl;
-            return false;
+            return result;
         }
     }
 
-    // View bill details
-    void viewBillDetails(const string& billID) {
+    // Version of a bill to pass back with a conditional write (nullopt if
+    // the bill is not found, versions are not enabled or the database is
+    // unreachable)
+    optional<RowVersion> getBillVersion(const string& billID) {
+        MODULE_SPAN("BillingModule", "getBillVersion");
+        if (offline()) return nullopt;
         try {
-            auto billStmt = db.prepareStatement(
-                "SELECT b.BillID, b.OrderID, s.Name as Staff_Name, "
-                "b.Bill_date, b.Total, b.Payment_method, b.Payment_status, "
-                "t.Table_number "
-                "FROM Bill b "
-                "JOIN Staff s ON b.StaffID = s.StaffID "
-                "JOIN Orders o ON b.OrderID = o.OrderID "
-                "JOIN Tables t ON o.TableID = t.TableID "
-                "WHERE b.BillID = ?");
-
-            if (billStmt) {
-                billStmt->setString(1, billID);
-                auto billRes = billStmt->executeQuery();
-
-                if (billRes->next()) {
-                    string orderID = billRes->getString("OrderID");
-
-                    cout << "\n" << string(60, '=') << endl;
-                    cout << "                      BILL" << endl;
-                    cout << string(60, '=') << endl;
-                    cout << "Bill ID: " << billRes->getString("BillID") << endl;
-                    cout << "Order ID: " << orderID << endl;
-                    cout << "Table: " << billRes->getString("Table_number") << endl;
-                    cout << "Staff: " << billRes->getString("Staff_Name") << endl;
-                    cout << "Date: " << billRes->getString("Bill_date") << endl;
-                    cout << string(60, '-') << endl;
-
-                    // Get order items
-                    auto itemStmt = db.prepareStatement(
-                        "SELECT m.Menu_name, oi.Quantity, oi.Unit_price, oi.Total "
-                        "FROM Order_Item oi "
-                        "JOIN Menu m ON oi.MenuID = m.MenuID "
-                        "WHERE oi.OrderID = ?");
-                    if (itemStmt) {
-                        itemStmt->setString(1, orderID);
-                        auto itemRes = itemStmt->executeQuery();
-
-                        cout << left << setw(28) << "Item"
-                            << setw(6) << "Qty"
-                            << setw(12) << "Price"
-                            << "Total" << endl;
-                        cout << string(60, '-') << endl;
-
-                        while (itemRes->next()) {
-                            cout << left << setw(28) << itemRes->getString("Menu_name")
-                                << setw(6) << itemRes->getInt("Quantity")
-                                << "RM " << setw(8) << fixed << setprecision(2)
-                                << itemRes->getDouble("Unit_price")
-                                << "RM " << itemRes->getDouble("Total") << endl;
-                        }
-                    }
+            return billVersions.read(billID);
+        }
+        catch (sql::SQLException& e) {
+            cerr << "Error reading bill version: " << e.what() << endl;
+            return nullopt;
+        }
+    }
 
-                    cout << string(60, '-') << endl;
-                    cout << right << setw(48) << "TOTAL: RM "
-                        << fixed << setprecision(2) << billRes->getDouble("Total") << endl;
-                    cout << string(60, '-') << endl;
-                    cout << "Payment Method: " << billRes->getString("Payment_method") << endl;
-                    cout << "Payment Status: " << billRes->getString("Payment_status") << endl;
-                    cout << string(60, '=') << endl;
-                    cout << "           Thank you for dining with us!" << endl;
-                    cout << string(60, '=') << endl;
-                }
-                else {
-                    cout << "[FAILED] Bill not found!" << endl;
-                }
-            }
+    // A bill with its order and lines, in one query (found is false if there
+    // is no such bill; nullopt if the query failed)
+    optional<OrderAggregate> getBillDetails(const string& billID) {
+        MODULE_SPAN("BillingModule", "getBillDetails");
+        if (OrderJournal* j = offline()) return j->findBill(billID);
+        try {
+            return OrderAggregateCache::loadBill(db, billID);
         }
         catch (sql::SQLException& e) {
             cerr << "Error viewing bill: " << e.what() << endl;
+            return nullopt;
         }
     }
 
-    // View all bills
-    void viewAllBills() {
-        auto res = db.executeQuery(
-            "SELECT b.BillID, b.OrderID, s.Name as Staff_Name, "
-            "b.Bill_date, b.Total, b.Payment_method, b.Payment_status "
-            "FROM Bill b "
-            "JOIN Staff s ON b.StaffID = s.StaffID "
-            "ORDER BY b.Bill_date DESC");
-
-        if (res) {
-            cout << "\n" << string(95, '=') << endl;
-            cout << "ALL BILLS" << endl;
-            cout << string(95, '=') << endl;
-            cout << left << setw(12) << "Bill ID"
-                << setw(12) << "Order ID"
-                << setw(18) << "Staff"
-                << setw(12) << "Total"
-                << setw(12) << "Method"
-                << setw(10) << "Status"
-                << "Date" << endl;
-            cout << string(95, '-') << endl;
-
-            while (res->next()) {
-                cout << left << setw(12) << res->getString("BillID")
-                    << setw(12) << res->getString("OrderID")
-                    << setw(18) << res->getString("Staff_Name")
-                    << "RM " << setw(8) << fixed << setprecision(2) << res->getDouble("Total")
-                    << setw(12) << res->getString("Payment_method")
-                    << setw(10) << res->getString("Payment_status")
-                    << res->getString("Bill_date") << endl;
-            }
-            cout << string(95, '=') << endl;
+    // View bill details
+    void viewBillDetails(const string& billID) {
+        MODULE_SPAN("BillingModule", "viewBillDetails");
+        optional<OrderAggregate> details = getBillDetails(billID);
+        if (!details) return;
+        if (details->found) {
+            ConsoleRenderer::billDetails(*details);
         }
+        else {
+            cout << "[FAILED] Bill not found!" << endl;
+        }
+    }
+
+    // All bills, archived ones included, newest first, read from the report
+    // replica when there is one (nullopt if the query failed, timed out or
+    // was cancelled)
+    optional<vector<BillRow>> listBills(const QueryOptions& options = QueryOptions()) {
+        MODULE_SPAN("BillingModule", "listBills");
+        const char* from = archive.available() ? BillRow::historyFrom : BillRow::from;
+        auto res = db.executeReport(selectRows<BillRow>(string(from) + "ORDER BY b.Bill_date DESC"), options);
+        if (!res) return nullopt;
+        return fetchRows<BillRow>(res.get());
+    }
+
+    // Unpaid bills, oldest first (nullopt if the query failed)
+    optional<vector<UnpaidBillRow>> listUnpaidBills() {
+        MODULE_SPAN("BillingModule", "listUnpaidBills");
+        auto res = db.executeQuery(selectRows<UnpaidBillRow>(string(UnpaidBillRow::from) +
+            "WHERE b.Payment_status = 'Unpaid' "
+            "ORDER BY b.Bill_date"));
+        if (!res) return nullopt;
+        return fetchRows<UnpaidBillRow>(res.get());
+    }
+
+    // Active orders that are unbilled or billed but unpaid, oldest first
+    // (nullopt if the query failed)
+    optional<vector<UnpaidOrderRow>> listUnpaidOrders() {
+        MODULE_SPAN("BillingModule", "listUnpaidOrders");
+        if (OrderJournal* j = offline()) return j->unpaidOrders();
+        auto res = db.executeQuery(selectRows<UnpaidOrderRow>(string(UnpaidOrderRow::from) +
+            "WHERE (b.Payment_status = 'Unpaid' OR b.Payment_status IS NULL) "
+            "AND o.Order_status = 'Active' "
+            "ORDER BY o.Order_date"));
+        if (!res) return nullopt;
+        return fetchRows<UnpaidOrderRow>(res.get());
+    }
+
+    // View all bills
+    void viewAllBills(const QueryOptions& options = QueryOptions()) {
+        MODULE_SPAN("BillingModule", "viewAllBills");
+        if (auto bills = listBills(options)) ConsoleRenderer::bills(*bills);
     }
 
     // View unpaid bills
     void viewUnpaidBills() {
-        auto res = db.executeQuery(
-            "SELECT b.BillID, b.OrderID, t.Table_number, b.Total, b.Payment_method "
-            "FROM Bill b "
-            "JOIN Orders o ON b.OrderID = o.OrderID "
-            "JOIN Tables t ON o.TableID = t.TableID "
-            "WHERE b.Payment_status = 'Unpaid' "
-            "ORDER BY b.Bill_date");
-
-        if (res) {
-            cout << "\n" << string(60, '=') << endl;
-            cout << "UNPAID BILLS" << endl;
-            cout << string(60, '=') << endl;
-            cout << left << setw(12) << "Bill ID"
-                << setw(12) << "Order ID"
-                << setw(10) << "Table"
-                << setw(14) << "Amount"
-                << "Payment Method" << endl;
-            cout << string(60, '-') << endl;
-
-            int count = 0;
-            double totalUnpaid = 0;
-            while (res->next()) {
-                double amount = res->getDouble("Total");
-                totalUnpaid += amount;
-                cout << left << setw(12) << res->getString("BillID")
-                    << setw(12) << res->getString("OrderID")
-                    << setw(10) << res->getString("Table_number")
-                    << "RM " << setw(10) << fixed << setprecision(2) << amount
-                    << res->getString("Payment_method") << endl;
-                count++;
-            }
-            if (count == 0) {
-                cout << "No unpaid bills." << endl;
-            }
-            else {
-                cout << string(60, '-') << endl;
-                cout << "Total Unpaid: RM " << fixed << setprecision(2) << totalUnpaid << endl;
-            }
-            cout << string(60, '=') << endl;
-        }
+        MODULE_SPAN("BillingModule", "viewUnpaidBills");
+        if (auto bills = listUnpaidBills()) ConsoleRenderer::unpaidBills(*bills);
     }
 
     // View unpaid orders (order-focused view)
     void viewUnpaidTables() {
-        auto res = db.executeQuery(
-            "SELECT o.OrderID, o.Order_date, o.Order_status, "
-            "t.Table_number, s.Name as Staff_Name, "
-            "COALESCE(b.Total, o.Total_amount) as Total, b.Payment_status "
-            "FROM Orders o "
-            "JOIN Tables t ON o.TableID = t.TableID "
-            "JOIN Staff s ON o.StaffID = s.StaffID "
-            "LEFT JOIN Bill b ON o.OrderID = b.OrderID "
-            "WHERE (b.Payment_status = 'Unpaid' OR b.Payment_status IS NULL) "
-            "AND o.Order_status = 'Active' "
-            "ORDER BY o.Order_date");
-
-        if (res) {
-            cout << "\n" << string(70, '=') << endl;
-            cout << "UNPAID ORDERS" << endl;
-            cout << string(70, '=') << endl;
-            cout << left << setw(12) << "Order ID"
-                << setw(10) << "Table #"
-                << setw(18) << "Staff"
-                << setw(15) << "Amount (RM)"
-                << "Order Date" << endl;
-            cout << string(70, '-') << endl;
-
-            int count = 0;
-            double totalUnpaid = 0;
-            while (res->next()) {
-                double amount = res->getDouble("Total");
-                totalUnpaid += amount;
-                
-                cout << left << setw(12) << res->getString("OrderID")
-                    << setw(10) << res->getString("Table_number")
-                    << setw(18) << res->getString("Staff_Name")
-                    << "RM " << setw(12) << fixed << setprecision(2) << amount
-                    << res->getString("Order_date") << endl;
-                count++;
-            }
-            if (count == 0) {
-                cout << "All orders are paid! No unpaid bills." << endl;
-            }
-            else {
-                cout << string(70, '-') << endl;
-                cout << left << setw(42) << "Total Unpaid Amount:"
-                    << "RM " << fixed << setprecision(2) << totalUnpaid << endl;
-                cout << left << setw(42) << "Number of Unpaid Orders:"
-                    << count << endl;
-            }
-            cout << string(70, '=') << endl;
-        }
+        MODULE_SPAN("BillingModule", "viewUnpaidTables");
+        if (auto orders = listUnpaidOrders()) ConsoleRenderer::unpaidOrders(*orders);
     }
 
     // Get bill for order
     string getBillForOrder(const string& orderID) {
+        MODULE_SPAN("BillingModule", "getBillForOrder");
+        if (OrderJournal* j = offline()) {
+            OrderAggregate order = j->findOrder(orderID);
+            return order.billed ? order.bill.billID : "";
+        }
         try {
+            // Inside an operation the order is usually loaded already
+            if (OrderAggregateCache::active()) {
+                optional<OrderAggregate> order = OrderAggregateCache::loadOrder(db, orderID);
+                return order && order->billed ? order->bill.billID : "";
+            }
             auto pstmt = db.prepareStatement("SELECT BillID FROM Bill WHERE OrderID = ?");
             if (pstmt) {
                 pstmt->setString(1, orderID);
@@ -398,10 +463,11 @@ public:
 
     // Calculate daily sales
     double calculateDailySales(const string& date) {
+        MODULE_SPAN("BillingModule", "calculateDailySales");
         try {
             auto pstmt = db.prepareStatement(
                 "SELECT COALESCE(SUM(Total), 0) as DailyTotal "
-                "FROM Bill WHERE DATE(Bill_date) = ? AND Payment_status = 'Paid'");
+                "FROM " + archive.allRows("Bill") + " WHERE DATE(Bill_date) = ? AND Payment_status = 'Paid'");
             if (pstmt) {
                 pstmt->setString(1, date);
                 auto res = pstmt->executeQuery();
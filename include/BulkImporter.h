@@ -0,0 +1,382 @@
+#pragma once
+#include "DatabaseConnection.h"
+#include "NormalizedKeyIndex.h"
+#include "CsvReader.h"
+#include "Status.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+using namespace std;
+
+enum class ImportKind { Menu, Tables, Staff };
+
+struct ImportRowError {
+    size_t line;          // 0 = not tied to a row
+    string message;
+};
+
+struct ImportReport {
+    size_t rowsRead = 0;
+    size_t rowsImported = 0;
+    bool committed = false;
+    double elapsedMs = 0;
+    string firstID;
+    string lastID;
+    vector<ImportRowError> errors;
+};
+
+// Loads menu items, tables or staff from a CSV file in one transaction.
+//
+// The first line names the columns (any order, case-insensitive; the
+// database column names work too):
+//   menu:   name, price, category [, availability]
+//   tables: number, capacity [, status]
+//   staff:  name, email, password [, address, status]
+//
+// Rows are validated and normalized in memory against the same rules as the
+// admin screens, duplicates are found with a NormalizedKeyIndex over the
+// existing rows plus the file itself, and IDs are allocated in one pass
+// (filling gaps first, like the module ID generators). Valid rows are then
+// written with multi-row prepared INSERTs. Invalid rows are skipped and
+// listed in the report; with strict, any invalid row cancels the import.
+class BulkImporter {
+private:
+    struct Column {
+        const char* header;
+        const char* dbColumn;
+        char type;                 // 's' string, 'd' decimal, 'i' integer
+        const char* defaultValue;  // nullptr = required
+    };
+
+    struct Spec {
+        const char* table;
+        const char* idColumn;
+        const char* idPrefix;
+        int keyColumn;             // index into columns of the unique value
+        const char* keyLabel;
+        vector<Column> columns;
+    };
+
+    struct PendingRow {
+        size_t line;
+        string id;
+        vector<string> values;
+    };
+
+    DatabaseConnection& db;
+    size_t batchRows;
+
+    static const Spec& spec(ImportKind kind) {
+        static const Spec menu = { "Menu", "MenuID", "MNU", 0, "Menu item", {
+            { "name", "Menu_name", 's', nullptr },
+            { "price", "Price", 'd', nullptr },
+            { "category", "Category", 's', nullptr },
+            { "availability", "Availability", 's', "Available" } } };
+        static const Spec tables = { "Tables", "TableID", "TBL", 0, "Table number", {
+            { "number", "Table_number", 's', nullptr },
+            { "capacity", "Capacity", 'i', nullptr },
+            { "status", "Status", 's', "Vacant" } } };
+        static const Spec staff = { "Staff", "StaffID", "STF", 1, "Email", {
+            { "name", "Name", 's', nullptr },
+            { "email", "Email", 's', nullptr },
+            { "address", "Address", 's', "" },
+            { "password", "Password", 's', nullptr },
+            { "status", "Status", 's', "Active" } } };
+        return kind == ImportKind::Menu ? menu : kind == ImportKind::Tables ? tables : staff;
+    }
+
+    static string trim(string_view text) {
+        size_t first = 0;
+        size_t last = text.size();
+        while (first < last && isspace((unsigned char)text[first])) first++;
+        while (last > first && isspace((unsigned char)text[last - 1])) last--;
+        return string(text.substr(first, last - first));
+    }
+
+    // 'A', 'B' or 'C' for the values of E
+    template <typename E>
+    static string enumOptions() {
+        string out;
+        for (size_t i = 1; i < enumCount<E>(); i++) {
+            if (i > 1) out += i + 1 == enumCount<E>() ? " or " : ", ";
+            out += string("'") + toString((E)i) + "'";
+        }
+        return out;
+    }
+
+    // Case-insensitive match of column c against the values of E, rewritten
+    // to the stored spelling. Returns an error message, or "" if it matches.
+    template <typename E>
+    static string normalizeChoice(const Spec& s, vector<string>& values, size_t c) {
+        E choice = parseEnum<E>(values[c]);
+        if (choice == E::Unknown) {
+            return string("invalid ") + s.columns[c].header + " '" + values[c] + "' (use " + enumOptions<E>() + ")";
+        }
+        values[c] = toString(choice);
+        return string();
+    }
+
+    // Normalize values in place. Returns an error message, or "" if the row is valid.
+    static string validate(ImportKind kind, vector<string>& values) {
+        const Spec& s = spec(kind);
+        for (size_t c = 0; c < s.columns.size(); c++) {
+            const Column& column = s.columns[c];
+            string& value = values[c];
+            if (value.empty()) {
+                if (!column.defaultValue) return string("missing ") + column.header;
+                value = column.defaultValue;
+            }
+            if (column.type == 'd') {
+                char* endPtr = nullptr;
+                double number = strtod(value.c_str(), &endPtr);
+                if (*endPtr != '\0' || !isfinite(number)) return string("invalid ") + column.header + " '" + value + "'";
+                if (number <= 0) return string(column.header) + " must be greater than 0";
+            }
+            if (column.type == 'i') {
+                char* endPtr = nullptr;
+                long number = strtol(value.c_str(), &endPtr, 10);
+                if (*endPtr != '\0') return string("invalid ") + column.header + " '" + value + "'";
+                if (number < 1) return string(column.header) + " must be at least 1";
+            }
+        }
+
+        string error;
+        if (kind == ImportKind::Menu) {
+            error = normalizeChoice<MenuCategory>(s, values, 2);
+            if (error.empty()) error = normalizeChoice<Availability>(s, values, 3);
+        }
+        else if (kind == ImportKind::Tables) {
+            error = normalizeChoice<TableStatus>(s, values, 2);
+        }
+        else {
+            if (values[1].find('@') == string::npos) return "invalid email '" + values[1] + "'";
+            error = normalizeChoice<StaffStatus>(s, values, 4);
+        }
+        return error;
+    }
+
+    // Hands out unused ID numbers: gaps in the existing IDs first, then max + 1 onwards
+    class IDAllocator {
+    private:
+        vector<long long> used;   // sorted
+        size_t nextUsed = 0;
+        long long candidate = 1;
+        string prefix;
+
+    public:
+        IDAllocator(DatabaseConnection& db, const Spec& s) : prefix(s.idPrefix) {
+            auto res = db.executeQuery(string("SELECT CAST(SUBSTRING(") + s.idColumn + ", 4) AS UNSIGNED) AS num FROM "
+                + s.table + " ORDER BY num");
+            if (res) while (res->next()) used.push_back(res->getInt64(1));
+        }
+
+        string next() {
+            while (nextUsed < used.size() && used[nextUsed] <= candidate) {
+                if (used[nextUsed] == candidate) candidate++;
+                nextUsed++;
+            }
+            char buffer[24];
+            snprintf(buffer, sizeof(buffer), "%s%03lld", prefix.c_str(), candidate++);
+            return string(buffer);
+        }
+    };
+
+    unique_ptr<sql::PreparedStatement> prepareInsert(const Spec& s, size_t rows) {
+        string sql = string("INSERT INTO ") + s.table + " (" + s.idColumn;
+        string placeholders = "(?";
+        for (const Column& column : s.columns) {
+            sql += string(", ") + column.dbColumn;
+            placeholders += ",?";
+        }
+        placeholders += ")";
+        sql += ") VALUES ";
+        sql.reserve(sql.size() + rows * (placeholders.size() + 1));
+        for (size_t r = 0; r < rows; r++) {
+            if (r > 0) sql += ",";
+            sql += placeholders;
+        }
+        return db.prepareStatement(sql);
+    }
+
+    void writeRows(const Spec& s, const vector<PendingRow>& rows) {
+        unique_ptr<sql::PreparedStatement> fullBatch;
+        for (size_t start = 0; start < rows.size(); start += batchRows) {
+            size_t count = min(batchRows, rows.size() - start);
+            unique_ptr<sql::PreparedStatement> tail;
+            sql::PreparedStatement* pstmt;
+            if (count == batchRows) {
+                if (!fullBatch) fullBatch = prepareInsert(s, batchRows);
+                pstmt = fullBatch.get();
+            }
+            else {
+                tail = prepareInsert(s, count);
+                pstmt = tail.get();
+            }
+            if (!pstmt) throw sql::SQLException("cannot prepare insert");
+
+            int index = 1;
+            for (size_t r = start; r < start + count; r++) {
+                pstmt->setString(index++, rows[r].id);
+                for (size_t c = 0; c < s.columns.size(); c++) {
+                    const string& value = rows[r].values[c];
+                    if (s.columns[c].type == 'd') pstmt->setDouble(index++, strtod(value.c_str(), nullptr));
+                    else if (s.columns[c].type == 'i') pstmt->setInt(index++, atoi(value.c_str()));
+                    else pstmt->setString(index++, value);
+                }
+            }
+            pstmt->executeUpdate();
+        }
+    }
+
+public:
+    BulkImporter(DatabaseConnection& database, size_t rowsPerInsert = 500)
+        : db(database), batchRows(rowsPerInsert == 0 ? 1 : rowsPerInsert) {}
+
+    static bool parseKind(const string& name, ImportKind& kind) {
+        string key = normalizeKey(name);
+        if (key == "menu") kind = ImportKind::Menu;
+        else if (key == "tables" || key == "table") kind = ImportKind::Tables;
+        else if (key == "staff") kind = ImportKind::Staff;
+        else return false;
+        return true;
+    }
+
+    ImportReport importFile(ImportKind kind, const string& path, bool strict = false) {
+        ifstream file(path, ios::binary);
+        if (!file) {
+            ImportReport report;
+            report.errors.push_back({ 0, "cannot open " + path });
+            return report;
+        }
+        return importStream(kind, file, strict);
+    }
+
+    ImportReport importStream(ImportKind kind, istream& in, bool strict = false) {
+        TRACE_SPAN("BulkImporter", "importStream");
+        auto start = chrono::steady_clock::now();
+        ImportReport report;
+        const Spec& s = spec(kind);
+        CsvReader reader(in);
+
+        // Header: map each spec column to its position in the file
+        const vector<string_view>* fields = reader.next();
+        if (!fields) {
+            report.errors.push_back({ 0, "file is empty" });
+            return report;
+        }
+        vector<int> position(s.columns.size(), -1);
+        for (size_t f = 0; f < fields->size(); f++) {
+            string header = normalizeKey(trim((*fields)[f]));
+            for (size_t c = 0; c < s.columns.size(); c++) {
+                if (header == s.columns[c].header || header == normalizeKey(s.columns[c].dbColumn)) {
+                    position[c] = (int)f;
+                }
+            }
+        }
+        for (size_t c = 0; c < s.columns.size(); c++) {
+            if (position[c] < 0 && !s.columns[c].defaultValue) {
+                report.errors.push_back({ reader.lineNumber(), string("header has no '") + s.columns[c].header + "' column" });
+            }
+        }
+        if (!report.errors.empty()) return report;
+
+        NormalizedKeyIndex existing(string("SELECT ") + s.idColumn + ", " + s.columns[s.keyColumn].dbColumn
+            + " FROM " + s.table);
+        if (!existing.load(db)) {
+            report.errors.push_back({ 0, string("cannot read existing ") + s.table });
+            return report;
+        }
+        IDAllocator ids(db, s);
+
+        vector<PendingRow> rows;
+        while ((fields = reader.next()) != nullptr) {
+            report.rowsRead++;
+            PendingRow row;
+            row.line = reader.lineNumber();
+            row.values.resize(s.columns.size());
+            for (size_t c = 0; c < s.columns.size(); c++) {
+                if (position[c] >= 0 && (size_t)position[c] < fields->size()) {
+                    row.values[c] = trim((*fields)[position[c]]);
+                }
+            }
+
+            string error = validate(kind, row.values);
+            if (error.empty()) {
+                string duplicateValue;
+                string duplicateID = existing.find(row.values[s.keyColumn], &duplicateValue);
+                if (!duplicateID.empty()) {
+                    error = string(s.keyLabel) + " '" + duplicateValue + "' already exists (" + duplicateID + ")";
+                }
+            }
+            if (!error.empty()) {
+                report.errors.push_back({ row.line, error });
+                continue;
+            }
+
+            row.id = ids.next();
+            existing.insert(row.id, row.values[s.keyColumn]);
+            rows.push_back(move(row));
+        }
+        if (!reader.error().empty()) {
+            report.errors.push_back({ reader.lineNumber(), reader.error() });
+        }
+
+        if (rows.empty() || (strict && !report.errors.empty())) {
+            report.elapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            return report;
+        }
+
+        try {
+            // All rows or none; a lock conflict writes them all again
+            report.committed = db.transaction("bulkImport", [&]() {
+                writeRows(s, rows);
+                return true;
+            });
+            if (report.committed) {
+                report.rowsImported = rows.size();
+                report.firstID = rows.front().id;
+                report.lastID = rows.back().id;
+            }
+            else {
+                report.errors.push_back({ 0, "not connected to database, nothing imported" });
+            }
+        }
+        catch (sql::SQLException& e) {
+            report.errors.push_back({ 0, string("database error, nothing imported: ") + e.what() });
+        }
+
+        report.elapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        return report;
+    }
+
+    static void printReport(const ImportReport& report, ostream& out) {
+        if (!report.errors.empty()) {
+            out << "\n" << string(70, '=') << endl;
+            out << "IMPORT ERRORS" << endl;
+            out << string(70, '=') << endl;
+            out << left << setw(8) << "Line" << "Problem" << endl;
+            out << string(70, '-') << endl;
+            for (const ImportRowError& error : report.errors) {
+                out << left << setw(8) << (error.line ? to_string(error.line) : "-") << error.message << endl;
+            }
+            out << string(70, '=') << endl;
+        }
+
+        if (report.committed) {
+            out << "[SUCCESS] Imported " << report.rowsImported << " of " << report.rowsRead << " rows ("
+                << report.firstID << " - " << report.lastID << ") in "
+                << fixed << setprecision(0) << report.elapsedMs << " ms" << endl;
+        }
+        else {
+            out << "[FAILED] Nothing imported (" << report.rowsRead << " rows read, "
+                << report.errors.size() << " problems)" << endl;
+        }
+    }
+};
@@ -0,0 +1,82 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <map>
+#include <functional>
+
+using namespace std;
+
+// Lets one thread ask work running on another to stop. Copies share the
+// same state, so the copy handed to a report and the one kept by whoever
+// may cancel it (a key watcher, a request handler) are the same token.
+//
+//   CancellationToken token;
+//   EscapeWatch watch([token]() mutable { token.cancel(); });
+//   billingModule->viewAllBills({ chrono::seconds(30), token });
+//
+// Work that blocks (a running SQL statement) registers a callback with
+// onCancel() for as long as it runs; cancel() calls it on the cancelling
+// thread.
+class CancellationToken {
+private:
+    struct State {
+        mutex lock;
+        bool cancelled = false;
+        int nextID = 0;
+        map<int, function<void()>> callbacks;
+    };
+
+    shared_ptr<State> state;
+
+public:
+    // Unregisters its callback when destroyed. A callback that is running
+    // finishes first, so whatever it refers to may be destroyed afterwards.
+    class Registration {
+    private:
+        shared_ptr<State> state;
+        int id = -1;
+
+        friend class CancellationToken;
+
+    public:
+        Registration() = default;
+        Registration(Registration&& other) noexcept : state(move(other.state)), id(other.id) {}
+        Registration& operator=(Registration&&) = delete;
+        Registration(const Registration&) = delete;
+        Registration& operator=(const Registration&) = delete;
+
+        ~Registration() {
+            if (!state) return;
+            lock_guard<mutex> guard(state->lock);
+            state->callbacks.erase(id);
+        }
+    };
+
+    CancellationToken() : state(make_shared<State>()) {}
+
+    // Mark the token cancelled and run the registered callbacks (once)
+    void cancel() {
+        lock_guard<mutex> guard(state->lock);
+        if (state->cancelled) return;
+        state->cancelled = true;
+        for (auto& entry : state->callbacks) entry.second();
+    }
+
+    bool isCancelled() const {
+        lock_guard<mutex> guard(state->lock);
+        return state->cancelled;
+    }
+
+    // Call callback when the token is cancelled while the registration is
+    // alive. If the token is already cancelled nothing is registered, so
+    // check isCancelled() after registering, not before.
+    Registration onCancel(function<void()> callback) {
+        Registration registration;
+        lock_guard<mutex> guard(state->lock);
+        if (state->cancelled) return registration;
+        registration.state = state;
+        registration.id = state->nextID++;
+        state->callbacks[registration.id] = move(callback);
+        return registration;
+    }
+};
@@ -0,0 +1,258 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+
+using namespace std;
+
+// Compact columnar table file used by the snapshot exporter and importer.
+//
+//   "RCOL1\n"
+//   varint columnCount, then per column: string name, string sqlType
+//   blocks of up to blockRows rows:
+//     varint rowCount (0 marks the end of the file)
+//     per column:
+//       byte encoding (0 = plain, 1 = dictionary)
+//       null bitmap, one bit per row
+//       plain:      string per non-null row
+//       dictionary: varint entries, string per entry, varint index per non-null row
+//
+// Strings are a varint length followed by the bytes. Values are kept in
+// MySQL's text form, so DECIMAL and DATETIME round-trip exactly. A column is
+// dictionary-encoded when at most a quarter of its values in a block are
+// distinct, which covers statuses, categories, foreign keys and dates.
+struct ColumnInfo {
+    string name;
+    string sqlType;
+};
+
+class ColumnarWriter {
+private:
+    ofstream out;
+    vector<ColumnInfo> columns;
+    size_t blockRows;
+    vector<vector<string>> values;        // column -> values of the current block
+    vector<vector<bool>> nulls;
+    size_t rows = 0;
+    unsigned long long totalRows = 0;
+    string buffer;
+
+    void putVarint(uint64_t v) {
+        while (v >= 0x80) {
+            buffer += (char)(v | 0x80);
+            v >>= 7;
+        }
+        buffer += (char)v;
+    }
+
+    void putString(const string& s) {
+        putVarint(s.size());
+        buffer += s;
+    }
+
+    void flushBuffer() {
+        out.write(buffer.data(), (streamsize)buffer.size());
+        buffer.clear();
+    }
+
+    void writeBlock() {
+        if (rows == 0) return;
+        putVarint(rows);
+        for (size_t c = 0; c < columns.size(); c++) {
+            const vector<string>& v = values[c];
+            const vector<bool>& n = nulls[c];
+
+            unordered_map<string, uint32_t> dictionary;
+            vector<const string*> entries;
+            bool useDictionary = true;
+            size_t limit = rows / 4 + 1;
+            for (size_t r = 0; r < rows && useDictionary; r++) {
+                if (n[r]) continue;
+                if (dictionary.emplace(v[r], (uint32_t)entries.size()).second) {
+                    entries.push_back(&v[r]);
+                    if (entries.size() > limit) useDictionary = false;
+                }
+            }
+
+            buffer += (char)(useDictionary ? 1 : 0);
+            for (size_t r = 0; r < rows; r += 8) {
+                unsigned char bits = 0;
+                for (size_t b = 0; b < 8 && r + b < rows; b++) {
+                    if (n[r + b]) bits |= (unsigned char)(1 << b);
+                }
+                buffer += (char)bits;
+            }
+
+            if (useDictionary) {
+                putVarint(entries.size());
+                for (const string* entry : entries) putString(*entry);
+                for (size_t r = 0; r < rows; r++) {
+                    if (!n[r]) putVarint(dictionary[v[r]]);
+                }
+            }
+            else {
+                for (size_t r = 0; r < rows; r++) {
+                    if (!n[r]) putString(v[r]);
+                }
+            }
+            if (buffer.size() > (1 << 20)) flushBuffer();
+        }
+        flushBuffer();
+
+        for (size_t c = 0; c < columns.size(); c++) {
+            values[c].clear();
+            nulls[c].clear();
+        }
+        rows = 0;
+    }
+
+public:
+    ColumnarWriter(const string& path, const vector<ColumnInfo>& tableColumns, size_t rowsPerBlock = 8192)
+        : out(path, ios::binary | ios::trunc), columns(tableColumns), blockRows(rowsPerBlock),
+        values(tableColumns.size()), nulls(tableColumns.size()) {
+        buffer = "RCOL1\n";
+        putVarint(columns.size());
+        for (const ColumnInfo& column : columns) {
+            putString(column.name);
+            putString(column.sqlType);
+        }
+        flushBuffer();
+    }
+
+    bool good() const { return (bool)out; }
+
+    // Append one value to column c of the current row; call endRow() after the last column
+    void add(size_t c, const string& value, bool isNull) {
+        values[c].push_back(isNull ? string() : value);
+        nulls[c].push_back(isNull);
+    }
+
+    void endRow() {
+        rows++;
+        totalRows++;
+        if (rows >= blockRows) writeBlock();
+    }
+
+    unsigned long long rowCount() const { return totalRows; }
+
+    bool close() {
+        writeBlock();
+        putVarint(0);
+        flushBuffer();
+        out.close();
+        return !out.fail();
+    }
+};
+
+class ColumnarReader {
+private:
+    ifstream in;
+    vector<ColumnInfo> columns;
+    bool valid = false;
+
+    bool getVarint(uint64_t& v) {
+        v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            int c = in.get();
+            if (c == EOF) return false;
+            v |= (uint64_t)(c & 0x7F) << shift;
+            if (!(c & 0x80)) return true;
+        }
+        return false;
+    }
+
+    bool getString(string& s) {
+        uint64_t length;
+        if (!getVarint(length) || length > (1u << 30)) return false;
+        s.resize((size_t)length);
+        if (length > 0) in.read(&s[0], (streamsize)length);
+        return (bool)in;
+    }
+
+public:
+    ColumnarReader(const string& path) : in(path, ios::binary) {
+        char magic[6];
+        if (!in.read(magic, 6) || memcmp(magic, "RCOL1\n", 6) != 0) return;
+        uint64_t count;
+        if (!getVarint(count) || count > 4096) return;
+        columns.resize((size_t)count);
+        for (ColumnInfo& column : columns) {
+            if (!getString(column.name) || !getString(column.sqlType)) return;
+        }
+        valid = true;
+    }
+
+    bool good() const { return valid; }
+
+    const vector<ColumnInfo>& getColumns() const { return columns; }
+
+    // Read the next block into values[column][row] / nulls[column][row].
+    // Returns false at the end of the file or on a corrupt block (see good()).
+    bool nextBlock(vector<vector<string>>& values, vector<vector<bool>>& nulls, size_t& rows) {
+        uint64_t count;
+        if (!valid || !getVarint(count)) {
+            valid = false;
+            return false;
+        }
+        if (count == 0) return false;
+        rows = (size_t)count;
+        values.assign(columns.size(), vector<string>());
+        nulls.assign(columns.size(), vector<bool>());
+
+        for (size_t c = 0; c < columns.size(); c++) {
+            int encoding = in.get();
+            vector<bool>& n = nulls[c];
+            n.resize(rows);
+            for (size_t r = 0; r < rows; r += 8) {
+                int bits = in.get();
+                if (bits == EOF) {
+                    valid = false;
+                    return false;
+                }
+                for (size_t b = 0; b < 8 && r + b < rows; b++) n[r + b] = (bits >> b) & 1;
+            }
+
+            vector<string>& v = values[c];
+            v.resize(rows);
+            if (encoding == 1) {
+                uint64_t entries;
+                if (!getVarint(entries) || entries > rows) {
+                    valid = false;
+                    return false;
+                }
+                vector<string> dictionary((size_t)entries);
+                for (string& entry : dictionary) {
+                    if (!getString(entry)) {
+                        valid = false;
+                        return false;
+                    }
+                }
+                for (size_t r = 0; r < rows; r++) {
+                    if (n[r]) continue;
+                    uint64_t index;
+                    if (!getVarint(index) || index >= entries) {
+                        valid = false;
+                        return false;
+                    }
+                    v[r] = dictionary[(size_t)index];
+                }
+            }
+            else if (encoding == 0) {
+                for (size_t r = 0; r < rows; r++) {
+                    if (!n[r] && !getString(v[r])) {
+                        valid = false;
+                        return false;
+                    }
+                }
+            }
+            else {
+                valid = false;
+                return false;
+            }
+        }
+        return true;
+    }
+};
@@ -0,0 +1,366 @@
+#pragma once
+#include "ScreenBuffer.h"
+#include "Rows.h"
+#include "MenuSearchIndex.h"
+#include <string>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+// Console screens for the module result types. The modules fetch plain
+// rows (listMenu(), getOrderDetails(), ...) and their viewX() methods hand
+// them to one of these; other front ends can use the same rows directly.
+// Each screen is rendered into one buffer sized for its rows and written
+// with a single call.
+class ConsoleRenderer {
+private:
+    // Rough bytes per screen: a fixed header and footer plus one line per row
+    static size_t screenBytes(size_t rows, size_t lineWidth) {
+        return (rows + 12) * (lineWidth + 1);
+    }
+
+public:
+    static void menu(const vector<MenuRow>& items, ostream& os = cout) {
+        ScreenBuffer screen(screenBytes(items.size(), 85));
+        screen.line().rule('=', 85).line("RESTAURANT MENU").rule('=', 85);
+        screen.cell("Menu ID", 10).cell("Item Name", 30).cell("Price (RM)", 12).cell("Category", 15)
+            .line("Status");
+        screen.rule('-', 85);
+
+        for (size_t i = 0; i < items.size(); i++) {
+            const MenuRow& item = items[i];
+            if (i > 0 && item.category != items[i - 1].category) {
+                screen.rule('-', 85);
+            }
+            screen.cell(item.menuID, 10).cell(item.name, 30).money(item.price, 12)
+                .cell(toString(item.category), 15).line(toString(item.availability));
+        }
+        screen.rule('=', 85);
+        screen.flush(os);
+    }
+
+    static void availableMenu(const vector<MenuRow>& items, ostream& os = cout) {
+        ScreenBuffer screen(screenBytes(items.size(), 70));
+        screen.line().rule('=', 70).line("AVAILABLE MENU ITEMS").rule('=', 70);
+        screen.cell("Menu ID", 10).cell("Item Name", 30).cell("Price (RM)", 12).line("Category");
+        screen.rule('-', 70);
+
+        for (const MenuRow& item : items) {
+            screen.cell(item.menuID, 10).cell(item.name, 30).money(item.price, 12)
+                .line(toString(item.category));
+        }
+        screen.rule('=', 70);
+        screen.flush(os);
+    }
+
+    static void menuByCategory(MenuCategory category, const vector<MenuRow>& items, ostream& os = cout) {
+        ScreenBuffer screen(screenBytes(items.size(), 60));
+        screen.line().rule('=', 60).cell(toString(category)).line(" MENU").rule('=', 60);
+        screen.cell("Menu ID", 10).cell("Item Name", 25).cell("Price (RM)", 12).line("Status");
+        screen.rule('-', 60);
+
+        for (const MenuRow& item : items) {
+            screen.cell(item.menuID, 10).cell(item.name, 25).money(item.price, 12)
+                .line(toString(item.availability));
+        }
+        if (items.empty()) {
+            screen.line("No items found in this category.");
+        }
+        screen.rule('=', 60);
+        screen.flush(os);
+    }
+
+    static void searchResults(const string& searchTerm, const vector<MenuSearchEntry>& items,
+        ostream& os = cout) {
+        ScreenBuffer screen(screenBytes(items.size(), 75));
+        screen.line().rule('=', 75).cell("SEARCH RESULTS FOR: ").line(searchTerm).rule('=', 75);
+
+        for (const MenuSearchEntry& item : items) {
+            screen.cell(item.menuID, 10).cell(item.name, 25).cell("RM ").money(item.price, 10)
+                .cell(toString(item.category), 12).line(toString(item.availability));
+        }
+        if (items.empty()) {
+            screen.cell("No items found matching '").cell(searchTerm).line("'");
+        }
+        screen.rule('=', 75);
+        screen.flush(os);
+    }
+
+    static void tables(const vector<TableRow>& tables, ostream& os = cout) {
+        ScreenBuffer screen(screenBytes(tables.size(), 60));
+        screen.line().rule('=', 60).line("RESTAURANT TABLES").rule('=', 60);
+        screen.cell("Table ID", 12).cell("Table Number", 15).cell("Capacity", 12).line("Status");
+        screen.rule('-', 60);
+
+        for (const TableRow& table : tables) {
+            screen.cell(table.tableID, 12).cell(table.tableNumber, 15).number(table.capacity, 12)
+                .line(toString(table.status));
+        }
+        screen.rule('=', 60);
+        screen.flush(os);
+    }
+
+    static void tablesByStatus(TableStatus status, const vector<TableRow>& tables, ostream& os = cout) {
+        ScreenBuffer screen(screenBytes(tables.size(), 50));
+        screen.line().rule('=', 50).cell(toString(status)).line(" TABLES").rule('=', 50);
+        screen.cell("Table ID", 12).cell("Table Number", 15).line("Capacity");
+        screen.rule('-', 50);
+
+        for (const TableRow& table : tables) {
+            screen.cell(table.tableID, 12).cell(table.tableNumber, 15).number(table.capacity).line();
+        }
+        if (tables.empty()) {
+            screen.cell("No ").cell(toString(status)).line(" tables found.");
+        }
+        screen.rule('=', 50);
+        screen.flush(os);
+    }
+
+    static void staff(const vector<StaffRow>& staff, ostream& os = cout) {
+        ScreenBuffer screen(screenBytes(staff.size(), 90));
+        screen.line().rule('=', 90).line("STAFF LIST").rule('=', 90);
+        screen.cell("Staff ID", 12).cell("Name", 20).cell("Email", 28).cell("Address", 20).line("Status");
+        screen.rule('-', 90);
+
+        for (const StaffRow& member : staff) {
+            screen.cell(member.staffID, 12).cell(member.name, 20).cell(member.email, 28)
+                .cell(member.address, 20).line(toString(member.status));
+        }
+        screen.rule('=', 90);
+        screen.flush(os);
+    }
+
+    static void activeStaff(const vector<StaffRow>& staff, ostream& os = cout) {
+        ScreenBuffer screen(screenBytes(staff.size(), 60));
+        screen.line().rule('=', 60).line("ACTIVE STAFF").rule('=', 60);
+        screen.cell("Staff ID", 12).cell("Name", 20).line("Email");
+        screen.rule('-', 60);
+
+        for (const StaffRow& member : staff) {
+            screen.cell(member.staffID, 12).cell(member.name, 20).line(member.email);
+        }
+        screen.rule('=', 60);
+        screen.flush(os);
+    }
+
+    static void admins(const vector<AdminRow>& admins, ostream& os = cout) {
+        ScreenBuffer screen(screenBytes(admins.size(), 80));
+        screen.line().rule('=', 80).line("ADMIN LIST").rule('=', 80);
+        screen.cell("Admin ID", 12).cell("Name", 25).cell("Email", 30).line("Address");
+        screen.rule('-', 80);
+
+        for (const AdminRow& admin : admins) {
+            screen.cell(admin.adminID, 12).cell(admin.name, 25).cell(admin.email, 30).line(admin.address);
+        }
+        screen.rule('=', 80);
+        screen.flush(os);
+    }
+
+    static void dailySalesReport(const DailySalesSummary& summary, ostream& os = cout) {
+        ScreenBuffer screen(screenBytes(0, 50));
+        screen.line().rule('=', 50).cell("DAILY SALES REPORT - ").line(summary.date).rule('=', 50);
+        screen.cell("Total Bills Processed: ").number(summary.totalBills).line();
+        screen.cell("Total Revenue: RM ").money(summary.totalRevenue).line();
+        screen.rule('=', 50);
+        screen.flush(os);
+    }
+
+    static void dailySales(const vector<DailySalesRow>& days, ostream& os = cout) {
+        ScreenBuffer screen(screenBytes(days.size(), 50));
+        screen.line().rule('=', 50).line("DAILY SALES HISTORY").rule('=', 50);
+        screen.cell("Sales ID", 15).cell("Date", 15).line("Total (RM)");
+        screen.rule('-', 50);
+
+        double grandTotal = 0;
+        for (const DailySalesRow& day : days) {
+            grandTotal += day.dailyTotal;
+            screen.cell(day.salesID, 15).cell(formatDate(day.salesDate), 15).money(day.dailyTotal).line();
+        }
+        screen.rule('-', 50);
+        screen.cell("GRAND TOTAL:", 30).money(grandTotal).line();
+        screen.rule('=', 50);
+        screen.flush(os);
+    }
+
+    // One line per period with a bar scaled to the best one
+    static void salesTrend(const vector<SalesBucket>& buckets, int bucketMinutes, ostream& os = cout) {
+        ScreenBuffer screen(screenBytes(buckets.size(), 80));
+        screen.line().rule('=', 80).line("SALES TREND").rule('=', 80);
+        screen.cell("Period", 18).cell("Revenue (RM)", 14).cell("Bills", 8).cell("Items", 8).line("Trend");
+        screen.rule('-', 80);
+
+        long long peak = 0;
+        SalesBucket total;
+        for (const SalesBucket& bucket : buckets) {
+            peak = max(peak, bucket.revenueCents);
+            total.revenueCents += bucket.revenueCents;
+            total.bills += bucket.bills;
+            total.items += bucket.items;
+        }
+        // Days and longer show the date only
+        size_t labelLength = bucketMinutes % 1440 == 0 ? 10 : 16;
+        for (const SalesBucket& bucket : buckets) {
+            size_t bar = peak > 0 && bucket.revenueCents > 0 ? (size_t)(bucket.revenueCents * 30 / peak) : 0;
+            screen.cell(formatDateTime(bucket.start).substr(0, labelLength), 18)
+                .money(bucket.revenueCents / 100.0, 14).number((long long)bucket.bills, 8)
+                .number((long long)bucket.items, 8).line(string(bar, '#'));
+        }
+        screen.rule('-', 80);
+        screen.cell("TOTAL:", 18).money(total.revenueCents / 100.0, 14).number((long long)total.bills, 8)
+            .number((long long)total.items, 8).line();
+        screen.rule('=', 80);
+        screen.flush(os);
+    }
+
+    static void orderDetails(const OrderAggregate& details, ostream& os = cout) {
+        const OrderRow& order = details.order;
+        ScreenBuffer screen(screenBytes(details.items.size(), 60));
+        screen.line().rule('=', 60).line("ORDER DETAILS").rule('=', 60);
+        screen.cell("Order ID: ").line(order.orderID);
+        screen.cell("Table: ").line(order.tableNumber);
+        screen.cell("Staff: ").line(order.staffName);
+        screen.cell("Date: ").line(formatDateTime(order.orderDate));
+        screen.cell("Status: ").line(toString(order.status));
+        screen.rule('-', 60);
+
+        screen.cell("Item ID", 12).cell("Menu Item", 25).cell("Qty", 8).cell("Price", 12).line("Total");
+        screen.rule('-', 60);
+        for (const OrderItemRow& item : details.items) {
+            screen.cell(item.orderItemID, 12).cell(item.menuName, 25).number(item.quantity, 8)
+                .cell("RM ").money(item.unitPrice, 8).cell("RM ").money(item.total).line();
+        }
+
+        screen.rule('-', 60);
+        screen.rightCell("ORDER TOTAL: RM ", 48).money(order.totalAmount).line();
+        screen.rule('=', 60);
+        screen.flush(os);
+    }
+
+    static void activeOrders(const vector<OrderRow>& orders, ostream& os = cout) {
+        ScreenBuffer screen(screenBytes(orders.size(), 75));
+        screen.line().rule('=', 75).line("ACTIVE ORDERS").rule('=', 75);
+        screen.cell("Order ID", 15).cell("Table", 10).cell("Staff", 20).cell("Amount (RM)", 15).line("Date");
+        screen.rule('-', 75);
+
+        for (const OrderRow& order : orders) {
+            screen.cell(order.orderID, 15).cell(order.tableNumber, 10).cell(order.staffName, 20)
+                .money(order.totalAmount, 15).line(formatDateTime(order.orderDate));
+        }
+        if (orders.empty()) {
+            screen.line("No active orders found.");
+        }
+        screen.rule('=', 75);
+        screen.flush(os);
+    }
+
+    static void allOrders(const vector<OrderRow>& orders, ostream& os = cout) {
+        ScreenBuffer screen(screenBytes(orders.size(), 90));
+        screen.line().rule('=', 90).line("ALL ORDERS").rule('=', 90);
+        screen.cell("Order ID", 15).cell("Table", 8).cell("Staff", 18).cell("Amount", 12).cell("Status", 12)
+            .line("Date");
+        screen.rule('-', 90);
+
+        for (const OrderRow& order : orders) {
+            screen.cell(order.orderID, 15).cell(order.tableNumber, 8).cell(order.staffName, 18)
+                .cell("RM ").money(order.totalAmount, 9).cell(toString(order.status), 12)
+                .line(formatDateTime(order.orderDate));
+        }
+        screen.rule('=', 90);
+        screen.flush(os);
+    }
+
+    static void billDetails(const OrderAggregate& details, ostream& os = cout) {
+        const BillRow& bill = details.bill;
+        ScreenBuffer screen(screenBytes(details.items.size(), 60));
+        screen.line().rule('=', 60).line("                      BILL").rule('=', 60);
+        screen.cell("Bill ID: ").line(bill.billID);
+        screen.cell("Order ID: ").line(bill.orderID);
+        screen.cell("Table: ").line(details.order.tableNumber);
+        screen.cell("Staff: ").line(bill.staffName);
+        screen.cell("Date: ").line(formatDateTime(bill.billDate));
+        screen.rule('-', 60);
+
+        screen.cell("Item", 28).cell("Qty", 6).cell("Price", 12).line("Total");
+        screen.rule('-', 60);
+        for (const OrderItemRow& item : details.items) {
+            screen.cell(item.menuName, 28).number(item.quantity, 6)
+                .cell("RM ").money(item.unitPrice, 8).cell("RM ").money(item.total).line();
+        }
+
+        screen.rule('-', 60);
+        screen.rightCell("TOTAL: RM ", 48).money(bill.total).line();
+        screen.rule('-', 60);
+        screen.cell("Payment Method: ").line(toString(bill.paymentMethod));
+        screen.cell("Payment Status: ").line(toString(bill.paymentStatus));
+        screen.rule('=', 60);
+        screen.line("           Thank you for dining with us!");
+        screen.rule('=', 60);
+        screen.flush(os);
+    }
+
+    static void bills(const vector<BillRow>& bills, ostream& os = cout) {
+        ScreenBuffer screen(screenBytes(bills.size(), 95));
+        screen.line().rule('=', 95).line("ALL BILLS").rule('=', 95);
+        screen.cell("Bill ID", 12).cell("Order ID", 12).cell("Staff", 18).cell("Total", 12).cell("Method", 12)
+            .cell("Status", 10).line("Date");
+        screen.rule('-', 95);
+
+        for (const BillRow& bill : bills) {
+            screen.cell(bill.billID, 12).cell(bill.orderID, 12).cell(bill.staffName, 18)
+                .cell("RM ").money(bill.total, 8).cell(toString(bill.paymentMethod), 12)
+                .cell(toString(bill.paymentStatus), 10).line(formatDateTime(bill.billDate));
+        }
+        screen.rule('=', 95);
+        screen.flush(os);
+    }
+
+    static void unpaidBills(const vector<UnpaidBillRow>& bills, ostream& os = cout) {
+        ScreenBuffer screen(screenBytes(bills.size(), 60));
+        screen.line().rule('=', 60).line("UNPAID BILLS").rule('=', 60);
+        screen.cell("Bill ID", 12).cell("Order ID", 12).cell("Table", 10).cell("Amount", 14)
+            .line("Payment Method");
+        screen.rule('-', 60);
+
+        double totalUnpaid = 0;
+        for (const UnpaidBillRow& bill : bills) {
+            totalUnpaid += bill.total;
+            screen.cell(bill.billID, 12).cell(bill.orderID, 12).cell(bill.tableNumber, 10)
+                .cell("RM ").money(bill.total, 10).line(toString(bill.paymentMethod));
+        }
+        if (bills.empty()) {
+            screen.line("No unpaid bills.");
+        }
+        else {
+            screen.rule('-', 60);
+            screen.cell("Total Unpaid: RM ").money(totalUnpaid).line();
+        }
+        screen.rule('=', 60);
+        screen.flush(os);
+    }
+
+    static void unpaidOrders(const vector<UnpaidOrderRow>& orders, ostream& os = cout) {
+        ScreenBuffer screen(screenBytes(orders.size(), 70));
+        screen.line().rule('=', 70).line("UNPAID ORDERS").rule('=', 70);
+        screen.cell("Order ID", 12).cell("Table #", 10).cell("Staff", 18).cell("Amount (RM)", 15)
+            .line("Order Date");
+        screen.rule('-', 70);
+
+        double totalUnpaid = 0;
+        for (const UnpaidOrderRow& order : orders) {
+            totalUnpaid += order.amount;
+            screen.cell(order.orderID, 12).cell(order.tableNumber, 10).cell(order.staffName, 18)
+                .cell("RM ").money(order.amount, 12).line(formatDateTime(order.orderDate));
+        }
+        if (orders.empty()) {
+            screen.line("All orders are paid! No unpaid bills.");
+        }
+        else {
+            screen.rule('-', 70);
+            screen.cell("Total Unpaid Amount:", 42).cell("RM ").money(totalUnpaid).line();
+            screen.cell("Number of Unpaid Orders:", 42).number((long long)orders.size()).line();
+        }
+        screen.rule('=', 70);
+        screen.flush(os);
+    }
+};
@@ -0,0 +1,142 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <istream>
+#include <cstring>
+
+using namespace std;
+
+// Streaming CSV reader (RFC 4180: comma separated, optional double quotes,
+// "" inside quotes for a literal quote, CRLF or LF line ends).
+//
+// The input is read in fixed-size chunks. Fields are string_views into the
+// chunk buffer, so nothing is copied per field; quoted fields are unescaped
+// in place. The views stay valid until the next call to next().
+//
+//   CsvReader reader(file);
+//   const vector<string_view>* fields;
+//   while ((fields = reader.next()) != nullptr) { ... reader.lineNumber() ... }
+class CsvReader {
+private:
+    istream& in;
+    vector<char> buffer;
+    size_t begin = 0;          // start of the unparsed data
+    size_t end = 0;            // end of valid data
+    bool eof = false;
+    size_t line = 0;           // first line of the current record
+    size_t nextLine = 1;
+    vector<string_view> fields;
+    string errorText;
+
+    bool fill() {
+        if (eof) return false;
+        // Move the partial record to the front, grow if a single record fills the buffer
+        if (begin > 0) {
+            memmove(buffer.data(), buffer.data() + begin, end - begin);
+            end -= begin;
+            begin = 0;
+        }
+        if (end == buffer.size()) buffer.resize(buffer.size() * 2);
+        in.read(buffer.data() + end, (streamsize)(buffer.size() - end));
+        streamsize got = in.gcount();
+        if (got <= 0) {
+            eof = true;
+            return false;
+        }
+        end += (size_t)got;
+        return true;
+    }
+
+    // Find the end of the record starting at begin (the offset of its '\n',
+    // or end at end of input). Returns false if more data is needed.
+    bool findRecordEnd(size_t& stop, size_t& newlines, bool& unterminated) {
+        const char* data = buffer.data();
+        bool quoted = false;
+        newlines = 0;
+        for (size_t i = begin; i < end; i++) {
+            if (data[i] == '"') quoted = !quoted;   // "" toggles twice
+            else if (data[i] == '\n') {
+                newlines++;
+                if (!quoted) {
+                    stop = i;
+                    return true;
+                }
+            }
+        }
+        if (!eof) return false;
+        stop = end;
+        unterminated = quoted;
+        return true;
+    }
+
+    // Split [begin, stop) into fields. Quoted fields are unescaped in place.
+    void splitRecord(size_t stop) {
+        fields.clear();
+        char* data = buffer.data();
+        if (stop > begin && data[stop - 1] == '\r') stop--;
+        size_t i = begin;
+        while (true) {
+            if (i < stop && data[i] == '"') {
+                size_t read = i + 1;
+                size_t write = i;
+                while (read < stop) {
+                    if (data[read] == '"') {
+                        if (read + 1 < stop && data[read + 1] == '"') {
+                            data[write++] = '"';
+                            read += 2;
+                            continue;
+                        }
+                        read++;
+                        break;
+                    }
+                    data[write++] = data[read++];
+                }
+                fields.emplace_back(data + i, write - i);
+                i = read;
+                // Anything between the closing quote and the separator is dropped
+                while (i < stop && data[i] != ',') i++;
+            }
+            else {
+                size_t start = i;
+                while (i < stop && data[i] != ',') i++;
+                fields.emplace_back(data + start, i - start);
+            }
+            if (i >= stop) return;
+            i++;   // ','
+        }
+    }
+
+public:
+    CsvReader(istream& input, size_t chunkSize = 1 << 16) : in(input), buffer(chunkSize) {}
+
+    // Next non-empty record, or nullptr at end of input
+    const vector<string_view>* next() {
+        while (true) {
+            if (begin >= end && !fill()) return nullptr;
+
+            size_t stop = 0;
+            size_t newlines = 0;
+            bool unterminated = false;
+            while (!findRecordEnd(stop, newlines, unterminated)) {
+                fill();
+            }
+            if (unterminated) errorText = "unterminated quoted field";
+
+            splitRecord(stop);
+            line = nextLine;
+            nextLine += newlines;
+            begin = stop < end ? stop + 1 : end;
+
+            bool blank = fields.size() == 1 && fields[0].empty();
+            if (!blank) return &fields;
+        }
+    }
+
+    // Line number where the last returned record starts (1-based)
+    size_t lineNumber() const { return line; }
+
+    // Set when the input ended inside a quoted field (the last record is
+    // still returned with what was read)
+    const string& error() const { return errorText; }
+};
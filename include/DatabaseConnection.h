@@ -5,12 +5,64 @@
 #include <cppconn/prepared_statement.h>
 #include <cppconn/resultset.h>
 #include <cppconn/exception.h>
+#include "Tracing.h"
+#include "Metrics.h"
+#include "CancellationToken.h"
 #include <memory>
 #include <iostream>
 #include <string>
+#include <map>
+#include <vector>
+#include <chrono>
+#include <functional>
 
 using namespace std;
 
+// Statement totals for one named business operation, collected by QueryTracker
+struct OperationQueryStats {
+    unsigned long long calls = 0;
+    unsigned long long statements = 0;
+    unsigned long long maxStatements = 0;
+};
+
+// Totals for one named transaction, collected by DatabaseConnection::transaction
+struct TransactionStats {
+    unsigned long long calls = 0;
+    unsigned long long committed = 0;
+    unsigned long long rolledBack = 0;       // the body returned false
+    unsigned long long failed = 0;           // ended by an error, after any retries
+    unsigned long long retries = 0;
+    unsigned long long deadlocks = 0;        // error 1213
+    unsigned long long lockWaitTimeouts = 0; // error 1205
+    double totalMs = 0;                      // including retries and backoff
+    double maxMs = 0;
+};
+
+enum class IsolationLevel {
+    ServerDefault,
+    ReadUncommitted,
+    ReadCommitted,
+    RepeatableRead,
+    Serializable,
+};
+
+// How DatabaseConnection::transaction runs its body
+struct TransactionOptions {
+    IsolationLevel isolation = IsolationLevel::ServerDefault;
+    int maxAttempts = 4;                                  // first try included
+    chrono::milliseconds baseBackoff{ 20 };               // doubled per retry, with full jitter
+    chrono::milliseconds maxBackoff{ 500 };
+};
+
+// Limits for one report query. The timeout is enforced by the server
+// (MAX_EXECUTION_TIME on MySQL, max_statement_time on MariaDB; SELECTs
+// only); cancelling the token stops the running statement with KILL QUERY
+// from a second connection.
+struct QueryOptions {
+    chrono::milliseconds timeout{ 0 };   // 0 = no limit
+    CancellationToken cancel;
+};
+
 class DatabaseConnection {
 private:
     sql::mysql::MySQL_Driver* driver;
@@ -19,10 +71,36 @@ private:
     string username = "root";
     string password = "";  // Change if you have a MySQL password
     string database = "restaurant_management";
+    bool verbose;
+    bool throwErrors = false;
+    bool interrupted = false;             // last statement timed out or was killed
+    bool lost = false;                    // the server went away; see reconnect()
+    bool inTransaction = false;           // inside transaction()'s body
+    int nestedFailure = 0;                // 1213/1205 a nested transaction() rethrew
+    vector<function<void()>> onCommit;    // afterCommit actions of the current attempt
+    long long connectionID = -1;          // server thread ID, read when first needed
+    bool mariaDB = false;                 // the server is MariaDB (read with connectionID)
+    unsigned long long statementCount = 0;
+    map<string, OperationQueryStats> operationStats;
+    map<string, TransactionStats> transactionStats;
+
+    // Read-only endpoint for reports (see reportConnection)
+    string replicaServer;
+    int replicaMaxLag = 5;
+    unique_ptr<DatabaseConnection> replica;
+    bool replicaUsable = false;
+    chrono::steady_clock::time_point replicaCheckedAt;
+    chrono::steady_clock::time_point replicaConnectTriedAt;
+
+    bool checkReplica();
+    void loadServerInfo();
+
+    friend class CancelScope;
 
 public:
-    // Constructor
-    DatabaseConnection();
+    // Constructor (verbose = false keeps connect/disconnect messages quiet,
+    // used when a tool opens many connections)
+    DatabaseConnection(bool verboseOutput = true);
 
     // Destructor
     ~DatabaseConnection();
@@ -33,6 +111,39 @@ public:
     // Disconnect from database
     void disconnect();
 
+    // Connect again after the server went away, without connect()'s
+    // troubleshooting output. Returns true once connected.
+    bool reconnect();
+
+    // True from the first statement that failed because the server was
+    // unreachable or dropped the connection until reconnect() succeeds
+    bool connectionLost() const;
+
+    // Server to connect to (default tcp://127.0.0.1:3306)
+    void setServer(const string& url);
+
+    // Send report and listing queries to a read-only server at url while it
+    // is no more than maxLagSeconds behind its source (-1 = trust it without
+    // checking, e.g. a restored copy that does not replicate)
+    void setReplica(const string& url, int maxLagSeconds);
+
+    // The connection report and listing queries should use: the replica
+    // while it is reachable and fresh enough, otherwise this one. Without a
+    // replica it is always this one.
+    DatabaseConnection& reportConnection();
+
+    // Run a report or listing SELECT on reportConnection(), and on this
+    // connection if the replica fails it
+    unique_ptr<sql::ResultSet> executeReport(const string& query);
+
+    // executeReport within options' limits. A report that timed out or
+    // was cancelled on the replica is not run again on this connection.
+    unique_ptr<sql::ResultSet> executeReport(const string& query, const QueryOptions& options);
+
+    // Seconds this server is behind its replication source, or -1 if it is
+    // not replicating (or the lag is unknown)
+    int replicationLag();
+
     // Check if connected
     bool isConnected();
 
@@ -42,12 +153,137 @@ public:
     // Execute query (SELECT)
     unique_ptr<sql::ResultSet> executeQuery(const string& query);
 
+    // Execute a SELECT within options' limits (nullptr if it failed, timed
+    // out or was cancelled)
+    unique_ptr<sql::ResultSet> executeQuery(const string& query, const QueryOptions& options);
+
+    // True if the last failed statement timed out or was cancelled rather
+    // than hitting an error
+    bool lastQueryInterrupted() const;
+
+    // Stop the statement this connection is running by sending KILL QUERY
+    // from a short-lived second connection. Safe to call from any thread;
+    // returns false if the kill could not be sent.
+    bool killRunningQuery();
+
+    // query limited to timeout by the server: a MAX_EXECUTION_TIME hint
+    // after its SELECT keyword on MySQL, SET STATEMENT max_statement_time
+    // ... FOR on MariaDB, which ignores the hint (unchanged for a zero
+    // timeout or a statement that is not a SELECT)
+    string withTimeLimit(const string& query, chrono::milliseconds timeout);
+
+    // True if e is the server reporting a statement that exceeded its time
+    // limit (3024 on MySQL, 1969 on MariaDB) or was killed (1317)
+    static bool isInterrupted(const sql::SQLException& e);
+
+    // Print the one-line notice for such a statement and count it
+    static void reportInterrupted(const sql::SQLException& e);
+
+    // True if e means the server cannot be reached (2002, 2003) or dropped
+    // the connection (2006, 2013, 2055)
+    static bool isConnectionError(const sql::SQLException& e);
+
     // Execute update (INSERT, UPDATE, DELETE)
     int executeUpdate(const string& query);
 
+    // Run body in one transaction named name: commit if it returns true,
+    // roll back if it returns false. Statements inside throw
+    // sql::SQLException instead of printing. A deadlock (1213) or lock
+    // wait timeout (1205) rolls back and runs body again after a jittered
+    // backoff, up to options.maxAttempts times, so body must not print or
+    // count anything before it returns. Any other error, or the last
+    // retryable one, is rethrown after the rollback; so is any other
+    // exception body throws, with the connection back in autocommit and
+    // the caller's error mode. Called inside another
+    // transaction's body it simply runs body as part of that transaction;
+    // a deadlock or lock wait timeout there still restarts the outermost
+    // transaction, even if the caller catches the rethrown error.
+    //
+    //   string orderID;
+    //   if (db.transaction("createOrder", [&]() {
+    //       ... SELECT ... FOR UPDATE, checks, INSERT ...
+    //       return true;
+    //   })) db.afterCommit([=]() { cout << "[SUCCESS] ..." << endl; });
+    bool transaction(const string& name, const function<bool()>& body,
+        const TransactionOptions& options = TransactionOptions());
+
+    // Run action (a success message, a metric) once the outermost
+    // transaction commits, or at once outside a transaction. A module
+    // write called inside another transaction's body reports through this,
+    // so an attempt that is retried or rolled back reports nothing.
+    void afterCommit(function<void()> action);
+
+    // True inside a transaction() body
+    bool insideTransaction() const;
+
+    // Totals per transaction name since the last reset
+    const map<string, TransactionStats>& getTransactionStats() const;
+    void resetTransactionStats();
+
     // Get prepared statement
     unique_ptr<sql::PreparedStatement> prepareStatement(const string& query);
 
+    // Rethrow sql::SQLException from executeQuery, executeUpdate and
+    // prepareStatement instead of printing it and returning nullptr / -1
+    // (used by connections owned by worker threads)
+    void setThrowOnError(bool enabled);
+
+    // Number of statements issued through this connection so far: each
+    // executeQuery, executeUpdate, prepareStatement and transaction control
+    // statement counts once. A prepared statement counts when it is
+    // prepared, not each time it is executed, so a loop that executes one
+    // statement many times counts as one.
+    unsigned long long getStatementCount() const;
+
+    // Statement totals per operation, filled in as QueryTrackers finish
+    void recordOperation(const string& operation, unsigned long long statements);
+    const map<string, OperationQueryStats>& getOperationStats() const;
+    void resetOperationStats();
+
     // Test connection with sample queries
     bool testConnection();
-};
\ No newline at end of file
+};
+
+// Kills the statement db is running if token is cancelled while the scope
+// is alive. Throws sql::SQLException (error 1317, as if killed) when the
+// token is already cancelled, so no new statement is started.
+//
+//   auto pstmt = db.prepareStatement(db.withTimeLimit(sql, options.timeout));
+//   CancelScope scope(db, options.cancel);
+//   unique_ptr<sql::ResultSet> res(pstmt->executeQuery());
+class CancelScope {
+private:
+    CancellationToken::Registration registration;
+
+    static CancellationToken::Registration watch(DatabaseConnection& db, CancellationToken& token);
+
+public:
+    CancelScope(DatabaseConnection& db, CancellationToken token);
+
+    CancelScope(const CancelScope&) = delete;
+    CancelScope& operator=(const CancelScope&) = delete;
+};
+
+// Counts the statements a logical business operation issues through a
+// connection (see getStatementCount for what counts). Trackers nest, so a composite flow and each step inside it
+// can be measured at the same time.
+//
+//   QueryTracker tracker(db, "OrderModule::createOrder");
+//   orderModule->createOrder(tableID, staffID);
+//   tracker.count();  // statements so far
+class QueryTracker {
+private:
+    DatabaseConnection& db;
+    string operation;
+    unsigned long long start;
+
+public:
+    QueryTracker(DatabaseConnection& database, const string& operationName);
+    ~QueryTracker();
+
+    QueryTracker(const QueryTracker&) = delete;
+    QueryTracker& operator=(const QueryTracker&) = delete;
+
+    // Statements issued since the tracker was created
+    unsigned long long count() const;
+};
@@ -0,0 +1,444 @@
+#pragma once
+#include "DatabaseConnection.h"
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <ctime>
+#include <cstdio>
+#include <cstdint>
+
+using namespace std;
+
+// Settings for --generate-fixtures, given as key=value arguments
+struct FixtureConfig {
+    int years = 3;               // history length, ending at endDate
+    long long orders = 0;        // total orders; overrides ordersPerDay when set
+    int ordersPerDay = 300;      // average orders per day
+    int maxItems = 6;            // order lines per order (1..maxItems)
+    double cancelRate = 0.03;    // share of orders cancelled (no bill)
+    int writers = 4;             // parallel connections
+    int batchRows = 1000;        // rows per multi-row INSERT
+    int chunkDays = 7;           // days per writer transaction
+    unsigned long long seed = 42;
+    string endDate;              // YYYY-MM-DD, default today
+
+    bool set(const string& key, const string& value) {
+        if (key == "years") years = atoi(value.c_str());
+        else if (key == "orders") orders = atoll(value.c_str());
+        else if (key == "perday") ordersPerDay = atoi(value.c_str());
+        else if (key == "items") maxItems = atoi(value.c_str());
+        else if (key == "cancel") cancelRate = atof(value.c_str());
+        else if (key == "writers") writers = atoi(value.c_str());
+        else if (key == "batch") batchRows = atoi(value.c_str());
+        else if (key == "chunk") chunkDays = atoi(value.c_str());
+        else if (key == "seed") seed = strtoull(value.c_str(), nullptr, 10);
+        else if (key == "end") endDate = value;
+        else return false;
+        return true;
+    }
+
+    bool valid() const {
+        return years > 0 && ordersPerDay > 0 && maxItems > 0 && writers > 0
+            && batchRows > 0 && chunkDays > 0 && cancelRate >= 0 && cancelRate <= 1;
+    }
+};
+
+// Generates years of internally consistent order history: Orders,
+// Order_Item, Bill and Daily_Sells, written by parallel writers through
+// multi-row INSERTs. Every day is generated from its own seed, so a day's
+// orders, line items and bills can be produced by whichever writer picks
+// it up, and IDs follow from per-day counts computed up front.
+//
+// Rows are written in the order Order_Item, Bill, Orders with foreign key
+// checks off for the writer sessions. The order-total trigger on
+// Order_Item then finds no order to update, and Orders is inserted with
+// its final total instead of being updated once per line.
+//
+// IDs continue from the current maximum and keep the modules' formats
+// (ORD%06d, ORI%06d, BIL%06d); beyond a million rows they simply grow a
+// digit, so the ID columns must be wide enough for the volume generated.
+class FixtureGenerator {
+private:
+    struct MenuEntry {
+        string menuID;
+        long long priceCents;
+    };
+
+    struct DayCounts {
+        long long orders = 0;
+        long long items = 0;
+        long long bills = 0;
+    };
+
+    DatabaseConnection& db;
+    FixtureConfig config;
+    vector<string> tableIDs;
+    vector<string> staffIDs;
+    vector<MenuEntry> menu;
+    long long firstDay = 0;      // days since 1970-01-01
+    int dayCount = 0;
+    vector<DayCounts> counts;    // per day
+    vector<DayCounts> offsets;   // per day, first ID number of each kind
+    atomic<int> nextChunk;
+    atomic<bool> failed;
+    atomic<long long> rowsWritten;
+
+    // Howard Hinnant's civil calendar conversions
+    static long long daysFromCivil(long long y, unsigned m, unsigned d) {
+        y -= m <= 2;
+        long long era = (y >= 0 ? y : y - 399) / 400;
+        unsigned yoe = (unsigned)(y - era * 400);
+        unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+        unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        return era * 146097 + (long long)doe - 719468;
+    }
+
+    static void civilFromDays(long long z, int& y, unsigned& m, unsigned& d) {
+        z += 719468;
+        long long era = (z >= 0 ? z : z - 146096) / 146097;
+        unsigned doe = (unsigned)(z - era * 146097);
+        unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+        long long yy = (long long)yoe + era * 400;
+        unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+        unsigned mp = (5 * doy + 2) / 153;
+        d = doy - (153 * mp + 2) / 5 + 1;
+        m = mp + (mp < 10 ? 3 : -9);
+        y = (int)(yy + (m <= 2));
+    }
+
+    static string formatDate(long long day) {
+        int y;
+        unsigned m, d;
+        civilFromDays(day, y, m, d);
+        char buffer[12];
+        snprintf(buffer, sizeof(buffer), "%04d-%02u-%02u", y, m, d);
+        return string(buffer);
+    }
+
+    static string formatDateTime(long long day, int minuteOfDay) {
+        char buffer[24];
+        snprintf(buffer, sizeof(buffer), "%s %02d:%02d:00",
+            formatDate(day).c_str(), minuteOfDay / 60, minuteOfDay % 60);
+        return string(buffer);
+    }
+
+    static string formatID(const char* prefix, long long number) {
+        char buffer[24];
+        snprintf(buffer, sizeof(buffer), "%s%06lld", prefix, number);
+        return string(buffer);
+    }
+
+    static void appendMoney(string& out, long long cents) {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%lld.%02lld", cents / 100, cents % 100);
+        out += buffer;
+    }
+
+    // Shape of a day (order count, lines per order, cancellations) comes from
+    // its own generator so the counting pass and the writing pass agree.
+    mt19937_64 shapeRng(int dayIndex) const {
+        return mt19937_64(config.seed * 0x9E3779B97F4A7C15ULL + (unsigned long long)dayIndex * 2 + 1);
+    }
+
+    mt19937_64 detailRng(int dayIndex) const {
+        return mt19937_64(config.seed * 0xC2B2AE3D27D4EB4FULL + (unsigned long long)dayIndex * 2);
+    }
+
+    long long ordersForDay(int dayIndex, mt19937_64& rng) const {
+        // Weekends are busier than Mondays; +/-20% noise on top
+        static const double weekdayFactor[] = { 1.05, 1.35, 1.45, 1.2, 0.75, 0.85, 0.9 }; // Thu..Wed
+        long long day = firstDay + dayIndex;
+        double factor = weekdayFactor[((day % 7) + 7) % 7];
+        double noise = 0.8 + (rng() % 4001) / 10000.0;
+        return max(1LL, (long long)(config.ordersPerDay * factor * noise));
+    }
+
+    int itemsForOrder(mt19937_64& rng) const {
+        return 1 + (int)(rng() % config.maxItems);
+    }
+
+    bool isCancelled(mt19937_64& rng) const {
+        return (rng() % 1000000) < (unsigned long long)(config.cancelRate * 1000000);
+    }
+
+    // Lunch and dinner peaks between 10:00 and 23:30
+    static int orderMinute(mt19937_64& rng) {
+        bool lunch = rng() % 10 < 4;
+        normal_distribution<double> dist(lunch ? 750.0 : 1170.0, lunch ? 45.0 : 60.0);
+        int minute = (int)dist(rng);
+        return minute < 600 ? 600 : (minute > 1350 ? 1350 : minute);
+    }
+
+    bool loadReferenceData() {
+        auto tables = db.executeQuery("SELECT TableID FROM Tables ORDER BY TableID");
+        if (tables) while (tables->next()) tableIDs.push_back(tables->getString(1));
+
+        auto staff = db.executeQuery("SELECT StaffID FROM Staff WHERE Status = 'Active' ORDER BY StaffID");
+        if (staff) while (staff->next()) staffIDs.push_back(staff->getString(1));
+
+        auto items = db.executeQuery("SELECT MenuID, Price FROM Menu ORDER BY MenuID");
+        if (items) {
+            while (items->next()) {
+                MenuEntry entry;
+                entry.menuID = items->getString(1);
+                entry.priceCents = (long long)(items->getDouble(2) * 100 + 0.5);
+                menu.push_back(entry);
+            }
+        }
+
+        if (tableIDs.empty() || staffIDs.empty() || menu.empty()) {
+            cerr << "[FAILED] Fixtures need at least one table, active staff member and menu item." << endl;
+            return false;
+        }
+        return true;
+    }
+
+    long long currentMax(const string& column, const string& table) {
+        auto res = db.executeQuery(
+            "SELECT COALESCE(MAX(CAST(SUBSTRING(" + column + ", 4) AS UNSIGNED)), 0) FROM " + table);
+        if (res && res->next()) return res->getInt64(1);
+        return 0;
+    }
+
+    void planDays() {
+        long long endDay;
+        if (config.endDate.size() == 10) {
+            endDay = daysFromCivil(atoi(config.endDate.substr(0, 4).c_str()),
+                (unsigned)atoi(config.endDate.substr(5, 2).c_str()),
+                (unsigned)atoi(config.endDate.substr(8, 2).c_str()));
+        }
+        else {
+            endDay = (long long)(time(0) / 86400);
+        }
+        firstDay = endDay - (long long)config.years * 365 + 1;
+        dayCount = config.years * 365;
+        if (config.orders > 0) {
+            config.ordersPerDay = (int)max(1LL, config.orders / dayCount);
+        }
+
+        counts.assign(dayCount, DayCounts());
+        for (int i = 0; i < dayCount; i++) {
+            mt19937_64 rng = shapeRng(i);
+            DayCounts& c = counts[i];
+            c.orders = ordersForDay(i, rng);
+            for (long long o = 0; o < c.orders; o++) {
+                c.items += itemsForOrder(rng);
+                if (!isCancelled(rng)) c.bills++;
+            }
+        }
+
+        DayCounts next;
+        next.orders = currentMax("OrderID", "Orders") + 1;
+        next.items = currentMax("Order_itemID", "Order_Item") + 1;
+        next.bills = currentMax("BillID", "Bill") + 1;
+        offsets.assign(dayCount, DayCounts());
+        for (int i = 0; i < dayCount; i++) {
+            offsets[i] = next;
+            next.orders += counts[i].orders;
+            next.items += counts[i].items;
+            next.bills += counts[i].bills;
+        }
+    }
+
+    // Buffers one table's rows and sends them as multi-row INSERTs
+    class BatchWriter {
+    private:
+        DatabaseConnection& conn;
+        string prefix;
+        string suffix;
+        string sql;
+        int rows;
+        int batchRows;
+        atomic<long long>& written;
+
+    public:
+        BatchWriter(DatabaseConnection& connection, const string& insertPrefix, int batch,
+            atomic<long long>& counter, const string& insertSuffix = "")
+            : conn(connection), prefix(insertPrefix), suffix(insertSuffix), rows(0),
+            batchRows(batch), written(counter) {
+            sql.reserve(batch * 128);
+        }
+
+        string& row() {
+            sql += rows == 0 ? prefix : ",";
+            rows++;
+            return sql;
+        }
+
+        bool rowDone() {
+            return full() ? flush() : true;
+        }
+
+        bool full() const { return rows >= batchRows; }
+
+        bool flush() {
+            if (rows == 0) return true;
+            sql += suffix;
+            bool ok = conn.executeUpdate(sql) >= 0;
+            written += rows;
+            sql.clear();
+            rows = 0;
+            return ok;
+        }
+    };
+
+    bool writeDay(int dayIndex, BatchWriter& items, BatchWriter& bills, BatchWriter& orders,
+        BatchWriter& sales) {
+        static const char* methods[] = { "Cash", "Card", "E-Wallet" };
+        mt19937_64 shape = shapeRng(dayIndex);
+        mt19937_64 detail = detailRng(dayIndex);
+        long long day = firstDay + dayIndex;
+        DayCounts id = offsets[dayIndex];
+        long long orderCount = ordersForDay(dayIndex, shape);
+        long long dayTotalCents = 0;
+
+        for (long long o = 0; o < orderCount; o++) {
+            int lines = itemsForOrder(shape);
+            bool cancelled = isCancelled(shape);
+            string orderID = formatID("ORD", id.orders++);
+            const string& tableID = tableIDs[detail() % tableIDs.size()];
+            const string& staffID = staffIDs[detail() % staffIDs.size()];
+            int minute = orderMinute(detail);
+
+            long long orderCents = 0;
+            for (int l = 0; l < lines; l++) {
+                const MenuEntry& m = menu[detail() % menu.size()];
+                int qty = 1 + (int)(detail() % 3);
+                long long lineCents = m.priceCents * qty;
+                orderCents += lineCents;
+
+                string& row = items.row();
+                row += "('" + formatID("ORI", id.items++) + "','" + orderID + "','" + m.menuID + "',";
+                row += to_string(qty);
+                row += ',';
+                appendMoney(row, m.priceCents);
+                row += ',';
+                appendMoney(row, lineCents);
+                row += ')';
+                if (!items.rowDone()) return false;
+            }
+
+            if (!cancelled) {
+                int billMinute = min(1439, minute + 30 + (int)(detail() % 60));
+                string& row = bills.row();
+                row += "('" + formatID("BIL", id.bills++) + "','" + orderID + "','" + staffID + "','"
+                    + formatDateTime(day, billMinute) + "',";
+                appendMoney(row, orderCents);
+                row += ",'";
+                row += methods[detail() % 3];
+                row += "','Paid')";
+                if (!bills.rowDone()) return false;
+                dayTotalCents += orderCents;
+            }
+
+            string& row = orders.row();
+            row += "('" + orderID + "','" + tableID + "','" + staffID + "','"
+                + formatDateTime(day, minute) + "',";
+            appendMoney(row, orderCents);
+            row += cancelled ? ",'Cancelled')" : ",'Completed')";
+            if (orders.full() && !(items.flush() && bills.flush() && orders.flush())) return false;
+        }
+
+        string date = formatDate(day);
+        string& row = sales.row();
+        row += "('SAL" + date.substr(0, 4) + date.substr(5, 2) + date.substr(8, 2) + "','" + date + "',";
+        appendMoney(row, dayTotalCents);
+        row += ')';
+        return sales.rowDone();
+    }
+
+    void runWriter() {
+        sql::mysql::get_mysql_driver_instance()->threadInit();
+        {
+            DatabaseConnection conn(false);
+            if (!conn.connect()) {
+                failed = true;
+            }
+            else {
+                conn.executeUpdate("SET SESSION foreign_key_checks = 0");
+                conn.executeUpdate("SET SESSION unique_checks = 0");
+                BatchWriter items(conn, "INSERT INTO Order_Item "
+                    "(Order_itemID, OrderID, MenuID, Quantity, Unit_price, Total) VALUES ",
+                    config.batchRows, rowsWritten);
+                BatchWriter bills(conn, "INSERT INTO Bill "
+                    "(BillID, OrderID, StaffID, Bill_date, Total, Payment_method, Payment_status) VALUES ",
+                    config.batchRows, rowsWritten);
+                BatchWriter orders(conn, "INSERT INTO Orders "
+                    "(OrderID, TableID, StaffID, Order_date, Total_amount, Order_status) VALUES ",
+                    config.batchRows, rowsWritten);
+                BatchWriter sales(conn, "INSERT INTO Daily_Sells (SalesID, Sales_date, Daily_total) VALUES ",
+                    config.batchRows, rowsWritten,
+                    " ON DUPLICATE KEY UPDATE Daily_total = Daily_total + VALUES(Daily_total)");
+
+                int chunks = (dayCount + config.chunkDays - 1) / config.chunkDays;
+                // The writers' buffers and row counts cannot be wound back, so
+                // a lock conflict fails the run instead of writing the chunk again
+                TransactionOptions once;
+                once.maxAttempts = 1;
+                try {
+                    while (!failed) {
+                        int chunk = nextChunk++;
+                        if (chunk >= chunks) break;
+                        int from = chunk * config.chunkDays;
+                        int to = min(dayCount, from + config.chunkDays);
+                        // One transaction per chunk, rolled back if any write fails
+                        bool ok = conn.transaction("fixtureChunk", [&]() {
+                            bool written = true;
+                            for (int d = from; d < to && written; d++) {
+                                written = writeDay(d, items, bills, orders, sales);
+                            }
+                            // Parents last, so the chunk's items and bills are in before their orders
+                            return written && items.flush() && bills.flush() && orders.flush() && sales.flush();
+                        }, once);
+                        if (!ok) {
+                            failed = true;
+                            break;
+                        }
+                    }
+                }
+                catch (sql::SQLException& e) {
+                    cerr << "Fixture writer error: " << e.what() << endl;
+                    failed = true;
+                }
+            }
+        }
+        sql::mysql::get_mysql_driver_instance()->threadEnd();
+    }
+
+public:
+    FixtureGenerator(DatabaseConnection& database, const FixtureConfig& fixtureConfig)
+        : db(database), config(fixtureConfig), nextChunk(0), failed(false), rowsWritten(0) {}
+
+    bool run() {
+        if (!loadReferenceData()) return false;
+        planDays();
+
+        long long totalOrders = 0, totalItems = 0, totalBills = 0;
+        for (const DayCounts& c : counts) {
+            totalOrders += c.orders;
+            totalItems += c.items;
+            totalBills += c.bills;
+        }
+        cout << "Generating " << dayCount << " days from " << formatDate(firstDay)
+            << ": " << totalOrders << " orders, " << totalItems << " order items, "
+            << totalBills << " bills using " << config.writers << " writers..." << endl;
+
+        auto start = chrono::steady_clock::now();
+        vector<thread> writers;
+        for (int w = 0; w < config.writers; w++) {
+            writers.emplace_back(&FixtureGenerator::runWriter, this);
+        }
+        for (thread& t : writers) t.join();
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        cout << (failed ? "[FAILED] " : "[SUCCESS] ") << rowsWritten << " rows written in "
+            << fixed << setprecision(1) << seconds << "s ("
+            << setprecision(0) << (seconds > 0 ? rowsWritten / seconds : 0) << " rows/s)" << endl;
+        return !failed;
+    }
+};
@@ -0,0 +1,376 @@
+#pragma once
+#include "DatabaseConnection.h"
+#include "AdminModule.h"
+#include "StaffModule.h"
+#include "MenuModule.h"
+#include "TableModule.h"
+#include "OrderModule.h"
+#include "BillingModule.h"
+#include "Json.h"
+#include <string>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <map>
+#include <chrono>
+#include <ctime>
+
+using namespace std;
+
+// Non-interactive command mode. Reads one operation per line, either as a
+// JSON object or as a script line, runs it against the modules and writes
+// one JSON result line per operation followed by a summary line.
+//
+//   {"op":"login","role":"staff","email":"john@restaurant.com","password":"john123"}
+//   createOrder table=TBL001 as=o1
+//   addItems order=$o1 items=MNU001:2,MNU004:1
+//   checkout order=$o1 method=Cash
+//
+// "as" binds the ID returned by an operation to a variable that later
+// lines can reference with "$name", so a recorded session can be replayed
+// even though the database hands out different IDs.
+class HeadlessRunner {
+private:
+    struct OpStats {
+        int count = 0;
+        int failed = 0;
+        double totalMs = 0;
+        double maxMs = 0;
+        unsigned long long queries = 0;
+    };
+
+    DatabaseConnection& db;
+    AdminModule& adminModule;
+    StaffModule& staffModule;
+    MenuModule& menuModule;
+    TableModule& tableModule;
+    OrderModule& orderModule;
+    BillingModule& billingModule;
+    ostream& out;
+    chrono::milliseconds reportTimeout{ 0 };
+
+    map<string, string> vars;
+    map<string, OpStats> stats;
+
+    static string todayString() {
+        time_t now = time(0);
+        tm ltm;
+#ifdef _WIN32
+        localtime_s(&ltm, &now);
+#else
+        localtime_r(&now, &ltm);
+#endif
+        char buffer[11];
+        strftime(buffer, 11, "%Y-%m-%d", &ltm);
+        return string(buffer);
+    }
+
+    // Split a script line into op + key=value pairs. Values may be quoted.
+    static bool parseScriptLine(const string& line, JsonValue& op) {
+        op.type = JsonValue::Object;
+        size_t i = 0;
+        bool first = true;
+        while (i < line.size()) {
+            while (i < line.size() && isspace((unsigned char)line[i])) i++;
+            if (i >= line.size()) break;
+
+            string token;
+            bool quoted = false;
+            while (i < line.size() && (quoted || !isspace((unsigned char)line[i]))) {
+                if (line[i] == '"') {
+                    quoted = !quoted;
+                }
+                else {
+                    token += line[i];
+                }
+                i++;
+            }
+            if (quoted) return false;
+
+            if (first) {
+                op.fields["op"] = JsonValue::fromString(token);
+                first = false;
+                continue;
+            }
+            size_t eq = token.find('=');
+            if (eq == string::npos) return false;
+            op.fields[token.substr(0, eq)] = JsonValue::fromString(token.substr(eq + 1));
+        }
+        return !first;
+    }
+
+    string arg(const JsonValue& op, const string& key, const string& fallback = "") {
+        if (!op.has(key)) return fallback;
+        string value = op[key].asString();
+        if (value.size() > 1 && value[0] == '$') {
+            auto it = vars.find(value.substr(1));
+            return it == vars.end() ? "" : it->second;
+        }
+        return value;
+    }
+
+    // Items come either as [{"menu":"MNU001","qty":2}, ...] or "MNU001:2,MNU004:1"
+    bool addItems(const JsonValue& op, const string& orderID, int& added) {
+        const JsonValue& items = op["items"];
+        vector<pair<string, int>> lines;
+        if (items.isArray()) {
+            for (const JsonValue& item : items.items) {
+                lines.push_back({ item["menu"].asString(), (int)item["qty"].asNumber(1) });
+            }
+        }
+        else {
+            stringstream list(arg(op, "items"));
+            string entry;
+            while (getline(list, entry, ',')) {
+                if (entry.empty()) continue;
+                size_t colon = entry.find(':');
+                int qty = colon == string::npos ? 1 : atoi(entry.substr(colon + 1).c_str());
+                lines.push_back({ entry.substr(0, colon), qty });
+            }
+        }
+        added = orderModule.addOrderItems(orderID, lines, arg(op, "key"));
+        return added == (int)lines.size();
+    }
+
+    // Same flow as the staff "Process Payment" screen, without prompts.
+    // With a key, the bill and the payment are each keyed (key/bill,
+    // key/pay), so a retried checkout neither bills nor charges twice.
+    bool checkout(const string& orderID, const string& method, const string& key, string& billID) {
+        if (!key.empty()) {
+            billID = billingModule.generateBill(orderID, staffModule.getStaffID(),
+                parseEnum<PaymentMethod>(method), key + "/bill");
+            return !billID.empty() && billingModule.processPayment(billID, key + "/pay");
+        }
+        OrderAggregateCache::Scope orderCache;
+        if (!orderModule.isOrderActive(orderID)) {
+            cout << "[FAILED] Order not found or not active!" << endl;
+            return false;
+        }
+        if (orderModule.getOrderTotal(orderID) <= 0) {
+            cout << "[FAILED] Order has no items!" << endl;
+            return false;
+        }
+        billID = billingModule.getBillForOrder(orderID);
+        if (billID.empty()) {
+            billID = billingModule.generateBill(orderID, staffModule.getStaffID(), method);
+            if (billID.empty()) return false;
+        }
+        return billingModule.processPayment(billID);
+    }
+
+    bool runReport(const string& kind, const JsonValue& op) {
+        // timeoutMs=... overrides the runner's limit for this report
+        QueryOptions options;
+        string limit = arg(op, "timeoutMs");
+        options.timeout = limit.empty() ? reportTimeout : chrono::milliseconds(atoll(limit.c_str()));
+
+        if (kind == "dailySales") {
+            adminModule.generateDailySalesReport(arg(op, "date", todayString()), options);
+        }
+        else if (kind == "salesHistory") {
+            adminModule.viewAllDailySales(options);
+        }
+        else if (kind == "allOrders") {
+            orderModule.viewAllOrders(options);
+        }
+        else if (kind == "activeOrders") {
+            orderModule.viewActiveOrders();
+        }
+        else if (kind == "allBills") {
+            billingModule.viewAllBills(options);
+        }
+        else if (kind == "unpaid") {
+            billingModule.viewUnpaidTables();
+        }
+        else {
+            cout << "[FAILED] Unknown report '" << kind << "'" << endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Run a single operation. Module console output is the caller's concern.
+    bool execute(const string& name, const JsonValue& op, string& resultID) {
+        if (name == "login") {
+            string role = arg(op, "role", "staff");
+            if (role == "admin") return adminModule.login(arg(op, "email"), arg(op, "password"));
+            return staffModule.login(arg(op, "email"), arg(op, "password"));
+        }
+        if (name == "logout") {
+            if (arg(op, "role", "staff") == "admin") adminModule.logout();
+            else staffModule.logout();
+            return true;
+        }
+        if (name == "setTableStatus") {
+            return tableModule.updateTableStatus(arg(op, "table"), arg(op, "status"));
+        }
+        if (name == "createOrder") {
+            if (!staffModule.checkLogin()) {
+                cout << "[FAILED] Staff login required!" << endl;
+                return false;
+            }
+            string tableID = arg(op, "table");
+            if (tableModule.getTableStatus(tableID) == TableStatus::Vacant) {
+                tableModule.updateTableStatus(tableID, TableStatus::Occupied);
+            }
+            resultID = orderModule.createOrder(tableID, staffModule.getStaffID(), arg(op, "key"));
+            return !resultID.empty();
+        }
+        if (name == "addItem") {
+            resultID = arg(op, "order");
+            return orderModule.addOrderItem(resultID, arg(op, "menu"), atoi(arg(op, "qty", "1").c_str()));
+        }
+        if (name == "addItems") {
+            resultID = arg(op, "order");
+            int added = 0;
+            return addItems(op, resultID, added);
+        }
+        if (name == "cancelOrder") {
+            resultID = arg(op, "order");
+            return orderModule.cancelOrder(resultID);
+        }
+        if (name == "checkout") {
+            if (!staffModule.checkLogin()) {
+                cout << "[FAILED] Staff login required!" << endl;
+                return false;
+            }
+            return checkout(arg(op, "order"), arg(op, "method", "Cash"), arg(op, "key"), resultID);
+        }
+        if (name == "viewOrder") {
+            orderModule.viewOrderDetails(arg(op, "order"));
+            return true;
+        }
+        if (name == "viewBill") {
+            billingModule.viewBillDetails(arg(op, "bill"));
+            return true;
+        }
+        if (name == "report") {
+            return runReport(arg(op, "kind"), op);
+        }
+        cout << "[FAILED] Unknown operation '" << name << "'" << endl;
+        return false;
+    }
+
+    void writeSummary(int total, int failed, double elapsedMs) {
+        out << "{\"summary\":true,\"ops\":" << total
+            << ",\"failed\":" << failed
+            << ",\"ms\":" << fixed << setprecision(3) << elapsedMs
+            << ",\"byOp\":{";
+        bool first = true;
+        for (const auto& entry : stats) {
+            const OpStats& s = entry.second;
+            if (!first) out << ",";
+            first = false;
+            out << jsonQuote(entry.first) << ":{\"count\":" << s.count
+                << ",\"failed\":" << s.failed
+                << ",\"meanMs\":" << (s.count ? s.totalMs / s.count : 0)
+                << ",\"maxMs\":" << s.maxMs
+                << ",\"queriesPerOp\":" << (s.count ? (double)s.queries / s.count : 0) << "}";
+        }
+        out << "},\"transactions\":{";
+        first = true;
+        for (const auto& entry : db.getTransactionStats()) {
+            const TransactionStats& t = entry.second;
+            if (!first) out << ",";
+            first = false;
+            out << jsonQuote(entry.first) << ":{\"count\":" << t.calls
+                << ",\"committed\":" << t.committed
+                << ",\"rolledBack\":" << t.rolledBack
+                << ",\"failed\":" << t.failed
+                << ",\"retries\":" << t.retries
+                << ",\"deadlocks\":" << t.deadlocks
+                << ",\"lockWaitTimeouts\":" << t.lockWaitTimeouts
+                << ",\"meanMs\":" << (t.calls ? t.totalMs / t.calls : 0)
+                << ",\"maxMs\":" << t.maxMs << "}";
+        }
+        out << "}}" << endl;
+    }
+
+public:
+    HeadlessRunner(DatabaseConnection& database, AdminModule& admin, StaffModule& staff,
+        MenuModule& menu, TableModule& table, OrderModule& order, BillingModule& billing,
+        ostream& output)
+        : db(database), adminModule(admin), staffModule(staff), menuModule(menu),
+        tableModule(table), orderModule(order), billingModule(billing), out(output) {}
+
+    // Time limit for report queries (0 = none)
+    void setReportTimeout(chrono::milliseconds timeout) { reportTimeout = timeout; }
+
+    // Run every operation in the stream. Returns the number of failed operations.
+    int run(istream& in) {
+        auto runStart = chrono::steady_clock::now();
+        int total = 0;
+        int failed = 0;
+        int lineNumber = 0;
+        string line;
+
+        while (getline(in, line)) {
+            lineNumber++;
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            size_t firstChar = line.find_first_not_of(" \t");
+            if (firstChar == string::npos || line[firstChar] == '#') continue;
+
+            JsonValue op;
+            bool parsed = line[firstChar] == '{'
+                ? JsonParser(line).parse(op) && op.isObject()
+                : parseScriptLine(line, op);
+            string name = op["op"].asString();
+
+            total++;
+            if (!parsed || name.empty()) {
+                failed++;
+                out << "{\"seq\":" << total << ",\"line\":" << lineNumber
+                    << ",\"ok\":false,\"error\":\"parse error\"}" << endl;
+                continue;
+            }
+
+            // Capture what the modules print so it travels with the result
+            ostringstream captured;
+            streambuf* savedOut = cout.rdbuf(captured.rdbuf());
+            streambuf* savedErr = cerr.rdbuf(captured.rdbuf());
+
+            string resultID;
+            bool ok = false;
+            unsigned long long queries = 0;
+            auto start = chrono::steady_clock::now();
+            try {
+                QueryTracker tracker(db, "headless:" + name);
+                ok = execute(name, op, resultID);
+                queries = tracker.count();
+            }
+            catch (exception& e) {
+                cerr << "Unhandled error: " << e.what() << endl;
+            }
+            double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+            cout.rdbuf(savedOut);
+            cerr.rdbuf(savedErr);
+
+            if (ok && op.has("as") && !resultID.empty()) {
+                vars[op["as"].asString()] = resultID;
+            }
+
+            OpStats& s = stats[name];
+            s.count++;
+            s.totalMs += ms;
+            s.queries += queries;
+            if (ms > s.maxMs) s.maxMs = ms;
+            if (!ok) {
+                s.failed++;
+                failed++;
+            }
+
+            out << "{\"seq\":" << total << ",\"line\":" << lineNumber
+                << ",\"op\":" << jsonQuote(name)
+                << ",\"ok\":" << (ok ? "true" : "false")
+                << ",\"ms\":" << fixed << setprecision(3) << ms
+                << ",\"queries\":" << queries;
+            if (!resultID.empty()) out << ",\"id\":" << jsonQuote(resultID);
+            out << ",\"output\":" << jsonQuote(captured.str()) << "}" << endl;
+        }
+
+        double elapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - runStart).count();
+        writeSummary(total, failed, elapsedMs);
+        return failed;
+    }
+};
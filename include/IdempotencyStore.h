@@ -0,0 +1,287 @@
+#pragma once
+#include "DatabaseConnection.h"
+#include "Metrics.h"
+#include "SchemaCheck.h"
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <functional>
+#include <chrono>
+#include <cstdio>
+
+using namespace std;
+
+// Remembers what operations submitted with an idempotency key returned, so
+// a till that retries after a timeout gets the first result back instead
+// of running the operation (and its checks) again.
+//
+//   string orderID = idempotency.run(key, "createOrder " + tableID + " " + staffID,
+//       [&]() { return createOrder(tableID, staffID); });
+//
+// request describes the call; a key sent again with a different request
+// is refused. Results are looked up in a bounded in-memory table first
+// (least recently used entries are dropped, entries expire after ttl) and
+// then in Idempotency_Keys by primary key, so a retry that reaches another
+// process, or this one after a restart, is recognised without reading
+// Orders or Bill.
+//
+// Before the operation runs its key is claimed with INSERT IGNORE, so when
+// two tills send the same key at once only one runs it and the other is
+// told it is in progress. The operation and its stored result commit in
+// one transaction. An operation that fails (returns "") releases its claim
+// and may be retried with the same key. A claim left by a till that died
+// mid-operation, which therefore changed nothing, is taken over after
+// claimTimeout. Without the
+// Idempotency_Keys table only the in-memory table is used.
+class IdempotencyStore {
+private:
+    struct Entry {
+        string key;
+        string requestHash;
+        string result;
+        chrono::steady_clock::time_point expiresAt;
+    };
+
+    enum class Claim { Claimed, Done, Busy, Mismatch, Error };
+
+    DatabaseConnection& db;
+    size_t capacity;
+    chrono::seconds ttl;
+    list<Entry> recent;                                   // most recently used first
+    unordered_map<string, list<Entry>::iterator> byKey;
+    chrono::steady_clock::time_point purgedAt;
+
+    static constexpr size_t maxKeyLength = 64;
+    static constexpr chrono::seconds claimTimeout{ 120 };
+    static constexpr chrono::minutes purgeInterval{ 10 };
+
+    // Keyed submissions by outcome
+    struct Outcomes {
+        Counter& fresh;      // ran the operation
+        Counter& memory;     // answered from the in-memory table
+        Counter& database;   // answered from Idempotency_Keys
+        Counter& busy;       // another till is running it
+        Counter& mismatch;   // key reused for a different request
+    };
+
+    static Outcomes& outcomes() {
+        static Outcomes counters = [] {
+            auto counter = [](const char* result) -> Counter& {
+                return Metrics::instance().counter("restaurant_idempotency_lookups_total",
+                    "Operations submitted with an idempotency key, by outcome",
+                    string("result=\"") + result + "\"");
+            };
+            return Outcomes{ counter("new"), counter("memory"), counter("database"),
+                counter("busy"), counter("mismatch") };
+        }();
+        return counters;
+    }
+
+    // 64-bit FNV-1a of request as 16 hex digits; the same on every build
+    static string hashRequest(const string& request) {
+        uint64_t hash = 1469598103934665603ULL;
+        for (unsigned char c : request) {
+            hash ^= c;
+            hash *= 1099511628211ULL;
+        }
+        char buffer[20];
+        snprintf(buffer, sizeof(buffer), "%016llx", (unsigned long long)hash);
+        return string(buffer);
+    }
+
+    // The in-memory entry for key, or nullptr (expired entries are dropped)
+    Entry* remembered(const string& key) {
+        auto it = byKey.find(key);
+        if (it == byKey.end()) return nullptr;
+        if (chrono::steady_clock::now() >= it->second->expiresAt) {
+            recent.erase(it->second);
+            byKey.erase(it);
+            return nullptr;
+        }
+        recent.splice(recent.begin(), recent, it->second);
+        return &*it->second;
+    }
+
+    void remember(const string& key, const string& requestHash, const string& result) {
+        auto it = byKey.find(key);
+        if (it != byKey.end()) {
+            recent.erase(it->second);
+            byKey.erase(it);
+        }
+        recent.push_front({ key, requestHash, result, chrono::steady_clock::now() + ttl });
+        byKey[key] = recent.begin();
+        if (recent.size() > capacity) {
+            byKey.erase(recent.back().key);
+            recent.pop_back();
+        }
+    }
+
+    // True if Idempotency_Keys exists (see SchemaCheck)
+    bool tableAvailable() {
+        return SchemaCheck::hasTables(db, { "Idempotency_Keys" });
+    }
+
+    // Drop stored keys older than ttl, at most every purgeInterval
+    void purgeExpired() {
+        auto now = chrono::steady_clock::now();
+        if (purgedAt != chrono::steady_clock::time_point() && now - purgedAt < purgeInterval) return;
+        purgedAt = now;
+        auto pstmt = db.prepareStatement(
+            "DELETE FROM Idempotency_Keys WHERE Created_at < NOW() - INTERVAL ? SECOND");
+        if (pstmt) {
+            pstmt->setInt64(1, (int64_t)ttl.count());
+            pstmt->executeUpdate();
+        }
+    }
+
+    // Claim key in Idempotency_Keys, or read what another run of it left
+    Claim claim(const string& key, const string& operation, const string& requestHash, string& result) {
+        try {
+            purgeExpired();
+            auto insert = db.prepareStatement(
+                "INSERT IGNORE INTO Idempotency_Keys (Idem_key, Operation, Request_hash) VALUES (?, ?, ?)");
+            if (!insert) return Claim::Error;
+            insert->setString(1, key);
+            insert->setString(2, operation);
+            insert->setString(3, requestHash);
+            if (insert->executeUpdate() == 1) return Claim::Claimed;
+
+            // Taken: by a till that died before finishing, if it is this old
+            auto takeOver = db.prepareStatement(
+                "UPDATE Idempotency_Keys SET Created_at = NOW() "
+                "WHERE Idem_key = ? AND Request_hash = ? AND Result IS NULL "
+                "AND Created_at < NOW() - INTERVAL ? SECOND");
+            if (!takeOver) return Claim::Error;
+            takeOver->setString(1, key);
+            takeOver->setString(2, requestHash);
+            takeOver->setInt64(3, (int64_t)claimTimeout.count());
+            if (takeOver->executeUpdate() == 1) return Claim::Claimed;
+
+            auto select = db.prepareStatement(
+                "SELECT Request_hash, Result FROM Idempotency_Keys WHERE Idem_key = ?");
+            if (!select) return Claim::Error;
+            select->setString(1, key);
+            unique_ptr<sql::ResultSet> res(select->executeQuery());
+            if (!res->next()) return Claim::Busy;   // released or purged just now
+            if (res->getString("Request_hash") != requestHash) return Claim::Mismatch;
+            if (res->isNull("Result")) return Claim::Busy;
+            result = res->getString("Result");
+            return Claim::Done;
+        }
+        catch (sql::SQLException& e) {
+            cerr << "Error claiming idempotency key: " << e.what() << endl;
+            return Claim::Error;
+        }
+    }
+
+    // Store the result of a claimed key; part of the operation's
+    // transaction. Throws sql::SQLException.
+    void saveResult(const string& key, const string& result) {
+        auto pstmt = db.prepareStatement("UPDATE Idempotency_Keys SET Result = ? WHERE Idem_key = ?");
+        if (!pstmt) throw sql::SQLException("Cannot prepare idempotency result update");
+        pstmt->setString(1, result);
+        pstmt->setString(2, key);
+        pstmt->executeUpdate();
+    }
+
+    // Release the claim of an operation that failed, so it may be retried
+    void release(const string& key) {
+        try {
+            auto pstmt = db.prepareStatement("DELETE FROM Idempotency_Keys WHERE Idem_key = ? AND Result IS NULL");
+            if (!pstmt) return;
+            pstmt->setString(1, key);
+            pstmt->executeUpdate();
+        }
+        catch (sql::SQLException& e) {
+            cerr << "Error releasing idempotency key: " << e.what() << endl;
+        }
+    }
+
+    // Run a claimed operation and store its result in one transaction (the
+    // module's own db.transaction joins it), so the change and the result
+    // are committed together or not at all. A claim whose till died is then
+    // only taken over when the operation never happened.
+    string runClaimed(const string& key, const string& name, const function<string()>& operation) {
+        string result;
+        try {
+            db.transaction(name, [&]() {
+                result = operation();
+                if (result.empty()) return false;
+                saveResult(key, result);
+                return true;
+            });
+        }
+        catch (sql::SQLException& e) {
+            cerr << "Error saving idempotency key: " << e.what() << endl;
+            result = "";
+        }
+        if (result.empty()) release(key);
+        return result;
+    }
+
+public:
+    IdempotencyStore(DatabaseConnection& database, size_t maxEntries = 10000,
+        chrono::seconds timeToLive = chrono::hours(24))
+        : db(database), capacity(maxEntries), ttl(timeToLive) {}
+
+    IdempotencyStore(const IdempotencyStore&) = delete;
+    IdempotencyStore& operator=(const IdempotencyStore&) = delete;
+
+    // Run operation once per key and return its result ("" = failed). An
+    // empty key runs it unprotected. request names the operation first
+    // ("createOrder TBL001 STF001"); its first word is stored with the key.
+    string run(const string& key, const string& request, const function<string()>& operation) {
+        if (key.empty()) return operation();
+        if (key.size() > maxKeyLength) {
+            cout << "[FAILED] Idempotency key is longer than " << maxKeyLength << " characters!" << endl;
+            return "";
+        }
+
+        string requestHash = hashRequest(request);
+        if (Entry* entry = remembered(key)) {
+            if (entry->requestHash != requestHash) {
+                outcomes().mismatch.inc();
+                cout << "[FAILED] Idempotency key " << key << " was used for a different request!" << endl;
+                return "";
+            }
+            outcomes().memory.inc();
+            cout << "[INFO] Request " << key << " was already completed: " << entry->result << endl;
+            return entry->result;
+        }
+
+        string result;
+        string name = request.substr(0, request.find(' '));
+        bool claimed = false;
+        if (tableAvailable()) {
+            switch (claim(key, name, requestHash, result)) {
+            case Claim::Claimed:
+                claimed = true;
+                break;
+            case Claim::Done:
+                outcomes().database.inc();
+                remember(key, requestHash, result);
+                cout << "[INFO] Request " << key << " was already completed: " << result << endl;
+                return result;
+            case Claim::Busy:
+                outcomes().busy.inc();
+                cout << "[FAILED] Request " << key << " is still being processed! Try again shortly." << endl;
+                return "";
+            case Claim::Mismatch:
+                outcomes().mismatch.inc();
+                cout << "[FAILED] Idempotency key " << key << " was used for a different request!" << endl;
+                return "";
+            case Claim::Error:
+                cout << "[FAILED] Cannot check idempotency key " << key << "!" << endl;
+                return "";
+            }
+        }
+
+        outcomes().fresh.inc();
+        result = claimed ? runClaimed(key, name, operation) : operation();
+        if (!result.empty()) remember(key, requestHash, result);
+        return result;
+    }
+
+    // Entries held in memory
+    size_t size() const { return recent.size(); }
+};
@@ -0,0 +1,201 @@
+#pragma once
+#include "DatabaseConnection.h"
+#include "OrderJournal.h"
+#include "OrderModule.h"
+#include "BillingModule.h"
+#include "TableModule.h"
+#include <string>
+#include <sstream>
+#include <optional>
+
+using namespace std;
+
+// Sends an OrderJournal's pending records to the database, oldest first.
+//
+// Each record is applied through the modules, so it gets the same checks
+// and ID generation as if it had been entered online, inside one
+// DatabaseConnection::transaction that also inserts (terminal, seq) into
+// Journal_Applied. A record already
+// in Journal_Applied was committed by an earlier run whose done marker did
+// not reach the journal, and is only marked done. A record the database
+// refuses (the menu item was withdrawn, the order was paid on another till)
+// is rolled back and marked rejected with the module's message; records
+// that depend on it are rejected in turn. If the connection drops again the
+// replay stops and the rest stays pending.
+//
+//   journal.onReconnect([&]() { JournalReplay(db, journal, salesSeries).run(); });
+class JournalReplay {
+private:
+    DatabaseConnection& db;
+    OrderJournal& journal;
+    // Modules without the journal, so nothing is journalled again
+    OrderModule orderModule;
+    BillingModule billingModule;
+    TableModule tableModule;
+
+    // Result_id stored when (terminal, seq) was applied, or nullopt if it
+    // was not. Throws sql::SQLException.
+    optional<string> appliedResult(unsigned long long seq) {
+        auto pstmt = db.prepareStatement(
+            "SELECT COALESCE(Result_id, '') AS Result_id FROM Journal_Applied WHERE Terminal = ? AND Seq = ?");
+        if (!pstmt) throw sql::SQLException("Cannot read Journal_Applied");
+        pstmt->setString(1, journal.getTerminal());
+        pstmt->setUInt64(2, seq);
+        unique_ptr<sql::ResultSet> res(pstmt->executeQuery());
+        if (res->next()) return string(res->getString("Result_id"));
+        return nullopt;
+    }
+
+    // A provisional ID that was replayed as a database ID; fails if the
+    // record that made it was rejected
+    bool reference(const JsonValue& record, const char* key, string& id) {
+        id = journal.resolve(record[key].asString());
+        if (journal.isUnresolved(id)) {
+            cout << "[FAILED] " << id << " was not saved to the database!" << endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Set the date column of the row keyed by id to when the record was made
+    bool stamp(const string& query, const JsonValue& record, const string& id) {
+        auto pstmt = db.prepareStatement(query);
+        if (!pstmt) return false;
+        pstmt->setString(1, record["at"].asString());
+        pstmt->setString(2, id);
+        pstmt->executeUpdate();
+        return true;
+    }
+
+    // Run one record through the modules. id is what it created, if
+    // anything. Throws sql::SQLException.
+    bool apply(const JsonValue& record, string& id) {
+        string op = record["op"].asString();
+        string orderID;
+        if (op == "createOrder") {
+            id = orderModule.createOrder(record["table"].asString(), record["staff"].asString());
+            return !id.empty() && stamp("UPDATE Orders SET Order_date = ? WHERE OrderID = ?", record, id);
+        }
+        if (op == "addItem") {
+            return reference(record, "order", orderID)
+                && orderModule.addOrderItem(orderID, record["menu"].asString(), (int)record["quantity"].asNumber());
+        }
+        if (op == "tableStatus") {
+            string tableID = record["table"].asString();
+            TableStatus status = parseEnum<TableStatus>(record["status"].asString());
+            // Already so (set by another till, or by a createOrder before it)
+            if (tableModule.getTableStatus(tableID) == status) return true;
+            return tableModule.updateTableStatus(tableID, status);
+        }
+        if (op == "generateBill") {
+            if (!reference(record, "order", orderID)) return false;
+            id = billingModule.generateBill(orderID, record["staff"].asString(),
+                parseEnum<PaymentMethod>(record["method"].asString()));
+            return !id.empty() && stamp("UPDATE Bill SET Bill_date = ? WHERE BillID = ?", record, id);
+        }
+        if (op == "pay") {
+            string billID;
+            return reference(record, "bill", billID) && billingModule.processPayment(billID);
+        }
+        if (op == "cancelOrder") {
+            return reference(record, "order", orderID) && orderModule.cancelOrder(orderID);
+        }
+        cout << "[FAILED] Unknown journal operation: " << op << endl;
+        return false;
+    }
+
+    // The line that explains a refusal in what the modules printed
+    static string failureLine(const string& printed) {
+        istringstream lines(printed);
+        string line, first;
+        while (getline(lines, line)) {
+            if (line.find("[FAILED]") != string::npos) return line;
+            if (first.empty() && !line.empty()) first = line;
+        }
+        return first.empty() ? "[FAILED] Rejected by the database" : first;
+    }
+
+public:
+    // Replayed payments are recorded in series, like payments taken online
+    JournalReplay(DatabaseConnection& database, OrderJournal& orderJournal, SalesSeries* series = nullptr)
+        : db(database), journal(orderJournal),
+          orderModule(database), billingModule(database), tableModule(database) {
+        billingModule.useSalesSeries(series);
+    }
+
+    // Apply what is pending. Returns the number of records applied.
+    int run() {
+        MODULE_SPAN("JournalReplay", "run");
+        if (journal.getPending().empty()) return 0;
+        cout << "[INFO] Sending " << journal.getPending().size()
+             << " offline operation(s) to the database..." << endl;
+
+        int applied = 0;
+        int rejected = 0;
+        while (!journal.getPending().empty() && !db.connectionLost()) {
+            const OrderJournal::Record& record = journal.getPending().front();
+            string provisional = record.fields[record.fields["op"].asString() == "generateBill" ? "bill" : "order"].asString();
+            string id;
+            bool ok = false;
+            string message;
+
+            ostringstream printed;
+            streambuf* savedOut = cout.rdbuf(printed.rdbuf());
+            streambuf* savedErr = cerr.rdbuf(printed.rdbuf());
+            try {
+                optional<string> done = appliedResult(record.seq);
+                if (done) {
+                    id = *done;
+                    ok = true;
+                }
+                else {
+                    // The modules' own transactions join this one
+                    ok = db.transaction("JournalReplay", [&]() {
+                        id.clear();
+                        if (!apply(record.fields, id)) return false;
+                        auto pstmt = db.prepareStatement(
+                            "INSERT INTO Journal_Applied (Terminal, Seq, Result_id) VALUES (?, ?, NULLIF(?, ''))");
+                        if (!pstmt) throw sql::SQLException("Cannot write Journal_Applied");
+                        pstmt->setString(1, journal.getTerminal());
+                        pstmt->setUInt64(2, record.seq);
+                        pstmt->setString(3, id);
+                        pstmt->executeUpdate();
+                        return true;
+                    });
+                }
+            }
+            catch (sql::SQLException& e) {
+                ok = false;
+                message = string("[FAILED] ") + e.what();
+            }
+            cout.rdbuf(savedOut);
+            cerr.rdbuf(savedErr);
+
+            // Stays pending; retried after the next reconnect
+            if (db.connectionLost()) break;
+
+            if (ok) {
+                if (!id.empty() && id != provisional && journal.isUnresolved(provisional)) {
+                    cout << "[INFO] Offline " << (provisional.compare(0, 3, "BIL") == 0 ? "bill " : "order ")
+                         << provisional << " is now " << id << endl;
+                }
+                journal.markApplied(id);
+                applied++;
+            }
+            else {
+                if (message.empty()) message = failureLine(printed.str());
+                cout << "[WARNING] Offline " << record.fields["op"].asString() << " #" << record.seq
+                     << " was not saved: " << message << endl;
+                journal.markRejected(message);
+                rejected++;
+            }
+        }
+
+        size_t left = journal.getPending().size();
+        cout << "[INFO] Offline operations sent: " << applied << ", rejected: " << rejected;
+        if (left > 0) cout << ", still waiting: " << left;
+        cout << endl;
+        journal.compact();
+        return applied;
+    }
+};
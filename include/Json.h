@@ -0,0 +1,218 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+
+using namespace std;
+
+// Minimal JSON value used by the headless runner and the tools that
+// read or write machine-readable results. Only what those callers need:
+// objects, arrays, strings, numbers, booleans and null.
+struct JsonValue {
+    enum Type { Null, Bool, Number, String, Array, Object };
+
+    Type type = Null;
+    bool boolValue = false;
+    double numberValue = 0;
+    string stringValue;
+    vector<JsonValue> items;
+    map<string, JsonValue> fields;
+
+    bool isNull() const { return type == Null; }
+    bool isObject() const { return type == Object; }
+    bool isArray() const { return type == Array; }
+
+    bool has(const string& key) const {
+        return type == Object && fields.find(key) != fields.end();
+    }
+
+    const JsonValue& operator[](const string& key) const {
+        static const JsonValue nullValue;
+        if (type != Object) return nullValue;
+        auto it = fields.find(key);
+        return it == fields.end() ? nullValue : it->second;
+    }
+
+    // Scalars are converted to text so callers can treat every argument
+    // as a string the way the module APIs expect.
+    string asString() const {
+        switch (type) {
+        case String: return stringValue;
+        case Bool: return boolValue ? "true" : "false";
+        case Number: {
+            char buffer[32];
+            if (numberValue == (double)(long long)numberValue) {
+                snprintf(buffer, sizeof(buffer), "%lld", (long long)numberValue);
+            }
+            else {
+                snprintf(buffer, sizeof(buffer), "%g", numberValue);
+            }
+            return string(buffer);
+        }
+        default: return "";
+        }
+    }
+
+    double asNumber(double fallback = 0) const {
+        if (type == Number) return numberValue;
+        if (type == String && !stringValue.empty()) return atof(stringValue.c_str());
+        return fallback;
+    }
+
+    static JsonValue fromString(const string& text) {
+        JsonValue v;
+        v.type = String;
+        v.stringValue = text;
+        return v;
+    }
+};
+
+class JsonParser {
+private:
+    const string& text;
+    size_t pos;
+
+    void skipSpace() {
+        while (pos < text.size() && isspace((unsigned char)text[pos])) pos++;
+    }
+
+    bool parseString(string& out) {
+        if (text[pos] != '"') return false;
+        pos++;
+        while (pos < text.size()) {
+            char c = text[pos++];
+            if (c == '"') return true;
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (pos >= text.size()) return false;
+            char e = text[pos++];
+            switch (e) {
+            case 'n': out += '\n'; break;
+            case 't': out += '\t'; break;
+            case 'r': out += '\r'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'u': {
+                if (pos + 4 > text.size()) return false;
+                unsigned code = (unsigned)strtoul(text.substr(pos, 4).c_str(), nullptr, 16);
+                pos += 4;
+                // Encode the BMP code point as UTF-8
+                if (code < 0x80) {
+                    out += (char)code;
+                }
+                else if (code < 0x800) {
+                    out += (char)(0xC0 | (code >> 6));
+                    out += (char)(0x80 | (code & 0x3F));
+                }
+                else {
+                    out += (char)(0xE0 | (code >> 12));
+                    out += (char)(0x80 | ((code >> 6) & 0x3F));
+                    out += (char)(0x80 | (code & 0x3F));
+                }
+                break;
+            }
+            default: out += e; break;
+            }
+        }
+        return false;
+    }
+
+    bool parseValue(JsonValue& v) {
+        skipSpace();
+        if (pos >= text.size()) return false;
+        char c = text[pos];
+        if (c == '{') {
+            v.type = JsonValue::Object;
+            pos++;
+            skipSpace();
+            if (pos < text.size() && text[pos] == '}') { pos++; return true; }
+            while (pos < text.size()) {
+                skipSpace();
+                string key;
+                if (pos >= text.size() || !parseString(key)) return false;
+                skipSpace();
+                if (pos >= text.size() || text[pos] != ':') return false;
+                pos++;
+                if (!parseValue(v.fields[key])) return false;
+                skipSpace();
+                if (pos < text.size() && text[pos] == ',') { pos++; continue; }
+                if (pos < text.size() && text[pos] == '}') { pos++; return true; }
+                return false;
+            }
+            return false;
+        }
+        if (c == '[') {
+            v.type = JsonValue::Array;
+            pos++;
+            skipSpace();
+            if (pos < text.size() && text[pos] == ']') { pos++; return true; }
+            while (pos < text.size()) {
+                v.items.emplace_back();
+                if (!parseValue(v.items.back())) return false;
+                skipSpace();
+                if (pos < text.size() && text[pos] == ',') { pos++; continue; }
+                if (pos < text.size() && text[pos] == ']') { pos++; return true; }
+                return false;
+            }
+            return false;
+        }
+        if (c == '"') {
+            v.type = JsonValue::String;
+            return parseString(v.stringValue);
+        }
+        if (text.compare(pos, 4, "true") == 0) { v.type = JsonValue::Bool; v.boolValue = true; pos += 4; return true; }
+        if (text.compare(pos, 5, "false") == 0) { v.type = JsonValue::Bool; v.boolValue = false; pos += 5; return true; }
+        if (text.compare(pos, 4, "null") == 0) { v.type = JsonValue::Null; pos += 4; return true; }
+
+        const char* start = text.c_str() + pos;
+        char* end = nullptr;
+        double number = strtod(start, &end);
+        if (end == start) return false;
+        v.type = JsonValue::Number;
+        v.numberValue = number;
+        pos += (size_t)(end - start);
+        return true;
+    }
+
+public:
+    JsonParser(const string& input) : text(input), pos(0) {}
+
+    // Parse a complete document; returns false on any syntax error
+    bool parse(JsonValue& out) {
+        if (!parseValue(out)) return false;
+        skipSpace();
+        return pos == text.size();
+    }
+};
+
+// Escape a string for inclusion in JSON output (quotes included)
+inline string jsonQuote(const string& text) {
+    string out;
+    out.reserve(text.size() + 2);
+    out += '"';
+    for (unsigned char c : text) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (c < 0x20) {
+                char buffer[8];
+                snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+                out += buffer;
+            }
+            else {
+                out += (char)c;
+            }
+        }
+    }
+    out += '"';
+    return out;
+}
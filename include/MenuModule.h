@@ -1,16 +1,48 @@
 #pragma once
 #include "DatabaseConnection.h"
+#include "MenuSearchIndex.h"
+#include "NormalizedKeyIndex.h"
+#include "ConsoleRenderer.h"
+#include "OrderJournal.h"
 #include <string>
 #include <iostream>
 #include <iomanip>
-#include <algorithm>
-#include <cctype>
+#include <vector>
+#include <optional>
 
 using namespace std;
 
 class MenuModule {
 private:
     DatabaseConnection& db;
+    OrderJournal* journal = nullptr;
+    MenuSearchIndex searchIndex;
+    bool searchIndexLoaded = false;
+    NormalizedKeyIndex menuNames{ "Menu", "MenuID", "Menu_name", "Menu_name_key", "uq_menu_name_key" };
+
+    // Load every menu item into the search index on first use. Later changes
+    // made through this module are applied to the index as they happen.
+    void ensureSearchIndex() {
+        if (searchIndexLoaded) return;
+        try {
+            auto res = db.executeQuery(selectRows<MenuRow>("FROM Menu"));
+            if (!res) return;
+            searchIndex.clear();
+            for (const MenuRow& item : fetchRows<MenuRow>(res.get())) {
+                MenuSearchEntry entry;
+                entry.menuID = item.menuID;
+                entry.name = item.name;
+                entry.price = item.price;
+                entry.category = item.category;
+                entry.availability = item.availability;
+                searchIndex.upsert(entry);
+            }
+            searchIndexLoaded = true;
+        }
+        catch (sql::SQLException& e) {
+            cerr << "Error loading menu search index: " << e.what() << endl;
+        }
+    }
 
     string generateMenuID() {
         // Find the smallest missing ID (reuses deleted IDs)
@@ -25,7 +57,7 @@ private:
         if (res && res->next()) {
             int gapID = res->getInt("gap");
             char buffer[10];
-            sprintf_s(buffer, "MNU%03d", gapID);
+            snprintf(buffer, sizeof(buffer), "MNU%03d", gapID);
             return string(buffer);
         }
         
@@ -35,156 +67,115 @@ private:
         if (maxRes && maxRes->next()) {
             int maxID = maxRes->getInt("MaxID");
             char buffer[10];
-            sprintf_s(buffer, "MNU%03d", maxID + 1);
+            snprintf(buffer, sizeof(buffer), "MNU%03d", maxID + 1);
             return string(buffer);
         }
         return "MNU001";
     }
 
+    // The journal to use instead of the database while it is unreachable
+    OrderJournal* offline() {
+        return journal && !journal->online() ? journal : nullptr;
+    }
+
 public:
     MenuModule(DatabaseConnection& database) : db(database) {}
 
+    // Read the available menu from journal while the database is
+    // unreachable (nullptr: fail as before)
+    void useJournal(OrderJournal* orderJournal) { journal = orderJournal; }
+
+    // All menu items by category and name (nullopt if the query failed)
+    optional<vector<MenuRow>> listMenu() {
+        MODULE_SPAN("MenuModule", "listMenu");
+        auto res = db.executeQuery(selectRows<MenuRow>("FROM Menu ORDER BY Category, Menu_name"));
+        if (!res) return nullopt;
+        return fetchRows<MenuRow>(res.get());
+    }
+
+    // Available menu items by category and name (nullopt if the query failed)
+    optional<vector<MenuRow>> listAvailableMenu() {
+        MODULE_SPAN("MenuModule", "listAvailableMenu");
+        if (OrderJournal* j = offline()) return j->availableMenu();
+        auto res = db.executeQuery(selectRows<MenuRow>(
+            "FROM Menu WHERE Availability = 'Available' ORDER BY Category, Menu_name"));
+        if (!res) return nullopt;
+        return fetchRows<MenuRow>(res.get());
+    }
+
+    // Menu items in one category by name (nullopt if the query failed)
+    optional<vector<MenuRow>> listMenuByCategory(MenuCategory category) {
+        MODULE_SPAN("MenuModule", "listMenuByCategory");
+        try {
+            auto pstmt = db.prepareStatement(
+                selectRows<MenuRow>("FROM Menu WHERE Category = ? ORDER BY Menu_name"));
+            if (!pstmt) return nullopt;
+            pstmt->setString(1, toString(category));
+            unique_ptr<sql::ResultSet> res(pstmt->executeQuery());
+            return fetchRows<MenuRow>(res.get());
+        }
+        catch (sql::SQLException& e) {
+            cerr << "Error listing menu: " << e.what() << endl;
+            return nullopt;
+        }
+    }
+
     // View all menu items
     void viewAllMenu() {
-        auto res = db.executeQuery(
-            "SELECT MenuID, Menu_name, Price, Category, Availability "
-            "FROM Menu ORDER BY Category, Menu_name");
-        if (res) {
-            cout << "\n" << string(85, '=') << endl;
-            cout << "RESTAURANT MENU" << endl;
-            cout << string(85, '=') << endl;
-            cout << left << setw(10) << "Menu ID"
-                << setw(30) << "Item Name"
-                << setw(12) << "Price (RM)"
-                << setw(15) << "Category"
-                << "Status" << endl;
-            cout << string(85, '-') << endl;
-
-            string currentCategory = "";
-            while (res->next()) {
-                string category = res->getString("Category");
-                if (category != currentCategory) {
-                    if (!currentCategory.empty()) {
-                        cout << string(85, '-') << endl;
-                    }
-                    currentCategory = category;
-                }
-                cout << left << setw(10) << res->getString("MenuID")
-                    << setw(30) << res->getString("Menu_name")
-                    << setw(12) << fixed << setprecision(2) << res->getDouble("Price")
-                    << setw(15) << category
-                    << res->getString("Availability") << endl;
-            }
-            cout << string(85, '=') << endl;
-        }
+        MODULE_SPAN("MenuModule", "viewAllMenu");
+        if (auto items = listMenu()) ConsoleRenderer::menu(*items);
     }
 
     // View available menu only
     void viewAvailableMenu() {
-        auto res = db.executeQuery(
-            "SELECT MenuID, Menu_name, Price, Category "
-            "FROM Menu WHERE Availability = 'Available' ORDER BY Category, Menu_name");
-        if (res) {
-            cout << "\n" << string(70, '=') << endl;
-            cout << "AVAILABLE MENU ITEMS" << endl;
-            cout << string(70, '=') << endl;
-            cout << left << setw(10) << "Menu ID"
-                << setw(30) << "Item Name"
-                << setw(12) << "Price (RM)"
-                << "Category" << endl;
-            cout << string(70, '-') << endl;
-
-            while (res->next()) {
-                cout << left << setw(10) << res->getString("MenuID")
-                    << setw(30) << res->getString("Menu_name")
-                    << setw(12) << fixed << setprecision(2) << res->getDouble("Price")
-                    << res->getString("Category") << endl;
-            }
-            cout << string(70, '=') << endl;
-        }
+        MODULE_SPAN("MenuModule", "viewAvailableMenu");
+        if (auto items = listAvailableMenu()) ConsoleRenderer::availableMenu(*items);
     }
 
     // View menu by category
-    void viewMenuByCategory(const string& category) {
-        auto pstmt = db.prepareStatement(
-            "SELECT MenuID, Menu_name, Price, Availability "
-            "FROM Menu WHERE Category = ? ORDER BY Menu_name");
-        if (pstmt) {
-            pstmt->setString(1, category);
-            auto res = pstmt->executeQuery();
-
-            cout << "\n" << string(60, '=') << endl;
-            cout << category << " MENU" << endl;
-            cout << string(60, '=') << endl;
-            cout << left << setw(10) << "Menu ID"
-                << setw(25) << "Item Name"
-                << setw(12) << "Price (RM)"
-                << "Status" << endl;
-            cout << string(60, '-') << endl;
-
-            int count = 0;
-            while (res->next()) {
-                cout << left << setw(10) << res->getString("MenuID")
-                    << setw(25) << res->getString("Menu_name")
-                    << setw(12) << fixed << setprecision(2) << res->getDouble("Price")
-                    << res->getString("Availability") << endl;
-                count++;
-            }
-            if (count == 0) {
-                cout << "No items found in this category." << endl;
-            }
-            cout << string(60, '=') << endl;
+    void viewMenuByCategory(MenuCategory category) {
+        MODULE_SPAN("MenuModule", "viewMenuByCategory");
+        if (category == MenuCategory::Unknown) {
+            cout << "[FAILED] Invalid category! Use 'Food', 'Beverage', or 'Dessert'." << endl;
+            return;
         }
+        if (auto items = listMenuByCategory(category)) ConsoleRenderer::menuByCategory(category, *items);
     }
 
-    // Search menu
-    void searchMenu(const string& searchTerm) {
-        auto pstmt = db.prepareStatement(
-            "SELECT MenuID, Menu_name, Price, Category, Availability "
-            "FROM Menu WHERE Menu_name LIKE ? ORDER BY Menu_name");
-        if (pstmt) {
-            pstmt->setString(1, "%" + searchTerm + "%");
-            auto res = pstmt->executeQuery();
-
-            cout << "\n" << string(75, '=') << endl;
-            cout << "SEARCH RESULTS FOR: " << searchTerm << endl;
-            cout << string(75, '=') << endl;
-
-            int count = 0;
-            while (res->next()) {
-                cout << left << setw(10) << res->getString("MenuID")
-                    << setw(25) << res->getString("Menu_name")
-                    << "RM " << setw(10) << fixed << setprecision(2) << res->getDouble("Price")
-                    << setw(12) << res->getString("Category")
-                    << res->getString("Availability") << endl;
-                count++;
-            }
-            if (count == 0) {
-                cout << "No items found matching '" << searchTerm << "'" << endl;
-            }
-            cout << string(75, '=') << endl;
+    // View menu by category given as text (case-insensitive)
+    void viewMenuByCategory(const string& category) {
+        viewMenuByCategory(parseEnum<MenuCategory>(category));
+    }
+
+    // Search menu (ranked; tolerates typos and matches word prefixes)
+    void searchMenu(const string& searchTerm, size_t maxResults = 20) {
+        MODULE_SPAN("MenuModule", "searchMenu");
+        ConsoleRenderer::searchResults(searchTerm, findMenuItems(searchTerm, maxResults));
+    }
+
+    // Ranked search results without printing (best match first)
+    vector<MenuSearchEntry> findMenuItems(const string& searchTerm, size_t maxResults = 20) {
+        MODULE_SPAN("MenuModule", "findMenuItems");
+        ensureSearchIndex();
+        vector<MenuSearchEntry> items;
+        for (const MenuSearchHit& hit : searchIndex.search(searchTerm, maxResults)) {
+            items.push_back(*hit.entry);
         }
+        return items;
+    }
+
+    // Drop the search and name indexes so they are reloaded on next use
+    // (for changes made outside this module, e.g. a bulk import)
+    void reloadIndexes() {
+        searchIndexLoaded = false;
+        menuNames.invalidate();
     }
 
     // Add menu item
-    bool addMenuItem(const string& name, double price, const string& category) {
+    bool addMenuItem(const string& name, double price, MenuCategory category) {
+        MODULE_SPAN("MenuModule", "addMenuItem");
         try {
-            // Convert input to lowercase for case-insensitive comparison
-            string categoryLower = category;
-            transform(categoryLower.begin(), categoryLower.end(), categoryLower.begin(), ::tolower);
-            
-            // Normalize to proper case format
-            string normalizedCategory;
-            if (categoryLower == "food") {
-                normalizedCategory = "Food";
-            }
-            else if (categoryLower == "beverage") {
-                normalizedCategory = "Beverage";
-            }
-            else if (categoryLower == "dessert") {
-                normalizedCategory = "Dessert";
-            }
-            else {
+            if (category == MenuCategory::Unknown) {
                 cout << "[FAILED] Invalid category! Use 'Food', 'Beverage', or 'Dessert'." << endl;
                 return false;
             }
@@ -196,41 +187,79 @@ public:
             }
 
             // Check if menu item with same name already exists (case-insensitive)
-            auto checkStmt = db.prepareStatement(
-                "SELECT MenuID, Menu_name FROM Menu WHERE LOWER(Menu_name) = LOWER(?)");
-            if (checkStmt) {
-                checkStmt->setString(1, name);
-                auto checkRes = checkStmt->executeQuery();
-                if (checkRes->next()) {
-                    cout << "[FAILED] Menu item with name '" << checkRes->getString("Menu_name") 
-                         << "' already exists! (ID: " << checkRes->getString("MenuID") << ")" << endl;
+            if (menuNames.ensureLoaded(db)) {
+                string existingName;
+                string existingID = menuNames.find(name, &existingName);
+                if (!existingID.empty()) {
+                    cout << "[FAILED] Menu item with name '" << existingName
+                         << "' already exists! (ID: " << existingID << ")" << endl;
                     return false;
                 }
             }
 
-            string menuID = generateMenuID();
-            auto pstmt = db.prepareStatement(
-                "INSERT INTO Menu (MenuID, Menu_name, Price, Category, Availability) "
-                "VALUES (?, ?, ?, ?, 'Available')");
-            if (pstmt) {
-                pstmt->setString(1, menuID);
-                pstmt->setString(2, name);
-                pstmt->setDouble(3, price);
-                pstmt->setString(4, normalizedCategory);
-                pstmt->executeUpdate();
+            string menuID;
+            bool added = db.transaction("addMenuItem", [&]() {
+                string existingName;
+                string existingID = menuNames.findStored(db, name, &existingName);
+                if (!existingID.empty()) {
+                    cout << "[FAILED] Menu item with name '" << existingName
+                         << "' already exists! (ID: " << existingID << ")" << endl;
+                    return false;
+                }
+                menuID = generateMenuID();
+                auto pstmt = db.prepareStatement(
+                    "INSERT INTO Menu (MenuID, Menu_name, Price, Category, Availability) "
+                    "VALUES (?, ?, ?, ?, 'Available')");
+                if (pstmt) {
+                    pstmt->setString(1, menuID);
+                    pstmt->setString(2, name);
+                    pstmt->setDouble(3, price);
+                    pstmt->setString(4, toString(category));
+                    pstmt->executeUpdate();
+                    return true;
+                }
+                return false;
+            });
+
+            if (added) {
+                menuNames.insert(menuID, name);
+                if (searchIndexLoaded) {
+                    MenuSearchEntry entry;
+                    entry.menuID = menuID;
+                    entry.name = name;
+                    entry.price = price;
+                    entry.category = category;
+                    entry.availability = Availability::Available;
+                    searchIndex.upsert(entry);
+                }
                 cout << "[SUCCESS] Menu item added with ID: " << menuID << endl;
-                return true;
             }
-            return false;
+            return added;
         }
         catch (sql::SQLException& e) {
+            if (menuNames.rejected(e)) {
+                // Added elsewhere since the index was loaded
+                menuNames.invalidate();
+                cout << "[FAILED] Menu item with name '" << name << "' already exists!" << endl;
+                return false;
+            }
+            if (e.getErrorCode() == MYSQL_DUPLICATE_ENTRY) {
+                cout << "[FAILED] Another terminal added a menu item at the same time! Please try again." << endl;
+                return false;
+            }
             cerr << "Error adding menu item: " << e.what() << endl;
             return false;
         }
     }
 
+    // Add menu item with the category given as text (case-insensitive)
+    bool addMenuItem(const string& name, double price, const string& category) {
+        return addMenuItem(name, price, parseEnum<MenuCategory>(category));
+    }
+
     // Update menu price
     bool updateMenuPrice(const string& menuID, double newPrice) {
+        MODULE_SPAN("MenuModule", "updateMenuPrice");
         try {
             if (newPrice <= 0) {
                 cout << "[FAILED] Price must be greater than 0!" << endl;
@@ -241,15 +270,13 @@ public:
             if (pstmt) {
                 pstmt->setDouble(1, newPrice);
                 pstmt->setString(2, menuID);
-                int result = pstmt->executeUpdate();
-                if (result > 0) {
+                if (pstmt->executeUpdate() > 0) {
+                    searchIndex.setPrice(menuID, newPrice);
                     cout << "[SUCCESS] Price updated to RM " << fixed
                         << setprecision(2) << newPrice << endl;
                     return true;
                 }
-                else {
-                    cout << "[FAILED] Menu item not found!" << endl;
-                }
+                cout << "[FAILED] Menu item not found!" << endl;
             }
             return false;
         }
@@ -260,37 +287,24 @@ public:
     }
 
     // Update menu availability
-    bool updateMenuAvailability(const string& menuID, const string& availability) {
+    bool updateMenuAvailability(const string& menuID, Availability availability) {
+        MODULE_SPAN("MenuModule", "updateMenuAvailability");
         try {
-            // Convert input to lowercase for case-insensitive comparison
-            string availabilityLower = availability;
-            transform(availabilityLower.begin(), availabilityLower.end(), availabilityLower.begin(), ::tolower);
-            
-            // Normalize to proper case format
-            string normalizedAvailability;
-            if (availabilityLower == "available") {
-                normalizedAvailability = "Available";
-            }
-            else if (availabilityLower == "unavailable") {
-                normalizedAvailability = "Unavailable";
-            }
-            else {
+            if (availability == Availability::Unknown) {
                 cout << "[FAILED] Invalid status! Use 'Available' or 'Unavailable'." << endl;
                 return false;
             }
 
             auto pstmt = db.prepareStatement("UPDATE Menu SET Availability = ? WHERE MenuID = ?");
             if (pstmt) {
-                pstmt->setString(1, normalizedAvailability);
+                pstmt->setString(1, toString(availability));
                 pstmt->setString(2, menuID);
-                int result = pstmt->executeUpdate();
-                if (result > 0) {
-                    cout << "[SUCCESS] Availability updated to " << normalizedAvailability << endl;
+                if (pstmt->executeUpdate() > 0) {
+                    searchIndex.setAvailability(menuID, availability);
+                    cout << "[SUCCESS] Availability updated to " << toString(availability) << endl;
                     return true;
                 }
-                else {
-                    cout << "[FAILED] Menu item not found!" << endl;
-                }
+                cout << "[FAILED] Menu item not found!" << endl;
             }
             return false;
         }
@@ -300,34 +314,43 @@ public:
         }
     }
 
+    // Update menu availability from user input (case-insensitive)
+    bool updateMenuAvailability(const string& menuID, const string& availability) {
+        return updateMenuAvailability(menuID, parseEnum<Availability>(availability));
+    }
+
     // Delete menu item
     bool deleteMenuItem(const string& menuID) {
+        MODULE_SPAN("MenuModule", "deleteMenuItem");
         try {
-            // Check if menu item has orders
-            auto checkStmt = db.prepareStatement("SELECT Order_itemID FROM Order_Item WHERE MenuID = ?");
-            if (checkStmt) {
-                checkStmt->setString(1, menuID);
-                auto checkRes = checkStmt->executeQuery();
-                if (checkRes->next()) {
-                    cout << "[FAILED] Cannot delete menu item with existing orders!" << endl;
-                    cout << "[INFO] Set availability to 'Unavailable' instead." << endl;
-                    return false;
+            bool deleted = db.transaction("deleteMenuItem", [&]() {
+                // Check if menu item has orders
+                auto checkStmt = db.prepareStatement("SELECT Order_itemID FROM Order_Item WHERE MenuID = ?");
+                if (checkStmt) {
+                    checkStmt->setString(1, menuID);
+                    auto checkRes = checkStmt->executeQuery();
+                    if (checkRes->next()) {
+                        cout << "[FAILED] Cannot delete menu item with existing orders!" << endl;
+                        cout << "[INFO] Set availability to 'Unavailable' instead." << endl;
+                        return false;
+                    }
                 }
-            }
 
-            auto pstmt = db.prepareStatement("DELETE FROM Menu WHERE MenuID = ?");
-            if (pstmt) {
-                pstmt->setString(1, menuID);
-                int result = pstmt->executeUpdate();
-                if (result > 0) {
-                    cout << "[SUCCESS] Menu item deleted successfully!" << endl;
-                    return true;
-                }
-                else {
+                auto pstmt = db.prepareStatement("DELETE FROM Menu WHERE MenuID = ?");
+                if (pstmt) {
+                    pstmt->setString(1, menuID);
+                    if (pstmt->executeUpdate() > 0) return true;
                     cout << "[FAILED] Menu item not found!" << endl;
                 }
+                return false;
+            });
+
+            if (deleted) {
+                searchIndex.remove(menuID);
+                menuNames.eraseID(menuID);
+                cout << "[SUCCESS] Menu item deleted successfully!" << endl;
             }
-            return false;
+            return deleted;
         }
         catch (sql::SQLException& e) {
             cerr << "Error deleting menu item: " << e.what() << endl;
@@ -337,6 +360,7 @@ public:
 
     // Get menu item price (for order processing)
     double getMenuPrice(const string& menuID) {
+        MODULE_SPAN("MenuModule", "getMenuPrice");
         try {
             auto pstmt = db.prepareStatement(
                 "SELECT Price FROM Menu WHERE MenuID = ? AND Availability = 'Available'");
@@ -357,6 +381,7 @@ public:
 
     // Check if menu item is available
     bool isMenuAvailable(const string& menuID) {
+        MODULE_SPAN("MenuModule", "isMenuAvailable");
         try {
             auto pstmt = db.prepareStatement(
                 "SELECT MenuID FROM Menu WHERE MenuID = ? AND Availability = 'Available'");
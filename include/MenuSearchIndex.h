@@ -0,0 +1,227 @@
+#pragma once
+#include "Status.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#include <cctype>
+
+using namespace std;
+
+struct MenuSearchEntry {
+    string menuID;
+    string name;
+    double price = 0;
+    MenuCategory category = MenuCategory::Unknown;
+    Availability availability = Availability::Unknown;
+};
+
+struct MenuSearchHit {
+    const MenuSearchEntry* entry;
+    double score;
+};
+
+// In-memory trigram inverted index over menu names.
+//
+// Names are lowercased, punctuation becomes a word break, and every word is
+// padded with two leading blanks, so "Nasi Lemak" yields "  n", " na", "nas",
+// "asi", ..., "  l", " le", ... The padded trigrams make one- and two-letter
+// queries behave as word-prefix searches, and full trigrams give typo
+// tolerance: "nasi lemk" still shares most trigrams with "Nasi Lemak".
+//
+// A query is scored against each candidate by trigram overlap (Dice
+// coefficient), with a bonus when the query is a prefix of a word or a
+// substring of the name. Only items sharing at least one trigram with the
+// query are ever touched.
+class MenuSearchIndex {
+private:
+    vector<MenuSearchEntry> entries;      // slot -> item; freed slots have empty menuID
+    vector<uint32_t> freeSlots;
+    vector<uint16_t> trigramCounts;       // slot -> distinct trigrams in the name
+    vector<string> normalizedNames;       // slot -> normalize(name)
+    unordered_map<string, uint32_t> slotByID;
+    unordered_map<uint32_t, vector<uint32_t>> postings;   // trigram -> sorted slots
+
+    // Scratch space reused between searches
+    vector<uint16_t> matches;
+    vector<uint32_t> touched;
+
+    static string normalize(const string& text) {
+        string out;
+        out.reserve(text.size());
+        for (unsigned char c : text) {
+            out += isalnum(c) ? (char)tolower(c) : ' ';
+        }
+        return out;
+    }
+
+    static uint32_t pack(char a, char b, char c) {
+        return ((uint32_t)(unsigned char)a << 16) | ((uint32_t)(unsigned char)b << 8) | (unsigned char)c;
+    }
+
+    // Distinct trigrams of a normalized string, sorted
+    static vector<uint32_t> trigrams(const string& normalized) {
+        vector<uint32_t> out;
+        size_t i = 0;
+        while (i < normalized.size()) {
+            while (i < normalized.size() && normalized[i] == ' ') i++;
+            size_t start = i;
+            while (i < normalized.size() && normalized[i] != ' ') i++;
+            if (i == start) break;
+
+            string word = "  " + normalized.substr(start, i - start);
+            for (size_t j = 0; j + 3 <= word.size(); j++) {
+                out.push_back(pack(word[j], word[j + 1], word[j + 2]));
+            }
+        }
+        sort(out.begin(), out.end());
+        out.erase(unique(out.begin(), out.end()), out.end());
+        return out;
+    }
+
+    void indexSlot(uint32_t slot) {
+        normalizedNames[slot] = normalize(entries[slot].name);
+        vector<uint32_t> grams = trigrams(normalizedNames[slot]);
+        trigramCounts[slot] = (uint16_t)min<size_t>(grams.size(), 0xFFFF);
+        for (uint32_t gram : grams) {
+            vector<uint32_t>& list = postings[gram];
+            list.insert(lower_bound(list.begin(), list.end(), slot), slot);
+        }
+    }
+
+    void unindexSlot(uint32_t slot) {
+        for (uint32_t gram : trigrams(normalizedNames[slot])) {
+            auto it = postings.find(gram);
+            if (it == postings.end()) continue;
+            vector<uint32_t>& list = it->second;
+            auto pos = lower_bound(list.begin(), list.end(), slot);
+            if (pos != list.end() && *pos == slot) list.erase(pos);
+            if (list.empty()) postings.erase(it);
+        }
+    }
+
+    static bool isWordPrefix(const string& name, const string& query) {
+        size_t pos = 0;
+        while ((pos = name.find(query, pos)) != string::npos) {
+            if (pos == 0 || name[pos - 1] == ' ') return true;
+            pos++;
+        }
+        return false;
+    }
+
+public:
+    void clear() {
+        entries.clear();
+        freeSlots.clear();
+        trigramCounts.clear();
+        normalizedNames.clear();
+        slotByID.clear();
+        postings.clear();
+    }
+
+    size_t size() const { return slotByID.size(); }
+
+    // Add an item, or re-index it if the ID is already present
+    void upsert(const MenuSearchEntry& entry) {
+        auto it = slotByID.find(entry.menuID);
+        if (it != slotByID.end()) {
+            uint32_t slot = it->second;
+            if (entries[slot].name != entry.name) {
+                unindexSlot(slot);
+                entries[slot] = entry;
+                indexSlot(slot);
+            }
+            else {
+                entries[slot] = entry;
+            }
+            return;
+        }
+
+        uint32_t slot;
+        if (!freeSlots.empty()) {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+            entries[slot] = entry;
+        }
+        else {
+            slot = (uint32_t)entries.size();
+            entries.push_back(entry);
+            trigramCounts.push_back(0);
+            normalizedNames.emplace_back();
+        }
+        slotByID[entry.menuID] = slot;
+        indexSlot(slot);
+    }
+
+    void remove(const string& menuID) {
+        auto it = slotByID.find(menuID);
+        if (it == slotByID.end()) return;
+        uint32_t slot = it->second;
+        unindexSlot(slot);
+        entries[slot] = MenuSearchEntry();
+        freeSlots.push_back(slot);
+        slotByID.erase(it);
+    }
+
+    // Price and availability are not part of the name, so no re-indexing
+    void setPrice(const string& menuID, double price) {
+        auto it = slotByID.find(menuID);
+        if (it != slotByID.end()) entries[it->second].price = price;
+    }
+
+    void setAvailability(const string& menuID, Availability availability) {
+        auto it = slotByID.find(menuID);
+        if (it != slotByID.end()) entries[it->second].availability = availability;
+    }
+
+    // Best topK matches, highest score first. Ties go to the shorter name,
+    // then the lower ID.
+    vector<MenuSearchHit> search(const string& query, size_t topK) {
+        vector<MenuSearchHit> hits;
+        string normalizedQuery = normalize(query);
+        vector<uint32_t> queryGrams = trigrams(normalizedQuery);
+        if (queryGrams.empty() || topK == 0) return hits;
+
+        size_t first = normalizedQuery.find_first_not_of(' ');
+        size_t last = normalizedQuery.find_last_not_of(' ');
+        string trimmedQuery = normalizedQuery.substr(first, last - first + 1);
+
+        matches.resize(entries.size(), 0);
+        touched.clear();
+        for (uint32_t gram : queryGrams) {
+            auto it = postings.find(gram);
+            if (it == postings.end()) continue;
+            for (uint32_t slot : it->second) {
+                if (matches[slot]++ == 0) touched.push_back(slot);
+            }
+        }
+
+        // A typo costs up to three trigrams; require a third of the query to match
+        size_t required = max<size_t>(1, (queryGrams.size() + 2) / 3);
+        for (uint32_t slot : touched) {
+            uint16_t matched = matches[slot];
+            matches[slot] = 0;   // leave the scratch array zeroed for the next search
+            if (matched < required) continue;
+            double score = 2.0 * matched / (queryGrams.size() + trigramCounts[slot]);
+            const string& name = normalizedNames[slot];
+            if (isWordPrefix(name, trimmedQuery)) score += 1.0;
+            else if (name.find(trimmedQuery) != string::npos) score += 0.5;
+            hits.push_back({ &entries[slot], score });
+        }
+
+        auto better = [](const MenuSearchHit& a, const MenuSearchHit& b) {
+            if (a.score != b.score) return a.score > b.score;
+            if (a.entry->name.size() != b.entry->name.size()) return a.entry->name.size() < b.entry->name.size();
+            return a.entry->menuID < b.entry->menuID;
+        };
+        if (hits.size() > topK) {
+            partial_sort(hits.begin(), hits.begin() + topK, hits.end(), better);
+            hits.resize(topK);
+        }
+        else {
+            sort(hits.begin(), hits.end(), better);
+        }
+        return hits;
+    }
+};
@@ -0,0 +1,211 @@
+#pragma once
+#include "Tracing.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+using namespace std;
+
+// Process-wide metrics in Prometheus text format. Updating a metric is a
+// relaxed atomic add; only registration takes a lock, and call sites
+// register once by keeping the returned reference in a function-local
+// static:
+//
+//   static Counter& created = Metrics::instance().counter(
+//       "restaurant_orders_created_total", "Orders created");
+//   created.inc();
+
+class Counter {
+private:
+    atomic<uint64_t> value{ 0 };
+
+public:
+    void inc(uint64_t n = 1) { value.fetch_add(n, memory_order_relaxed); }
+    uint64_t get() const { return value.load(memory_order_relaxed); }
+};
+
+class Gauge {
+private:
+    atomic<int64_t> value{ 0 };
+
+public:
+    void set(int64_t v) { value.store(v, memory_order_relaxed); }
+    void add(int64_t n) { value.fetch_add(n, memory_order_relaxed); }
+    void inc() { add(1); }
+    void dec() { add(-1); }
+    int64_t get() const { return value.load(memory_order_relaxed); }
+};
+
+// Latency histogram with fixed buckets from 0.5 ms to 5 s
+class Histogram {
+public:
+    static const int bucketCount = 13;
+
+    static const double* bounds() {
+        static const double b[bucketCount] = {
+            0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5 };
+        return b;
+    }
+
+    void observeMicros(uint64_t micros) {
+        double seconds = micros / 1e6;
+        const double* b = bounds();
+        int i = 0;
+        while (i < bucketCount && seconds > b[i]) i++;
+        buckets[i].fetch_add(1, memory_order_relaxed);   // bucketCount = +Inf
+        sumMicros.fetch_add(micros, memory_order_relaxed);
+    }
+
+    uint64_t bucket(int i) const { return buckets[i].load(memory_order_relaxed); }
+    uint64_t sum() const { return sumMicros.load(memory_order_relaxed); }
+
+private:
+    atomic<uint64_t> buckets[bucketCount + 1] = {};
+    atomic<uint64_t> sumMicros{ 0 };
+};
+
+class Metrics {
+private:
+    enum Kind { CounterKind, GaugeKind, HistogramKind };
+
+    struct Entry {
+        string name;
+        string help;
+        string labels;   // e.g. method="Cash"
+        Kind kind;
+        unique_ptr<Counter> counter;
+        unique_ptr<Gauge> gauge;
+        unique_ptr<Histogram> histogram;
+    };
+
+    mutex registryLock;
+    vector<unique_ptr<Entry>> entries;
+
+    Metrics() {}
+
+    Entry& find(const string& name, const string& help, const string& labels, Kind kind) {
+        lock_guard<mutex> guard(registryLock);
+        for (auto& e : entries) {
+            if (e->name == name && e->labels == labels) return *e;
+        }
+        unique_ptr<Entry> e(new Entry());
+        e->name = name;
+        e->help = help;
+        e->labels = labels;
+        e->kind = kind;
+        if (kind == CounterKind) e->counter.reset(new Counter());
+        if (kind == GaugeKind) e->gauge.reset(new Gauge());
+        if (kind == HistogramKind) e->histogram.reset(new Histogram());
+        entries.push_back(move(e));
+        return *entries.back();
+    }
+
+    static string withLabels(const string& name, const string& labels, const string& extra = "") {
+        if (labels.empty() && extra.empty()) return name;
+        string out = name + "{" + labels;
+        if (!labels.empty() && !extra.empty()) out += ",";
+        return out + extra + "}";
+    }
+
+public:
+    static Metrics& instance() {
+        static Metrics metrics;
+        return metrics;
+    }
+
+    Counter& counter(const string& name, const string& help, const string& labels = "") {
+        return *find(name, help, labels, CounterKind).counter;
+    }
+
+    Gauge& gauge(const string& name, const string& help, const string& labels = "") {
+        return *find(name, help, labels, GaugeKind).gauge;
+    }
+
+    Histogram& histogram(const string& name, const string& help, const string& labels = "") {
+        return *find(name, help, labels, HistogramKind).histogram;
+    }
+
+    // Prometheus text exposition format, version 0.0.4
+    string render() {
+        lock_guard<mutex> guard(registryLock);
+        string out;
+        out.reserve(entries.size() * 256);
+        char number[64];
+        vector<bool> done(entries.size(), false);
+
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (done[i]) continue;
+            const Entry& family = *entries[i];
+            const char* type = family.kind == CounterKind ? "counter"
+                : family.kind == GaugeKind ? "gauge" : "histogram";
+            out += "# HELP " + family.name + " " + family.help + "\n";
+            out += "# TYPE " + family.name + " " + type + "\n";
+
+            for (size_t j = i; j < entries.size(); j++) {
+                const Entry& e = *entries[j];
+                if (e.name != family.name) continue;
+                done[j] = true;
+
+                if (e.kind == CounterKind) {
+                    snprintf(number, sizeof(number), " %llu\n", (unsigned long long)e.counter->get());
+                    out += withLabels(e.name, e.labels) + number;
+                }
+                else if (e.kind == GaugeKind) {
+                    snprintf(number, sizeof(number), " %lld\n", (long long)e.gauge->get());
+                    out += withLabels(e.name, e.labels) + number;
+                }
+                else {
+                    const double* bounds = Histogram::bounds();
+                    uint64_t cumulative = 0;
+                    for (int b = 0; b <= Histogram::bucketCount; b++) {
+                        cumulative += e.histogram->bucket(b);
+                        string le = b < Histogram::bucketCount ? "" : "+Inf";
+                        if (le.empty()) {
+                            snprintf(number, sizeof(number), "%g", bounds[b]);
+                            le = number;
+                        }
+                        snprintf(number, sizeof(number), " %llu\n", (unsigned long long)cumulative);
+                        out += withLabels(e.name + "_bucket", e.labels, "le=\"" + le + "\"") + number;
+                    }
+                    snprintf(number, sizeof(number), " %.6f\n", e.histogram->sum() / 1e6);
+                    out += withLabels(e.name + "_sum", e.labels) + number;
+                    snprintf(number, sizeof(number), " %llu\n", (unsigned long long)cumulative);
+                    out += withLabels(e.name + "_count", e.labels) + number;
+                }
+            }
+        }
+        return out;
+    }
+};
+
+// Observes the lifetime of the object into a histogram
+class LatencyTimer {
+private:
+    Histogram& histogram;
+    chrono::steady_clock::time_point start;
+
+public:
+    LatencyTimer(Histogram& target) : histogram(target), start(chrono::steady_clock::now()) {}
+
+    ~LatencyTimer() {
+        histogram.observeMicros((uint64_t)chrono::duration_cast<chrono::microseconds>(
+            chrono::steady_clock::now() - start).count());
+    }
+
+    LatencyTimer(const LatencyTimer&) = delete;
+    LatencyTimer& operator=(const LatencyTimer&) = delete;
+};
+
+// Trace span plus per-method latency histogram for a public module method.
+// module and method must be string literals.
+#define MODULE_SPAN(module, method) \
+    TRACE_SPAN(module, method); \
+    static Histogram& TRACE_CONCAT(moduleLatency_, __LINE__) = Metrics::instance().histogram( \
+        "restaurant_module_latency_seconds", "Latency of public module methods", \
+        "module=\"" module "\",method=\"" method "\""); \
+    LatencyTimer TRACE_CONCAT(moduleTimer_, __LINE__)(TRACE_CONCAT(moduleLatency_, __LINE__))
@@ -0,0 +1,178 @@
+#pragma once
+#include "DatabaseConnection.h"
+#include "Metrics.h"
+#include <string>
+#include <thread>
+#include <atomic>
+#include <iostream>
+#include <cstring>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "Ws2_32.lib")
+typedef SOCKET MetricsSocket;
+#define METRICS_INVALID_SOCKET INVALID_SOCKET
+#define metricsCloseSocket closesocket
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+typedef int MetricsSocket;
+#define METRICS_INVALID_SOCKET (-1)
+#define metricsCloseSocket close
+#endif
+
+using namespace std;
+
+// Serves Metrics::instance() in Prometheus text format on
+// http://127.0.0.1:<port>/metrics from a background thread.
+//
+// Everything except the table and order gauges is maintained by the code
+// that changes it. Open tables are read at scrape time over the server's
+// own connection, and the active order gauge is seeded from the database
+// once at start so it is right even when orders were left open by an
+// earlier run.
+class MetricsServer {
+private:
+    int port;
+    MetricsSocket listener = METRICS_INVALID_SOCKET;
+    atomic<bool> running{ false };
+    thread worker;
+    DatabaseConnection db{ false };
+
+    static Gauge& openTables() {
+        static Gauge& gauge = Metrics::instance().gauge(
+            "restaurant_open_tables", "Tables that are not Vacant");
+        return gauge;
+    }
+
+    long long countRows(const string& query) {
+        try {
+            auto res = db.executeQuery(query);
+            if (res && res->next()) return res->getInt(1);
+        }
+        catch (sql::SQLException& e) {
+            cerr << "[METRICS] Query error: " << e.what() << endl;
+        }
+        return -1;
+    }
+
+    void refreshDatabaseGauges() {
+        long long tables = countRows("SELECT COUNT(*) FROM Tables WHERE Status <> 'Vacant'");
+        if (tables >= 0) openTables().set(tables);
+    }
+
+    void handle(MetricsSocket client) {
+        char request[1024];
+        int received = recv(client, request, sizeof(request) - 1, 0);
+        if (received <= 0) return;
+        request[received] = '\0';
+
+        string status = "200 OK";
+        string body;
+        if (strncmp(request, "GET /metrics", 12) == 0) {
+            refreshDatabaseGauges();
+            body = Metrics::instance().render();
+        }
+        else {
+            status = "404 Not Found";
+            body = "Not found. Try /metrics\n";
+        }
+
+        string response = "HTTP/1.1 " + status + "\r\n"
+            "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+            "Content-Length: " + to_string(body.size()) + "\r\n"
+            "Connection: close\r\n\r\n" + body;
+        size_t sent = 0;
+        while (sent < response.size()) {
+            int n = send(client, response.data() + sent, (int)(response.size() - sent), 0);
+            if (n <= 0) break;
+            sent += (size_t)n;
+        }
+    }
+
+    void serve() {
+        sql::mysql::get_mysql_driver_instance()->threadInit();
+        db.connect();
+
+        static Gauge& activeOrders = Metrics::instance().gauge(
+            "restaurant_active_orders", "Orders currently active");
+        long long active = countRows("SELECT COUNT(*) FROM Orders WHERE Order_status = 'Active'");
+        if (active >= 0) activeOrders.set(active);
+        else cerr << "[WARNING] Cannot count active orders; restaurant_active_orders starts from 0." << endl;
+
+        while (running.load()) {
+            MetricsSocket client = accept(listener, nullptr, nullptr);
+            if (client == METRICS_INVALID_SOCKET) continue;   // listener closed by stop()
+            handle(client);
+            metricsCloseSocket(client);
+        }
+
+        db.disconnect();
+        sql::mysql::get_mysql_driver_instance()->threadEnd();
+    }
+
+public:
+    MetricsServer(int listenPort) : port(listenPort) {}
+
+    ~MetricsServer() {
+        stop();
+    }
+
+    // Bind to 127.0.0.1:port and start serving. Returns false if the port is unavailable.
+    bool start() {
+#ifdef _WIN32
+        WSADATA wsaData;
+        if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+            cerr << "[FAILED] Winsock initialization failed" << endl;
+            return false;
+        }
+#endif
+        listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (listener == METRICS_INVALID_SOCKET) {
+            cerr << "[FAILED] Cannot create metrics socket" << endl;
+            return false;
+        }
+
+        int reuse = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+
+        sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons((unsigned short)port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        if (bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 8) != 0) {
+            cerr << "[FAILED] Cannot listen for metrics on port " << port << endl;
+            metricsCloseSocket(listener);
+            listener = METRICS_INVALID_SOCKET;
+            return false;
+        }
+
+        running = true;
+        worker = thread(&MetricsServer::serve, this);
+        clog << "Metrics available at http://127.0.0.1:" << port << "/metrics" << endl;
+        return true;
+    }
+
+    void stop() {
+        if (!running.exchange(false)) return;
+#ifdef _WIN32
+        closesocket(listener);
+#else
+        shutdown(listener, SHUT_RDWR);
+        close(listener);
+#endif
+        listener = METRICS_INVALID_SOCKET;
+        if (worker.joinable()) worker.join();
+#ifdef _WIN32
+        WSACleanup();
+#endif
+    }
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+};
@@ -0,0 +1,152 @@
+#pragma once
+#include "DatabaseConnection.h"
+#include "SchemaCheck.h"
+#include <string>
+#include <unordered_map>
+#include <iostream>
+#include <cctype>
+
+using namespace std;
+
+// Canonical form used for uniqueness: surrounding blanks removed, inner
+// runs of whitespace collapsed to one space, ASCII letters lowercased.
+// database/normalized_keys.sql computes the same key in MySQL.
+inline string normalizeKey(const string& value) {
+    string key;
+    key.reserve(value.size());
+    bool pendingSpace = false;
+    for (unsigned char c : value) {
+        if (isspace(c)) {
+            pendingSpace = !key.empty();
+            continue;
+        }
+        if (pendingSpace) {
+            key += ' ';
+            pendingSpace = false;
+        }
+        key += (char)tolower(c);
+    }
+    return key;
+}
+
+// MySQL error code for a duplicate entry in a unique index
+const int MYSQL_DUPLICATE_ENTRY = 1062;
+
+// In-memory hash index from normalized key to row ID, used by the
+// uniqueness checks on Menu.Menu_name, Tables.Table_number and Staff.Email.
+// It is loaded with one query the first time it is needed and then kept up
+// to date by the owning module, so a duplicate check is a hash lookup
+// instead of a LOWER(...) = LOWER(?) scan. The unique indexes from
+// database/normalized_keys.sql remain the authority when another process
+// inserts a row this index has not seen; without them the insert
+// transaction asks the table with findStored() instead.
+class NormalizedKeyIndex {
+private:
+    string loadQuery;     // selects (id, value)
+    string lookupQuery;   // selects (id, value) of the row with value ?
+    string table;
+    string keyColumn;     // generated key column of normalized_keys.sql
+    string uniqueIndex;   // its unique index
+    bool loaded = false;
+    unordered_map<string, pair<string, string>> byKey;   // key -> (id, original value)
+    unordered_map<string, string> keyByID;
+
+public:
+    NormalizedKeyIndex(const string& idAndValueQuery) : loadQuery(idAndValueQuery) {}
+
+    // Index over valueColumn of tableName, whose normalized copy is
+    // keyName with unique index indexName once normalized_keys.sql is run
+    NormalizedKeyIndex(const string& tableName, const string& idColumn, const string& valueColumn,
+        const string& keyName, const string& indexName)
+        : loadQuery("SELECT " + idColumn + ", " + valueColumn + " FROM " + tableName),
+          lookupQuery("SELECT " + idColumn + ", " + valueColumn + " FROM " + tableName
+              + " WHERE " + valueColumn + " = ? LIMIT 1"),
+          table(tableName), keyColumn(keyName), uniqueIndex(indexName) {}
+
+    // True if the database rejects duplicates itself (see SchemaCheck)
+    bool enforced(DatabaseConnection& db) const {
+        return !keyColumn.empty() && SchemaCheck::hasColumn(db, table, keyColumn);
+    }
+
+    // Without the unique index, the ID of a stored row with value (the
+    // column's collation ignores case), so a row another terminal added
+    // since load() is still found; empty if there is none or the index
+    // makes the check unnecessary. Call inside the insert transaction.
+    // Throws sql::SQLException.
+    string findStored(DatabaseConnection& db, const string& value, string* existingValue = nullptr) {
+        if (lookupQuery.empty() || enforced(db)) return "";
+        auto pstmt = db.prepareStatement(lookupQuery);
+        if (!pstmt) return "";
+        pstmt->setString(1, value);
+        unique_ptr<sql::ResultSet> res(pstmt->executeQuery());
+        if (!res->next()) return "";
+        string id = res->getString(1);
+        string stored = res->getString(2);
+        insert(id, stored);
+        if (existingValue) *existingValue = stored;
+        return id;
+    }
+
+    // True if e is a duplicate on this index's unique key (not, say, on
+    // the primary key)
+    bool rejected(const sql::SQLException& e) const {
+        return e.getErrorCode() == MYSQL_DUPLICATE_ENTRY && !uniqueIndex.empty()
+            && string(e.what()).find(uniqueIndex) != string::npos;
+    }
+
+    bool load(DatabaseConnection& db) {
+        try {
+            auto res = db.executeQuery(loadQuery);
+            if (!res) return false;
+            clear();
+            while (res->next()) {
+                insert(res->getString(1), res->getString(2));
+            }
+            loaded = true;
+            return true;
+        }
+        catch (sql::SQLException& e) {
+            cerr << "Error loading key index: " << e.what() << endl;
+            return false;
+        }
+    }
+
+    bool ensureLoaded(DatabaseConnection& db) {
+        return loaded || load(db);
+    }
+
+    // Mark stale so the next ensureLoaded() reads the table again
+    void invalidate() { loaded = false; }
+
+    void clear() {
+        byKey.clear();
+        keyByID.clear();
+    }
+
+    size_t size() const { return byKey.size(); }
+
+    // ID of the row whose value normalizes to the same key, or empty.
+    // existingValue receives that row's value as stored.
+    string find(const string& value, string* existingValue = nullptr) const {
+        auto it = byKey.find(normalizeKey(value));
+        if (it == byKey.end()) return "";
+        if (existingValue) *existingValue = it->second.second;
+        return it->second.first;
+    }
+
+    // Returns false (and changes nothing) if the key is already taken
+    bool insert(const string& id, const string& value) {
+        string key = normalizeKey(value);
+        if (byKey.count(key)) return false;
+        byKey.emplace(key, make_pair(id, value));
+        keyByID[id] = key;
+        return true;
+    }
+
+    void eraseID(const string& id) {
+        auto it = keyByID.find(id);
+        if (it == keyByID.end()) return;
+        byKey.erase(it->second);
+        keyByID.erase(it);
+    }
+};
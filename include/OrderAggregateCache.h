@@ -0,0 +1,162 @@
+#pragma once
+#include "DatabaseConnection.h"
+#include "RowMapping.h"
+#include "Rows.h"
+#include "SchemaCheck.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <optional>
+
+using namespace std;
+
+// Loads an order together with its bill and lines in one query, and keeps
+// what it loaded for the rest of an operation.
+//
+//   void staffProcessPayment() {
+//       OrderAggregateCache::Scope scope;
+//       orderModule->viewOrderDetails(orderID);   // one query
+//       billingModule->processPayment(billID);    // patches the cached bill
+//       billingModule->viewBillDetails(billID);   // no query
+//   }
+//
+// Without a Scope on the calling thread every load goes to the database.
+// Writes that change an order call forget() or paid() so a cached copy
+// never shows something the database no longer holds.
+class OrderAggregateCache {
+public:
+    // Keeps loaded aggregates until it goes out of scope. Nested scopes
+    // share the outermost one.
+    class Scope {
+    private:
+        map<string, OrderAggregate> byOrder;
+        bool owner;
+
+        friend class OrderAggregateCache;
+
+    public:
+        Scope() : owner(current() == nullptr) {
+            if (owner) current() = this;
+        }
+
+        ~Scope() {
+            if (owner) current() = nullptr;
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+private:
+    static Scope*& current() {
+        static thread_local Scope* scope = nullptr;
+        return scope;
+    }
+
+    // The detail lines, then version (o.Version, or NULL without the
+    // column), so what is shown and the version a conditional write sends
+    // back come from the same read
+    static string detailQuery(const char* version, const char* where) {
+        return "SELECT " + selectList<OrderDetailLine>() + ", " + version + " " + OrderDetailLine::from + where;
+    }
+
+    static bool versioned(DatabaseConnection& db) {
+        return SchemaCheck::hasColumn(db, "Orders", "Version");
+    }
+
+    // Run a detail query for key; remember the result in the active scope
+    static optional<OrderAggregate> load(DatabaseConnection& db, const string& query, const string& key) {
+        static const uint32_t versionIndex = (uint32_t)tuple_size_v<decltype(OrderDetailLine::columns())> + 1;
+        auto pstmt = db.prepareStatement(query);
+        if (!pstmt) return nullopt;
+        pstmt->setString(1, key);
+        unique_ptr<sql::ResultSet> res(pstmt->executeQuery());
+        vector<OrderDetailLine> lines;
+        optional<RowVersion> version;
+        while (res->next()) {
+            lines.push_back(mapRow<OrderDetailLine>(*res));
+            if (!res->isNull(versionIndex)) version = (RowVersion)res->getUInt64(versionIndex);
+        }
+        OrderAggregate aggregate = assemble(lines);
+        aggregate.version = version;
+        if (current() && aggregate.found) {
+            current()->byOrder[aggregate.order.orderID] = aggregate;
+        }
+        return aggregate;
+    }
+
+public:
+    // Build the aggregate of one order from its detail lines
+    static OrderAggregate assemble(const vector<OrderDetailLine>& lines) {
+        OrderAggregate aggregate;
+        if (lines.empty()) return aggregate;
+
+        const OrderDetailLine& first = lines.front();
+        aggregate.found = true;
+        aggregate.order = { first.orderID, first.tableNumber, first.staffName,
+            first.totalAmount, first.status, first.orderDate };
+        aggregate.billed = !first.billID.empty();
+        if (aggregate.billed) {
+            aggregate.bill = { first.billID, first.orderID, first.billStaffName,
+                first.billDate, first.billTotal, first.paymentMethod, first.paymentStatus };
+        }
+        aggregate.items.reserve(lines.size());
+        for (const OrderDetailLine& line : lines) {
+            if (line.orderItemID.empty()) continue;
+            aggregate.items.push_back({ line.orderItemID, line.menuName,
+                line.quantity, line.unitPrice, line.itemTotal });
+        }
+        return aggregate;
+    }
+
+    // True while a Scope is open on this thread
+    static bool active() { return current() != nullptr; }
+
+    // An order with its bill and lines (found is false if there is no such
+    // order; nullopt if the query failed). Throws sql::SQLException.
+    static optional<OrderAggregate> loadOrder(DatabaseConnection& db, const string& orderID) {
+        if (Scope* scope = current()) {
+            auto it = scope->byOrder.find(orderID);
+            if (it != scope->byOrder.end()) return it->second;
+        }
+        static const char* where = "WHERE o.OrderID = ? ORDER BY oi.Order_itemID";
+        static const string withVersion = detailQuery("o.Version", where);
+        static const string withoutVersion = detailQuery("NULL", where);
+        return load(db, versioned(db) ? withVersion : withoutVersion, orderID);
+    }
+
+    // The order a bill belongs to, loaded by bill ID (found is false if
+    // there is no such bill)
+    static optional<OrderAggregate> loadBill(DatabaseConnection& db, const string& billID) {
+        if (Scope* scope = current()) {
+            for (const auto& entry : scope->byOrder) {
+                if (entry.second.billed && entry.second.bill.billID == billID) return entry.second;
+            }
+        }
+        static const char* where = "WHERE b.BillID = ? ORDER BY oi.Order_itemID";
+        static const string withVersion = detailQuery("o.Version", where);
+        static const string withoutVersion = detailQuery("NULL", where);
+        return load(db, versioned(db) ? withVersion : withoutVersion, billID);
+    }
+
+    // Drop a cached order after its lines, status or bill changed
+    static void forget(const string& orderID) {
+        if (Scope* scope = current()) scope->byOrder.erase(orderID);
+    }
+
+    // Drop every cached order (for writes that only know a line ID)
+    static void forgetAll() {
+        if (Scope* scope = current()) scope->byOrder.clear();
+    }
+
+    // A bill was marked Paid. The payment trigger completes its order; the
+    // date, totals and lines are left as they were.
+    static void paid(const string& orderID) {
+        Scope* scope = current();
+        if (!scope) return;
+        auto it = scope->byOrder.find(orderID);
+        if (it == scope->byOrder.end() || !it->second.billed) return;
+        it->second.bill.paymentStatus = PaymentStatus::Paid;
+        it->second.order.status = OrderStatus::Completed;
+    }
+};
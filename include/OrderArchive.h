@@ -0,0 +1,231 @@
+#pragma once
+#include "DatabaseConnection.h"
+#include "Metrics.h"
+#include "SchemaCheck.h"
+#include <string>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <chrono>
+
+using namespace std;
+
+// The history tables and views of database/order_archive.sql. Reports read
+// orders and bills through the All_* views so archived rows still count,
+// and the ID generators stay above the highest archived ID so an archived
+// order's ID is never handed out again. Without the script both fall back
+// to the hot tables alone.
+class ArchiveSchema {
+private:
+    DatabaseConnection& db;
+
+public:
+    explicit ArchiveSchema(DatabaseConnection& database) : db(database) {}
+
+    // True if the history tables and views exist (see SchemaCheck)
+    bool available() {
+        return SchemaCheck::hasArchive(db);
+    }
+
+    // The view over table and its history ("All_Orders" for "Orders"), or
+    // table itself without the archive
+    string allRows(const string& table) {
+        if (!available()) return table;
+        return table == "Order_Item" ? "All_Order_Items" : table == "Bill" ? "All_Bills" : "All_" + table;
+    }
+
+    // SQL expression for the number in the highest keyColumn moved to
+    // table's history ("0" without the archive). The IDs have a fixed width,
+    // so MAX reads one end of the primary key.
+    string highWater(const string& table, const string& keyColumn) {
+        if (!available()) return "0";
+        return "(SELECT COALESCE(CAST(SUBSTRING(MAX(" + keyColumn + "), 4) AS UNSIGNED), 0) FROM "
+            + table + "_History)";
+    }
+};
+
+struct ArchiveConfig {
+    int days = 90;             // move orders placed more than this many days ago
+    size_t batchOrders = 200;  // orders (with their items and bill) per transaction
+    int pauseMs = 50;          // between batches, so service writes get the locks
+    size_t maxOrders = 0;      // stop after this many orders (0 = all)
+
+    bool set(const string& key, const string& value) {
+        if (key == "days") days = atoi(value.c_str());
+        else if (key == "batch") batchOrders = (size_t)atol(value.c_str());
+        else if (key == "pause") pauseMs = atoi(value.c_str());
+        else if (key == "limit") maxOrders = (size_t)atol(value.c_str());
+        else return false;
+        return true;
+    }
+
+    bool valid() const {
+        return days >= 0 && batchOrders > 0 && pauseMs >= 0;
+    }
+};
+
+// Moves Completed and Cancelled orders older than config.days, with their
+// items and bills, from Orders, Order_Item and Bill into the *_History
+// tables, so the hot tables (and the active-order queries and ID
+// generators that scan them) only hold recent service.
+//
+// Each batch is one READ COMMITTED transaction: the finished orders are
+// locked, all their rows copied, and only then deleted, children first.
+// READ COMMITTED releases the rows the selection looked at but did not
+// take, so tills writing current orders are not blocked; a deadlock with one of them is retried by
+// DatabaseConnection::transaction. Batches are separated by a short pause
+// and the run can be repeated at any time: an interrupted run leaves every
+// order either fully hot or fully archived.
+class OrderArchiver {
+private:
+    DatabaseConnection& db;
+    ArchiveConfig config;
+
+    struct Moved {
+        size_t orders = 0;
+        size_t items = 0;
+        size_t bills = 0;
+    };
+
+    // Columns table shares with its history table, as "a, b, c". The
+    // history tables are copies made with CREATE TABLE ... LIKE, so a
+    // column added to the hot table later is simply not archived.
+    string sharedColumns(const string& table) {
+        auto pstmt = db.prepareStatement(
+            "SELECT c.COLUMN_NAME FROM information_schema.COLUMNS c "
+            "JOIN information_schema.COLUMNS h ON h.TABLE_SCHEMA = c.TABLE_SCHEMA "
+            "AND h.TABLE_NAME = ? AND h.COLUMN_NAME = c.COLUMN_NAME "
+            "WHERE c.TABLE_SCHEMA = DATABASE() AND c.TABLE_NAME = ? "
+            "ORDER BY c.ORDINAL_POSITION");
+        if (!pstmt) return "";
+        pstmt->setString(1, table + "_History");
+        pstmt->setString(2, table);
+        unique_ptr<sql::ResultSet> res(pstmt->executeQuery());
+        string columns;
+        while (res->next()) {
+            if (!columns.empty()) columns += ", ";
+            columns += res->getString(1);
+        }
+        return columns;
+    }
+
+    // Bind ids to the placeholders of statement
+    static void bindIds(sql::PreparedStatement& statement, const vector<string>& ids) {
+        for (size_t i = 0; i < ids.size(); i++) statement.setString((unsigned)i + 1, ids[i]);
+    }
+
+    // Copy the rows of table whose OrderID is in ids to its history table;
+    // returns how many were copied. Throws sql::SQLException.
+    size_t copyRows(const string& table, const string& columns, const vector<string>& ids, const string& placeholders) {
+        auto copy = db.prepareStatement(
+            "INSERT INTO " + table + "_History (" + columns + ") "
+            "SELECT " + columns + " FROM " + table + " WHERE OrderID IN (" + placeholders + ")");
+        if (!copy) throw sql::SQLException("Cannot prepare archive copy for " + table);
+        bindIds(*copy, ids);
+        return (size_t)copy->executeUpdate();
+    }
+
+    // Delete the rows of table whose OrderID is in ids, checking that they
+    // are the copied ones. Throws sql::SQLException.
+    void deleteRows(const string& table, const vector<string>& ids, const string& placeholders, size_t copied) {
+        auto remove = db.prepareStatement("DELETE FROM " + table + " WHERE OrderID IN (" + placeholders + ")");
+        if (!remove) throw sql::SQLException("Cannot prepare archive delete for " + table);
+        bindIds(*remove, ids);
+        // Something wrote rows the copy did not see; keep them hot
+        if ((size_t)remove->executeUpdate() != copied) {
+            throw sql::SQLException("Rows of " + table + " changed while being archived");
+        }
+    }
+
+    // Move up to limit orders in one transaction; moved.orders is 0 when
+    // nothing is left. Throws sql::SQLException.
+    Moved moveBatch(size_t limit, const string& orderColumns, const string& itemColumns, const string& billColumns) {
+        Moved moved;
+        TransactionOptions options;
+        options.isolation = IsolationLevel::ReadCommitted;
+        db.transaction("archiveOrders", [&]() {
+            moved = Moved();
+            auto select = db.prepareStatement(
+                "SELECT OrderID FROM Orders WHERE Order_status IN ('Completed', 'Cancelled') "
+                "AND Order_date < NOW() - INTERVAL ? DAY ORDER BY OrderID LIMIT ? FOR UPDATE");
+            if (!select) return false;
+            select->setInt(1, config.days);
+            select->setInt(2, (int)limit);
+            unique_ptr<sql::ResultSet> res(select->executeQuery());
+            vector<string> ids;
+            while (res->next()) ids.push_back(res->getString("OrderID"));
+            if (ids.empty()) return false;
+
+            string placeholders;
+            for (size_t i = 0; i < ids.size(); i++) placeholders += i ? ", ?" : "?";
+            // Copy everything before deleting anything: removing the items
+            // fires the trigger that recalculates the order total
+            moved.orders = copyRows("Orders", orderColumns, ids, placeholders);
+            moved.bills = copyRows("Bill", billColumns, ids, placeholders);
+            moved.items = copyRows("Order_Item", itemColumns, ids, placeholders);
+            deleteRows("Bill", ids, placeholders, moved.bills);
+            deleteRows("Order_Item", ids, placeholders, moved.items);
+            deleteRows("Orders", ids, placeholders, moved.orders);
+            return true;
+        }, options);
+        return moved;
+    }
+
+public:
+    OrderArchiver(DatabaseConnection& database, const ArchiveConfig& archiveConfig)
+        : db(database), config(archiveConfig) {}
+
+    // Archive until nothing is old enough (or config.maxOrders are moved).
+    // Returns false if the archive tables are missing or a batch failed;
+    // the batches before it stay archived.
+    bool run(ostream& out) {
+        ArchiveSchema schema(db);
+        if (!schema.available()) {
+            out << "[FAILED] Archive tables not found. Run database/order_archive.sql first." << endl;
+            return false;
+        }
+
+        static Counter& ordersArchived = Metrics::instance().counter(
+            "restaurant_archived_orders_total", "Finished orders moved to the history tables");
+
+        auto start = chrono::steady_clock::now();
+        Moved total;
+        size_t batches = 0;
+        bool ok = true;
+        try {
+            string orderColumns = sharedColumns("Orders");
+            string itemColumns = sharedColumns("Order_Item");
+            string billColumns = sharedColumns("Bill");
+            if (orderColumns.empty() || itemColumns.empty() || billColumns.empty()) {
+                out << "[FAILED] Cannot read the columns of the archive tables." << endl;
+                return false;
+            }
+
+            out << "[INFO] Archiving orders finished more than " << config.days << " day(s) ago, "
+                << config.batchOrders << " per batch..." << endl;
+            while (config.maxOrders == 0 || total.orders < config.maxOrders) {
+                size_t limit = config.batchOrders;
+                if (config.maxOrders > 0) limit = min(limit, config.maxOrders - total.orders);
+                Moved moved = moveBatch(limit, orderColumns, itemColumns, billColumns);
+                if (moved.orders == 0) break;
+                total.orders += moved.orders;
+                total.items += moved.items;
+                total.bills += moved.bills;
+                batches++;
+                ordersArchived.inc(moved.orders);
+                this_thread::sleep_for(chrono::milliseconds(config.pauseMs));
+            }
+        }
+        catch (sql::SQLException& e) {
+            cerr << "Error archiving orders: " << e.what() << endl;
+            ok = false;
+        }
+
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        out << (ok ? "[SUCCESS] " : "[WARNING] ") << "Archived " << total.orders << " order(s), "
+            << total.items << " item(s) and " << total.bills << " bill(s) in " << batches
+            << " batch(es), " << fixed << setprecision(1) << seconds << "s." << endl;
+        return ok;
+    }
+};
@@ -0,0 +1,817 @@
+#pragma once
+#include "DatabaseConnection.h"
+#include "OrderAggregateCache.h"
+#include "RowMapping.h"
+#include "Rows.h"
+#include "Json.h"
+#include "Metrics.h"
+#include "SchemaCheck.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <optional>
+#include <functional>
+#include <algorithm>
+#include <iomanip>
+#include <fstream>
+#include <iterator>
+#include <filesystem>
+#include <random>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <ctime>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// Append-only file of newline-terminated records with group commit: any
+// number of appends are made durable by one fsync, and a thread waiting for
+// its record either runs that fsync or waits for the one in progress.
+//
+//   uint64_t position = file.append(record);
+//   if (!file.waitDurable(position)) ...   // not on disk
+//
+// Safe to use from several threads.
+class JournalFile {
+private:
+    int fd = -1;
+    string path;
+    mutex lock;
+    condition_variable synced;
+    uint64_t written = 0;    // records appended
+    uint64_t durable = 0;    // records covered by a completed fsync
+    bool syncing = false;
+    bool failed = false;
+
+    static int openAppend(const string& file, bool truncate) {
+#ifdef _WIN32
+        int flags = _O_WRONLY | _O_CREAT | _O_BINARY | (truncate ? _O_TRUNC : _O_APPEND);
+        return _open(file.c_str(), flags, _S_IREAD | _S_IWRITE);
+#else
+        int flags = O_WRONLY | O_CREAT | (truncate ? O_TRUNC : O_APPEND);
+        return ::open(file.c_str(), flags, 0644);
+#endif
+    }
+
+    static bool writeAll(int handle, const string& data) {
+        size_t done = 0;
+        while (done < data.size()) {
+#ifdef _WIN32
+            int n = _write(handle, data.data() + done, (unsigned int)(data.size() - done));
+#else
+            ssize_t n = ::write(handle, data.data() + done, data.size() - done);
+#endif
+            if (n <= 0) return false;
+            done += (size_t)n;
+        }
+        return true;
+    }
+
+    static bool syncFile(int handle) {
+#ifdef _WIN32
+        return _commit(handle) == 0;
+#else
+        return fsync(handle) == 0;
+#endif
+    }
+
+    static void closeFile(int handle) {
+#ifdef _WIN32
+        _close(handle);
+#else
+        ::close(handle);
+#endif
+    }
+
+public:
+    JournalFile() = default;
+    ~JournalFile() { close(); }
+
+    JournalFile(const JournalFile&) = delete;
+    JournalFile& operator=(const JournalFile&) = delete;
+
+    // Open (or create) file for appending
+    bool open(const string& file) {
+        close();
+        fd = openAppend(file, false);
+        path = file;
+        failed = fd < 0;
+        return fd >= 0;
+    }
+
+    void close() {
+        if (fd >= 0) closeFile(fd);
+        fd = -1;
+    }
+
+    // Write one record (a newline is added). Returns its position for
+    // waitDurable(), or 0 if the write failed.
+    uint64_t append(const string& record) {
+        lock_guard<mutex> guard(lock);
+        if (fd < 0 || !writeAll(fd, record + "\n")) {
+            failed = true;
+            return 0;
+        }
+        return ++written;
+    }
+
+    // Block until the record at position is on disk. One caller fsyncs for
+    // everything appended so far; the others wait for it.
+    bool waitDurable(uint64_t position) {
+        static Counter& fsyncs = Metrics::instance().counter(
+            "restaurant_journal_fsyncs_total", "Offline journal fsync calls");
+        if (position == 0) return false;
+        unique_lock<mutex> guard(lock);
+        while (durable < position && !failed) {
+            if (syncing) {
+                synced.wait(guard);
+                continue;
+            }
+            syncing = true;
+            uint64_t target = written;
+            int handle = fd;
+            guard.unlock();
+            bool ok = syncFile(handle);
+            fsyncs.inc();
+            guard.lock();
+            syncing = false;
+            if (ok) durable = target;
+            else failed = true;
+            synced.notify_all();
+        }
+        return durable >= position;
+    }
+
+    // Replace the file with records, atomically: the new contents are
+    // written and synced under a temporary name and then renamed over it
+    bool rewrite(const vector<string>& records) {
+        lock_guard<mutex> guard(lock);
+        string temporary = path + ".tmp";
+        int handle = openAppend(temporary, true);
+        if (handle < 0) return false;
+        string data;
+        for (const string& record : records) data += record + "\n";
+        bool ok = writeAll(handle, data) && syncFile(handle);
+        closeFile(handle);
+        if (!ok) return false;
+
+        if (fd >= 0) closeFile(fd);
+        error_code ec;
+        filesystem::rename(temporary, path, ec);
+        fd = openAppend(path, false);
+        failed = fd < 0 || (bool)ec;
+        written = durable = 0;
+        return !failed;
+    }
+};
+
+// Keeps the POS taking orders while the database is unreachable.
+//
+// Order, item, bill, payment and table-status operations made while the
+// connection is lost are checked against an in-memory copy of the menu,
+// tables, staff and active orders, written to an append-only journal file
+// and synced before the till shows them as saved. When the connection
+// returns the onReconnect() handler (JournalReplay) applies them to the
+// database in order. Each record carries this terminal's ID and a sequence
+// number, and the replay stores both in Journal_Applied in the same
+// transaction as the change, so a record is never applied twice even if
+// the till crashes between committing it and marking it done.
+//
+//   OrderJournal journal(db);
+//   journal.open("restaurant_journal.log");
+//   journal.load();
+//   orderModule->useJournal(&journal);   // and billing, table, menu
+//
+// The file is JSON lines:
+//
+//   {"journal":1,"terminal":"5f0c...","next":42}              header
+//   {"seq":42,"op":"createOrder","at":"...","order":"ORD-000042",...}
+//   {"done":42,"id":"ORD000317"}                              applied
+//   {"done":43,"rejected":"[FAILED] Menu item is not available!"}
+//
+// Records get provisional IDs (ORD-000042, ORI-..., BIL-...) until they
+// are replayed. The file is compacted to its header once nothing is
+// pending. Not thread-safe, like the modules that use it.
+class OrderJournal {
+public:
+    struct Record {
+        unsigned long long seq = 0;
+        JsonValue fields;
+    };
+
+private:
+    struct OfflineOrder {
+        OrderAggregate aggregate;
+        string tableID;
+    };
+
+    DatabaseConnection& db;
+    JournalFile file;
+    string terminal;
+    unsigned long long nextSeq = 1;
+    bool enabled = false;
+    vector<Record> pending;
+    map<string, string> resolved;    // provisional ID -> database ID
+
+    map<string, TableRow> tables;
+    map<string, MenuRow> menu;
+    map<string, StaffRow> staff;
+    map<string, OfflineOrder> orders;
+    map<string, string> billOrders;  // bill ID -> order ID
+    chrono::steady_clock::time_point loadedAt;
+
+    bool warned = false;
+    chrono::steady_clock::time_point reconnectTriedAt;
+    function<void()> replayHandler;
+
+    static constexpr chrono::seconds reconnectInterval{ 5 };
+
+    static Gauge& pendingGauge() {
+        static Gauge& gauge = Metrics::instance().gauge(
+            "restaurant_journal_pending", "Offline journal records not yet applied to the database");
+        return gauge;
+    }
+
+    static string field(const string& name, const string& value) {
+        return "," + jsonQuote(name) + ":" + jsonQuote(value);
+    }
+
+    // Parse "YYYY-MM-DD HH:MM:SS" written by formatDateTime
+    static DateTime parseDateTime(const string& text) {
+        int y = 0, mo = 0, d = 0, h = 0, mi = 0, s = 0;
+        if (sscanf(text.c_str(), "%d-%d-%d %d:%d:%d", &y, &mo, &d, &h, &mi, &s) != 6) return DateTime();
+        return DateTime(chrono::seconds(daysFromCivil(y, (unsigned)mo, (unsigned)d) * 86400 + h * 3600 + mi * 60 + s));
+    }
+
+    static string provisionalID(const char* prefix, unsigned long long seq) {
+        char buffer[24];
+        snprintf(buffer, sizeof(buffer), "%s-%06llu", prefix, seq);
+        return string(buffer);
+    }
+
+    // The provisional ID a record gave what it created ("" if nothing)
+    static string createdID(const JsonValue& r) {
+        string op = r["op"].asString();
+        if (op == "createOrder") return r["order"].asString();
+        if (op == "addItem") return r["item"].asString();
+        if (op == "generateBill") return r["bill"].asString();
+        return "";
+    }
+
+    static string newTerminalID() {
+        random_device random;
+        char buffer[24];
+        snprintf(buffer, sizeof(buffer), "%08x%08x", random(), random());
+        return string(buffer);
+    }
+
+    string header() const {
+        return "{\"journal\":1" + field("terminal", terminal) + ",\"next\":" + to_string(nextSeq) + "}";
+    }
+
+    // Append a record for op and wait until it is on disk. Returns the
+    // record's sequence number, or 0 if it could not be saved.
+    unsigned long long write(const string& op, const string& fields) {
+        static Counter& records = Metrics::instance().counter(
+            "restaurant_journal_records_total", "Operations saved to the offline journal");
+        unsigned long long seq = nextSeq;
+        string line = "{\"seq\":" + to_string(seq) + field("op", op)
+            + field("at", formatDateTime(localNow())) + fields + "}";
+        if (!file.waitDurable(file.append(line))) {
+            cout << "[FAILED] Cannot write the offline journal! Nothing was saved." << endl;
+            return 0;
+        }
+        nextSeq++;
+        records.inc();
+
+        Record record;
+        record.seq = seq;
+        JsonParser(line).parse(record.fields);
+        apply(record);
+        pending.push_back(move(record));
+        pendingGauge().set((int64_t)pending.size());
+        return seq;
+    }
+
+    // Reflect one saved record in the in-memory copy. Records that refer
+    // to something the copy does not hold are skipped.
+    void apply(const Record& record) {
+        const JsonValue& r = record.fields;
+        string op = r["op"].asString();
+        DateTime at = parseDateTime(r["at"].asString());
+
+        if (op == "createOrder") {
+            OfflineOrder order;
+            order.tableID = r["table"].asString();
+            OrderRow& row = order.aggregate.order;
+            row.orderID = r["order"].asString();
+            row.tableNumber = tables.count(order.tableID) ? tables[order.tableID].tableNumber : order.tableID;
+            row.staffName = staff.count(r["staff"].asString()) ? staff[r["staff"].asString()].name : "";
+            row.status = OrderStatus::Active;
+            row.orderDate = at;
+            order.aggregate.found = true;
+            orders[row.orderID] = order;
+            if (tables.count(order.tableID)) tables[order.tableID].status = TableStatus::Occupied;
+        }
+        else if (op == "addItem") {
+            auto it = orders.find(resolve(r["order"].asString()));
+            if (it == orders.end()) return;
+            int quantity = (int)r["quantity"].asNumber();
+            double price = r["price"].asNumber();
+            string menuID = r["menu"].asString();
+            string name = menu.count(menuID) ? menu[menuID].name : menuID;
+            it->second.aggregate.items.push_back({ r["item"].asString(), name, quantity, price, price * quantity });
+            it->second.aggregate.order.totalAmount += price * quantity;
+        }
+        else if (op == "tableStatus") {
+            auto it = tables.find(r["table"].asString());
+            if (it != tables.end()) it->second.status = parseEnum<TableStatus>(r["status"].asString());
+        }
+        else if (op == "generateBill") {
+            auto it = orders.find(resolve(r["order"].asString()));
+            if (it == orders.end()) return;
+            OrderAggregate& aggregate = it->second.aggregate;
+            string staffID = r["staff"].asString();
+            aggregate.billed = true;
+            aggregate.bill = { r["bill"].asString(), aggregate.order.orderID,
+                staff.count(staffID) ? staff[staffID].name : "", at, aggregate.order.totalAmount,
+                parseEnum<PaymentMethod>(r["method"].asString()), PaymentStatus::Unpaid };
+            billOrders[aggregate.bill.billID] = aggregate.order.orderID;
+        }
+        else if (op == "pay") {
+            auto bill = billOrders.find(resolve(r["bill"].asString()));
+            if (bill == billOrders.end()) return;
+            OfflineOrder& order = orders[bill->second];
+            // What the payment trigger does in the database
+            order.aggregate.bill.paymentStatus = PaymentStatus::Paid;
+            order.aggregate.order.status = OrderStatus::Completed;
+            if (tables.count(order.tableID)) tables[order.tableID].status = TableStatus::Vacant;
+        }
+        else if (op == "cancelOrder") {
+            auto it = orders.find(resolve(r["order"].asString()));
+            if (it == orders.end()) return;
+            it->second.aggregate.order.status = OrderStatus::Cancelled;
+            if (tables.count(it->second.tableID)) tables[it->second.tableID].status = TableStatus::Vacant;
+        }
+    }
+
+    // The active order at tableID ("" if none)
+    string orderAtTable(const string& tableID) const {
+        for (const auto& entry : orders) {
+            if (entry.second.tableID == tableID && entry.second.aggregate.order.status == OrderStatus::Active) {
+                return entry.first;
+            }
+        }
+        return "";
+    }
+
+    // Staff member who may take orders; prints why not otherwise
+    bool checkStaff(const string& staffID) const {
+        auto it = staff.find(staffID);
+        if (it == staff.end()) {
+            cout << "[FAILED] Staff not found!" << endl;
+            return false;
+        }
+        if (it->second.status != StaffStatus::Active) {
+            cout << "[FAILED] Staff is not active!" << endl;
+            return false;
+        }
+        return true;
+    }
+
+    // The offline copy of an order, by provisional or database ID
+    OfflineOrder* findOfflineOrder(const string& orderID) {
+        auto it = orders.find(resolve(orderID));
+        return it == orders.end() ? nullptr : &it->second;
+    }
+
+public:
+    OrderJournal(DatabaseConnection& database) : db(database) {}
+
+    OrderJournal(const OrderJournal&) = delete;
+    OrderJournal& operator=(const OrderJournal&) = delete;
+
+    // Open the journal at path (created if missing) and read back the
+    // records that were not applied yet
+    bool open(const string& path) {
+        ifstream in(path, ios::binary);
+        string contents((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+        in.close();
+        vector<string> lines;
+        size_t start = 0;
+        while (start < contents.size()) {
+            size_t end = contents.find('\n', start);
+            if (end == string::npos) end = contents.size();
+            if (end > start) lines.push_back(contents.substr(start, end - start));
+            start = end + 1;
+        }
+        // A last line without its newline is a write the till never
+        // confirmed; it is dropped and must not have more appended to it
+        bool torn = !contents.empty() && contents.back() != '\n';
+        if (torn) lines.pop_back();
+
+        map<unsigned long long, Record> records;
+        for (size_t i = 0; i < lines.size(); i++) {
+            JsonValue value;
+            if (!JsonParser(lines[i]).parse(value) || !value.isObject()) {
+                cout << "[FAILED] Offline journal " << path << " is damaged at line " << (i + 1) << "!" << endl;
+                return false;
+            }
+            if (value.has("journal")) {
+                terminal = value["terminal"].asString();
+                nextSeq = max(nextSeq, (unsigned long long)value["next"].asNumber(1));
+            }
+            else if (value.has("seq")) {
+                Record record;
+                record.seq = (unsigned long long)value["seq"].asNumber();
+                record.fields = value;
+                nextSeq = max(nextSeq, record.seq + 1);
+                records[record.seq] = move(record);
+            }
+            else if (value.has("done")) {
+                auto it = records.find((unsigned long long)value["done"].asNumber());
+                if (it == records.end()) continue;
+                string provisional = createdID(it->second.fields);
+                if (value.has("id") && !provisional.empty()) resolved[provisional] = value["id"].asString();
+                records.erase(it);
+            }
+        }
+
+        bool created = terminal.empty();
+        if (created) terminal = newTerminalID();
+        if (!file.open(path)) {
+            cout << "[FAILED] Cannot open offline journal: " << path << endl;
+            return false;
+        }
+        if (torn && !file.rewrite(lines)) {
+            cout << "[FAILED] Cannot repair offline journal: " << path << endl;
+            return false;
+        }
+        if (created && !file.waitDurable(file.append(header()))) {
+            cout << "[FAILED] Cannot write offline journal: " << path << endl;
+            return false;
+        }
+
+        pending.clear();
+        for (auto& entry : records) pending.push_back(move(entry.second));
+        pendingGauge().set((int64_t)pending.size());
+        enabled = true;
+        return true;
+    }
+
+    // Fill the in-memory copy from the database: menu, tables, staff and
+    // active orders (four queries), then re-apply the pending records.
+    // The first load disables the journal if Journal_Applied is missing.
+    bool load() {
+        MODULE_SPAN("OrderJournal", "load");
+        if (!enabled) return false;
+        if (!SchemaCheck::hasTables(db, { "Journal_Applied" })) {
+            // A lost connection is not a missing table; try again next time
+            if (!db.isConnected()) return false;
+            cout << "[WARNING] Table Journal_Applied is missing; orders cannot be taken offline." << endl;
+            cout << "[INFO] Run database/offline_journal.sql to enable the offline journal." << endl;
+            enabled = false;
+            return false;
+        }
+
+        auto menuRows = db.executeQuery(selectRows<MenuRow>("FROM Menu"));
+        auto tableRows = db.executeQuery(selectRows<TableRow>("FROM Tables"));
+        auto staffRows = db.executeQuery(selectRows<StaffRow>("FROM Staff"));
+        auto orderLines = db.executeQuery(selectRows<OrderDetailLine>(string(OrderDetailLine::from) +
+            "WHERE o.Order_status = 'Active' ORDER BY o.OrderID, oi.Order_itemID"));
+        if (!menuRows || !tableRows || !staffRows || !orderLines) return false;
+
+        menu.clear();
+        tables.clear();
+        staff.clear();
+        orders.clear();
+        billOrders.clear();
+        for (MenuRow& row : fetchRows<MenuRow>(menuRows.get())) menu[row.menuID] = row;
+        map<string, string> tableByNumber;
+        for (TableRow& row : fetchRows<TableRow>(tableRows.get())) {
+            tableByNumber[row.tableNumber] = row.tableID;
+            tables[row.tableID] = row;
+        }
+        for (StaffRow& row : fetchRows<StaffRow>(staffRows.get())) staff[row.staffID] = row;
+
+        vector<OrderDetailLine> lines = fetchRows<OrderDetailLine>(orderLines.get());
+        for (size_t begin = 0; begin < lines.size();) {
+            size_t end = begin;
+            while (end < lines.size() && lines[end].orderID == lines[begin].orderID) end++;
+            OfflineOrder order;
+            order.aggregate = OrderAggregateCache::assemble(vector<OrderDetailLine>(lines.begin() + begin, lines.begin() + end));
+            order.tableID = tableByNumber[order.aggregate.order.tableNumber];
+            if (order.aggregate.billed) billOrders[order.aggregate.bill.billID] = order.aggregate.order.orderID;
+            orders[order.aggregate.order.orderID] = move(order);
+            begin = end;
+        }
+
+        for (const Record& record : pending) apply(record);
+        loadedAt = chrono::steady_clock::now();
+        return true;
+    }
+
+    // Reload the copy if it is older than maxAge and the database is up,
+    // and retry records a broken-off replay left behind
+    void refresh(chrono::seconds maxAge = chrono::seconds(5)) {
+        if (!enabled || !online()) return;
+        if (!pending.empty() && replayHandler) replayHandler();
+        if (chrono::steady_clock::now() - loadedAt >= maxAge) load();
+    }
+
+    // Called after a lost connection comes back, before the copy is
+    // reloaded (JournalReplay::run)
+    void onReconnect(function<void()> handler) {
+        replayHandler = move(handler);
+    }
+
+    bool isEnabled() const { return enabled; }
+
+    // False while the database is unreachable. Tries to reconnect at most
+    // every few seconds; on success replays the journal first.
+    bool online() {
+        if (!enabled || !db.connectionLost()) return true;
+        auto now = chrono::steady_clock::now();
+        if (now - reconnectTriedAt >= reconnectInterval) {
+            reconnectTriedAt = now;
+            if (db.reconnect()) {
+                cout << "[INFO] Database connection restored." << endl;
+                warned = false;
+                if (replayHandler) replayHandler();
+                load();
+                return !db.connectionLost();
+            }
+        }
+        if (!warned) {
+            cout << "[WARNING] Database unreachable. Orders and payments are saved on this till "
+                "and sent when it is back." << endl;
+            warned = true;
+        }
+        return false;
+    }
+
+    // The database ID a provisional ID was replayed as (id itself if it is
+    // not provisional or has not been replayed yet)
+    string resolve(const string& id) const {
+        auto it = resolved.find(id);
+        return it == resolved.end() ? id : it->second;
+    }
+
+    // True if id is a provisional ID that has no database ID yet
+    bool isUnresolved(const string& id) const {
+        return id.size() > 4 && id[3] == '-' && resolved.find(id) == resolved.end();
+    }
+
+    const string& getTerminal() const { return terminal; }
+    const vector<Record>& getPending() const { return pending; }
+
+    // Mark the oldest pending record applied (id: what it created, if
+    // anything). Done markers are not synced: replaying a record whose
+    // marker was lost finds it in Journal_Applied.
+    void markApplied(const string& id) {
+        static Counter& applied = Metrics::instance().counter(
+            "restaurant_journal_replayed_total", "Offline journal records replayed", "result=\"applied\"");
+        const Record& record = pending.front();
+        string line = "{\"done\":" + to_string(record.seq);
+        if (!id.empty()) {
+            line += field("id", id);
+            string provisional = createdID(record.fields);
+            if (!provisional.empty()) resolved[provisional] = id;
+        }
+        file.append(line + "}");
+        applied.inc();
+        pending.erase(pending.begin());
+        pendingGauge().set((int64_t)pending.size());
+    }
+
+    // Mark the oldest pending record rejected by the database with reason
+    void markRejected(const string& reason) {
+        static Counter& rejected = Metrics::instance().counter(
+            "restaurant_journal_replayed_total", "Offline journal records replayed", "result=\"rejected\"");
+        file.append("{\"done\":" + to_string(pending.front().seq) + field("rejected", reason) + "}");
+        rejected.inc();
+        pending.erase(pending.begin());
+        pendingGauge().set((int64_t)pending.size());
+    }
+
+    // Shrink the file to its header once nothing is pending
+    void compact() {
+        if (!enabled || !pending.empty()) return;
+        if (file.rewrite({ header() })) resolved.clear();
+    }
+
+    // ---- Operations while offline. Each checks what the module would,
+    // ---- prints the same messages and returns what the module returns.
+
+    string createOrder(const string& tableID, const string& staffID) {
+        auto table = tables.find(tableID);
+        if (table == tables.end()) {
+            cout << "[FAILED] Table not found!" << endl;
+            return "";
+        }
+        if (!acceptsOrders(table->second.status)) {
+            cout << "[FAILED] Orders can only be created for Occupied or Reserved tables!" << endl;
+            return "";
+        }
+        string existing = orderAtTable(tableID);
+        if (!existing.empty()) {
+            cout << "[FAILED] Table already has an active order!" << endl;
+            cout << "[INFO] Active Order ID: " << existing << endl;
+            return "";
+        }
+        if (!checkStaff(staffID)) return "";
+
+        string orderID = provisionalID("ORD", nextSeq);
+        if (!write("createOrder", field("order", orderID) + field("table", tableID) + field("staff", staffID))) return "";
+        cout << "[SUCCESS] Order created with ID: " << orderID << " (offline)" << endl;
+        return orderID;
+    }
+
+    bool addOrderItem(const string& orderID, const string& menuID, int quantity) {
+        if (quantity < 1) {
+            cout << "[FAILED] Quantity must be at least 1!" << endl;
+            return false;
+        }
+        OfflineOrder* order = findOfflineOrder(orderID);
+        if (!order) {
+            cout << "[FAILED] Order not found!" << endl;
+            return false;
+        }
+        if (order->aggregate.order.status != OrderStatus::Active) {
+            cout << "[FAILED] Order is not active!" << endl;
+            return false;
+        }
+        auto item = menu.find(menuID);
+        if (item == menu.end()) {
+            cout << "[FAILED] Menu item not found!" << endl;
+            return false;
+        }
+        if (item->second.availability != Availability::Available) {
+            cout << "[FAILED] Menu item is not available!" << endl;
+            return false;
+        }
+
+        double unitPrice = item->second.price;
+        char price[32];
+        snprintf(price, sizeof(price), "%.2f", unitPrice);
+        if (!write("addItem", field("order", order->aggregate.order.orderID) + field("item", provisionalID("ORI", nextSeq))
+            + field("menu", menuID) + ",\"quantity\":" + to_string(quantity) + ",\"price\":" + price)) return false;
+        cout << "[SUCCESS] Added: " << quantity << "x " << item->second.name
+            << " @ RM" << fixed << setprecision(2) << unitPrice
+            << " = RM" << unitPrice * quantity << " (offline)" << endl;
+        return true;
+    }
+
+    bool updateTableStatus(const string& tableID, TableStatus status) {
+        if (status == TableStatus::Unknown) {
+            cout << "[FAILED] Invalid status! Use 'Vacant', 'Occupied', or 'Reserved'." << endl;
+            return false;
+        }
+        if (!tables.count(tableID)) {
+            cout << "[FAILED] Table not found!" << endl;
+            return false;
+        }
+        if (status == TableStatus::Vacant && !orderAtTable(tableID).empty()) {
+            cout << "[FAILED] Cannot set to Vacant! Table has an active order." << endl;
+            return false;
+        }
+        if (!write("tableStatus", field("table", tableID) + field("status", toString(status)))) return false;
+        cout << "[SUCCESS] Table status updated to " << toString(status) << " (offline)" << endl;
+        return true;
+    }
+
+    string generateBill(const string& orderID, const string& staffID, PaymentMethod paymentMethod) {
+        if (paymentMethod == PaymentMethod::Unknown) {
+            cout << "[FAILED] Invalid payment method! Use 'Cash', 'Card', or 'E-Wallet'." << endl;
+            return "";
+        }
+        OfflineOrder* order = findOfflineOrder(orderID);
+        if (!order) {
+            cout << "[FAILED] Order not found!" << endl;
+            return "";
+        }
+        const OrderAggregate& aggregate = order->aggregate;
+        if (aggregate.order.status != OrderStatus::Active) {
+            cout << "[FAILED] Order is not active! Status: " << toString(aggregate.order.status) << endl;
+            return "";
+        }
+        if (aggregate.order.totalAmount <= 0) {
+            cout << "[FAILED] Order has no items!" << endl;
+            return "";
+        }
+        if (aggregate.billed) {
+            cout << "[FAILED] Bill already exists for this order!" << endl;
+            cout << "[INFO] Bill ID: " << aggregate.bill.billID << endl;
+            return "";
+        }
+        if (!checkStaff(staffID)) return "";
+
+        string billID = provisionalID("BIL", nextSeq);
+        if (!write("generateBill", field("order", aggregate.order.orderID) + field("bill", billID)
+            + field("staff", staffID) + field("method", toString(paymentMethod)))) return "";
+        cout << "[SUCCESS] Bill generated with ID: " << billID << " (offline)" << endl;
+        return billID;
+    }
+
+    bool processPayment(const string& billID) {
+        auto bill = billOrders.find(resolve(billID));
+        if (bill == billOrders.end()) {
+            cout << "[FAILED] Bill not found!" << endl;
+            return false;
+        }
+        if (orders[bill->second].aggregate.bill.paymentStatus == PaymentStatus::Paid) {
+            cout << "[INFO] Bill is already paid!" << endl;
+            return true;
+        }
+        if (!write("pay", field("bill", bill->first))) return false;
+        cout << "[SUCCESS] Payment processed successfully! (offline)" << endl;
+        return true;
+    }
+
+    bool cancelOrder(const string& orderID) {
+        OfflineOrder* order = findOfflineOrder(orderID);
+        if (!order) {
+            cout << "[FAILED] Order not found!" << endl;
+            return false;
+        }
+        if (order->aggregate.order.status != OrderStatus::Active) {
+            cout << "[FAILED] Only active orders can be cancelled!" << endl;
+            return false;
+        }
+        if (!write("cancelOrder", field("order", order->aggregate.order.orderID))) return false;
+        cout << "[SUCCESS] Order cancelled successfully! (offline)" << endl;
+        return true;
+    }
+
+    // ---- Reads while offline, from the copy
+
+    // An order with its bill and lines (found is false if the copy does
+    // not hold it: it was not active at the last reload)
+    OrderAggregate findOrder(const string& orderID) {
+        OfflineOrder* order = findOfflineOrder(orderID);
+        return order ? order->aggregate : OrderAggregate();
+    }
+
+    OrderAggregate findBill(const string& billID) {
+        auto bill = billOrders.find(resolve(billID));
+        return bill == billOrders.end() ? OrderAggregate() : orders[bill->second].aggregate;
+    }
+
+    vector<OrderRow> activeOrders() const {
+        vector<OrderRow> rows;
+        for (const auto& entry : orders) {
+            if (entry.second.aggregate.order.status == OrderStatus::Active) rows.push_back(entry.second.aggregate.order);
+        }
+        sort(rows.begin(), rows.end(), [](const OrderRow& a, const OrderRow& b) { return a.orderDate < b.orderDate; });
+        return rows;
+    }
+
+    // Active orders with their bill total once billed (a paid order is no
+    // longer active)
+    vector<UnpaidOrderRow> unpaidOrders() const {
+        vector<UnpaidOrderRow> rows;
+        for (const OrderRow& order : activeOrders()) {
+            const OrderAggregate& aggregate = orders.at(order.orderID).aggregate;
+            rows.push_back({ order.orderID, order.tableNumber, order.staffName,
+                aggregate.billed ? aggregate.bill.total : order.totalAmount, order.orderDate });
+        }
+        return rows;
+    }
+
+    string activeOrderForTable(const string& tableID) const {
+        return orderAtTable(tableID);
+    }
+
+    TableStatus tableStatus(const string& tableID) const {
+        auto it = tables.find(tableID);
+        return it == tables.end() ? TableStatus::Unknown : it->second.status;
+    }
+
+    vector<TableRow> listTables() const {
+        vector<TableRow> rows;
+        for (const auto& entry : tables) rows.push_back(entry.second);
+        sort(rows.begin(), rows.end(), [](const TableRow& a, const TableRow& b) { return a.tableNumber < b.tableNumber; });
+        return rows;
+    }
+
+    vector<MenuRow> availableMenu() const {
+        vector<MenuRow> rows;
+        for (const auto& entry : menu) {
+            if (entry.second.availability == Availability::Available) rows.push_back(entry.second);
+        }
+        sort(rows.begin(), rows.end(), [](const MenuRow& a, const MenuRow& b) {
+            return a.category != b.category ? a.category < b.category : a.name < b.name;
+        });
+        return rows;
+    }
+};
@@ -1,144 +1,187 @@
 #pragma once
 #include "DatabaseConnection.h"
+#include "ConsoleRenderer.h"
+#include "OrderAggregateCache.h"
+#include "OrderJournal.h"
+#include "IdempotencyStore.h"
+#include "RowVersion.h"
+#include "OrderArchive.h"
 #include <string>
 #include <iostream>
 #include <iomanip>
 #include <vector>
+#include <optional>
 
 using namespace std;
 
 class OrderModule {
 private:
     DatabaseConnection& db;
+    OrderJournal* journal = nullptr;
+    IdempotencyStore idempotency{ db };
+    VersionColumn orderVersions{ db, "Orders", "OrderID" };
+    ArchiveSchema archive{ db };
 
     string generateOrderID() {
-        // Find the smallest missing ID (reuses deleted IDs)
+        // Find the smallest missing ID (reuses deleted IDs, but none at or
+        // below the highest archived one)
         auto res = db.executeQuery(
             "SELECT t1.num + 1 AS gap "
             "FROM (SELECT CAST(SUBSTRING(OrderID, 4) AS UNSIGNED) AS num FROM Orders) t1 "
             "LEFT JOIN (SELECT CAST(SUBSTRING(OrderID, 4) AS UNSIGNED) AS num FROM Orders) t2 "
             "ON t1.num + 1 = t2.num "
             "WHERE t2.num IS NULL "
+            "AND t1.num >= " + archive.highWater("Orders", "OrderID") + " "
             "ORDER BY gap LIMIT 1");
         
         if (res && res->next()) {
             int gapID = res->getInt("gap");
             char buffer[15];
-            sprintf_s(buffer, "ORD%06d", gapID);
+            snprintf(buffer, sizeof(buffer), "ORD%06d", gapID);
             return string(buffer);
         }
         
         // If no gaps found, get max + 1 (or start with ORD000001 if table is empty)
         auto maxRes = db.executeQuery(
-            "SELECT COALESCE(MAX(CAST(SUBSTRING(OrderID, 4) AS UNSIGNED)), 0) as MaxID FROM Orders");
+            "SELECT GREATEST(COALESCE(MAX(CAST(SUBSTRING(OrderID, 4) AS UNSIGNED)), 0), "
+            + archive.highWater("Orders", "OrderID") + ") as MaxID FROM Orders");
         if (maxRes && maxRes->next()) {
             int maxID = maxRes->getInt("MaxID");
             char buffer[15];
-            sprintf_s(buffer, "ORD%06d", maxID + 1);
+            snprintf(buffer, sizeof(buffer), "ORD%06d", maxID + 1);
             return string(buffer);
         }
         return "ORD000001";
     }
 
     string generateOrderItemID() {
-        // Find the smallest missing ID (reuses deleted IDs)
+        // Find the smallest missing ID (reuses deleted IDs, but none at or
+        // below the highest archived one)
         auto res = db.executeQuery(
             "SELECT t1.num + 1 AS gap "
             "FROM (SELECT CAST(SUBSTRING(Order_itemID, 4) AS UNSIGNED) AS num FROM Order_Item) t1 "
             "LEFT JOIN (SELECT CAST(SUBSTRING(Order_itemID, 4) AS UNSIGNED) AS num FROM Order_Item) t2 "
             "ON t1.num + 1 = t2.num "
             "WHERE t2.num IS NULL "
+            "AND t1.num >= " + archive.highWater("Order_Item", "Order_itemID") + " "
             "ORDER BY gap LIMIT 1");
         
         if (res && res->next()) {
             int gapID = res->getInt("gap");
             char buffer[15];
-            sprintf_s(buffer, "ORI%06d", gapID);
+            snprintf(buffer, sizeof(buffer), "ORI%06d", gapID);
             return string(buffer);
         }
         
         // If no gaps found, get max + 1 (or start with ORI000001 if table is empty)
         auto maxRes = db.executeQuery(
-            "SELECT COALESCE(MAX(CAST(SUBSTRING(Order_itemID, 4) AS UNSIGNED)), 0) as MaxID FROM Order_Item");
+            "SELECT GREATEST(COALESCE(MAX(CAST(SUBSTRING(Order_itemID, 4) AS UNSIGNED)), 0), "
+            + archive.highWater("Order_Item", "Order_itemID") + ") as MaxID FROM Order_Item");
         if (maxRes && maxRes->next()) {
             int maxID = maxRes->getInt("MaxID");
             char buffer[15];
-            sprintf_s(buffer, "ORI%06d", maxID + 1);
+            snprintf(buffer, sizeof(buffer), "ORI%06d", maxID + 1);
             return string(buffer);
         }
         return "ORI000001";
     }
 
+    // The journal to use instead of the database while it is unreachable
+    OrderJournal* offline() {
+        return journal && !journal->online() ? journal : nullptr;
+    }
+
 public:
     OrderModule(DatabaseConnection& database) : db(database) {}
 
+    // Take orders and items into journal while the database is
+    // unreachable (nullptr: fail as before)
+    void useJournal(OrderJournal* orderJournal) { journal = orderJournal; }
+
     // Create new order
     string createOrder(const string& tableID, const string& staffID) {
+        MODULE_SPAN("OrderModule", "createOrder");
+        if (OrderJournal* j = offline()) return j->createOrder(tableID, staffID);
         try {
-            // Check if table can accept order (Occupied or Reserved)
-            auto checkTable = db.prepareStatement(
-                "SELECT Status FROM Tables WHERE TableID = ?");
-            if (checkTable) {
-                checkTable->setString(1, tableID);
-                auto res = checkTable->executeQuery();
-                if (res->next()) {
-                    string status = res->getString("Status");
-                    if (status != "Occupied" && status != "Reserved") {
-                        cout << "[FAILED] Orders can only be created for Occupied or Reserved tables!" << endl;
-                        return "";
+            string orderID;
+            bool created = db.transaction("createOrder", [&]() {
+                // Check if table can accept order (Occupied or Reserved); the
+                // row stays locked so a second till waits for this order
+                auto checkTable = db.prepareStatement(
+                    "SELECT " + sqlField<TableStatus>("Status") + " AS Status FROM Tables WHERE TableID = ? FOR UPDATE");
+                if (checkTable) {
+                    checkTable->setString(1, tableID);
+                    auto res = checkTable->executeQuery();
+                    if (res->next()) {
+                        if (!acceptsOrders(getEnum<TableStatus>(*res, "Status"))) {
+                            cout << "[FAILED] Orders can only be created for Occupied or Reserved tables!" << endl;
+                            return false;
+                        }
+                    }
+                    else {
+                        cout << "[FAILED] Table not found!" << endl;
+                        return false;
                     }
                 }
-                else {
-                    cout << "[FAILED] Table not found!" << endl;
-                    return "";
-                }
-            }
 
-            // Check if table already has an active order
-            auto checkOrder = db.prepareStatement(
-                "SELECT OrderID FROM Orders WHERE TableID = ? AND Order_status = 'Active'");
-            if (checkOrder) {
-                checkOrder->setString(1, tableID);
-                auto res = checkOrder->executeQuery();
-                if (res->next()) {
-                    cout << "[FAILED] Table already has an active order!" << endl;
-                    cout << "[INFO] Active Order ID: " << res->getString("OrderID") << endl;
-                    return "";
+                // Check if table already has an active order
+                auto checkOrder = db.prepareStatement(
+                    "SELECT OrderID FROM Orders WHERE TableID = ? AND Order_status = 'Active'");
+                if (checkOrder) {
+                    checkOrder->setString(1, tableID);
+                    auto res = checkOrder->executeQuery();
+                    if (res->next()) {
+                        cout << "[FAILED] Table already has an active order!" << endl;
+                        cout << "[INFO] Active Order ID: " << res->getString("OrderID") << endl;
+                        return false;
+                    }
                 }
-            }
 
-            // Check if staff is active
-            auto checkStaff = db.prepareStatement(
-                "SELECT Status FROM Staff WHERE StaffID = ?");
-            if (checkStaff) {
-                checkStaff->setString(1, staffID);
-                auto res = checkStaff->executeQuery();
-                if (res->next()) {
-                    if (res->getString("Status") != "Active") {
-                        cout << "[FAILED] Staff is not active!" << endl;
-                        return "";
+                // Check if staff is active
+                auto checkStaff = db.prepareStatement(
+                    "SELECT " + sqlField<StaffStatus>("Status") + " AS Status FROM Staff WHERE StaffID = ?");
+                if (checkStaff) {
+                    checkStaff->setString(1, staffID);
+                    auto res = checkStaff->executeQuery();
+                    if (res->next()) {
+                        if (getEnum<StaffStatus>(*res, "Status") != StaffStatus::Active) {
+                            cout << "[FAILED] Staff is not active!" << endl;
+                            return false;
+                        }
+                    }
+                    else {
+                        cout << "[FAILED] Staff not found!" << endl;
+                        return false;
                     }
                 }
-                else {
-                    cout << "[FAILED] Staff not found!" << endl;
-                    return "";
-                }
-            }
-
-            string orderID = generateOrderID();
-            auto pstmt = db.prepareStatement(
-                "INSERT INTO Orders (OrderID, TableID, StaffID, Total_amount, Order_status) "
-                "VALUES (?, ?, ?, 0.00, 'Active')");
-            if (pstmt) {
-                pstmt->setString(1, orderID);
-                pstmt->setString(2, tableID);
-                pstmt->setString(3, staffID);
-                pstmt->executeUpdate();
 
-                // Update table status to Occupied
-                db.executeUpdate("UPDATE Tables SET Status = 'Occupied' WHERE TableID = '" + tableID + "'");
-
-                cout << "[SUCCESS] Order created with ID: " << orderID << endl;
+                orderID = generateOrderID();
+                auto pstmt = db.prepareStatement(
+                    "INSERT INTO Orders (OrderID, TableID, StaffID, Total_amount, Order_status) "
+                    "VALUES (?, ?, ?, 0.00, 'Active')");
+                if (pstmt) {
+                    pstmt->setString(1, orderID);
+                    pstmt->setString(2, tableID);
+                    pstmt->setString(3, staffID);
+                    pstmt->executeUpdate();
+
+                    // Update table status to Occupied
+                    db.executeUpdate("UPDATE Tables SET Status = 'Occupied' WHERE TableID = '" + tableID + "'");
+                    return true;
+                }
+                return false;
+            });
+
+            if (created) {
+                static Counter& ordersCreated = Metrics::instance().counter(
+                    "restaurant_orders_created_total", "Orders created");
+                static Gauge& activeOrders = Metrics::instance().gauge(
+                    "restaurant_active_orders", "Orders currently active");
+                db.afterCommit([orderID]() {
+                    ordersCreated.inc();
+                    activeOrders.inc();
+                    cout << "[SUCCESS] Order created with ID: " << orderID << endl;
+                });
                 return orderID;
             }
             return "";
@@ -151,6 +194,8 @@ public:
 
     // Add item to order
     bool addOrderItem(const string& orderID, const string& menuID, int quantity) {
+        MODULE_SPAN("OrderModule", "addOrderItem");
+        if (OrderJournal* j = offline()) return j->addOrderItem(orderID, menuID, quantity);
         try {
             // Validate quantity
             if (quantity < 1) {
@@ -158,64 +203,84 @@ public:
                 return false;
             }
 
-            // Check if order is active
-            auto checkOrder = db.prepareStatement(
-                "SELECT Order_status FROM Orders WHERE OrderID = ?");
-            if (checkOrder) {
-                checkOrder->setString(1, orderID);
-                auto res = checkOrder->executeQuery();
-                if (res->next()) {
-                    if (res->getString("Order_status") != "Active") {
-                        cout << "[FAILED] Order is not active!" << endl;
-                        return false;
+            double unitPrice = 0;
+            string menuName;
+            bool added = db.transaction("addOrderItem", [&]() {
+                // New version for the order; the row stays locked so it cannot
+                // be billed or cancelled while the line goes in
+                if (!orderVersions.update(orderID, "", "Order_status = 'Active'", nullopt)) {
+                    // Not updated: say why (without versions, lock and check here)
+                    auto checkOrder = db.prepareStatement(
+                        "SELECT " + sqlField<OrderStatus>("Order_status") + " AS Order_status FROM Orders WHERE OrderID = ? FOR UPDATE");
+                    if (checkOrder) {
+                        checkOrder->setString(1, orderID);
+                        auto res = checkOrder->executeQuery();
+                        if (res->next()) {
+                            if (getEnum<OrderStatus>(*res, "Order_status") != OrderStatus::Active) {
+                                cout << "[FAILED] Order is not active!" << endl;
+                                return false;
+                            }
+                        }
+                        else {
+                            cout << "[FAILED] Order not found!" << endl;
+                            return false;
+                        }
                     }
                 }
-                else {
-                    cout << "[FAILED] Order not found!" << endl;
-                    return false;
-                }
-            }
 
-            // Get menu price and check availability
-            auto getPrice = db.prepareStatement(
-                "SELECT Price, Menu_name, Availability FROM Menu WHERE MenuID = ?");
-            double unitPrice = 0;
-            string menuName;
-            if (getPrice) {
-                getPrice->setString(1, menuID);
-                auto res = getPrice->executeQuery();
-                if (res->next()) {
-                    if (res->getString("Availability") != "Available") {
-                        cout << "[FAILED] Menu item is not available!" << endl;
+                // Get menu price and check availability
+                auto getPrice = db.prepareStatement(
+                    "SELECT Price, Menu_name, " + sqlField<Availability>("Availability") + " AS Availability "
+                    "FROM Menu WHERE MenuID = ?");
+                if (getPrice) {
+                    getPrice->setString(1, menuID);
+                    auto res = getPrice->executeQuery();
+                    if (res->next()) {
+                        if (getEnum<Availability>(*res, "Availability") != Availability::Available) {
+                            cout << "[FAILED] Menu item is not available!" << endl;
+                            return false;
+                        }
+                        unitPrice = res->getDouble("Price");
+                        menuName = res->getString("Menu_name");
+                    }
+                    else {
+                        cout << "[FAILED] Menu item not found!" << endl;
                         return false;
                     }
-                    unitPrice = res->getDouble("Price");
-                    menuName = res->getString("Menu_name");
                 }
-                else {
-                    cout << "[FAILED] Menu item not found!" << endl;
-                    return false;
-                }
-            }
 
-            double total = unitPrice * quantity;
-            string orderItemID = generateOrderItemID();
-
-            auto pstmt = db.prepareStatement(
-                "INSERT INTO Order_Item (Order_itemID, OrderID, MenuID, Quantity, Unit_price, Total) "
-                "VALUES (?, ?, ?, ?, ?, ?)");
-            if (pstmt) {
-                pstmt->setString(1, orderItemID);
-                pstmt->setString(2, orderID);
-                pstmt->setString(3, menuID);
-                pstmt->setInt(4, quantity);
-                pstmt->setDouble(5, unitPrice);
-                pstmt->setDouble(6, total);
-                pstmt->executeUpdate();
-
-                cout << "[SUCCESS] Added: " << quantity << "x " << menuName
-                    << " @ RM" << fixed << setprecision(2) << unitPrice
-                    << " = RM" << total << endl;
+                string orderItemID = generateOrderItemID();
+
+                auto pstmt = db.prepareStatement(
+                    "INSERT INTO Order_Item (Order_itemID, OrderID, MenuID, Quantity, Unit_price, Total) "
+                    "VALUES (?, ?, ?, ?, ?, ?)");
+                if (pstmt) {
+                    pstmt->setString(1, orderItemID);
+                    pstmt->setString(2, orderID);
+                    pstmt->setString(3, menuID);
+                    pstmt->setInt(4, quantity);
+                    pstmt->setDouble(5, unitPrice);
+                    pstmt->setDouble(6, unitPrice * quantity);
+                    pstmt->executeUpdate();
+                    return true;
+                }
+                return false;
+            });
+
+            if (added) {
+                OrderAggregateCache::forget(orderID);
+
+                static Counter& itemsAdded = Metrics::instance().counter(
+                    "restaurant_order_items_added_total", "Order lines added");
+                static Counter& unitsAdded = Metrics::instance().counter(
+                    "restaurant_order_item_units_total", "Menu item units ordered (sum of quantities)");
+                db.afterCommit([quantity, menuName, unitPrice]() {
+                    itemsAdded.inc();
+                    unitsAdded.inc((uint64_t)quantity);
+                    cout << "[SUCCESS] Added: " << quantity << "x " << menuName
+                        << " @ RM" << fixed << setprecision(2) << unitPrice
+                        << " = RM" << unitPrice * quantity << endl;
+                });
                 return true;
             }
             return false;
@@ -226,39 +291,77 @@ public:
         }
     }
 
+    // createOrder at most once per idempotencyKey: a retry with the same
+    // key returns the first call's order ID without running it again
+    string createOrder(const string& tableID, const string& staffID, const string& idempotencyKey) {
+        return idempotency.run(idempotencyKey, "createOrder " + tableID + " " + staffID,
+            [&]() { return createOrder(tableID, staffID); });
+    }
+
+    // Add (menuID, quantity) lines to an order; returns how many were
+    // added. With an idempotency key a retry returns the first call's
+    // count without adding anything again.
+    int addOrderItems(const string& orderID, const vector<pair<string, int>>& items,
+        const string& idempotencyKey = "") {
+        MODULE_SPAN("OrderModule", "addOrderItems");
+        string request = "addOrderItems " + orderID;
+        for (const auto& item : items) request += " " + item.first + ":" + to_string(item.second);
+        string added = idempotency.run(idempotencyKey, request, [&]() {
+            int count = 0;
+            for (const auto& item : items) {
+                if (addOrderItem(orderID, item.first, item.second)) count++;
+            }
+            return count > 0 ? to_string(count) : string();
+        });
+        return atoi(added.c_str());
+    }
+
     // Remove item from order
     bool removeOrderItem(const string& orderItemID) {
+        MODULE_SPAN("OrderModule", "removeOrderItem");
+        if (offline()) {
+            cout << "[FAILED] Items cannot be removed while the database is unreachable!" << endl;
+            return false;
+        }
         try {
-            // Check if order is active
-            auto checkOrder = db.prepareStatement(
-                "SELECT o.Order_status FROM Orders o "
-                "JOIN Order_Item oi ON o.OrderID = oi.OrderID "
-                "WHERE oi.Order_itemID = ?");
-            if (checkOrder) {
-                checkOrder->setString(1, orderItemID);
-                auto res = checkOrder->executeQuery();
-                if (res->next()) {
-                    if (res->getString("Order_status") != "Active") {
-                        cout << "[FAILED] Cannot modify completed order!" << endl;
+            bool removed = db.transaction("removeOrderItem", [&]() {
+                // Check if order is active
+                auto checkOrder = db.prepareStatement(
+                    "SELECT " + sqlField<OrderStatus>("o.Order_status") + " AS Order_status, o.OrderID FROM Orders o "
+                    "JOIN Order_Item oi ON o.OrderID = oi.OrderID "
+                    "WHERE oi.Order_itemID = ? FOR UPDATE");
+                string orderID;
+                if (checkOrder) {
+                    checkOrder->setString(1, orderItemID);
+                    auto res = checkOrder->executeQuery();
+                    if (res->next()) {
+                        if (getEnum<OrderStatus>(*res, "Order_status") != OrderStatus::Active) {
+                            cout << "[FAILED] Cannot modify completed order!" << endl;
+                            return false;
+                        }
+                        orderID = res->getString("OrderID");
+                    }
+                    else {
+                        cout << "[FAILED] Order item not found!" << endl;
                         return false;
                     }
                 }
-                else {
-                    cout << "[FAILED] Order item not found!" << endl;
-                    return false;
-                }
-            }
 
-            auto pstmt = db.prepareStatement("DELETE FROM Order_Item WHERE Order_itemID = ?");
-            if (pstmt) {
-                pstmt->setString(1, orderItemID);
-                int result = pstmt->executeUpdate();
-                if (result > 0) {
-                    cout << "[SUCCESS] Item removed from order!" << endl;
+                auto pstmt = db.prepareStatement("DELETE FROM Order_Item WHERE Order_itemID = ?");
+                if (pstmt) {
+                    pstmt->setString(1, orderItemID);
+                    if (pstmt->executeUpdate() == 0) return false;
+                    orderVersions.update(orderID, "", "", nullopt);
                     return true;
                 }
+                return false;
+            });
+
+            if (removed) {
+                OrderAggregateCache::forgetAll();
+                cout << "[SUCCESS] Item removed from order!" << endl;
             }
-            return false;
+            return removed;
         }
         catch (sql::SQLException& e) {
             cerr << "Error removing item: " << e.what() << endl;
@@ -266,194 +369,182 @@ public:
         }
     }
 
-    // View order details
-    void viewOrderDetails(const string& orderID) {
+    // An order with its bill and lines, in one query (found is false if there
+    // is no such order; nullopt if the query failed)
+    optional<OrderAggregate> getOrderDetails(const string& orderID) {
+        MODULE_SPAN("OrderModule", "getOrderDetails");
+        if (OrderJournal* j = offline()) return j->findOrder(orderID);
         try {
-            // Get order info
-            auto orderStmt = db.prepareStatement(
-                "SELECT o.OrderID, t.Table_number, s.Name as Staff_Name, "
-                "o.Total_amount, o.Order_status, o.Order_date "
-                "FROM Orders o "
-                "JOIN Tables t ON o.TableID = t.TableID "
-                "JOIN Staff s ON o.StaffID = s.StaffID "
-                "WHERE o.OrderID = ?");
-            if (orderStmt) {
-                orderStmt->setString(1, orderID);
-                auto orderRes = orderStmt->executeQuery();
-
-                if (orderRes->next()) {
-                    cout << "\n" << string(60, '=') << endl;
-                    cout << "ORDER DETAILS" << endl;
-                    cout << string(60, '=') << endl;
-                    cout << "Order ID: " << orderRes->getString("OrderID") << endl;
-                    cout << "Table: " << orderRes->getString("Table_number") << endl;
-                    cout << "Staff: " << orderRes->getString("Staff_Name") << endl;
-                    cout << "Date: " << orderRes->getString("Order_date") << endl;
-                    cout << "Status: " << orderRes->getString("Order_status") << endl;
-                    cout << string(60, '-') << endl;
-
-                    // Get order items
-                    auto itemStmt = db.prepareStatement(
-                        "SELECT oi.Order_itemID, m.Menu_name, oi.Quantity, "
-                        "oi.Unit_price, oi.Total "
-                        "FROM Order_Item oi "
-                        "JOIN Menu m ON oi.MenuID = m.MenuID "
-                        "WHERE oi.OrderID = ?");
-                    if (itemStmt) {
-                        itemStmt->setString(1, orderID);
-                        auto itemRes = itemStmt->executeQuery();
-
-                        cout << left << setw(12) << "Item ID"
-                            << setw(25) << "Menu Item"
-                            << setw(8) << "Qty"
-                            << setw(12) << "Price"
-                            << "Total" << endl;
-                        cout << string(60, '-') << endl;
-
-                        while (itemRes->next()) {
-                            cout << left << setw(12) << itemRes->getString("Order_itemID")
-                                << setw(25) << itemRes->getString("Menu_name")
-                                << setw(8) << itemRes->getInt("Quantity")
-                                << "RM " << setw(8) << fixed << setprecision(2)
-                                << itemRes->getDouble("Unit_price")
-                                << "RM " << itemRes->getDouble("Total") << endl;
-                        }
-                    }
-
-                    cout << string(60, '-') << endl;
-                    cout << right << setw(48) << "ORDER TOTAL: RM "
-                        << fixed << setprecision(2) << orderRes->getDouble("Total_amount") << endl;
-                    cout << string(60, '=') << endl;
-                }
-                else {
-                    cout << "[FAILED] Order not found!" << endl;
-                }
-            }
+            return OrderAggregateCache::loadOrder(db, orderID);
         }
         catch (sql::SQLException& e) {
             cerr << "Error viewing order: " << e.what() << endl;
+            return nullopt;
         }
     }
 
-    // View all active orders
-    void viewActiveOrders() {
-        auto res = db.executeQuery(
-            "SELECT o.OrderID, t.Table_number, s.Name as Staff_Name, "
-            "o.Total_amount, o.Order_date "
-            "FROM Orders o "
-            "JOIN Tables t ON o.TableID = t.TableID "
-            "JOIN Staff s ON o.StaffID = s.StaffID "
+    // View order details
+    void viewOrderDetails(const string& orderID) {
+        MODULE_SPAN("OrderModule", "viewOrderDetails");
+        optional<OrderAggregate> details = getOrderDetails(orderID);
+        if (!details) return;
+        if (details->found) {
+            ConsoleRenderer::orderDetails(*details);
+        }
+        else {
+            cout << "[FAILED] Order not found!" << endl;
+        }
+    }
+
+    // Active orders, oldest first (nullopt if the query failed)
+    optional<vector<OrderRow>> listActiveOrders() {
+        MODULE_SPAN("OrderModule", "listActiveOrders");
+        if (OrderJournal* j = offline()) return j->activeOrders();
+        auto res = db.executeQuery(selectRows<OrderRow>(string(OrderRow::from) +
             "WHERE o.Order_status = 'Active' "
-            "ORDER BY o.Order_date");
-
-        if (res) {
-            cout << "\n" << string(75, '=') << endl;
-            cout << "ACTIVE ORDERS" << endl;
-            cout << string(75, '=') << endl;
-            cout << left << setw(15) << "Order ID"
-                << setw(10) << "Table"
-                << setw(20) << "Staff"
-                << setw(15) << "Amount (RM)"
-                << "Date" << endl;
-            cout << string(75, '-') << endl;
+            "ORDER BY o.Order_date"));
+        if (!res) return nullopt;
+        return fetchRows<OrderRow>(res.get());
+    }
 
-            int count = 0;
-            while (res->next()) {
-                cout << left << setw(15) << res->getString("OrderID")
-                    << setw(10) << res->getString("Table_number")
-                    << setw(20) << res->getString("Staff_Name")
-                    << setw(15) << fixed << setprecision(2) << res->getDouble("Total_amount")
-                    << res->getString("Order_date") << endl;
-                count++;
-            }
-            if (count == 0) {
-                cout << "No active orders found." << endl;
-            }
-            cout << string(75, '=') << endl;
-        }
+    // All orders, archived ones included, newest first, read from the
+    // report replica when there is one (nullopt if the query failed, timed
+    // out or was cancelled)
+    optional<vector<OrderRow>> listOrders(const QueryOptions& options = QueryOptions()) {
+        MODULE_SPAN("OrderModule", "listOrders");
+        const char* from = archive.available() ? OrderRow::historyFrom : OrderRow::from;
+        auto res = db.executeReport(selectRows<OrderRow>(string(from) + "ORDER BY o.Order_date DESC"), options);
+        if (!res) return nullopt;
+        return fetchRows<OrderRow>(res.get());
+    }
+
+    // View all active orders
+    void viewActiveOrders() {
+        MODULE_SPAN("OrderModule", "viewActiveOrders");
+        if (auto orders = listActiveOrders()) ConsoleRenderer::activeOrders(*orders);
     }
 
     // View all orders
-    void viewAllOrders() {
-        auto res = db.executeQuery(
-            "SELECT o.OrderID, t.Table_number, s.Name as Staff_Name, "
-            "o.Total_amount, o.Order_status, o.Order_date "
-            "FROM Orders o "
-            "JOIN Tables t ON o.TableID = t.TableID "
-            "JOIN Staff s ON o.StaffID = s.StaffID "
-            "ORDER BY o.Order_date DESC");
-
-        if (res) {
-            cout << "\n" << string(90, '=') << endl;
-            cout << "ALL ORDERS" << endl;
-            cout << string(90, '=') << endl;
-            cout << left << setw(15) << "Order ID"
-                << setw(8) << "Table"
-                << setw(18) << "Staff"
-                << setw(12) << "Amount"
-                << setw(12) << "Status"
-                << "Date" << endl;
-            cout << string(90, '-') << endl;
-
-            while (res->next()) {
-                cout << left << setw(15) << res->getString("OrderID")
-                    << setw(8) << res->getString("Table_number")
-                    << setw(18) << res->getString("Staff_Name")
-                    << "RM " << setw(9) << fixed << setprecision(2) << res->getDouble("Total_amount")
-                    << setw(12) << res->getString("Order_status")
-                    << res->getString("Order_date") << endl;
-            }
-            cout << string(90, '=') << endl;
-        }
+    void viewAllOrders(const QueryOptions& options = QueryOptions()) {
+        MODULE_SPAN("OrderModule", "viewAllOrders");
+        if (auto orders = listOrders(options)) ConsoleRenderer::allOrders(*orders);
     }
 
     // Cancel order
     bool cancelOrder(const string& orderID) {
+        return (bool)cancelOrder(orderID, nullopt);
+    }
+
+    // Cancel order if it is still at expectedVersion (any version if not
+    // set); otherwise the result is a Conflict with the current version
+    WriteResult cancelOrder(const string& orderID, const optional<RowVersion>& expectedVersion) {
+        MODULE_SPAN("OrderModule", "cancelOrder");
+        WriteResult result;
+        result.id = orderID;
+        if (OrderJournal* j = offline()) {
+            if (j->cancelOrder(orderID)) result.status = WriteStatus::Done;
+            return result;
+        }
         try {
-            // Check if order is active
-            auto checkOrder = db.prepareStatement(
-                "SELECT Order_status, TableID FROM Orders WHERE OrderID = ?");
-            string tableID;
-            if (checkOrder) {
-                checkOrder->setString(1, orderID);
-                auto res = checkOrder->executeQuery();
-                if (res->next()) {
-                    if (res->getString("Order_status") != "Active") {
-                        cout << "[FAILED] Only active orders can be cancelled!" << endl;
-                        return false;
+            bool cancelled = db.transaction("cancelOrder", [&]() {
+                if (!orderVersions.update(orderID, "Order_status = 'Cancelled'", "Order_status = 'Active'", expectedVersion)) {
+                    // Not cancelled: say why (without versions, check and cancel here)
+                    auto checkOrder = db.prepareStatement(
+                        "SELECT " + sqlField<OrderStatus>("Order_status") + " AS Order_status" + orderVersions.column()
+                        + " FROM Orders WHERE OrderID = ? FOR UPDATE");
+                    if (checkOrder) {
+                        checkOrder->setString(1, orderID);
+                        auto res = checkOrder->executeQuery();
+                        if (!res->next()) {
+                            cout << "[FAILED] Order not found!" << endl;
+                            return false;
+                        }
+                        if (getEnum<OrderStatus>(*res, "Order_status") != OrderStatus::Active) {
+                            cout << "[FAILED] Only active orders can be cancelled!" << endl;
+                            return false;
+                        }
+                        if (orderVersions.available()) {
+                            result.status = WriteStatus::Conflict;
+                            result.version = res->getUInt64("Version");
+                            cout << "[FAILED] Order was changed on another terminal!" << endl;
+                            return false;
+                        }
                     }
-                    tableID = res->getString("TableID");
-                }
-                else {
-                    cout << "[FAILED] Order not found!" << endl;
-                    return false;
-                }
-            }
 
-            // Cancel order
-            auto pstmt = db.prepareStatement(
-                "UPDATE Orders SET Order_status = 'Cancelled' WHERE OrderID = ?");
-            if (pstmt) {
-                pstmt->setString(1, orderID);
-                pstmt->executeUpdate();
+                    // Cancel order
+                    auto pstmt = db.prepareStatement(
+                        "UPDATE Orders SET Order_status = 'Cancelled' WHERE OrderID = ?");
+                    if (!pstmt) return false;
+                    pstmt->setString(1, orderID);
+                    pstmt->executeUpdate();
+                }
 
                 // Set table to vacant
-                db.executeUpdate("UPDATE Tables SET Status = 'Vacant' WHERE TableID = '" + tableID + "'");
-
-                cout << "[SUCCESS] Order cancelled successfully!" << endl;
+                auto vacate = db.prepareStatement(
+                    "UPDATE Tables SET Status = 'Vacant' WHERE TableID = (SELECT TableID FROM Orders WHERE OrderID = ?)");
+                if (!vacate) return false;
+                vacate->setString(1, orderID);
+                vacate->executeUpdate();
                 return true;
+            });
+
+            if (cancelled) {
+                OrderAggregateCache::forget(orderID);
+
+                static Counter& ordersCancelled = Metrics::instance().counter(
+                    "restaurant_orders_cancelled_total", "Orders cancelled");
+                static Gauge& activeOrders = Metrics::instance().gauge(
+                    "restaurant_active_orders", "Orders currently active");
+                db.afterCommit([]() {
+                    ordersCancelled.inc();
+                    activeOrders.dec();
+                    cout << "[SUCCESS] Order cancelled successfully!" << endl;
+                });
+                result.status = WriteStatus::Done;
+                // The write bumped Version only if the table has one
+                if (expectedVersion && orderVersions.available()) result.version = *expectedVersion + 1;
             }
-            return false;
+            else if (result.conflict()) {
+                OrderAggregateCache::forget(orderID);
+            }
+            return result;
         }
         catch (sql::SQLException& e) {
             cerr << "Error cancelling order: " << e.what() << endl;
-            return false;
+            return result;
+        }
+    }
+
+    // Version of an order to pass back with a conditional write (nullopt if
+    // the order is not found, versions are not enabled or the database is
+    // unreachable). Inside an operation it is the version of the order as
+    // loaded and shown, not a later read.
+    optional<RowVersion> getOrderVersion(const string& orderID) {
+        MODULE_SPAN("OrderModule", "getOrderVersion");
+        if (offline()) return nullopt;
+        try {
+            if (OrderAggregateCache::active()) {
+                optional<OrderAggregate> order = OrderAggregateCache::loadOrder(db, orderID);
+                return order && order->found ? order->version : nullopt;
+            }
+            return orderVersions.read(orderID);
+        }
+        catch (sql::SQLException& e) {
+            cerr << "Error reading order version: " << e.what() << endl;
+            return nullopt;
         }
     }
 
     // Get order total
     double getOrderTotal(const string& orderID) {
+        MODULE_SPAN("OrderModule", "getOrderTotal");
+        if (OrderJournal* j = offline()) return j->findOrder(orderID).order.totalAmount;
         try {
+            // Inside an operation the order is usually loaded already
+            if (OrderAggregateCache::active()) {
+                optional<OrderAggregate> order = OrderAggregateCache::loadOrder(db, orderID);
+                return order && order->found ? order->order.totalAmount : 0;
+            }
             auto pstmt = db.prepareStatement("SELECT Total_amount FROM Orders WHERE OrderID = ?");
             if (pstmt) {
                 pstmt->setString(1, orderID);
@@ -472,7 +563,16 @@ public:
 
     // Check if order exists and is active
     bool isOrderActive(const string& orderID) {
+        MODULE_SPAN("OrderModule", "isOrderActive");
+        if (OrderJournal* j = offline()) {
+            OrderAggregate order = j->findOrder(orderID);
+            return order.found && order.order.status == OrderStatus::Active;
+        }
         try {
+            if (OrderAggregateCache::active()) {
+                optional<OrderAggregate> order = OrderAggregateCache::loadOrder(db, orderID);
+                return order && order->found && order->order.status == OrderStatus::Active;
+            }
             auto pstmt = db.prepareStatement(
                 "SELECT OrderID FROM Orders WHERE OrderID = ? AND Order_status = 'Active'");
             if (pstmt) {
@@ -489,6 +589,8 @@ public:
 
     // Get active order for table
     string getActiveOrderForTable(const string& tableID) {
+        MODULE_SPAN("OrderModule", "getActiveOrderForTable");
+        if (OrderJournal* j = offline()) return j->activeOrderForTable(tableID);
         try {
             auto pstmt = db.prepareStatement(
                 "SELECT OrderID FROM Orders WHERE TableID = ? AND Order_status = 'Active'");
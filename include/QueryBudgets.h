@@ -0,0 +1,163 @@
+#pragma once
+#include "DatabaseConnection.h"
+#include "TableModule.h"
+#include "OrderModule.h"
+#include "BillingModule.h"
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+using namespace std;
+
+// Maximum statements each hot-path operation may issue, as counted by
+// DatabaseConnection::getStatementCount: a prepared statement counts once
+// when prepared, and none of these operations executes one twice. The ID
+// generators fall back to a second query when their table is empty, so the
+// write paths allow one statement more than the usual case. Every
+// DatabaseConnection::transaction adds two: START TRANSACTION and COMMIT
+// (or ROLLBACK). The payment screen takes the order's
+// version from the load it shows, so it costs nothing there.
+// Lower these when an operation gets cheaper; never raise them to make a
+// failing check pass without knowing why the operation got more expensive.
+struct QueryBudget {
+    const char* operation;
+    unsigned long long maxStatements;
+};
+
+static const QueryBudget queryBudgets[] = {
+    { "TableModule::updateTableStatus", 4 },
+    { "OrderModule::createOrder", 9 },
+    { "OrderModule::addOrderItem", 7 },
+    { "OrderModule::viewOrderDetails", 1 },
+    { "OrderModule::isOrderActive", 1 },
+    { "OrderModule::getOrderTotal", 1 },
+    { "OrderModule::getOrderVersion", 1 },
+    { "OrderModule::cancelOrder", 5 },
+    { "BillingModule::getBillForOrder", 1 },
+    { "BillingModule::generateBill", 8 },
+    { "BillingModule::processPayment", 4 },
+    { "BillingModule::viewBillDetails", 1 },
+    { "staffProcessPayment", 14 },
+};
+
+// Returns the budget for an operation, or 0 if it has none
+inline unsigned long long findQueryBudget(const string& operation) {
+    for (const QueryBudget& budget : queryBudgets) {
+        if (operation == budget.operation) return budget.maxStatements;
+    }
+    return 0;
+}
+
+// Runs a short service against the connected database (seat a table, order,
+// view, pay, then a second order that is cancelled) with every step under a
+// QueryTracker, and checks the totals against queryBudgets. Meant for a
+// test database: it creates real orders and bills.
+class QueryBudgetCheck {
+private:
+    DatabaseConnection& db;
+
+    string firstValue(const string& query) {
+        auto res = db.executeQuery(query);
+        if (res && res->next()) return res->getString(1);
+        return "";
+    }
+
+    void runScenario(const string& tableID, const string& staffID, const vector<string>& menuIDs) {
+        TableModule tables(db);
+        OrderModule orders(db);
+        BillingModule billing(db);
+
+        { QueryTracker t(db, "TableModule::updateTableStatus"); tables.updateTableStatus(tableID, TableStatus::Occupied); }
+        string orderID;
+        { QueryTracker t(db, "OrderModule::createOrder"); orderID = orders.createOrder(tableID, staffID); }
+        if (orderID.empty()) return;
+        for (const string& menuID : menuIDs) {
+            QueryTracker t(db, "OrderModule::addOrderItem");
+            orders.addOrderItem(orderID, menuID, 2);
+        }
+        { QueryTracker t(db, "OrderModule::viewOrderDetails"); orders.viewOrderDetails(orderID); }
+
+        // The staff "Process Payment" screen, step by step
+        {
+            QueryTracker flow(db, "staffProcessPayment");
+            OrderAggregateCache::Scope orderCache;
+            { QueryTracker t(db, "OrderModule::isOrderActive"); orders.isOrderActive(orderID); }
+            { QueryTracker t(db, "OrderModule::getOrderTotal"); orders.getOrderTotal(orderID); }
+            optional<RowVersion> shownVersion;
+            { QueryTracker t(db, "OrderModule::getOrderVersion"); shownVersion = orders.getOrderVersion(orderID); }
+            { QueryTracker t(db, "OrderModule::viewOrderDetails"); orders.viewOrderDetails(orderID); }
+            string billID;
+            { QueryTracker t(db, "BillingModule::getBillForOrder"); billID = billing.getBillForOrder(orderID); }
+            if (billID.empty()) {
+                QueryTracker t(db, "BillingModule::generateBill");
+                billID = billing.generateBill(orderID, staffID, PaymentMethod::Cash, shownVersion).id;
+            }
+            if (!billID.empty()) {
+                bool paid;
+                { QueryTracker t(db, "BillingModule::processPayment"); paid = billing.processPayment(billID); }
+                if (paid) {
+                    QueryTracker t(db, "BillingModule::viewBillDetails");
+                    billing.viewBillDetails(billID);
+                }
+            }
+        }
+
+        // Second party on the same table walks out
+        tables.updateTableStatus(tableID, TableStatus::Occupied);
+        string cancelID = orders.createOrder(tableID, staffID);
+        if (!cancelID.empty()) {
+            orders.addOrderItem(cancelID, menuIDs.front(), 1);
+            QueryTracker t(db, "OrderModule::cancelOrder");
+            orders.cancelOrder(cancelID);
+        }
+    }
+
+public:
+    QueryBudgetCheck(DatabaseConnection& database) : db(database) {}
+
+    // Returns true when every measured operation stays within its budget
+    bool run(ostream& out) {
+        string tableID = firstValue("SELECT TableID FROM Tables WHERE Status = 'Vacant' ORDER BY TableID LIMIT 1");
+        string staffID = firstValue("SELECT StaffID FROM Staff WHERE Status = 'Active' ORDER BY StaffID LIMIT 1");
+        vector<string> menuIDs;
+        auto menuRes = db.executeQuery(
+            "SELECT MenuID FROM Menu WHERE Availability = 'Available' ORDER BY MenuID LIMIT 2");
+        if (menuRes) while (menuRes->next()) menuIDs.push_back(menuRes->getString(1));
+
+        if (tableID.empty() || staffID.empty() || menuIDs.empty()) {
+            out << "[FAILED] Budget check needs a vacant table, an active staff member and an available menu item." << endl;
+            return false;
+        }
+
+        db.resetOperationStats();
+        ostringstream captured;
+        streambuf* savedOut = cout.rdbuf(captured.rdbuf());
+        runScenario(tableID, staffID, menuIDs);
+        cout.rdbuf(savedOut);
+
+        out << left << setw(36) << "Operation" << setw(8) << "Calls"
+            << setw(8) << "Max" << setw(8) << "Budget" << "Result" << endl;
+        out << string(70, '-') << endl;
+
+        bool passed = true;
+        const auto& stats = db.getOperationStats();
+        for (const QueryBudget& budget : queryBudgets) {
+            auto it = stats.find(budget.operation);
+            out << left << setw(36) << budget.operation;
+            if (it == stats.end()) {
+                out << setw(8) << 0 << setw(8) << "-" << setw(8) << budget.maxStatements << "NOT RUN" << endl;
+                passed = false;
+                continue;
+            }
+            bool ok = it->second.maxStatements <= budget.maxStatements;
+            passed = passed && ok;
+            out << setw(8) << it->second.calls << setw(8) << it->second.maxStatements
+                << setw(8) << budget.maxStatements << (ok ? "OK" : "OVER BUDGET") << endl;
+        }
+        out << string(70, '-') << endl;
+        out << (passed ? "[SUCCESS] All operations within budget." : "[FAILED] Query budget exceeded.") << endl;
+        return passed;
+    }
+};
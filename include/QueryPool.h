@@ -0,0 +1,308 @@
+#pragma once
+#include "DatabaseConnection.h"
+#include "Metrics.h"
+#include <mysql_driver.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <type_traits>
+
+using namespace std;
+
+// What a pooled task is for, highest priority first. Free connections
+// always go to the most urgent queued class.
+enum class WorkClass : uint8_t {
+    PosWrite,         // a till changing an order, bill or table
+    InteractiveRead,  // a screen someone is waiting on
+    Report,           // admin reports and listings
+    Batch,            // imports, exports, benchmarks' background load
+};
+
+constexpr size_t workClassCount = 4;
+
+inline const char* workClassName(WorkClass workClass) {
+    static const char* const names[workClassCount] = { "pos", "read", "report", "batch" };
+    return names[(size_t)workClass];
+}
+
+// Admission rules for one class
+struct WorkClassLimits {
+    size_t maxQueued;               // submit() fails once this many are waiting
+    chrono::milliseconds maxWait;   // queued longer than this: dropped unrun
+};
+
+// A task the pool refused (queue full) or dropped (waited past its
+// deadline) without running it. Derives from sql::SQLException so the
+// modules' existing error handling covers it.
+class QueryRejected : public sql::SQLException {
+public:
+    explicit QueryRejected(const string& reason) : sql::SQLException(reason) {}
+};
+
+// Runs database work on worker threads that each own a connection, so
+// several independent queries can be in flight instead of waiting for one
+// before sending the next.
+//
+//   QueryPool pool(4);   // one connection held back for POS writes
+//   auto saved = pool.submit(WorkClass::Report, [date](DatabaseConnection& conn) {
+//       return saveDailyTotal(conn, date);
+//   });
+//   auto summary = summarizeDailySales(date);   // meanwhile, on db
+//   saved.get();
+//
+// Scheduling: each class has its own queue and a free worker takes the
+// oldest task of the most urgent non-empty class. reservedForPos workers
+// only ever run PosWrite tasks, so reports and batch jobs can fill the rest
+// of the pool without making a till wait behind them. A class whose queue
+// is full rejects new work, and a task that waited longer than its class's
+// maxWait is failed with QueryRejected instead of being run late.
+//
+// Pool connections throw sql::SQLException instead of printing, so a failed
+// task rethrows from future::get() and the caller reports it on its own
+// thread. Tasks must not write to cout or cerr themselves.
+class QueryPool {
+public:
+    // Queue waits and shedding for one class since the pool started
+    struct ClassStats {
+        unsigned long long started = 0;
+        unsigned long long rejected = 0;   // queue full
+        unsigned long long expired = 0;    // waited past maxWait
+        double totalWaitMs = 0;
+        double maxWaitMs = 0;
+    };
+
+private:
+    struct Task {
+        function<void(DatabaseConnection&)> run;
+        function<void(exception_ptr)> fail;
+        chrono::steady_clock::time_point queuedAt;
+    };
+
+    // Per-class metrics, labelled class="pos" etc.
+    struct ClassMetrics {
+        Gauge* queued;
+        Histogram* wait;
+        Counter* rejected;
+        Counter* expired;
+    };
+
+    mutex lock;
+    condition_variable wake;
+    condition_variable started;
+    deque<Task> queues[workClassCount];
+    WorkClassLimits limits[workClassCount];
+    ClassStats stats[workClassCount];
+    vector<thread> workers;
+    int starting = 0;
+    int connected = 0;
+    int reservedForPos;
+    int generalBusy = 0;   // workers running something other than PosWrite
+    bool stopping = false;
+    mutex connectLock;     // connect() prints its troubleshooting on failure
+
+    static const ClassMetrics& metrics(WorkClass workClass) {
+        static const auto all = []() {
+            vector<ClassMetrics> m;
+            Metrics& registry = Metrics::instance();
+            for (size_t i = 0; i < workClassCount; i++) {
+                string label = string("class=\"") + workClassName((WorkClass)i) + "\"";
+                m.push_back({
+                    &registry.gauge("restaurant_db_pool_queued", "Query pool tasks waiting for a connection", label),
+                    &registry.histogram("restaurant_db_pool_wait_seconds", "Time query pool tasks spent queued", label),
+                    &registry.counter("restaurant_db_pool_rejected_total", "Query pool tasks refused because the queue was full", label),
+                    &registry.counter("restaurant_db_pool_expired_total", "Query pool tasks dropped after waiting too long", label) });
+            }
+            return m;
+        }();
+        return all[(size_t)workClass];
+    }
+
+    // Next task this worker may run, most urgent class first. Tasks past
+    // their deadline are moved to expired. Caller holds lock.
+    bool takeNext(Task& task, WorkClass& workClass, vector<Task>& expired) {
+        auto now = chrono::steady_clock::now();
+        int generalLimit = connected - reservedForPos;
+        for (size_t i = 0; i < workClassCount; i++) {
+            WorkClass c = (WorkClass)i;
+            deque<Task>& queue = queues[i];
+            while (!queue.empty() && now - queue.front().queuedAt > limits[i].maxWait) {
+                expired.push_back(move(queue.front()));
+                queue.pop_front();
+                stats[i].expired++;
+                metrics(c).queued->dec();
+                metrics(c).expired->inc();
+            }
+            if (queue.empty()) continue;
+            if (c != WorkClass::PosWrite && generalBusy >= generalLimit) continue;
+
+            task = move(queue.front());
+            queue.pop_front();
+            workClass = c;
+            double waitMs = chrono::duration<double, milli>(now - task.queuedAt).count();
+            ClassStats& s = stats[i];
+            s.started++;
+            s.totalWaitMs += waitMs;
+            if (waitMs > s.maxWaitMs) s.maxWaitMs = waitMs;
+            metrics(c).queued->dec();
+            metrics(c).wait->observeMicros((uint64_t)(waitMs * 1000));
+            return true;
+        }
+        return false;
+    }
+
+    bool anyQueued() const {
+        for (const deque<Task>& queue : queues) {
+            if (!queue.empty()) return true;
+        }
+        return false;
+    }
+
+    void workerLoop() {
+        sql::mysql::get_mysql_driver_instance()->threadInit();
+        {
+            DatabaseConnection conn(false);
+            bool ok;
+            {
+                lock_guard<mutex> guard(connectLock);
+                ok = conn.connect();
+            }
+            conn.setThrowOnError(true);
+
+            unique_lock<mutex> guard(lock);
+            starting--;
+            if (ok) connected++;
+            started.notify_all();
+
+            while (ok) {
+                Task task;
+                WorkClass workClass = WorkClass::PosWrite;
+                vector<Task> expired;
+                bool found = false;
+                wake.wait(guard, [&]() {
+                    found = takeNext(task, workClass, expired);
+                    return found || !expired.empty() || (stopping && !anyQueued());
+                });
+                if (!found && expired.empty()) break;   // stopping, and everything queued has run
+
+                bool general = found && workClass != WorkClass::PosWrite;
+                if (general) generalBusy++;
+                guard.unlock();
+                for (Task& dropped : expired) {
+                    dropped.fail(make_exception_ptr(QueryRejected("Query waited too long in the pool")));
+                }
+                if (found) task.run(conn);
+                guard.lock();
+                if (general) {
+                    generalBusy--;
+                    wake.notify_one();   // a held-back general task may go now
+                }
+            }
+        }
+        sql::mysql::get_mysql_driver_instance()->threadEnd();
+    }
+
+public:
+    // Opens size connections and returns once each has connected or failed.
+    // reservedForPos of them run PosWrite tasks only (at least one
+    // connection is always left for the other classes).
+    explicit QueryPool(int size, int reservedPosConnections = 1)
+        : reservedForPos(reservedPosConnections) {
+        limits[(size_t)WorkClass::PosWrite] = { 256, chrono::seconds(5) };
+        limits[(size_t)WorkClass::InteractiveRead] = { 128, chrono::seconds(5) };
+        limits[(size_t)WorkClass::Report] = { 16, chrono::seconds(60) };
+        limits[(size_t)WorkClass::Batch] = { 8, chrono::minutes(10) };
+
+        starting = size;
+        for (int i = 0; i < size; i++) {
+            workers.emplace_back([this]() { workerLoop(); });
+        }
+        unique_lock<mutex> guard(lock);
+        started.wait(guard, [this]() { return starting == 0; });
+        if (reservedForPos > connected - 1) reservedForPos = connected > 0 ? connected - 1 : 0;
+        if (reservedForPos < 0) reservedForPos = 0;
+    }
+
+    ~QueryPool() {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (thread& worker : workers) worker.join();
+    }
+
+    QueryPool(const QueryPool&) = delete;
+    QueryPool& operator=(const QueryPool&) = delete;
+
+    // Workers that connected and are taking tasks
+    int size() {
+        lock_guard<mutex> guard(lock);
+        return connected;
+    }
+
+    // Change the queue limit and deadline of one class
+    void setLimits(WorkClass workClass, const WorkClassLimits& classLimits) {
+        lock_guard<mutex> guard(lock);
+        limits[(size_t)workClass] = classLimits;
+    }
+
+    ClassStats getStats(WorkClass workClass) {
+        lock_guard<mutex> guard(lock);
+        return stats[(size_t)workClass];
+    }
+
+    // Queue task(conn) in its class. The future carries the result, the
+    // exception the task threw, or QueryRejected if it never ran.
+    template <typename F>
+    future<invoke_result_t<F&, DatabaseConnection&>> submit(WorkClass workClass, F task) {
+        using Result = invoke_result_t<F&, DatabaseConnection&>;
+        auto done = make_shared<promise<Result>>();
+        future<Result> result = done->get_future();
+
+        Task queued;
+        queued.run = [done, task = move(task)](DatabaseConnection& conn) mutable {
+            try {
+                if constexpr (is_void_v<Result>) {
+                    task(conn);
+                    done->set_value();
+                }
+                else {
+                    done->set_value(task(conn));
+                }
+            }
+            catch (...) {
+                done->set_exception(current_exception());
+            }
+        };
+        queued.fail = [done](exception_ptr error) { done->set_exception(error); };
+        queued.queuedAt = chrono::steady_clock::now();
+
+        size_t index = (size_t)workClass;
+        {
+            lock_guard<mutex> guard(lock);
+            if (connected == 0) {
+                queued.fail(make_exception_ptr(QueryRejected("Query pool has no connections")));
+                return result;
+            }
+            if (queues[index].size() >= limits[index].maxQueued) {
+                stats[index].rejected++;
+                metrics(workClass).rejected->inc();
+                queued.fail(make_exception_ptr(QueryRejected(
+                    string("Query pool queue is full for ") + workClassName(workClass) + " work")));
+                return result;
+            }
+            queues[index].push_back(move(queued));
+            metrics(workClass).queued->inc();
+        }
+        // Every worker re-checks: the one woken may not be allowed this class
+        wake.notify_all();
+        return result;
+    }
+};
@@ -0,0 +1,236 @@
+#pragma once
+#include "Status.h"
+#include "DatabaseConnection.h"
+#include <cppconn/resultset.h>
+#include <string>
+#include <vector>
+#include <optional>
+#include <memory>
+#include <tuple>
+#include <chrono>
+#include <utility>
+#include <type_traits>
+#include <cstdio>
+#include <ctime>
+#include <initializer_list>
+
+using namespace std;
+
+// Maps result rows into plain structs by column position.
+//
+// A row type lists its fields and the SQL expression for each one:
+//
+//   struct MenuRow {
+//       string menuID;
+//       double price;
+//       Availability availability;
+//       static auto columns() {
+//           return make_tuple(
+//               column(&MenuRow::menuID, "MenuID"),
+//               column(&MenuRow::price, "Price"),
+//               column(&MenuRow::availability, "Availability"));
+//       }
+//   };
+//
+//   auto res = db.executeQuery(selectRows<MenuRow>("FROM Menu ORDER BY Menu_name"));
+//   vector<MenuRow> rows = fetchRows<MenuRow>(res.get());
+//
+// The position of a field in columns() is its column index, fixed at
+// compile time, so reading a row never looks a column up by name. Enums
+// are selected with FIELD(...) and dates as day or second counts, so they
+// arrive as integers and are never built as strings.
+
+// Stored DATETIME as seconds since 1970-01-01 00:00:00 (wall clock, no time zone)
+using DateTime = chrono::time_point<chrono::system_clock, chrono::seconds>;
+using Days = chrono::duration<int, ratio<86400>>;
+// Stored DATE as days since 1970-01-01
+using Date = chrono::time_point<chrono::system_clock, Days>;
+
+struct CivilDate {
+    int year;
+    unsigned month;
+    unsigned day;
+};
+
+// Days since 1970-01-01 to year/month/day (proleptic Gregorian)
+constexpr CivilDate civilFromDays(long long z) {
+    z += 719468;
+    long long era = (z >= 0 ? z : z - 146096) / 146097;
+    unsigned doe = (unsigned)(z - era * 146097);
+    unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    long long y = (long long)yoe + era * 400;
+    unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned mp = (5 * doy + 2) / 153;
+    unsigned d = doy - (153 * mp + 2) / 5 + 1;
+    unsigned m = mp < 10 ? mp + 3 : mp - 9;
+    return { (int)(y + (m <= 2)), m, d };
+}
+
+constexpr long long daysFromCivil(int year, unsigned month, unsigned day) {
+    long long y = (long long)year - (month <= 2);
+    long long era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = (unsigned)(y - era * 400);
+    unsigned doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (long long)doe - 719468;
+}
+
+static_assert(daysFromCivil(1970, 1, 1) == 0, "epoch");
+static_assert(civilFromDays(daysFromCivil(2024, 2, 29)).day == 29, "leap day round trip");
+
+// YYYY-MM-DD, as MySQL prints a DATE
+inline string formatDate(Date date) {
+    CivilDate c = civilFromDays(date.time_since_epoch().count());
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "%04d-%02u-%02u", c.year, c.month, c.day);
+    return string(buffer);
+}
+
+// YYYY-MM-DD HH:MM:SS, as MySQL prints a DATETIME
+inline string formatDateTime(DateTime time) {
+    long long seconds = time.time_since_epoch().count();
+    long long days = seconds >= 0 ? seconds / 86400 : (seconds - 86399) / 86400;
+    int rest = (int)(seconds - days * 86400);
+    CivilDate c = civilFromDays(days);
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%04d-%02u-%02u %02d:%02d:%02d",
+        c.year, c.month, c.day, rest / 3600, rest / 60 % 60, rest % 60);
+    return string(buffer);
+}
+
+// Local wall-clock time, the way MySQL stores NOW()
+inline DateTime localNow() {
+    time_t now = time(0);
+    tm ltm;
+#ifdef _WIN32
+    localtime_s(&ltm, &now);
+#else
+    localtime_r(&now, &ltm);
+#endif
+    long long days = daysFromCivil(ltm.tm_year + 1900, (unsigned)ltm.tm_mon + 1, (unsigned)ltm.tm_mday);
+    return DateTime(chrono::seconds(days * 86400 + ltm.tm_hour * 3600 + ltm.tm_min * 60 + ltm.tm_sec));
+}
+
+// How a field type is selected and read
+template <typename T, typename = void>
+struct ColumnType;
+
+template <> struct ColumnType<string> {
+    static string select(const string& expression) { return expression; }
+    static void read(sql::ResultSet& res, uint32_t index, string& out) { out = res.getString(index); }
+};
+
+template <> struct ColumnType<int> {
+    static string select(const string& expression) { return expression; }
+    static void read(sql::ResultSet& res, uint32_t index, int& out) { out = res.getInt(index); }
+};
+
+template <> struct ColumnType<long long> {
+    static string select(const string& expression) { return expression; }
+    static void read(sql::ResultSet& res, uint32_t index, long long& out) { out = (long long)res.getInt64(index); }
+};
+
+template <> struct ColumnType<double> {
+    static string select(const string& expression) { return expression; }
+    static void read(sql::ResultSet& res, uint32_t index, double& out) { out = (double)res.getDouble(index); }
+};
+
+template <> struct ColumnType<DateTime> {
+    // TO_SECONDS counts from year 0; 62167219200 is TO_SECONDS('1970-01-01')
+    static string select(const string& expression) { return "TO_SECONDS(" + expression + ") - 62167219200"; }
+    static void read(sql::ResultSet& res, uint32_t index, DateTime& out) {
+        out = DateTime(chrono::seconds((long long)res.getInt64(index)));
+    }
+};
+
+template <> struct ColumnType<Date> {
+    // 719528 is TO_DAYS('1970-01-01')
+    static string select(const string& expression) { return "TO_DAYS(" + expression + ") - 719528"; }
+    static void read(sql::ResultSet& res, uint32_t index, Date& out) { out = Date(Days(res.getInt(index))); }
+};
+
+template <typename E>
+struct ColumnType<E, enable_if_t<is_enum_v<E>>> {
+    static string select(const string& expression) { return sqlField<E>(expression); }
+    static void read(sql::ResultSet& res, uint32_t index, E& out) { out = (E)res.getInt(index); }
+};
+
+// Read a column selected as sqlField<E>(...) outside a row type
+template <typename E>
+E getEnum(sql::ResultSet& res, const string& columnLabel) {
+    return (E)res.getInt(columnLabel);
+}
+
+template <typename Row, typename T>
+struct Column {
+    T Row::* field;
+    const char* expression;
+};
+
+template <typename Row, typename T>
+constexpr Column<Row, T> column(T Row::* field, const char* expression) {
+    return { field, expression };
+}
+
+template <typename Row, size_t... I>
+string buildSelectList(index_sequence<I...>) {
+    auto columns = Row::columns();
+    string list;
+    ((list += (I == 0 ? "" : ", ")
+        + ColumnType<remove_reference_t<decltype(declval<Row&>().*(get<I>(columns).field))>>::select(
+            get<I>(columns).expression)), ...);
+    return list;
+}
+
+// Comma-separated select expressions for Row, built once
+template <typename Row>
+const string& selectList() {
+    static const string list = buildSelectList<Row>(
+        make_index_sequence<tuple_size_v<decltype(Row::columns())>>());
+    return list;
+}
+
+// "SELECT <Row's columns> " + rest
+template <typename Row>
+string selectRows(const string& rest) {
+    return "SELECT " + selectList<Row>() + " " + rest;
+}
+
+template <typename Row, size_t... I>
+void mapRow(sql::ResultSet& res, Row& row, index_sequence<I...>) {
+    static const auto columns = Row::columns();
+    (ColumnType<remove_reference_t<decltype(row.*(get<I>(columns).field))>>::read(
+        res, (uint32_t)(I + 1), row.*(get<I>(columns).field)), ...);
+}
+
+// Read the current row of a result selected with selectRows<Row>
+template <typename Row>
+Row mapRow(sql::ResultSet& res) {
+    Row row{};
+    mapRow(res, row, make_index_sequence<tuple_size_v<decltype(Row::columns())>>());
+    return row;
+}
+
+// Read every remaining row
+template <typename Row>
+vector<Row> fetchRows(sql::ResultSet* res) {
+    vector<Row> rows;
+    if (!res) return rows;
+    rows.reserve(res->rowsCount());
+    while (res->next()) rows.push_back(mapRow<Row>(*res));
+    return rows;
+}
+
+// Run a SELECT built with selectRows<Row>, binding params to its ? markers
+// in order (nullopt if the statement could not be prepared)
+template <typename Row>
+optional<vector<Row>> queryRows(DatabaseConnection& conn, const string& query, initializer_list<string> params) {
+    auto pstmt = conn.prepareStatement(query);
+    if (!pstmt) return nullopt;
+    uint32_t index = 1;
+    for (const string& param : params) {
+        pstmt->setString(index++, param);
+    }
+    unique_ptr<sql::ResultSet> res(pstmt->executeQuery());
+    return fetchRows<Row>(res.get());
+}
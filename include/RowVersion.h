@@ -0,0 +1,92 @@
+#pragma once
+#include "DatabaseConnection.h"
+#include "SchemaCheck.h"
+#include <string>
+#include <optional>
+
+using namespace std;
+
+// Version of an Orders or Bill row: raised by every write to it
+using RowVersion = unsigned long long;
+
+enum class WriteStatus {
+    Done,
+    Conflict,   // the row changed since the caller read its version
+    Failed,     // refused or not found (the module printed why), or an error
+};
+
+// Result of a write that can be made conditional on the version the caller
+// last showed the user
+struct WriteResult {
+    WriteStatus status = WriteStatus::Failed;
+    string id;              // the row created or changed
+    RowVersion version = 0; // on Conflict, the current version to retry with;
+                            // on Done, the new version if one was expected
+
+    explicit operator bool() const { return status == WriteStatus::Done; }
+    bool conflict() const { return status == WriteStatus::Conflict; }
+};
+
+// The Version column of one table, for optimistic checks. A caller reads
+// the version with what it shows, lets the user decide, and passes it back
+// with the write; the write is refused with a Conflict if anyone changed
+// the row in between, so nothing stays locked while the user thinks.
+//
+//   if (!versions.update(orderID, "", "Order_status = 'Active'", expected)) {
+//       ... SELECT the row FOR UPDATE to find out why (or, without the
+//       ... column, to lock and check it the old way)
+//   }
+//
+// Without the column (database/row_versions.sql not run) update() does
+// nothing and returns false, read() returns nullopt and expected versions
+// are not checked.
+class VersionColumn {
+private:
+    DatabaseConnection& db;
+    string table;
+    string keyColumn;
+
+public:
+    VersionColumn(DatabaseConnection& database, const string& tableName, const string& key)
+        : db(database), table(tableName), keyColumn(key) {}
+
+    // True if the table has a Version column (see SchemaCheck)
+    bool available() {
+        return SchemaCheck::hasColumn(db, table, "Version");
+    }
+
+    // ", Version" to add to a SELECT of the row, when there is one
+    string column() {
+        return available() ? ", Version" : "";
+    }
+
+    // UPDATE the row keyed by id: apply set (may be empty) and raise its
+    // version, if it matches condition (may be empty) and its version is
+    // expected (any, if not set). True if the row was updated; it stays
+    // locked until the transaction ends. Throws sql::SQLException.
+    bool update(const string& id, const string& set, const string& condition,
+        const optional<RowVersion>& expected) {
+        if (!available()) return false;
+        string query = "UPDATE " + table + " SET " + (set.empty() ? "" : set + ", ")
+            + "Version = Version + 1 WHERE " + keyColumn + " = ?";
+        if (!condition.empty()) query += " AND " + condition;
+        if (expected) query += " AND Version = ?";
+        auto pstmt = db.prepareStatement(query);
+        if (!pstmt) return false;
+        pstmt->setString(1, id);
+        if (expected) pstmt->setUInt64(2, *expected);
+        return pstmt->executeUpdate() > 0;
+    }
+
+    // Current version of the row keyed by id (nullopt if there is no such
+    // row or no column)
+    optional<RowVersion> read(const string& id) {
+        if (!available()) return nullopt;
+        auto pstmt = db.prepareStatement("SELECT Version FROM " + table + " WHERE " + keyColumn + " = ?");
+        if (!pstmt) return nullopt;
+        pstmt->setString(1, id);
+        unique_ptr<sql::ResultSet> res(pstmt->executeQuery());
+        if (!res->next()) return nullopt;
+        return (RowVersion)res->getUInt64("Version");
+    }
+};
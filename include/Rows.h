@@ -0,0 +1,285 @@
+#pragma once
+#include "RowMapping.h"
+#include "RowVersion.h"
+#include <string>
+#include <tuple>
+#include <vector>
+#include <optional>
+
+using namespace std;
+
+// Row types for the listings and reports. Field order is column order.
+
+struct MenuRow {
+    string menuID;
+    string name;
+    double price = 0;
+    MenuCategory category = MenuCategory::Unknown;
+    Availability availability = Availability::Unknown;
+
+    static auto columns() {
+        return make_tuple(
+            column(&MenuRow::menuID, "MenuID"),
+            column(&MenuRow::name, "Menu_name"),
+            column(&MenuRow::price, "Price"),
+            column(&MenuRow::category, "Category"),
+            column(&MenuRow::availability, "Availability"));
+    }
+};
+
+// Orders joined with their table number and staff name
+struct OrderRow {
+    string orderID;
+    string tableNumber;
+    string staffName;
+    double totalAmount = 0;
+    OrderStatus status = OrderStatus::Unknown;
+    DateTime orderDate;
+
+    static constexpr const char* from =
+        "FROM Orders o "
+        "JOIN Tables t ON o.TableID = t.TableID "
+        "JOIN Staff s ON o.StaffID = s.StaffID ";
+
+    // Hot and archived orders (database/order_archive.sql)
+    static constexpr const char* historyFrom =
+        "FROM All_Orders o "
+        "JOIN Tables t ON o.TableID = t.TableID "
+        "JOIN Staff s ON o.StaffID = s.StaffID ";
+
+    static auto columns() {
+        return make_tuple(
+            column(&OrderRow::orderID, "o.OrderID"),
+            column(&OrderRow::tableNumber, "t.Table_number"),
+            column(&OrderRow::staffName, "s.Name"),
+            column(&OrderRow::totalAmount, "o.Total_amount"),
+            column(&OrderRow::status, "o.Order_status"),
+            column(&OrderRow::orderDate, "o.Order_date"));
+    }
+};
+
+// Bills joined with the name of the staff member who issued them
+struct BillRow {
+    string billID;
+    string orderID;
+    string staffName;
+    DateTime billDate;
+    double total = 0;
+    PaymentMethod paymentMethod = PaymentMethod::Unknown;
+    PaymentStatus paymentStatus = PaymentStatus::Unknown;
+
+    static constexpr const char* from =
+        "FROM Bill b "
+        "JOIN Staff s ON b.StaffID = s.StaffID ";
+
+    // Hot and archived bills (database/order_archive.sql)
+    static constexpr const char* historyFrom =
+        "FROM All_Bills b "
+        "JOIN Staff s ON b.StaffID = s.StaffID ";
+
+    static auto columns() {
+        return make_tuple(
+            column(&BillRow::billID, "b.BillID"),
+            column(&BillRow::orderID, "b.OrderID"),
+            column(&BillRow::staffName, "s.Name"),
+            column(&BillRow::billDate, "b.Bill_date"),
+            column(&BillRow::total, "b.Total"),
+            column(&BillRow::paymentMethod, "b.Payment_method"),
+            column(&BillRow::paymentStatus, "b.Payment_status"));
+    }
+};
+
+struct DailySalesRow {
+    string salesID;
+    Date salesDate;
+    double dailyTotal = 0;
+
+    static auto columns() {
+        return make_tuple(
+            column(&DailySalesRow::salesID, "SalesID"),
+            column(&DailySalesRow::salesDate, "Sales_date"),
+            column(&DailySalesRow::dailyTotal, "Daily_total"));
+    }
+};
+
+struct TableRow {
+    string tableID;
+    string tableNumber;
+    int capacity = 0;
+    TableStatus status = TableStatus::Unknown;
+
+    static auto columns() {
+        return make_tuple(
+            column(&TableRow::tableID, "TableID"),
+            column(&TableRow::tableNumber, "Table_number"),
+            column(&TableRow::capacity, "Capacity"),
+            column(&TableRow::status, "Status"));
+    }
+};
+
+struct StaffRow {
+    string staffID;
+    string name;
+    string email;
+    string address;
+    StaffStatus status = StaffStatus::Unknown;
+
+    static auto columns() {
+        return make_tuple(
+            column(&StaffRow::staffID, "StaffID"),
+            column(&StaffRow::name, "Name"),
+            column(&StaffRow::email, "Email"),
+            column(&StaffRow::address, "Address"),
+            column(&StaffRow::status, "Status"));
+    }
+};
+
+struct AdminRow {
+    string adminID;
+    string name;
+    string email;
+    string address;
+
+    static auto columns() {
+        return make_tuple(
+            column(&AdminRow::adminID, "AdminID"),
+            column(&AdminRow::name, "Name"),
+            column(&AdminRow::email, "Email"),
+            column(&AdminRow::address, "Address"));
+    }
+};
+
+// Order lines joined with the menu item name
+struct OrderItemRow {
+    string orderItemID;
+    string menuName;
+    int quantity = 0;
+    double unitPrice = 0;
+    double total = 0;
+};
+
+// One row of the order detail query: the order, its bill (empty billID if
+// none was generated) and one of its lines (empty orderItemID if it has
+// none). The order and bill columns repeat on every line.
+struct OrderDetailLine {
+    string orderID;
+    string tableNumber;
+    string staffName;
+    double totalAmount = 0;
+    OrderStatus status = OrderStatus::Unknown;
+    DateTime orderDate;
+    string billID;
+    string billStaffName;
+    DateTime billDate;
+    double billTotal = 0;
+    PaymentMethod paymentMethod = PaymentMethod::Unknown;
+    PaymentStatus paymentStatus = PaymentStatus::Unknown;
+    string orderItemID;
+    string menuName;
+    int quantity = 0;
+    double unitPrice = 0;
+    double itemTotal = 0;
+
+    static constexpr const char* from =
+        "FROM Orders o "
+        "JOIN Tables t ON o.TableID = t.TableID "
+        "JOIN Staff s ON o.StaffID = s.StaffID "
+        "LEFT JOIN Bill b ON b.OrderID = o.OrderID "
+        "LEFT JOIN Staff bs ON b.StaffID = bs.StaffID "
+        "LEFT JOIN Order_Item oi ON oi.OrderID = o.OrderID "
+        "LEFT JOIN Menu m ON oi.MenuID = m.MenuID ";
+
+    static auto columns() {
+        return make_tuple(
+            column(&OrderDetailLine::orderID, "o.OrderID"),
+            column(&OrderDetailLine::tableNumber, "t.Table_number"),
+            column(&OrderDetailLine::staffName, "s.Name"),
+            column(&OrderDetailLine::totalAmount, "o.Total_amount"),
+            column(&OrderDetailLine::status, "o.Order_status"),
+            column(&OrderDetailLine::orderDate, "o.Order_date"),
+            column(&OrderDetailLine::billID, "b.BillID"),
+            column(&OrderDetailLine::billStaffName, "bs.Name"),
+            column(&OrderDetailLine::billDate, "b.Bill_date"),
+            column(&OrderDetailLine::billTotal, "b.Total"),
+            column(&OrderDetailLine::paymentMethod, "b.Payment_method"),
+            column(&OrderDetailLine::paymentStatus, "b.Payment_status"),
+            column(&OrderDetailLine::orderItemID, "oi.Order_itemID"),
+            column(&OrderDetailLine::menuName, "m.Menu_name"),
+            column(&OrderDetailLine::quantity, "oi.Quantity"),
+            column(&OrderDetailLine::unitPrice, "oi.Unit_price"),
+            column(&OrderDetailLine::itemTotal, "oi.Total"));
+    }
+};
+
+// An order with its bill and lines, assembled from OrderDetailLines.
+// found is false if there is no such order (or bill, when loaded by bill).
+struct OrderAggregate {
+    bool found = false;
+    OrderRow order;
+    bool billed = false;
+    BillRow bill;
+    vector<OrderItemRow> items;
+    optional<RowVersion> version;   // of the order, when versions are enabled
+};
+
+struct UnpaidBillRow {
+    string billID;
+    string orderID;
+    string tableNumber;
+    double total = 0;
+    PaymentMethod paymentMethod = PaymentMethod::Unknown;
+
+    static constexpr const char* from =
+        "FROM Bill b "
+        "JOIN Orders o ON b.OrderID = o.OrderID "
+        "JOIN Tables t ON o.TableID = t.TableID ";
+
+    static auto columns() {
+        return make_tuple(
+            column(&UnpaidBillRow::billID, "b.BillID"),
+            column(&UnpaidBillRow::orderID, "b.OrderID"),
+            column(&UnpaidBillRow::tableNumber, "t.Table_number"),
+            column(&UnpaidBillRow::total, "b.Total"),
+            column(&UnpaidBillRow::paymentMethod, "b.Payment_method"));
+    }
+};
+
+// Active orders without a paid bill; amount is the bill total once billed
+struct UnpaidOrderRow {
+    string orderID;
+    string tableNumber;
+    string staffName;
+    double amount = 0;
+    DateTime orderDate;
+
+    static constexpr const char* from =
+        "FROM Orders o "
+        "JOIN Tables t ON o.TableID = t.TableID "
+        "JOIN Staff s ON o.StaffID = s.StaffID "
+        "LEFT JOIN Bill b ON o.OrderID = b.OrderID ";
+
+    static auto columns() {
+        return make_tuple(
+            column(&UnpaidOrderRow::orderID, "o.OrderID"),
+            column(&UnpaidOrderRow::tableNumber, "t.Table_number"),
+            column(&UnpaidOrderRow::staffName, "s.Name"),
+            column(&UnpaidOrderRow::amount, "COALESCE(b.Total, o.Total_amount)"),
+            column(&UnpaidOrderRow::orderDate, "o.Order_date"));
+    }
+};
+
+// Paid bills for one day (not row-mapped; built from an aggregate query)
+struct DailySalesSummary {
+    string date;
+    int totalBills = 0;
+    double totalRevenue = 0;
+};
+
+// Paid sales in one period of a trend (not row-mapped; read from the sales
+// series file)
+struct SalesBucket {
+    DateTime start;
+    long long revenueCents = 0;
+    unsigned long long bills = 0;
+    unsigned long long items = 0;
+};
@@ -0,0 +1,408 @@
+#pragma once
+#include "DatabaseConnection.h"
+#include "MenuModule.h"
+#include "StaffModule.h"
+#include "TableModule.h"
+#include "OrderModule.h"
+#include "BillingModule.h"
+#include "QueryPool.h"
+#include "Json.h"
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <map>
+#include <thread>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <memory>
+#include <atomic>
+#include <utility>
+
+using namespace std;
+
+// Settings for a dinner-rush run, given as key=value arguments after --bench
+struct BenchmarkConfig {
+    int tables = 20;          // seeded tables (BT001...)
+    int menuItems = 40;       // seeded menu items ("Bench Item 001"...)
+    int staff = 4;            // seeded staff (bench01@bench.local...)
+    int workers = 4;          // concurrent terminals, one connection each
+    int durationSec = 30;     // stop after this long...
+    int parties = 0;          // ...or after this many parties per worker (0 = no limit)
+    int maxRounds = 3;        // ordering rounds per party
+    int maxItemsPerRound = 4; // items added per round
+    double cancelRate = 0.05; // share of parties that cancel instead of paying
+    int pool = 0;             // terminals share this many pooled connections (0 = one each)
+    int reserve = 1;          // pooled connections kept for POS writes
+    int reports = 0;          // threads running admin listings through the pool meanwhile
+    unsigned seed = 42;
+    string outPath;           // empty = stdout
+
+    bool set(const string& key, const string& value) {
+        if (key == "tables") tables = atoi(value.c_str());
+        else if (key == "menu") menuItems = atoi(value.c_str());
+        else if (key == "staff") staff = atoi(value.c_str());
+        else if (key == "workers") workers = atoi(value.c_str());
+        else if (key == "duration") durationSec = atoi(value.c_str());
+        else if (key == "parties") parties = atoi(value.c_str());
+        else if (key == "rounds") maxRounds = atoi(value.c_str());
+        else if (key == "items") maxItemsPerRound = atoi(value.c_str());
+        else if (key == "cancel") cancelRate = atof(value.c_str());
+        else if (key == "pool") pool = atoi(value.c_str());
+        else if (key == "reserve") reserve = atoi(value.c_str());
+        else if (key == "reports") reports = atoi(value.c_str());
+        else if (key == "seed") seed = (unsigned)strtoul(value.c_str(), nullptr, 10);
+        else if (key == "out") outPath = value;
+        else return false;
+        return true;
+    }
+
+    bool valid() const {
+        return tables >= workers && workers > 0 && menuItems > 0 && staff > 0
+            && maxRounds > 0 && maxItemsPerRound > 0 && cancelRate >= 0 && cancelRate <= 1
+            && pool >= 0 && reserve >= 0 && reports >= 0 && (reports == 0 || pool > 0);
+    }
+};
+
+// Seeds a benchmark data set and drives OrderModule, BillingModule and
+// TableModule from several terminals at once. Each worker owns its own
+// connection and a disjoint slice of the tables, the way real tills work
+// their own sections. Results are written as one JSON document.
+//
+// With pool=N the terminals instead send each step as a PosWrite task to a
+// QueryPool of N connections, and reports=R threads keep the same pool busy
+// with Report-class listings, so the run shows how long POS work queues
+// behind reports.
+class RushBenchmark {
+private:
+    struct OpSamples {
+        vector<double> latenciesMs;
+        unsigned long long statements = 0;
+        int failed = 0;
+    };
+
+    struct WorkerResult {
+        map<string, OpSamples> ops;
+        int parties = 0;
+    };
+
+    // Swallows module console output while the workers run
+    class NullBuffer : public streambuf {
+    protected:
+        int overflow(int c) override { return c == EOF ? 0 : c; }
+        streamsize xsputn(const char*, streamsize n) override { return n; }
+    };
+
+    DatabaseConnection& db;
+    BenchmarkConfig config;
+    vector<string> tableIDs;
+    vector<string> menuIDs;
+    vector<string> staffIDs;
+
+    vector<string> loadIDs(const string& query) {
+        vector<string> ids;
+        auto res = db.executeQuery(query);
+        if (res) {
+            while (res->next()) {
+                ids.push_back(res->getString(1));
+            }
+        }
+        return ids;
+    }
+
+    void seed() {
+        TableModule tables(db);
+        MenuModule menu(db);
+        StaffModule staff(db);
+        OrderModule orders(db);
+        mt19937 rng(config.seed);
+        const MenuCategory categories[] = { MenuCategory::Food, MenuCategory::Beverage, MenuCategory::Dessert };
+        char buffer[40];
+
+        // addX() rejects duplicates, so re-running against a seeded database is cheap
+        for (int i = 1; i <= config.tables; i++) {
+            snprintf(buffer, sizeof(buffer), "BT%03d", i);
+            tables.addTable(buffer, 2 + (i % 4) * 2);
+        }
+        for (int i = 1; i <= config.menuItems; i++) {
+            snprintf(buffer, sizeof(buffer), "Bench Item %03d", i);
+            double price = 5.0 + (rng() % 3500) / 100.0;
+            menu.addMenuItem(buffer, price, categories[i % 3]);
+        }
+        for (int i = 1; i <= config.staff; i++) {
+            char name[40];
+            snprintf(name, sizeof(name), "Bench Staff %02d", i);
+            snprintf(buffer, sizeof(buffer), "bench%02d@bench.local", i);
+            staff.addStaff(name, buffer, "Benchmark", "bench");
+        }
+
+        tableIDs = loadIDs("SELECT TableID FROM Tables WHERE Table_number LIKE 'BT%' ORDER BY TableID");
+        menuIDs = loadIDs("SELECT MenuID FROM Menu WHERE Menu_name LIKE 'Bench Item %' ORDER BY MenuID");
+        staffIDs = loadIDs("SELECT StaffID FROM Staff WHERE Email LIKE 'bench%@bench.local' ORDER BY StaffID");
+
+        // Leave every benchmark table vacant, cancelling anything an aborted run left open
+        for (const string& tableID : tableIDs) {
+            string active = orders.getActiveOrderForTable(tableID);
+            if (!active.empty()) orders.cancelOrder(active);
+            tables.updateTableStatus(tableID, TableStatus::Vacant);
+        }
+    }
+
+    // The modules one step of a party uses, bound to the connection it runs on
+    struct Till {
+        TableModule tables;
+        OrderModule orders;
+        BillingModule billing;
+
+        explicit Till(DatabaseConnection& conn) : tables(conn), orders(conn), billing(conn) {}
+    };
+
+    static void runWorker(int index, const BenchmarkConfig& config, const vector<string>& myTables,
+        const vector<string>& menuIDs, const string& staffID, QueryPool* pool,
+        chrono::steady_clock::time_point deadline, WorkerResult& result) {
+        sql::mysql::get_mysql_driver_instance()->threadInit();
+        {
+            DatabaseConnection conn(false);
+            if (!pool && !conn.connect()) {
+                result.ops["connect"].failed++;
+                sql::mysql::get_mysql_driver_instance()->threadEnd();
+                return;
+            }
+            mt19937 rng(config.seed + 7919u * (unsigned)(index + 1));
+            uniform_real_distribution<double> chance(0.0, 1.0);
+            const PaymentMethod methods[] = { PaymentMethod::Cash, PaymentMethod::Card, PaymentMethod::EWallet };
+
+            // Run fn(till) on this worker's connection or as a pooled POS
+            // write; returns whether it succeeded and the statements it sent
+            auto perform = [&](auto fn) {
+                auto step = [&fn](DatabaseConnection& c) {
+                    Till till(c);
+                    unsigned long long before = c.getStatementCount();
+                    bool ok = fn(till);
+                    return make_pair(ok, c.getStatementCount() - before);
+                };
+                if (!pool) return step(conn);
+                try {
+                    return pool->submit(WorkClass::PosWrite, step).get();
+                }
+                catch (sql::SQLException&) {
+                    return make_pair(false, 0ULL);
+                }
+            };
+
+            auto timed = [&](const string& kind, auto fn) {
+                auto start = chrono::steady_clock::now();
+                pair<bool, unsigned long long> outcome = perform(fn);
+                double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+                OpSamples& s = result.ops[kind];
+                s.latenciesMs.push_back(ms);
+                s.statements += outcome.second;
+                if (!outcome.first) s.failed++;
+                return outcome.first;
+            };
+
+            size_t next = 0;
+            while (chrono::steady_clock::now() < deadline
+                && (config.parties == 0 || result.parties < config.parties)) {
+                const string& tableID = myTables[next++ % myTables.size()];
+
+                if (!timed("seat", [&](Till& t) { return t.tables.updateTableStatus(tableID, TableStatus::Occupied); })) continue;
+
+                string orderID;
+                if (!timed("createOrder", [&](Till& t) {
+                    orderID = t.orders.createOrder(tableID, staffID);
+                    return !orderID.empty();
+                })) {
+                    perform([&](Till& t) { return t.tables.updateTableStatus(tableID, TableStatus::Vacant); });
+                    continue;
+                }
+
+                int rounds = 1 + (int)(rng() % config.maxRounds);
+                for (int r = 0; r < rounds; r++) {
+                    int items = 1 + (int)(rng() % config.maxItemsPerRound);
+                    for (int i = 0; i < items; i++) {
+                        const string& menuID = menuIDs[rng() % menuIDs.size()];
+                        int qty = 1 + (int)(rng() % 3);
+                        timed("addItem", [&](Till& t) { return t.orders.addOrderItem(orderID, menuID, qty); });
+                    }
+                }
+
+                if (chance(rng) < config.cancelRate) {
+                    timed("cancel", [&](Till& t) { return t.orders.cancelOrder(orderID); });
+                }
+                else {
+                    string billID;
+                    PaymentMethod method = methods[rng() % 3];
+                    bool billed = timed("generateBill", [&](Till& t) {
+                        billID = t.billing.generateBill(orderID, staffID, method);
+                        return !billID.empty();
+                    });
+                    if (billed) {
+                        timed("pay", [&](Till& t) { return t.billing.processPayment(billID); });
+                    }
+                    else {
+                        perform([&](Till& t) { return t.orders.cancelOrder(orderID); });
+                    }
+                }
+                result.parties++;
+            }
+        }
+        sql::mysql::get_mysql_driver_instance()->threadEnd();
+    }
+
+    // Background load: listings through the pool until the terminals finish
+    static void runReports(QueryPool& pool, const atomic<bool>& tillsDone, WorkerResult& result) {
+        int turn = 0;
+        while (!tillsDone.load()) {
+            bool bills = turn++ % 2 == 0;
+            auto start = chrono::steady_clock::now();
+            bool ok;
+            try {
+                ok = pool.submit(WorkClass::Report, [bills](DatabaseConnection& c) {
+                    if (bills) return BillingModule(c).listBills().has_value();
+                    return OrderModule(c).listOrders().has_value();
+                }).get();
+            }
+            catch (sql::SQLException&) {
+                ok = false;
+            }
+            double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            OpSamples& s = result.ops[bills ? "reportBills" : "reportOrders"];
+            s.latenciesMs.push_back(ms);
+            if (!ok) {
+                s.failed++;
+                this_thread::sleep_for(chrono::milliseconds(50));   // shed: back off like a retrying client
+            }
+        }
+    }
+
+    static double percentile(const vector<double>& sorted, double p) {
+        if (sorted.empty()) return 0;
+        size_t rank = (size_t)(p / 100.0 * (sorted.size() - 1) + 0.5);
+        return sorted[min(rank, sorted.size() - 1)];
+    }
+
+    void writeReport(ostream& out, const vector<WorkerResult>& results, double elapsedSec, QueryPool* pool) {
+        map<string, OpSamples> merged;
+        int parties = 0;
+        for (const WorkerResult& r : results) {
+            parties += r.parties;
+            for (const auto& entry : r.ops) {
+                OpSamples& m = merged[entry.first];
+                m.latenciesMs.insert(m.latenciesMs.end(),
+                    entry.second.latenciesMs.begin(), entry.second.latenciesMs.end());
+                m.statements += entry.second.statements;
+                m.failed += entry.second.failed;
+            }
+        }
+
+        size_t totalOps = 0;
+        for (const auto& entry : merged) totalOps += entry.second.latenciesMs.size();
+
+        out << fixed << setprecision(3);
+        out << "{\"benchmark\":\"dinner-rush\",\"config\":{"
+            << "\"tables\":" << config.tables << ",\"menu\":" << config.menuItems
+            << ",\"staff\":" << config.staff << ",\"workers\":" << config.workers
+            << ",\"durationSec\":" << config.durationSec << ",\"parties\":" << config.parties
+            << ",\"rounds\":" << config.maxRounds << ",\"items\":" << config.maxItemsPerRound
+            << ",\"cancel\":" << config.cancelRate << ",\"seed\":" << config.seed
+            << ",\"pool\":" << config.pool << ",\"reserve\":" << config.reserve
+            << ",\"reports\":" << config.reports << "}"
+            << ",\"elapsedSec\":" << elapsedSec
+            << ",\"parties\":" << parties
+            << ",\"partiesPerSec\":" << (elapsedSec > 0 ? parties / elapsedSec : 0)
+            << ",\"opsPerSec\":" << (elapsedSec > 0 ? totalOps / elapsedSec : 0)
+            << ",\"operations\":{";
+        bool first = true;
+        for (auto& entry : merged) {
+            OpSamples& s = entry.second;
+            sort(s.latenciesMs.begin(), s.latenciesMs.end());
+            double sum = 0;
+            for (double v : s.latenciesMs) sum += v;
+            size_t n = s.latenciesMs.size();
+            if (!first) out << ",";
+            first = false;
+            out << jsonQuote(entry.first) << ":{\"count\":" << n
+                << ",\"failed\":" << s.failed
+                << ",\"meanMs\":" << (n ? sum / n : 0)
+                << ",\"p50Ms\":" << percentile(s.latenciesMs, 50)
+                << ",\"p90Ms\":" << percentile(s.latenciesMs, 90)
+                << ",\"p99Ms\":" << percentile(s.latenciesMs, 99)
+                << ",\"maxMs\":" << (n ? s.latenciesMs.back() : 0)
+                << ",\"statementsPerOp\":" << (n ? (double)s.statements / n : 0) << "}";
+        }
+        out << "}";
+
+        // Queueing delay per class, as the pool measured it
+        if (pool) {
+            out << ",\"scheduler\":{";
+            for (size_t i = 0; i < workClassCount; i++) {
+                WorkClass workClass = (WorkClass)i;
+                QueryPool::ClassStats st = pool->getStats(workClass);
+                if (i > 0) out << ",";
+                out << jsonQuote(workClassName(workClass)) << ":{\"started\":" << st.started
+                    << ",\"rejected\":" << st.rejected << ",\"expired\":" << st.expired
+                    << ",\"meanWaitMs\":" << (st.started ? st.totalWaitMs / st.started : 0)
+                    << ",\"maxWaitMs\":" << st.maxWaitMs << "}";
+            }
+            out << "}";
+        }
+        out << "}" << endl;
+    }
+
+public:
+    RushBenchmark(DatabaseConnection& database, const BenchmarkConfig& benchConfig)
+        : db(database), config(benchConfig) {}
+
+    // Seed, run the rush and write the report. Returns false if the run could not start.
+    bool run(ostream& out) {
+        NullBuffer nullBuffer;
+        streambuf* savedOut = cout.rdbuf(&nullBuffer);
+        streambuf* savedErr = cerr.rdbuf(&nullBuffer);
+
+        seed();
+
+        bool ready = (int)tableIDs.size() >= config.workers && !menuIDs.empty() && !staffIDs.empty();
+        vector<WorkerResult> results(config.workers + config.reports);
+        double elapsedSec = 0;
+        unique_ptr<QueryPool> pool;
+        if (ready && config.pool > 0) {
+            pool.reset(new QueryPool(config.pool, config.reserve));
+            ready = pool->size() > 0;
+        }
+        if (ready) {
+            vector<vector<string>> slices(config.workers);
+            for (size_t i = 0; i < tableIDs.size(); i++) {
+                slices[i % config.workers].push_back(tableIDs[i]);
+            }
+
+            auto start = chrono::steady_clock::now();
+            auto deadline = start + chrono::seconds(config.durationSec);
+            vector<thread> threads;
+            for (int w = 0; w < config.workers; w++) {
+                threads.emplace_back(runWorker, w, cref(config), cref(slices[w]), cref(menuIDs),
+                    cref(staffIDs[w % staffIDs.size()]), pool.get(), deadline, ref(results[w]));
+            }
+            atomic<bool> tillsDone{ false };
+            vector<thread> reporters;
+            for (int r = 0; r < config.reports; r++) {
+                reporters.emplace_back(runReports, ref(*pool), cref(tillsDone), ref(results[config.workers + r]));
+            }
+            for (thread& t : threads) t.join();
+            tillsDone = true;
+            for (thread& t : reporters) t.join();
+            elapsedSec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        }
+
+        cout.rdbuf(savedOut);
+        cerr.rdbuf(savedErr);
+
+        if (!ready) {
+            cerr << "[FAILED] Benchmark data could not be seeded." << endl;
+            return false;
+        }
+        writeReport(out, results, elapsedSec, pool.get());
+        return true;
+    }
+};
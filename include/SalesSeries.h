@@ -0,0 +1,444 @@
+#pragma once
+#include "RowMapping.h"
+#include "Rows.h"
+#include "Metrics.h"
+#include <string>
+#include <vector>
+#include <mutex>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#endif
+
+using namespace std;
+
+// A file mapped into memory for reading and writing, grown on demand. It is
+// opened exclusively: a second process opening the same file fails instead
+// of writing over the first.
+class MappedFile {
+private:
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+    uint8_t* base = nullptr;
+    size_t length = 0;
+
+    // Map the first size bytes, extending the file if it is shorter
+    bool map(size_t size) {
+#ifdef _WIN32
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE,
+            (DWORD)((uint64_t)size >> 32), (DWORD)(size & 0xFFFFFFFF), nullptr);
+        if (!mapping) return false;
+        base = (uint8_t*)MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+        if (!base) {
+            CloseHandle(mapping);
+            mapping = nullptr;
+            return false;
+        }
+#else
+        struct stat st;
+        if (fstat(fd, &st) != 0) return false;
+        if ((size_t)st.st_size < size && ftruncate(fd, (off_t)size) != 0) return false;
+        void* view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (view == MAP_FAILED) return false;
+        base = (uint8_t*)view;
+#endif
+        length = size;
+        return true;
+    }
+
+    void unmap() {
+        if (!base) return;
+#ifdef _WIN32
+        UnmapViewOfFile(base);
+        CloseHandle(mapping);
+        mapping = nullptr;
+#else
+        munmap(base, length);
+#endif
+        base = nullptr;
+        length = 0;
+    }
+
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Open (or create) path and map all of it, and at least minSize bytes
+    bool open(const string& path, size_t minSize) {
+        close();
+        size_t existing = 0;
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_ALWAYS,
+            FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER size;
+        if (GetFileSizeEx(file, &size)) existing = (size_t)size.QuadPart;
+#else
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0) return false;
+        struct stat st;
+        if (flock(fd, LOCK_EX | LOCK_NB) != 0 || fstat(fd, &st) != 0) {
+            close();
+            return false;
+        }
+        existing = (size_t)st.st_size;
+#endif
+        if (!map(max(existing, minSize))) {
+            close();
+            return false;
+        }
+        // Extending a file is not guaranteed to zero it on every file system
+        if (length > existing) memset(base + existing, 0, length - existing);
+        return true;
+    }
+
+    // Map at least size bytes; the added bytes are zero. Pointers into the
+    // mapping are invalid afterwards. On failure the old mapping is kept.
+    bool grow(size_t size) {
+        if (size <= length) return true;
+        size_t old = length;
+        unmap();
+        if (!map(size)) {
+            map(old);
+            return false;
+        }
+        memset(base + old, 0, length - old);
+        return true;
+    }
+
+    // Write the changed pages to disk
+    bool flush() {
+        if (!base) return false;
+#ifdef _WIN32
+        return FlushViewOfFile(base, length) && FlushFileBuffers(file);
+#else
+        return msync(base, length, MS_SYNC) == 0;
+#endif
+    }
+
+    void close() {
+        unmap();
+#ifdef _WIN32
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+#endif
+    }
+
+    bool isOpen() const { return base != nullptr; }
+    uint8_t* data() { return base; }
+    size_t size() const { return length; }
+};
+
+// Paid revenue, bills and items sold per minute, kept in a memory-mapped
+// append-only file so trend charts over years of service never touch the
+// Bill table. Payments are recorded as they are taken; a range query reads
+// the mapping directly.
+//
+//   "RSALES1\n"
+//   one block per day with sales, in day order:
+//     int32 day (days since 1970-01-01, wall clock), uint32 bytes of points,
+//     int64 revenue cents, uint32 bills, uint32 items, uint32 points,
+//     uint32 minute of day of the last point
+//     points, oldest first: varint minutes since the previous point (the
+//     first: since midnight), zigzag varint revenue cents, varint bills,
+//     varint items
+//
+// Header integers are in the machine's byte order. A point is usually 5 or
+// 6 bytes; several payments in one minute are stored as points 0 minutes
+// apart and add up when read. The day totals let day and week buckets skip
+// the points altogether, and the in-memory index of days finds the first
+// block of a range by binary search.
+//
+// A payment is in the mapping (and survives the program crashing) once
+// record() returns; flush() or closing writes it to disk. After a power
+// loss the last minutes may be missing; AdminModule::rebuildSalesSeries
+// rewrites the file from the paid bills.
+class SalesSeries {
+private:
+    struct DayBlock {
+        int32_t day = 0;
+        uint32_t bytes = 0;
+        int64_t revenueCents = 0;
+        uint32_t bills = 0;
+        uint32_t items = 0;
+        uint32_t points = 0;
+        uint32_t lastMinute = 0;
+    };
+    static_assert(sizeof(DayBlock) == 32, "day block header is 32 bytes on disk");
+
+    static constexpr const char* magic = "RSALES1\n";
+    static constexpr size_t headerBytes = 8;
+    static constexpr size_t minGrowBytes = 1 << 20;
+    static constexpr long long minutesPerDay = 1440;
+
+    MappedFile file;
+    mutex lock;
+    vector<DayBlock> days;    // copies of the block headers, in day order
+    vector<size_t> offsets;   // where each block starts
+    size_t end = headerBytes; // first byte after the last block
+
+    static long long floorDiv(long long a, long long b) {
+        return a >= 0 ? a / b : -((-a + b - 1) / b);
+    }
+
+    static void putVarint(uint8_t*& p, uint64_t v) {
+        while (v >= 0x80) {
+            *p++ = (uint8_t)(v | 0x80);
+            v >>= 7;
+        }
+        *p++ = (uint8_t)v;
+    }
+
+    static bool getVarint(const uint8_t*& p, const uint8_t* limit, uint64_t& v) {
+        v = 0;
+        for (int shift = 0; shift < 64 && p < limit; shift += 7) {
+            uint8_t byte = *p++;
+            v |= (uint64_t)(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+
+    static uint64_t zigzag(int64_t v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+    static int64_t unzigzag(uint64_t v) { return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+
+    DayBlock readBlock(size_t offset) {
+        DayBlock block;
+        memcpy(&block, file.data() + offset, sizeof(block));
+        return block;
+    }
+
+    void writeBlock(size_t offset, const DayBlock& block) {
+        memcpy(file.data() + offset, &block, sizeof(block));
+    }
+
+    // Call visit(minuteOfDay, cents, bills, items) for each point of the
+    // block at index; false if the points end early
+    template <typename Visit>
+    bool decode(size_t index, Visit&& visit) {
+        const uint8_t* p = file.data() + offsets[index] + sizeof(DayBlock);
+        const uint8_t* limit = p + days[index].bytes;
+        uint64_t minute = 0;
+        while (p < limit) {
+            uint64_t delta, cents, bills, items;
+            if (!getVarint(p, limit, delta) || !getVarint(p, limit, cents)
+                || !getVarint(p, limit, bills) || !getVarint(p, limit, items)) return false;
+            minute += delta;
+            visit((uint32_t)minute, (long long)unzigzag(cents), bills, items);
+        }
+        return true;
+    }
+
+    // Index the blocks in the file. The walk stops at a block that does not
+    // follow the previous day or does not fit, which is where the last
+    // complete write ended; everything after it is cleared.
+    void load() {
+        days.clear();
+        offsets.clear();
+        size_t pos = headerBytes;
+        while (pos + sizeof(DayBlock) <= file.size()) {
+            DayBlock block = readBlock(pos);
+            if (block.points == 0 || block.bytes == 0 || (!days.empty() && block.day <= days.back().day)
+                || block.bytes > file.size() - pos - sizeof(DayBlock)) break;
+            days.push_back(block);
+            offsets.push_back(pos);
+            pos += sizeof(DayBlock) + block.bytes;
+        }
+        end = pos;
+        memset(file.data() + end, 0, file.size() - end);
+
+        // Only the last day is ever written to; recount its totals in case
+        // the program stopped between writing a point and its header
+        if (days.empty()) return;
+        DayBlock counted = days.back();
+        counted.revenueCents = 0;
+        counted.bills = counted.items = counted.points = counted.lastMinute = 0;
+        decode(days.size() - 1, [&](uint32_t minute, long long cents, uint64_t bills, uint64_t items) {
+            counted.revenueCents += cents;
+            counted.bills += (uint32_t)bills;
+            counted.items += (uint32_t)items;
+            counted.points++;
+            counted.lastMinute = minute;
+        });
+        if (memcmp(&counted, &days.back(), sizeof(DayBlock)) != 0) {
+            days.back() = counted;
+            writeBlock(offsets.back(), counted);
+        }
+    }
+
+public:
+    SalesSeries() = default;
+    ~SalesSeries() { close(); }
+
+    SalesSeries(const SalesSeries&) = delete;
+    SalesSeries& operator=(const SalesSeries&) = delete;
+
+    // Open (or create) the series file. Fails if it is not a series file or
+    // another program has it open.
+    bool open(const string& path) {
+        lock_guard<mutex> guard(lock);
+        if (!file.open(path, minGrowBytes)) return false;
+        uint8_t* header = file.data();
+        bool fresh = all_of(header, header + headerBytes, [](uint8_t b) { return b == 0; });
+        if (fresh) {
+            memcpy(header, magic, headerBytes);
+        }
+        else if (memcmp(header, magic, headerBytes) != 0) {
+            file.close();
+            return false;
+        }
+        load();
+        return true;
+    }
+
+    void close() {
+        lock_guard<mutex> guard(lock);
+        if (!file.isOpen()) return;
+        file.flush();
+        file.close();
+        days.clear();
+        offsets.clear();
+    }
+
+    bool isOpen() const { return file.isOpen(); }
+
+    // Write what has been recorded to disk
+    bool flush() {
+        lock_guard<mutex> guard(lock);
+        return file.flush();
+    }
+
+    // Add sales at when (wall clock). A time before the last one recorded
+    // (the clock was set back) counts in the last recorded minute.
+    bool record(DateTime when, long long revenueCents, unsigned bills, unsigned items) {
+        static Counter& recorded = Metrics::instance().counter(
+            "restaurant_sales_series_points_total", "Points appended to the sales series file");
+        lock_guard<mutex> guard(lock);
+        if (!file.isOpen()) return false;
+
+        long long minute = floorDiv(when.time_since_epoch().count(), 60);
+        long long day = floorDiv(minute, minutesPerDay);
+        uint32_t minuteOfDay = (uint32_t)(minute - day * minutesPerDay);
+        bool newDay = days.empty() || day > days.back().day;
+        if (!newDay && (day < days.back().day || minuteOfDay < days.back().lastMinute)) {
+            day = days.back().day;
+            minuteOfDay = days.back().lastMinute;
+        }
+
+        uint8_t point[40];
+        uint8_t* p = point;
+        putVarint(p, minuteOfDay - (newDay ? 0 : days.back().lastMinute));
+        putVarint(p, zigzag(revenueCents));
+        putVarint(p, bills);
+        putVarint(p, items);
+        size_t pointBytes = (size_t)(p - point);
+
+        size_t blockOffset = newDay ? end : offsets.back();
+        size_t at = newDay ? end + sizeof(DayBlock) : end;
+        if (at + pointBytes > file.size()
+            && !file.grow(max(at + pointBytes, file.size() + max(minGrowBytes, file.size() / 4)))) return false;
+
+        // The point first, then the header that counts it
+        memcpy(file.data() + at, point, pointBytes);
+        DayBlock block = newDay ? DayBlock() : days.back();
+        block.day = (int32_t)day;
+        block.bytes += (uint32_t)pointBytes;
+        block.revenueCents += revenueCents;
+        block.bills += bills;
+        block.items += items;
+        block.points++;
+        block.lastMinute = minuteOfDay;
+        writeBlock(blockOffset, block);
+
+        if (newDay) {
+            days.push_back(block);
+            offsets.push_back(blockOffset);
+        }
+        else {
+            days.back() = block;
+        }
+        end = at + pointBytes;
+        recorded.inc();
+        return true;
+    }
+
+    // Drop everything recorded (before a rebuild)
+    void clear() {
+        lock_guard<mutex> guard(lock);
+        if (!file.isOpen()) return;
+        memset(file.data() + headerBytes, 0, file.size() - headerBytes);
+        days.clear();
+        offsets.clear();
+        end = headerBytes;
+    }
+
+    // Sales from from up to (not including) to, in buckets of bucketMinutes
+    // aligned on multiples of it since 1970-01-01, so hours start on the
+    // hour and days at midnight. Every bucket in the range is returned,
+    // empty ones included (none if the range holds more than maxBuckets).
+    vector<SalesBucket> query(DateTime from, DateTime to, int bucketMinutes, size_t maxBuckets = 100000) {
+        vector<SalesBucket> buckets;
+        if (bucketMinutes <= 0 || to <= from) return buckets;
+        long long fromMinute = floorDiv(from.time_since_epoch().count(), 60);
+        long long toMinute = floorDiv(to.time_since_epoch().count() + 59, 60);
+        long long firstBucket = floorDiv(fromMinute, bucketMinutes);
+        long long lastBucket = floorDiv(toMinute - 1, bucketMinutes);
+        if (lastBucket - firstBucket + 1 > (long long)maxBuckets) return buckets;
+        buckets.resize((size_t)(lastBucket - firstBucket + 1));
+        for (size_t i = 0; i < buckets.size(); i++) {
+            buckets[i].start = DateTime(chrono::seconds((firstBucket + (long long)i) * bucketMinutes * 60));
+        }
+
+        lock_guard<mutex> guard(lock);
+        if (!file.isOpen()) return buckets;
+        long long firstDay = floorDiv(fromMinute, minutesPerDay);
+        size_t index = lower_bound(days.begin(), days.end(), firstDay,
+            [](const DayBlock& block, long long day) { return block.day < day; }) - days.begin();
+        bool wholeDays = bucketMinutes % minutesPerDay == 0;
+        for (; index < days.size() && days[index].day * minutesPerDay < toMinute; index++) {
+            const DayBlock& block = days[index];
+            long long dayStart = block.day * minutesPerDay;
+            if (wholeDays && dayStart >= fromMinute && dayStart + minutesPerDay <= toMinute) {
+                SalesBucket& bucket = buckets[(size_t)(floorDiv(dayStart, bucketMinutes) - firstBucket)];
+                bucket.revenueCents += block.revenueCents;
+                bucket.bills += block.bills;
+                bucket.items += block.items;
+                continue;
+            }
+            decode(index, [&](uint32_t minuteOfDay, long long cents, uint64_t bills, uint64_t items) {
+                long long minute = dayStart + minuteOfDay;
+                if (minute < fromMinute || minute >= toMinute) return;
+                SalesBucket& bucket = buckets[(size_t)(floorDiv(minute, bucketMinutes) - firstBucket)];
+                bucket.revenueCents += cents;
+                bucket.bills += bills;
+                bucket.items += items;
+            });
+        }
+        return buckets;
+    }
+};
@@ -0,0 +1,93 @@
+#pragma once
+#include "DatabaseConnection.h"
+#include <string>
+#include <map>
+#include <mutex>
+#include <initializer_list>
+#include <iostream>
+
+using namespace std;
+
+// Which of the optional scripts in database/ have been run, found once per
+// process. run() checks them all right after connecting, outside any
+// transaction, and says what is missing; the modules then only read the
+// cached answers, so no operation queries information_schema or prints a
+// warning halfway through. A check that run() did not cover (or that
+// failed) is made on first use instead.
+//
+//   if (SchemaCheck::hasColumn(db, "Orders", "Version")) { ... }
+class SchemaCheck {
+private:
+    struct State {
+        mutex lock;
+        map<string, bool> found;
+    };
+
+    static State& state() {
+        static State s;
+        return s;
+    }
+
+    // Cached answer for key, or the COUNT(*) of query compared to expected
+    static bool probe(DatabaseConnection& db, const string& key, const string& query, int expected) {
+        State& s = state();
+        {
+            lock_guard<mutex> guard(s.lock);
+            auto it = s.found.find(key);
+            if (it != s.found.end()) return it->second;
+        }
+        auto res = db.executeQuery(query);
+        if (!res) return false;
+        bool present = res->next() && res->getInt("Found") == expected;
+        lock_guard<mutex> guard(s.lock);
+        s.found[key] = present;
+        return present;
+    }
+
+public:
+    // True if table has column
+    static bool hasColumn(DatabaseConnection& db, const string& table, const string& column) {
+        return probe(db, table + "." + column,
+            "SELECT COUNT(*) AS Found FROM information_schema.COLUMNS "
+            "WHERE TABLE_SCHEMA = DATABASE() AND TABLE_NAME = '" + table + "' AND COLUMN_NAME = '" + column + "'", 1);
+    }
+
+    // True if every one of tables (or views) exists
+    static bool hasTables(DatabaseConnection& db, initializer_list<const char*> tables) {
+        string key, names;
+        for (const char* table : tables) {
+            key += string(key.empty() ? "" : ",") + table;
+            names += string(names.empty() ? "'" : ", '") + table + "'";
+        }
+        return probe(db, key,
+            "SELECT COUNT(*) AS Found FROM information_schema.TABLES "
+            "WHERE TABLE_SCHEMA = DATABASE() AND TABLE_NAME IN (" + names + ")", (int)tables.size());
+    }
+
+    // The history tables and views of database/order_archive.sql
+    static bool hasArchive(DatabaseConnection& db) {
+        return hasTables(db, { "Orders_History", "Order_Item_History", "Bill_History",
+            "All_Orders", "All_Order_Items", "All_Bills" });
+    }
+
+    // Check everything the modules adapt to and warn about what is missing
+    static void run(DatabaseConnection& db) {
+        for (const char* table : { "Orders", "Bill" }) {
+            if (!hasColumn(db, table, "Version")) {
+                cout << "[WARNING] " << table << " has no Version column; changes made on other terminals "
+                    "are not detected." << endl;
+                cout << "[INFO] Run database/row_versions.sql to enable the checks." << endl;
+            }
+        }
+        if (!hasTables(db, { "Idempotency_Keys" })) {
+            cout << "[WARNING] Table Idempotency_Keys is missing; idempotency keys are remembered "
+                "by this process only." << endl;
+            cout << "[INFO] Run database/idempotency_keys.sql to share them between tills." << endl;
+        }
+        hasArchive(db);
+        // Without these the add screens check for duplicates with a query
+        hasColumn(db, "Menu", "Menu_name_key");
+        hasColumn(db, "Tables", "Table_number_key");
+        hasColumn(db, "Staff", "Email_key");
+    }
+};
@@ -0,0 +1,76 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <iostream>
+#include <cstdio>
+
+using namespace std;
+
+// Builds one screen of console output in memory and writes it with a single
+// call. Cells pad the way left/right << setw(width) do (never truncating),
+// and money() prints like fixed << setprecision(2), so a screen rendered
+// here matches the old line-by-line cout output byte for byte.
+class ScreenBuffer {
+private:
+    string out;
+
+    void pad(size_t used, size_t width) {
+        if (used < width) out.append(width - used, ' ');
+    }
+
+public:
+    explicit ScreenBuffer(size_t expectedBytes = 4096) {
+        out.reserve(expectedBytes);
+    }
+
+    // Text, padded on the right to width
+    ScreenBuffer& cell(string_view text, size_t width = 0) {
+        out.append(text.data(), text.size());
+        pad(text.size(), width);
+        return *this;
+    }
+
+    // Text, padded on the left to width
+    ScreenBuffer& rightCell(string_view text, size_t width) {
+        pad(text.size(), width);
+        out.append(text.data(), text.size());
+        return *this;
+    }
+
+    ScreenBuffer& number(long long value, size_t width = 0) {
+        char buffer[24];
+        int length = snprintf(buffer, sizeof(buffer), "%lld", value);
+        return cell(string_view(buffer, (size_t)length), width);
+    }
+
+    // Two decimal places
+    ScreenBuffer& money(double value, size_t width = 0) {
+        char buffer[48];
+        int length = snprintf(buffer, sizeof(buffer), "%.2f", value);
+        return cell(string_view(buffer, (size_t)length), width);
+    }
+
+    // Text followed by a line break
+    ScreenBuffer& line(string_view text = string_view()) {
+        out.append(text.data(), text.size());
+        out += '\n';
+        return *this;
+    }
+
+    // A full-width rule such as ==== or ----
+    ScreenBuffer& rule(char c, size_t width) {
+        out.append(width, c);
+        out += '\n';
+        return *this;
+    }
+
+    size_t size() const { return out.size(); }
+    const string& str() const { return out; }
+
+    // Write everything in one call and start over
+    void flush(ostream& os = cout) {
+        os.write(out.data(), (streamsize)out.size());
+        os.flush();
+        out.clear();
+    }
+};
@@ -0,0 +1,502 @@
+#pragma once
+#include "DatabaseConnection.h"
+#include "ColumnarFile.h"
+#include <cppconn/datatype.h>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <algorithm>
+
+using namespace std;
+
+// Settings for --export / --restore, given as key=value arguments
+struct SnapshotConfig {
+    int threads = 4;          // connections reading or writing tables in parallel
+    bool lock = true;         // export: hold FLUSH TABLES WITH READ LOCK while the snapshots start
+    bool replace = false;     // restore: empty the target tables first
+    size_t blockRows = 8192;  // rows per file block (and per export page)
+    size_t batchRows = 500;   // restore: rows per multi-row INSERT
+
+    bool set(const string& key, const string& value) {
+        if (key == "threads") threads = atoi(value.c_str());
+        else if (key == "lock") lock = value != "0";
+        else if (key == "replace") replace = value == "1";
+        else if (key == "block") blockRows = (size_t)atol(value.c_str());
+        else if (key == "batch") batchRows = (size_t)atol(value.c_str());
+        else return false;
+        return true;
+    }
+
+    bool valid() const {
+        return threads > 0 && blockRows > 0 && batchRows > 0;
+    }
+};
+
+// Shared pieces of the exporter and importer
+class SnapshotBase {
+protected:
+    struct TableJob {
+        string name;
+        vector<ColumnInfo> columns;
+        string primaryKey;        // single-column primary key, or empty
+        unsigned long long rows = 0;
+        double ms = 0;
+        bool ok = false;
+    };
+
+    DatabaseConnection& db;
+    SnapshotConfig config;
+    mutex reportLock;
+    atomic<bool> failed{ false };
+
+    SnapshotBase(DatabaseConnection& database, const SnapshotConfig& snapshotConfig)
+        : db(database), config(snapshotConfig) {}
+
+    static string quoteName(const string& name) {
+        string out = "`";
+        for (char c : name) {
+            if (c == '`') out += '`';
+            out += c;
+        }
+        return out + "`";
+    }
+
+    static string columnList(const vector<ColumnInfo>& columns) {
+        string list;
+        for (size_t c = 0; c < columns.size(); c++) {
+            if (c > 0) list += ",";
+            list += quoteName(columns[c].name);
+        }
+        return list;
+    }
+
+    // Run sql on the main connection, which prints errors instead of
+    // throwing; throws sql::SQLException if it failed
+    static void execute(DatabaseConnection& conn, const string& sql) {
+        if (conn.executeUpdate(sql) < 0) throw sql::SQLException("cannot run " + sql);
+    }
+
+    void fail(const string& message) {
+        lock_guard<mutex> guard(reportLock);
+        cerr << "[FAILED] " << message << endl;
+        failed = true;
+    }
+
+    // Run worker(i, conn) on count threads, each with its own connection,
+    // which throws sql::SQLException on any failed statement. The worker is
+    // called even if its connection failed (check isConnected()).
+    template <typename Worker>
+    void runWorkers(int count, Worker worker) {
+        vector<thread> threads;
+        for (int i = 0; i < count; i++) {
+            threads.emplace_back([this, i, &worker]() {
+                sql::mysql::get_mysql_driver_instance()->threadInit();
+                {
+                    DatabaseConnection conn(false);
+                    if (!conn.connect()) fail("worker cannot connect to the database");
+                    conn.setThrowOnError(true);
+                    worker(i, conn);
+                }
+                sql::mysql::get_mysql_driver_instance()->threadEnd();
+            });
+        }
+        for (thread& t : threads) t.join();
+    }
+
+    static void printSummary(const vector<TableJob>& jobs, double elapsedMs, ostream& out) {
+        out << left << setw(20) << "Table" << right << setw(12) << "Rows" << setw(12) << "ms" << endl;
+        out << string(44, '-') << endl;
+        unsigned long long total = 0;
+        for (const TableJob& job : jobs) {
+            out << left << setw(20) << job.name << right << setw(12) << job.rows
+                << setw(12) << fixed << setprecision(0) << job.ms << (job.ok ? "" : "  FAILED") << endl;
+            total += job.rows;
+        }
+        out << string(44, '-') << endl;
+        out << left << setw(20) << "Total" << right << setw(12) << total
+            << setw(12) << fixed << setprecision(0) << elapsedMs << endl;
+    }
+};
+
+// Writes every base table of the current database to <dir>/<table>.rcol
+// plus <dir>/manifest.txt, reading tables in parallel.
+//
+// All workers read inside START TRANSACTION WITH CONSISTENT SNAPSHOT, and
+// the snapshots are opened while the main connection holds FLUSH TABLES
+// WITH READ LOCK, so every table is read as of the same instant. The global
+// read lock is released as soon as the last snapshot has started, usually
+// within milliseconds, so writes from the tills are blocked only for that
+// moment instead of for the whole dump. lock=0 skips the lock (no RELOAD
+// privilege needed); each worker's snapshot is then consistent on its own
+// but the workers may start a few moments apart.
+//
+// Tables with a single-column primary key are read in key order, one block
+// at a time (WHERE pk > last ORDER BY pk LIMIT block), so the client never
+// buffers a whole table. Generated columns are left out because they cannot
+// be inserted on restore.
+class SnapshotExporter : public SnapshotBase {
+private:
+    bool listTables(vector<TableJob>& jobs) {
+        auto tables = db.executeQuery(
+            "SELECT TABLE_NAME FROM information_schema.TABLES "
+            "WHERE TABLE_SCHEMA = DATABASE() AND TABLE_TYPE = 'BASE TABLE' "
+            "ORDER BY DATA_LENGTH DESC, TABLE_NAME");
+        if (!tables) return false;
+        while (tables->next()) {
+            TableJob job;
+            job.name = tables->getString(1);
+            jobs.push_back(job);
+        }
+
+        auto columns = db.prepareStatement(
+            "SELECT COLUMN_NAME, COLUMN_TYPE FROM information_schema.COLUMNS "
+            "WHERE TABLE_SCHEMA = DATABASE() AND TABLE_NAME = ? AND EXTRA NOT LIKE '%GENERATED%' "
+            "ORDER BY ORDINAL_POSITION");
+        auto keys = db.prepareStatement(
+            "SELECT COLUMN_NAME FROM information_schema.KEY_COLUMN_USAGE "
+            "WHERE TABLE_SCHEMA = DATABASE() AND TABLE_NAME = ? AND CONSTRAINT_NAME = 'PRIMARY'");
+        if (!columns || !keys) return false;
+        for (TableJob& job : jobs) {
+            columns->setString(1, job.name);
+            unique_ptr<sql::ResultSet> res(columns->executeQuery());
+            while (res->next()) {
+                job.columns.push_back({ res->getString(1), res->getString(2) });
+            }
+            keys->setString(1, job.name);
+            unique_ptr<sql::ResultSet> keyRes(keys->executeQuery());
+            vector<string> keyColumns;
+            while (keyRes->next()) keyColumns.push_back(keyRes->getString(1));
+            if (keyColumns.size() == 1) job.primaryKey = keyColumns[0];
+        }
+        return true;
+    }
+
+    void exportTable(DatabaseConnection& conn, TableJob& job, const string& dir) {
+        auto start = chrono::steady_clock::now();
+        ColumnarWriter writer((filesystem::path(dir) / (job.name + ".rcol")).string(), job.columns, config.blockRows);
+        if (!writer.good()) {
+            fail("cannot write " + job.name + ".rcol");
+            return;
+        }
+
+        string select = "SELECT " + columnList(job.columns) + " FROM " + quoteName(job.name);
+        size_t keyIndex = 0;
+        for (size_t c = 0; c < job.columns.size(); c++) {
+            if (job.columns[c].name == job.primaryKey) keyIndex = c + 1;
+        }
+
+        auto copyRows = [&](sql::ResultSet* res, string* lastKey) {
+            size_t count = 0;
+            while (res->next()) {
+                for (size_t c = 0; c < job.columns.size(); c++) {
+                    string value = res->getString((uint32_t)(c + 1));
+                    writer.add(c, value, res->isNull((uint32_t)(c + 1)));
+                }
+                if (lastKey) *lastKey = res->getString((uint32_t)keyIndex);
+                writer.endRow();
+                count++;
+            }
+            return count;
+        };
+
+        if (keyIndex > 0) {
+            string order = " ORDER BY " + quoteName(job.primaryKey) + " LIMIT " + to_string(config.blockRows);
+            auto first = conn.prepareStatement(select + order);
+            auto next = conn.prepareStatement(select + " WHERE " + quoteName(job.primaryKey) + " > ?" + order);
+            if (!first || !next) {
+                fail("cannot read " + job.name);
+                return;
+            }
+            string lastKey;
+            unique_ptr<sql::ResultSet> res(first->executeQuery());
+            while (copyRows(res.get(), &lastKey) == config.blockRows) {
+                next->setString(1, lastKey);
+                res.reset(next->executeQuery());
+            }
+        }
+        else {
+            auto res = conn.executeQuery(select);
+            if (!res) {
+                fail("cannot read " + job.name);
+                return;
+            }
+            copyRows(res.get(), nullptr);
+        }
+
+        job.rows = writer.rowCount();
+        job.ok = writer.close();
+        job.ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        if (!job.ok) fail("error writing " + job.name + ".rcol");
+    }
+
+public:
+    SnapshotExporter(DatabaseConnection& database, const SnapshotConfig& snapshotConfig)
+        : SnapshotBase(database, snapshotConfig) {}
+
+    bool run(const string& dir, ostream& out) {
+        TRACE_SPAN("Snapshot", "export");
+        auto start = chrono::steady_clock::now();
+        error_code ec;
+        filesystem::create_directories(dir, ec);
+        if (ec) {
+            fail("cannot create directory " + dir);
+            return false;
+        }
+
+        vector<TableJob> jobs;
+        try {
+            if (!listTables(jobs) || jobs.empty()) {
+                fail("no tables to export");
+                return false;
+            }
+        }
+        catch (sql::SQLException& e) {
+            fail(string("cannot read table list: ") + e.what());
+            return false;
+        }
+
+        int workers = min<int>(config.threads, (int)jobs.size());
+        bool locked = false;
+        if (config.lock) {
+            try {
+                execute(db, "FLUSH TABLES WITH READ LOCK");
+                locked = true;
+            }
+            catch (sql::SQLException& e) {
+                cerr << "[INFO] Global read lock unavailable (" << e.what()
+                    << "); snapshots are per connection." << endl;
+            }
+        }
+
+        // The read lock is released once every worker has opened its snapshot
+        mutex startLock;
+        condition_variable started;
+        int snapshotsOpen = 0;
+        atomic<size_t> nextJob{ 0 };
+
+        thread unlocker([&]() {
+            unique_lock<mutex> guard(startLock);
+            started.wait(guard, [&]() { return snapshotsOpen == workers; });
+            guard.unlock();
+            if (!locked) return;
+            sql::mysql::get_mysql_driver_instance()->threadInit();
+            try {
+                execute(db, "UNLOCK TABLES");
+            }
+            catch (sql::SQLException& e) {
+                fail(string("cannot release read lock: ") + e.what());
+            }
+            sql::mysql::get_mysql_driver_instance()->threadEnd();
+        });
+
+        runWorkers(workers, [&](int, DatabaseConnection& conn) {
+            bool open = false;
+            if (conn.isConnected()) try {
+                conn.executeUpdate("SET SESSION TRANSACTION ISOLATION LEVEL REPEATABLE READ");
+                conn.executeUpdate("START TRANSACTION WITH CONSISTENT SNAPSHOT");
+                open = true;
+            }
+            catch (sql::SQLException& e) {
+                fail(string("cannot start snapshot: ") + e.what());
+            }
+            {
+                lock_guard<mutex> guard(startLock);
+                snapshotsOpen++;
+            }
+            started.notify_all();
+            if (!open) return;
+
+            try {
+                size_t index;
+                while (!failed && (index = nextJob++) < jobs.size()) {
+                    exportTable(conn, jobs[index], dir);
+                }
+                conn.executeUpdate("COMMIT");
+            }
+            catch (sql::SQLException& e) {
+                fail(string("export error: ") + e.what());
+            }
+        });
+
+        unlocker.join();
+
+        ofstream manifest((filesystem::path(dir) / "manifest.txt").string(), ios::trunc);
+        manifest << "RCOL-SNAPSHOT 1" << endl;
+        for (const TableJob& job : jobs) {
+            manifest << job.name << "\t" << job.rows << endl;
+        }
+        manifest.close();
+
+        double elapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        printSummary(jobs, elapsedMs, out);
+        bool ok = !failed && (bool)manifest;
+        out << (ok ? "[SUCCESS] Snapshot written to " : "[FAILED] Snapshot incomplete in ") << dir << endl;
+        return ok;
+    }
+};
+
+// Loads a directory written by SnapshotExporter back into the current
+// database, several tables at a time, with foreign key and unique checks
+// off for the loading sessions.
+//
+// Orders and Tables are loaded after everything else. The Order_Item
+// trigger then finds no order to add line totals to, and the payment
+// trigger finds no order or table to update, so restored totals and
+// statuses are exactly the exported ones.
+//
+// Target tables must be empty unless replace=1, which deletes their rows first.
+class SnapshotImporter : public SnapshotBase {
+private:
+    static bool loadsLast(const string& table) {
+        return table == "Orders" || table == "Tables";
+    }
+
+    unique_ptr<sql::PreparedStatement> prepareInsert(DatabaseConnection& conn, const TableJob& job, size_t rows) {
+        string placeholders = "(";
+        for (size_t c = 0; c < job.columns.size(); c++) placeholders += c == 0 ? "?" : ",?";
+        placeholders += ")";
+        string sql = "INSERT INTO " + quoteName(job.name) + " (" + columnList(job.columns) + ") VALUES ";
+        sql.reserve(sql.size() + rows * (placeholders.size() + 1));
+        for (size_t r = 0; r < rows; r++) {
+            if (r > 0) sql += ",";
+            sql += placeholders;
+        }
+        return conn.prepareStatement(sql);
+    }
+
+    void importTable(DatabaseConnection& conn, TableJob& job, const string& dir) {
+        auto start = chrono::steady_clock::now();
+        ColumnarReader reader((filesystem::path(dir) / (job.name + ".rcol")).string());
+        if (!reader.good()) {
+            fail("cannot read " + job.name + ".rcol");
+            return;
+        }
+        job.columns = reader.getColumns();
+
+        unique_ptr<sql::PreparedStatement> fullBatch;
+        vector<vector<string>> values;
+        vector<vector<bool>> nulls;
+        size_t rows;
+        while (!failed && reader.nextBlock(values, nulls, rows)) {
+            // One transaction per block; a lock conflict writes the block again
+            conn.transaction("restoreBlock", [&]() {
+                for (size_t first = 0; first < rows; first += config.batchRows) {
+                    size_t count = min(config.batchRows, rows - first);
+                    unique_ptr<sql::PreparedStatement> tail;
+                    sql::PreparedStatement* pstmt;
+                    if (count == config.batchRows) {
+                        if (!fullBatch) fullBatch = prepareInsert(conn, job, count);
+                        pstmt = fullBatch.get();
+                    }
+                    else {
+                        tail = prepareInsert(conn, job, count);
+                        pstmt = tail.get();
+                    }
+                    if (!pstmt) throw sql::SQLException("cannot prepare insert for " + job.name);
+
+                    int index = 1;
+                    for (size_t r = first; r < first + count; r++) {
+                        for (size_t c = 0; c < job.columns.size(); c++) {
+                            if (nulls[c][r]) pstmt->setNull(index++, sql::DataType::VARCHAR);
+                            else pstmt->setString(index++, values[c][r]);
+                        }
+                    }
+                    pstmt->executeUpdate();
+                }
+                return true;
+            });
+            job.rows += rows;
+        }
+
+        job.ok = reader.good() && !failed;
+        job.ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        if (!reader.good()) fail(job.name + ".rcol is truncated or corrupt");
+    }
+
+    // Load the given tables in parallel
+    void loadPhase(vector<TableJob*> phase, const string& dir) {
+        if (phase.empty()) return;
+        atomic<size_t> nextJob{ 0 };
+        runWorkers(min<int>(config.threads, (int)phase.size()), [&](int, DatabaseConnection& conn) {
+            if (!conn.isConnected()) return;
+            try {
+                conn.executeUpdate("SET SESSION foreign_key_checks = 0");
+                conn.executeUpdate("SET SESSION unique_checks = 0");
+                size_t index;
+                while (!failed && (index = nextJob++) < phase.size()) {
+                    importTable(conn, *phase[index], dir);
+                }
+            }
+            catch (sql::SQLException& e) {
+                fail(string("restore error: ") + e.what());
+            }
+        });
+    }
+
+public:
+    SnapshotImporter(DatabaseConnection& database, const SnapshotConfig& snapshotConfig)
+        : SnapshotBase(database, snapshotConfig) {}
+
+    bool run(const string& dir, ostream& out) {
+        TRACE_SPAN("Snapshot", "restore");
+        auto start = chrono::steady_clock::now();
+
+        ifstream manifest((filesystem::path(dir) / "manifest.txt").string());
+        string line;
+        if (!getline(manifest, line) || line != "RCOL-SNAPSHOT 1") {
+            fail("no snapshot manifest in " + dir);
+            return false;
+        }
+        vector<TableJob> jobs;
+        while (getline(manifest, line)) {
+            size_t tab = line.find('\t');
+            if (tab == string::npos) continue;
+            TableJob job;
+            job.name = line.substr(0, tab);
+            jobs.push_back(job);
+        }
+
+        try {
+            execute(db, "SET SESSION foreign_key_checks = 0");
+            for (const TableJob& job : jobs) {
+                if (config.replace) {
+                    execute(db, "DELETE FROM " + quoteName(job.name));
+                    continue;
+                }
+                auto res = db.executeQuery("SELECT 1 FROM " + quoteName(job.name) + " LIMIT 1");
+                if (!res) {
+                    fail("cannot read table " + job.name);
+                }
+                else if (res->next()) {
+                    fail("table " + job.name + " is not empty (use replace=1 to overwrite)");
+                }
+            }
+            execute(db, "SET SESSION foreign_key_checks = 1");
+        }
+        catch (sql::SQLException& e) {
+            fail(string("cannot prepare target tables: ") + e.what());
+            db.executeUpdate("SET SESSION foreign_key_checks = 1");
+        }
+        if (failed) return false;
+
+        vector<TableJob*> first, last;
+        for (TableJob& job : jobs) {
+            (loadsLast(job.name) ? last : first).push_back(&job);
+        }
+        loadPhase(first, dir);
+        if (!failed) loadPhase(last, dir);
+
+        double elapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        printSummary(jobs, elapsedMs, out);
+        out << (failed ? "[FAILED] Restore incomplete from " : "[SUCCESS] Snapshot restored from ") << dir << endl;
+        return !failed;
+    }
+};
@@ -1,8 +1,14 @@
 #pragma once
 #include "DatabaseConnection.h"
+#include "NormalizedKeyIndex.h"
+#include "OrderArchive.h"
+#include "ConsoleRenderer.h"
 #include <string>
 #include <iostream>
 #include <iomanip>
+#include <vector>
+#include <optional>
+#include <cstdio>
 
 using namespace std;
 
@@ -12,6 +18,8 @@ private:
     string currentStaffID;
     string currentStaffName;
     bool isLoggedIn;
+    NormalizedKeyIndex staffEmails{ "Staff", "StaffID", "Email", "Email_key", "uq_staff_email_key" };
+    ArchiveSchema archive{ db };
 
     string generateStaffID() {
         // Find the smallest missing ID (reuses deleted IDs)
@@ -26,7 +34,7 @@ private:
         if (res && res->next()) {
             int gapID = res->getInt("gap");
             char buffer[10];
-            sprintf_s(buffer, "STF%03d", gapID);
+            snprintf(buffer, sizeof(buffer), "STF%03d", gapID);
             return string(buffer);
         }
         
@@ -36,7 +44,7 @@ private:
         if (maxRes && maxRes->next()) {
             int maxID = maxRes->getInt("MaxID");
             char buffer[10];
-            sprintf_s(buffer, "STF%03d", maxID + 1);
+            snprintf(buffer, sizeof(buffer), "STF%03d", maxID + 1);
             return string(buffer);
         }
         return "STF001";
@@ -45,19 +53,25 @@ private:
 public:
     StaffModule(DatabaseConnection& database) : db(database), isLoggedIn(false) {}
 
+    // Reload the email index on next use (after a bulk import)
+    void reloadIndexes() {
+        staffEmails.invalidate();
+    }
+
     // Staff Login
     bool login(const string& email, const string& password) {
+        MODULE_SPAN("StaffModule", "login");
         try {
             auto pstmt = db.prepareStatement(
-                "SELECT StaffID, Name, Status FROM Staff WHERE Email = ? AND Password = ?");
+                "SELECT StaffID, Name, " + sqlField<StaffStatus>("Status") + " AS Status "
+                "FROM Staff WHERE Email = ? AND Password = ?");
             if (pstmt) {
                 pstmt->setString(1, email);
                 pstmt->setString(2, password);
                 auto res = pstmt->executeQuery();
 
                 if (res->next()) {
-                    string status = res->getString("Status");
-                    if (status == "Inactive") {
+                    if (getEnum<StaffStatus>(*res, "Status") == StaffStatus::Inactive) {
                         cout << "[FAILED] Your account is inactive. Contact admin." << endl;
                         return false;
                     }
@@ -78,6 +92,7 @@ public:
     }
 
     void logout() {
+        MODULE_SPAN("StaffModule", "logout");
         currentStaffID = "";
         currentStaffName = "";
         isLoggedIn = false;
@@ -88,111 +103,106 @@ public:
     string getStaffID() const { return currentStaffID; }
     string getStaffName() const { return currentStaffName; }
 
+    // All staff by name (nullopt if the query failed)
+    optional<vector<StaffRow>> listStaff() {
+        MODULE_SPAN("StaffModule", "listStaff");
+        auto res = db.executeQuery(selectRows<StaffRow>("FROM Staff ORDER BY Name"));
+        if (!res) return nullopt;
+        return fetchRows<StaffRow>(res.get());
+    }
+
+    // Active staff by name (nullopt if the query failed)
+    optional<vector<StaffRow>> listActiveStaff() {
+        MODULE_SPAN("StaffModule", "listActiveStaff");
+        auto res = db.executeQuery(selectRows<StaffRow>("FROM Staff WHERE Status = 'Active' ORDER BY Name"));
+        if (!res) return nullopt;
+        return fetchRows<StaffRow>(res.get());
+    }
+
     // View all staff
     void viewAllStaff() {
-        auto res = db.executeQuery(
-            "SELECT StaffID, Name, Email, Address, Status FROM Staff ORDER BY Name");
-        if (res) {
-            cout << "\n" << string(90, '=') << endl;
-            cout << "STAFF LIST" << endl;
-            cout << string(90, '=') << endl;
-            cout << left << setw(12) << "Staff ID"
-                << setw(20) << "Name"
-                << setw(28) << "Email"
-                << setw(20) << "Address"
-                << "Status" << endl;
-            cout << string(90, '-') << endl;
-
-            while (res->next()) {
-                cout << left << setw(12) << res->getString("StaffID")
-                    << setw(20) << res->getString("Name")
-                    << setw(28) << res->getString("Email")
-                    << setw(20) << res->getString("Address")
-                    << res->getString("Status") << endl;
-            }
-            cout << string(90, '=') << endl;
-        }
+        MODULE_SPAN("StaffModule", "viewAllStaff");
+        if (auto staff = listStaff()) ConsoleRenderer::staff(*staff);
     }
 
     // View active staff only
     void viewActiveStaff() {
-        auto res = db.executeQuery(
-            "SELECT StaffID, Name, Email FROM Staff WHERE Status = 'Active' ORDER BY Name");
-        if (res) {
-            cout << "\n" << string(60, '=') << endl;
-            cout << "ACTIVE STAFF" << endl;
-            cout << string(60, '=') << endl;
-            cout << left << setw(12) << "Staff ID"
-                << setw(20) << "Name"
-                << "Email" << endl;
-            cout << string(60, '-') << endl;
-
-            while (res->next()) {
-                cout << left << setw(12) << res->getString("StaffID")
-                    << setw(20) << res->getString("Name")
-                    << res->getString("Email") << endl;
-            }
-            cout << string(60, '=') << endl;
-        }
+        MODULE_SPAN("StaffModule", "viewActiveStaff");
+        if (auto staff = listActiveStaff()) ConsoleRenderer::activeStaff(*staff);
     }
 
     // Add new staff
     bool addStaff(const string& name, const string& email,
         const string& address, const string& password) {
+        MODULE_SPAN("StaffModule", "addStaff");
         try {
-            // Check if email already exists
-            auto checkStmt = db.prepareStatement("SELECT StaffID FROM Staff WHERE Email = ?");
-            if (checkStmt) {
-                checkStmt->setString(1, email);
-                auto checkRes = checkStmt->executeQuery();
-                if (checkRes->next()) {
+            // Check if email already exists (case-insensitive)
+            if (staffEmails.ensureLoaded(db) && !staffEmails.find(email).empty()) {
+                cout << "[FAILED] Email already registered!" << endl;
+                return false;
+            }
+
+            string staffID;
+            bool added = db.transaction("addStaff", [&]() {
+                if (!staffEmails.findStored(db, email).empty()) {
                     cout << "[FAILED] Email already registered!" << endl;
                     return false;
                 }
-            }
+                staffID = generateStaffID();
+                auto pstmt = db.prepareStatement(
+                    "INSERT INTO Staff (StaffID, Name, Email, Address, Password, Status) "
+                    "VALUES (?, ?, ?, ?, ?, 'Active')");
+                if (pstmt) {
+                    pstmt->setString(1, staffID);
+                    pstmt->setString(2, name);
+                    pstmt->setString(3, email);
+                    pstmt->setString(4, address);
+                    pstmt->setString(5, password);
+                    pstmt->executeUpdate();
+                    return true;
+                }
+                return false;
+            });
 
-            string staffID = generateStaffID();
-            auto pstmt = db.prepareStatement(
-                "INSERT INTO Staff (StaffID, Name, Email, Address, Password, Status) "
-                "VALUES (?, ?, ?, ?, ?, 'Active')");
-            if (pstmt) {
-                pstmt->setString(1, staffID);
-                pstmt->setString(2, name);
-                pstmt->setString(3, email);
-                pstmt->setString(4, address);
-                pstmt->setString(5, password);
-                pstmt->executeUpdate();
+            if (added) {
+                staffEmails.insert(staffID, email);
                 cout << "[SUCCESS] Staff added with ID: " << staffID << endl;
-                return true;
             }
-            return false;
+            return added;
         }
         catch (sql::SQLException& e) {
+            if (staffEmails.rejected(e)) {
+                staffEmails.invalidate();
+                cout << "[FAILED] Email already registered!" << endl;
+                return false;
+            }
+            if (e.getErrorCode() == MYSQL_DUPLICATE_ENTRY) {
+                cout << "[FAILED] Another terminal added a staff member at the same time! Please try again." << endl;
+                return false;
+            }
             cerr << "Error adding staff: " << e.what() << endl;
             return false;
         }
     }
 
     // Update staff status
-    bool updateStaffStatus(const string& staffID, const string& status) {
+    bool updateStaffStatus(const string& staffID, StaffStatus status) {
+        MODULE_SPAN("StaffModule", "updateStaffStatus");
         try {
-            if (status != "Active" && status != "Inactive") {
+            if (status == StaffStatus::Unknown) {
                 cout << "[FAILED] Invalid status! Use 'Active' or 'Inactive'." << endl;
                 return false;
             }
 
             auto pstmt = db.prepareStatement("UPDATE Staff SET Status = ? WHERE StaffID = ?");
             if (pstmt) {
-                pstmt->setString(1, status);
+                pstmt->setString(1, toString(status));
                 pstmt->setString(2, staffID);
-                int result = pstmt->executeUpdate();
-                if (result > 0) {
-                    cout << "[SUCCESS] Staff status updated to " << status << endl;
+                if (pstmt->executeUpdate() > 0) {
+                    cout << "[SUCCESS] Staff status updated to " << toString(status) << endl;
                     return true;
                 }
-                else {
-                    cout << "[FAILED] Staff not found!" << endl;
-                }
+                cout << "[FAILED] Staff not found!" << endl;
             }
             return false;
         }
@@ -202,34 +212,43 @@ public:
         }
     }
 
+    // Update staff status from user input (case-insensitive)
+    bool updateStaffStatus(const string& staffID, const string& status) {
+        return updateStaffStatus(staffID, parseEnum<StaffStatus>(status));
+    }
+
     // Delete staff
     bool deleteStaff(const string& staffID) {
+        MODULE_SPAN("StaffModule", "deleteStaff");
         try {
-            // Check if staff has orders
-            auto checkStmt = db.prepareStatement("SELECT OrderID FROM Orders WHERE StaffID = ?");
-            if (checkStmt) {
-                checkStmt->setString(1, staffID);
-                auto checkRes = checkStmt->executeQuery();
-                if (checkRes->next()) {
-                    cout << "[FAILED] Cannot delete staff with existing orders!" << endl;
-                    cout << "[INFO] Set status to 'Inactive' instead." << endl;
-                    return false;
+            bool deleted = db.transaction("deleteStaff", [&]() {
+                // Check if staff has orders (archived ones included)
+                auto checkStmt = db.prepareStatement(
+                    "SELECT OrderID FROM " + archive.allRows("Orders") + " WHERE StaffID = ? LIMIT 1");
+                if (checkStmt) {
+                    checkStmt->setString(1, staffID);
+                    auto checkRes = checkStmt->executeQuery();
+                    if (checkRes->next()) {
+                        cout << "[FAILED] Cannot delete staff with existing orders!" << endl;
+                        cout << "[INFO] Set status to 'Inactive' instead." << endl;
+                        return false;
+                    }
                 }
-            }
 
-            auto pstmt = db.prepareStatement("DELETE FROM Staff WHERE StaffID = ?");
-            if (pstmt) {
-                pstmt->setString(1, staffID);
-                int result = pstmt->executeUpdate();
-                if (result > 0) {
-                    cout << "[SUCCESS] Staff deleted successfully!" << endl;
-                    return true;
-                }
-                else {
+                auto pstmt = db.prepareStatement("DELETE FROM Staff WHERE StaffID = ?");
+                if (pstmt) {
+                    pstmt->setString(1, staffID);
+                    if (pstmt->executeUpdate() > 0) return true;
                     cout << "[FAILED] Staff not found!" << endl;
                 }
+                return false;
+            });
+
+            if (deleted) {
+                staffEmails.eraseID(staffID);
+                cout << "[SUCCESS] Staff deleted successfully!" << endl;
             }
-            return false;
+            return deleted;
         }
         catch (sql::SQLException& e) {
             cerr << "Error deleting staff: " << e.what() << endl;
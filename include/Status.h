@@ -0,0 +1,100 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+// Status and category values stored as ENUM/VARCHAR text in the database.
+// Each enum has a one-byte representation whose numeric value is the
+// position of its name in EnumTraits<E>::names, with 0 reserved for
+// Unknown (unrecognized text or NULL). That numbering matches MySQL's
+// FIELD(column, 'name1', 'name2', ...), so a query can return the enum as
+// an integer instead of a string (see sqlField).
+
+enum class TableStatus : uint8_t { Unknown, Vacant, Occupied, Reserved };
+enum class OrderStatus : uint8_t { Unknown, Active, Completed, Cancelled };
+enum class PaymentStatus : uint8_t { Unknown, Unpaid, Paid };
+enum class PaymentMethod : uint8_t { Unknown, Cash, Card, EWallet };
+enum class Availability : uint8_t { Unknown, Available, Unavailable };
+enum class MenuCategory : uint8_t { Unknown, Food, Beverage, Dessert };
+enum class StaffStatus : uint8_t { Unknown, Active, Inactive };
+
+template <typename E> struct EnumTraits;
+
+template <> struct EnumTraits<TableStatus> {
+    static constexpr const char* names[] = { "", "Vacant", "Occupied", "Reserved" };
+};
+template <> struct EnumTraits<OrderStatus> {
+    static constexpr const char* names[] = { "", "Active", "Completed", "Cancelled" };
+};
+template <> struct EnumTraits<PaymentStatus> {
+    static constexpr const char* names[] = { "", "Unpaid", "Paid" };
+};
+template <> struct EnumTraits<PaymentMethod> {
+    static constexpr const char* names[] = { "", "Cash", "Card", "E-Wallet" };
+};
+template <> struct EnumTraits<Availability> {
+    static constexpr const char* names[] = { "", "Available", "Unavailable" };
+};
+template <> struct EnumTraits<MenuCategory> {
+    static constexpr const char* names[] = { "", "Food", "Beverage", "Dessert" };
+};
+template <> struct EnumTraits<StaffStatus> {
+    static constexpr const char* names[] = { "", "Active", "Inactive" };
+};
+
+template <typename E>
+constexpr size_t enumCount() {
+    return sizeof(EnumTraits<E>::names) / sizeof(EnumTraits<E>::names[0]);
+}
+
+// Database spelling of a value ("" for Unknown)
+template <typename E>
+constexpr const char* toString(E value) {
+    size_t index = (size_t)value;
+    return index < enumCount<E>() ? EnumTraits<E>::names[index] : "";
+}
+
+constexpr char lowerAscii(char c) {
+    return c >= 'A' && c <= 'Z' ? (char)(c - 'A' + 'a') : c;
+}
+
+constexpr bool equalsIgnoreCase(string_view a, string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (lowerAscii(a[i]) != lowerAscii(b[i])) return false;
+    }
+    return true;
+}
+
+// Case-insensitive parse; Unknown if the text names no value
+template <typename E>
+constexpr E parseEnum(string_view text) {
+    for (size_t i = 1; i < enumCount<E>(); i++) {
+        if (equalsIgnoreCase(text, EnumTraits<E>::names[i])) return (E)i;
+    }
+    return E::Unknown;
+}
+
+// FIELD(expression, 'name1', 'name2', ...): selects the column as its enum number
+template <typename E>
+string sqlField(const string& expression) {
+    string sql = "FIELD(" + expression;
+    for (size_t i = 1; i < enumCount<E>(); i++) {
+        sql += ",'";
+        sql += EnumTraits<E>::names[i];
+        sql += "'";
+    }
+    return sql + ")";
+}
+
+// Tables that can take a new order
+constexpr bool acceptsOrders(TableStatus status) {
+    return status == TableStatus::Occupied || status == TableStatus::Reserved;
+}
+
+static_assert(parseEnum<OrderStatus>("active") == OrderStatus::Active, "case-insensitive parse");
+static_assert(parseEnum<PaymentMethod>("E-Wallet") == PaymentMethod::EWallet, "names match the database");
+static_assert(parseEnum<TableStatus>("Closed") == TableStatus::Unknown, "unknown text");
@@ -1,16 +1,23 @@
 #pragma once
 #include "DatabaseConnection.h"
+#include "NormalizedKeyIndex.h"
+#include "OrderArchive.h"
+#include "ConsoleRenderer.h"
+#include "OrderJournal.h"
 #include <string>
 #include <iostream>
 #include <iomanip>
-#include <algorithm>
-#include <cctype>
+#include <vector>
+#include <optional>
 
 using namespace std;
 
 class TableModule {
 private:
     DatabaseConnection& db;
+    OrderJournal* journal = nullptr;
+    NormalizedKeyIndex tableNumbers{ "Tables", "TableID", "Table_number", "Table_number_key", "uq_table_number_key" };
+    ArchiveSchema archive{ db };
 
     string generateTableID() {
         // Find the smallest missing ID (reuses deleted IDs)
@@ -25,7 +32,7 @@ private:
         if (res && res->next()) {
             int gapID = res->getInt("gap");
             char buffer[10];
-            sprintf_s(buffer, "TBL%03d", gapID);
+            snprintf(buffer, sizeof(buffer), "TBL%03d", gapID);
             return string(buffer);
         }
         
@@ -35,73 +42,77 @@ private:
         if (maxRes && maxRes->next()) {
             int maxID = maxRes->getInt("MaxID");
             char buffer[10];
-            sprintf_s(buffer, "TBL%03d", maxID + 1);
+            snprintf(buffer, sizeof(buffer), "TBL%03d", maxID + 1);
             return string(buffer);
         }
         return "TBL001";
     }
 
+    // The journal to use instead of the database while it is unreachable
+    OrderJournal* offline() {
+        return journal && !journal->online() ? journal : nullptr;
+    }
+
 public:
     TableModule(DatabaseConnection& database) : db(database) {}
 
-    // View all tables
-    void viewAllTables() {
-        auto res = db.executeQuery(
-            "SELECT TableID, Table_number, Capacity, Status "
-            "FROM Tables ORDER BY Table_number");
-        if (res) {
-            cout << "\n" << string(60, '=') << endl;
-            cout << "RESTAURANT TABLES" << endl;
-            cout << string(60, '=') << endl;
-            cout << left << setw(12) << "Table ID"
-                << setw(15) << "Table Number"
-                << setw(12) << "Capacity"
-                << "Status" << endl;
-            cout << string(60, '-') << endl;
+    // Read tables from and take status changes into journal while the
+    // database is unreachable (nullptr: fail as before)
+    void useJournal(OrderJournal* orderJournal) { journal = orderJournal; }
 
-            while (res->next()) {
-                cout << left << setw(12) << res->getString("TableID")
-                    << setw(15) << res->getString("Table_number")
-                    << setw(12) << res->getInt("Capacity")
-                    << res->getString("Status") << endl;
-            }
-            cout << string(60, '=') << endl;
-        }
+    // Reload the table number index on next use (after a bulk import)
+    void reloadIndexes() {
+        tableNumbers.invalidate();
     }
 
-    // View tables by status
-    void viewTablesByStatus(const string& status) {
-        auto pstmt = db.prepareStatement(
-            "SELECT TableID, Table_number, Capacity "
-            "FROM Tables WHERE Status = ? ORDER BY Table_number");
-        if (pstmt) {
-            pstmt->setString(1, status);
-            auto res = pstmt->executeQuery();
-
-            cout << "\n" << string(50, '=') << endl;
-            cout << status << " TABLES" << endl;
-            cout << string(50, '=') << endl;
-            cout << left << setw(12) << "Table ID"
-                << setw(15) << "Table Number"
-                << "Capacity" << endl;
-            cout << string(50, '-') << endl;
+    // All tables by number (nullopt if the query failed)
+    optional<vector<TableRow>> listTables() {
+        MODULE_SPAN("TableModule", "listTables");
+        if (OrderJournal* j = offline()) return j->listTables();
+        auto res = db.executeQuery(selectRows<TableRow>("FROM Tables ORDER BY Table_number"));
+        if (!res) return nullopt;
+        return fetchRows<TableRow>(res.get());
+    }
 
-            int count = 0;
-            while (res->next()) {
-                cout << left << setw(12) << res->getString("TableID")
-                    << setw(15) << res->getString("Table_number")
-                    << res->getInt("Capacity") << endl;
-                count++;
-            }
-            if (count == 0) {
-                cout << "No " << status << " tables found." << endl;
+    // Tables with one status by number (nullopt if the query failed)
+    optional<vector<TableRow>> listTablesByStatus(TableStatus status) {
+        MODULE_SPAN("TableModule", "listTablesByStatus");
+        if (OrderJournal* j = offline()) {
+            vector<TableRow> tables;
+            for (TableRow& table : j->listTables()) {
+                if (table.status == status) tables.push_back(table);
             }
-            cout << string(50, '=') << endl;
+            return tables;
         }
+        try {
+            auto pstmt = db.prepareStatement(
+                selectRows<TableRow>("FROM Tables WHERE Status = ? ORDER BY Table_number"));
+            if (!pstmt) return nullopt;
+            pstmt->setString(1, toString(status));
+            unique_ptr<sql::ResultSet> res(pstmt->executeQuery());
+            return fetchRows<TableRow>(res.get());
+        }
+        catch (sql::SQLException& e) {
+            cerr << "Error listing tables: " << e.what() << endl;
+            return nullopt;
+        }
+    }
+
+    // View all tables
+    void viewAllTables() {
+        MODULE_SPAN("TableModule", "viewAllTables");
+        if (auto tables = listTables()) ConsoleRenderer::tables(*tables);
+    }
+
+    // View tables by status
+    void viewTablesByStatus(TableStatus status) {
+        MODULE_SPAN("TableModule", "viewTablesByStatus");
+        if (auto tables = listTablesByStatus(status)) ConsoleRenderer::tablesByStatus(status, *tables);
     }
 
     // Add new table
     bool addTable(const string& tableNumber, int capacity) {
+        MODULE_SPAN("TableModule", "addTable");
         try {
             // Validate capacity
             if (capacity < 1) {
@@ -109,89 +120,106 @@ public:
                 return false;
             }
 
-            // Check if table number already exists
-            auto checkStmt = db.prepareStatement("SELECT TableID, Table_number FROM Tables WHERE Table_number = ?");
-            if (checkStmt) {
-                checkStmt->setString(1, tableNumber);
-                auto checkRes = checkStmt->executeQuery();
-                if (checkRes->next()) {
-                    cout << "[FAILED] Table number '" << checkRes->getString("Table_number") 
-                         << "' already exists! (ID: " << checkRes->getString("TableID") << ")" << endl;
+            // Check if table number already exists (ignoring case and spacing)
+            if (tableNumbers.ensureLoaded(db)) {
+                string existingNumber;
+                string existingID = tableNumbers.find(tableNumber, &existingNumber);
+                if (!existingID.empty()) {
+                    cout << "[FAILED] Table number '" << existingNumber
+                         << "' already exists! (ID: " << existingID << ")" << endl;
                     return false;
                 }
             }
 
-            string tableID = generateTableID();
-            auto pstmt = db.prepareStatement(
-                "INSERT INTO Tables (TableID, Table_number, Capacity, Status) "
-                "VALUES (?, ?, ?, 'Vacant')");
-            if (pstmt) {
-                pstmt->setString(1, tableID);
-                pstmt->setString(2, tableNumber);
-                pstmt->setInt(3, capacity);
-                pstmt->executeUpdate();
+            string tableID;
+            bool added = db.transaction("addTable", [&]() {
+                string existingNumber;
+                string existingID = tableNumbers.findStored(db, tableNumber, &existingNumber);
+                if (!existingID.empty()) {
+                    cout << "[FAILED] Table number '" << existingNumber
+                         << "' already exists! (ID: " << existingID << ")" << endl;
+                    return false;
+                }
+                tableID = generateTableID();
+                auto pstmt = db.prepareStatement(
+                    "INSERT INTO Tables (TableID, Table_number, Capacity, Status) "
+                    "VALUES (?, ?, ?, 'Vacant')");
+                if (pstmt) {
+                    pstmt->setString(1, tableID);
+                    pstmt->setString(2, tableNumber);
+                    pstmt->setInt(3, capacity);
+                    pstmt->executeUpdate();
+                    return true;
+                }
+                return false;
+            });
+
+            if (added) {
+                tableNumbers.insert(tableID, tableNumber);
                 cout << "[SUCCESS] Table added with ID: " << tableID << endl;
-                return true;
             }
-            return false;
+            return added;
         }
         catch (sql::SQLException& e) {
+            if (tableNumbers.rejected(e)) {
+                tableNumbers.invalidate();
+                cout << "[FAILED] Table number '" << tableNumber << "' already exists!" << endl;
+                return false;
+            }
+            if (e.getErrorCode() == MYSQL_DUPLICATE_ENTRY) {
+                cout << "[FAILED] Another terminal added a table at the same time! Please try again." << endl;
+                return false;
+            }
             cerr << "Error adding table: " << e.what() << endl;
             return false;
         }
     }
 
     // Update table status
-    bool updateTableStatus(const string& tableID, const string& status) {
+    bool updateTableStatus(const string& tableID, TableStatus status) {
+        MODULE_SPAN("TableModule", "updateTableStatus");
+        if (OrderJournal* j = offline()) return j->updateTableStatus(tableID, status);
         try {
-            // Convert input to lowercase for case-insensitive comparison
-            string statusLower = status;
-            transform(statusLower.begin(), statusLower.end(), statusLower.begin(), ::tolower);
-            
-            // Normalize to proper case format
-            string normalizedStatus;
-            if (statusLower == "vacant") {
-                normalizedStatus = "Vacant";
-            }
-            else if (statusLower == "occupied") {
-                normalizedStatus = "Occupied";
-            }
-            else if (statusLower == "reserved") {
-                normalizedStatus = "Reserved";
-            }
-            else {
+            if (status == TableStatus::Unknown) {
                 cout << "[FAILED] Invalid status! Use 'Vacant', 'Occupied', or 'Reserved'." << endl;
                 return false;
             }
 
-            // Business rule: Vacant tables cannot have active orders (check when setting to Vacant)
-            if (normalizedStatus == "Vacant") {
-                auto checkStmt = db.prepareStatement(
-                    "SELECT OrderID FROM Orders WHERE TableID = ? AND Order_status = 'Active'");
-                if (checkStmt) {
-                    checkStmt->setString(1, tableID);
-                    auto checkRes = checkStmt->executeQuery();
-                    if (checkRes->next()) {
-                        cout << "[FAILED] Cannot set to Vacant! Table has an active order." << endl;
+            bool updated = db.transaction("updateTableStatus", [&]() {
+                // Updated first: the row lock keeps createOrder (which locks
+                // it too) from opening an order until the check below is done
+                auto pstmt = db.prepareStatement("UPDATE Tables SET Status = ? WHERE TableID = ?");
+                if (pstmt) {
+                    pstmt->setString(1, toString(status));
+                    pstmt->setString(2, tableID);
+                    if (pstmt->executeUpdate() == 0) {
+                        cout << "[FAILED] Table not found!" << endl;
                         return false;
                     }
                 }
-            }
 
-            auto pstmt = db.prepareStatement("UPDATE Tables SET Status = ? WHERE TableID = ?");
-            if (pstmt) {
-                pstmt->setString(1, normalizedStatus);
-                pstmt->setString(2, tableID);
-                int result = pstmt->executeUpdate();
-                if (result > 0) {
-                    cout << "[SUCCESS] Table status updated to " << normalizedStatus << endl;
-                    return true;
-                }
-                else {
-                    cout << "[FAILED] Table not found!" << endl;
+                // Business rule: Vacant tables cannot have active orders (check when setting to Vacant)
+                if (status == TableStatus::Vacant) {
+                    auto checkStmt = db.prepareStatement(
+                        "SELECT OrderID FROM Orders WHERE TableID = ? AND Order_status = 'Active'");
+                    if (checkStmt) {
+                        checkStmt->setString(1, tableID);
+                        auto checkRes = checkStmt->executeQuery();
+                        if (checkRes->next()) {
+                            cout << "[FAILED] Cannot set to Vacant! Table has an active order." << endl;
+                            return false;
+                        }
+                    }
                 }
+                return true;
+            });
+
+            if (updated) {
+                db.afterCommit([status]() {
+                    cout << "[SUCCESS] Table status updated to " << toString(status) << endl;
+                });
             }
-            return false;
+            return updated;
         }
         catch (sql::SQLException& e) {
             cerr << "Error updating status: " << e.what() << endl;
@@ -199,8 +227,14 @@ public:
         }
     }
 
+    // Update table status from user input (case-insensitive)
+    bool updateTableStatus(const string& tableID, const string& status) {
+        return updateTableStatus(tableID, parseEnum<TableStatus>(status));
+    }
+
     // Update table capacity
     bool updateTableCapacity(const string& tableID, int newCapacity) {
+        MODULE_SPAN("TableModule", "updateTableCapacity");
         try {
             if (newCapacity < 1) {
                 cout << "[FAILED] Capacity must be at least 1!" << endl;
@@ -211,14 +245,11 @@ public:
             if (pstmt) {
                 pstmt->setInt(1, newCapacity);
                 pstmt->setString(2, tableID);
-                int result = pstmt->executeUpdate();
-                if (result > 0) {
+                if (pstmt->executeUpdate() > 0) {
                     cout << "[SUCCESS] Table capacity updated to " << newCapacity << endl;
                     return true;
                 }
-                else {
-                    cout << "[FAILED] Table not found!" << endl;
-                }
+                cout << "[FAILED] Table not found!" << endl;
             }
             return false;
         }
@@ -230,31 +261,35 @@ public:
 
     // Delete table
     bool deleteTable(const string& tableID) {
+        MODULE_SPAN("TableModule", "deleteTable");
         try {
-            // Check if table has orders
-            auto checkStmt = db.prepareStatement("SELECT OrderID FROM Orders WHERE TableID = ?");
-            if (checkStmt) {
-                checkStmt->setString(1, tableID);
-                auto checkRes = checkStmt->executeQuery();
-                if (checkRes->next()) {
-                    cout << "[FAILED] Cannot delete table with existing orders!" << endl;
-                    return false;
+            bool deleted = db.transaction("deleteTable", [&]() {
+                // Check if table has orders (archived ones included)
+                auto checkStmt = db.prepareStatement(
+                    "SELECT OrderID FROM " + archive.allRows("Orders") + " WHERE TableID = ? LIMIT 1");
+                if (checkStmt) {
+                    checkStmt->setString(1, tableID);
+                    auto checkRes = checkStmt->executeQuery();
+                    if (checkRes->next()) {
+                        cout << "[FAILED] Cannot delete table with existing orders!" << endl;
+                        return false;
+                    }
                 }
-            }
 
-            auto pstmt = db.prepareStatement("DELETE FROM Tables WHERE TableID = ?");
-            if (pstmt) {
-                pstmt->setString(1, tableID);
-                int result = pstmt->executeUpdate();
-                if (result > 0) {
-                    cout << "[SUCCESS] Table deleted successfully!" << endl;
-                    return true;
-                }
-                else {
+                auto pstmt = db.prepareStatement("DELETE FROM Tables WHERE TableID = ?");
+                if (pstmt) {
+                    pstmt->setString(1, tableID);
+                    if (pstmt->executeUpdate() > 0) return true;
                     cout << "[FAILED] Table not found!" << endl;
                 }
+                return false;
+            });
+
+            if (deleted) {
+                tableNumbers.eraseID(tableID);
+                cout << "[SUCCESS] Table deleted successfully!" << endl;
             }
-            return false;
+            return deleted;
         }
         catch (sql::SQLException& e) {
             cerr << "Error deleting table: " << e.what() << endl;
@@ -264,46 +299,36 @@ public:
 
     // Check if table can accept orders (Occupied or Reserved)
     bool canAcceptOrder(const string& tableID) {
-        try {
-            auto pstmt = db.prepareStatement(
-                "SELECT Status FROM Tables WHERE TableID = ?");
-            if (pstmt) {
-                pstmt->setString(1, tableID);
-                auto res = pstmt->executeQuery();
-                if (res->next()) {
-                    string status = res->getString("Status");
-                    return (status == "Occupied" || status == "Reserved");
-                }
-            }
-            return false;
-        }
-        catch (sql::SQLException& e) {
-            cerr << "Error checking table: " << e.what() << endl;
-            return false;
-        }
+        MODULE_SPAN("TableModule", "canAcceptOrder");
+        return acceptsOrders(getTableStatus(tableID));
     }
 
-    // Get table status
-    string getTableStatus(const string& tableID) {
+    // Get table status (Unknown if the table does not exist)
+    TableStatus getTableStatus(const string& tableID) {
+        MODULE_SPAN("TableModule", "getTableStatus");
+        if (OrderJournal* j = offline()) return j->tableStatus(tableID);
         try {
-            auto pstmt = db.prepareStatement("SELECT Status FROM Tables WHERE TableID = ?");
+            auto pstmt = db.prepareStatement(
+                "SELECT " + sqlField<TableStatus>("Status") + " AS Status FROM Tables WHERE TableID = ?");
             if (pstmt) {
                 pstmt->setString(1, tableID);
                 auto res = pstmt->executeQuery();
                 if (res->next()) {
-                    return res->getString("Status");
+                    return getEnum<TableStatus>(*res, "Status");
                 }
             }
-            return "";
+            return TableStatus::Unknown;
         }
         catch (sql::SQLException& e) {
             cerr << "Error getting status: " << e.what() << endl;
-            return "";
+            return TableStatus::Unknown;
         }
     }
 
     // Check if table has active order
     bool hasActiveOrder(const string& tableID) {
+        MODULE_SPAN("TableModule", "hasActiveOrder");
+        if (OrderJournal* j = offline()) return !j->activeOrderForTable(tableID).empty();
         try {
             auto pstmt = db.prepareStatement(
                 "SELECT OrderID FROM Orders WHERE TableID = ? AND Order_status = 'Active'");
@@ -0,0 +1,424 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <iostream>
+#include <streambuf>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <cstdlib>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <conio.h>
+#include <io.h>
+#else
+#include <termios.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#endif
+
+using namespace std;
+
+// Console screen handling for the interactive menus.
+//
+// Once installed, everything written to cout and cerr after clearScreen()
+// is collected as one frame instead of going straight to the terminal. The
+// frame is drawn when the program next waits for input (cin is tied to a
+// stream that triggers it) or when present() is called. Drawing compares
+// the frame line by line with the previous one and rewrites only the rows
+// that changed, using ANSI cursor positioning, so a menu that is redrawn
+// with one new line costs one line of output instead of a cleared screen
+// and a spawned shell.
+//
+// Rows the terminal may have changed behind our back are never reused: the
+// prompt row (where input was echoed) and everything below it, and the
+// whole screen once output since the last frame may have scrolled it.
+// Frames taller or wider than the window are drawn in full.
+//
+// Output that is not a TTY is left untouched, so piped and scripted runs
+// see exactly what the program writes.
+class Terminal {
+public:
+    static const int NoKey = -1;
+    static const int OtherKey = 0;       // arrows, function keys, ...
+    static const int Enter = '\n';
+    static const int Backspace = '\b';
+    static const int Escape = 27;
+
+private:
+    // Routes cout/cerr writes into the current frame
+    class FrameBuf : public streambuf {
+    private:
+        Terminal& terminal;
+
+    protected:
+        int overflow(int c) override {
+            if (c != EOF) {
+                char ch = (char)c;
+                terminal.write(&ch, 1);
+            }
+            return c;
+        }
+
+        streamsize xsputn(const char* s, streamsize n) override {
+            terminal.write(s, (size_t)n);
+            return n;
+        }
+
+        int sync() override {
+            terminal.flushPassthrough();
+            return 0;
+        }
+
+    public:
+        explicit FrameBuf(Terminal& owner) : terminal(owner) {}
+    };
+
+    // cin's tie: flushed by the stream before every read
+    class InputTieBuf : public streambuf {
+    private:
+        Terminal& terminal;
+
+    protected:
+        int overflow(int c) override { return c; }
+
+        int sync() override {
+            terminal.beforeInput();
+            return 0;
+        }
+
+    public:
+        explicit InputTieBuf(Terminal& owner) : terminal(owner) {}
+    };
+
+    bool installed = false;
+    bool outputIsTty = false;
+    bool inputIsTty = false;
+    bool errorIsTty = false;
+    bool ansi = false;
+
+    FrameBuf frameBuf{ *this };
+    InputTieBuf inputTieBuf{ *this };
+    ostream inputTie{ &inputTieBuf };
+    streambuf* target = nullptr;          // the real stdout buffer
+    streambuf* savedCerr = nullptr;
+    ostream* savedTie = nullptr;
+
+    bool framing = false;
+    string frame;                         // text written since clearScreen()
+    vector<string> shown;                 // rows of the last frame drawn
+    bool shownValid = false;
+    size_t rowsSincePresent = 0;          // newlines written (or typed) after it
+
+    Terminal() {
+#ifdef _WIN32
+        outputIsTty = _isatty(_fileno(stdout)) != 0;
+        inputIsTty = _isatty(_fileno(stdin)) != 0;
+        errorIsTty = _isatty(_fileno(stderr)) != 0;
+#else
+        outputIsTty = isatty(STDOUT_FILENO) != 0;
+        inputIsTty = isatty(STDIN_FILENO) != 0;
+        errorIsTty = isatty(STDERR_FILENO) != 0;
+#endif
+        ansi = outputIsTty && enableAnsi();
+    }
+
+    static bool enableAnsi() {
+#ifdef _WIN32
+        HANDLE out = GetStdHandle(STD_OUTPUT_HANDLE);
+        DWORD mode = 0;
+        if (out == INVALID_HANDLE_VALUE || !GetConsoleMode(out, &mode)) return false;
+        return SetConsoleMode(out, mode | 0x0004 /* ENABLE_VIRTUAL_TERMINAL_PROCESSING */) != 0;
+#else
+        const char* term = getenv("TERM");
+        return !(term && string(term) == "dumb");
+#endif
+    }
+
+    void windowSize(size_t& rows, size_t& columns) const {
+        rows = 24;
+        columns = 80;
+#ifdef _WIN32
+        CONSOLE_SCREEN_BUFFER_INFO info;
+        if (GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &info)) {
+            rows = (size_t)(info.srWindow.Bottom - info.srWindow.Top + 1);
+            columns = (size_t)(info.srWindow.Right - info.srWindow.Left + 1);
+        }
+#else
+        winsize size;
+        if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_row > 0 && size.ws_col > 0) {
+            rows = size.ws_row;
+            columns = size.ws_col;
+        }
+#endif
+    }
+
+    static vector<string> splitRows(const string& text) {
+        vector<string> rows;
+        size_t start = 0;
+        while (true) {
+            size_t end = text.find('\n', start);
+            if (end == string::npos) {
+                rows.push_back(text.substr(start));
+                return rows;
+            }
+            rows.push_back(text.substr(start, end - start));
+            start = end + 1;
+        }
+    }
+
+    // A row whose on-screen width we can predict from its length
+    static bool plainRow(const string& row, size_t columns) {
+        if (row.size() >= columns) return false;
+        for (char c : row) {
+            if (c == '\r' || c == '\t' || c == '\b' || c == '\x1b') return false;
+        }
+        return true;
+    }
+
+    void emit(const string& text) {
+        target->sputn(text.data(), (streamsize)text.size());
+        target->pubsync();
+    }
+
+    void write(const char* s, size_t n) {
+        if (framing) {
+            frame.append(s, n);
+            return;
+        }
+        for (size_t i = 0; i < n; i++) {
+            if (s[i] == '\n') rowsSincePresent++;
+        }
+        target->sputn(s, (streamsize)n);
+    }
+
+    void flushPassthrough() {
+        if (!framing) target->pubsync();
+    }
+
+    void beforeInput() {
+        if (framing) present();
+        else target->pubsync();
+        rowsSincePresent++;               // the user's Enter
+    }
+
+    static void clearWithoutAnsi() {
+#ifdef _WIN32
+        HANDLE out = GetStdHandle(STD_OUTPUT_HANDLE);
+        CONSOLE_SCREEN_BUFFER_INFO info;
+        if (!GetConsoleScreenBufferInfo(out, &info)) return;
+        DWORD cells = (DWORD)info.dwSize.X * (DWORD)info.dwSize.Y;
+        DWORD written = 0;
+        COORD home = { 0, 0 };
+        FillConsoleOutputCharacterA(out, ' ', cells, home, &written);
+        FillConsoleOutputAttribute(out, info.wAttributes, cells, home, &written);
+        SetConsoleCursorPosition(out, home);
+#endif
+    }
+
+public:
+    static Terminal& instance() {
+        static Terminal terminal;
+        return terminal;
+    }
+
+    Terminal(const Terminal&) = delete;
+    Terminal& operator=(const Terminal&) = delete;
+
+    // True when stdin and stdout are both a terminal
+    bool isInteractive() const { return inputIsTty && outputIsTty; }
+
+    // Start collecting cout/cerr into frames (no-op unless stdout is an
+    // ANSI-capable terminal)
+    void install() {
+        if (installed || !ansi) return;
+        cout.flush();
+        target = cout.rdbuf(&frameBuf);
+        // Errors join the frame so they stay in order, unless stderr is redirected
+        if (errorIsTty) savedCerr = cerr.rdbuf(&frameBuf);
+        savedTie = cin.tie(&inputTie);
+        installed = true;
+    }
+
+    // Draw anything pending and give cout/cerr back their own buffers
+    void uninstall() {
+        if (!installed) return;
+        if (framing) present();
+        cin.tie(savedTie);
+        if (savedCerr) cerr.rdbuf(savedCerr);
+        savedCerr = nullptr;
+        cout.rdbuf(target);
+        installed = false;
+    }
+
+    // Begin a new screen. The old one stays visible until the new frame is
+    // drawn over it.
+    void clearScreen() {
+        if (!installed) {
+            if (outputIsTty) {
+                cout.flush();
+                clearWithoutAnsi();
+            }
+            return;
+        }
+        if (framing) present();
+        framing = true;
+        frame.clear();
+    }
+
+    // Draw the current frame now (it is drawn on the next read otherwise)
+    void present() {
+        if (!installed || !framing) {
+            cout.flush();
+            return;
+        }
+        framing = false;
+
+        size_t height, width;
+        windowSize(height, width);
+        vector<string> rows = splitRows(frame);
+        frame.clear();
+
+        // Rows above the previous prompt are still on screen unless later
+        // output scrolled them away
+        size_t reusable = 0;
+        if (shownValid && shown.size() + rowsSincePresent <= height) {
+            reusable = shown.size() - 1;
+        }
+        bool fits = rows.size() <= height;
+        size_t bytes = 16;
+        for (const string& row : rows) {
+            if (!plainRow(row, width)) fits = false;
+            bytes += row.size() + 12;
+        }
+
+        string out;
+        out.reserve(bytes);
+        if (!fits || reusable == 0) {
+            out += "\x1b[H\x1b[2J";
+            for (size_t i = 0; i < rows.size(); i++) {
+                if (i > 0) out += '\n';
+                out += rows[i];
+            }
+        }
+        else {
+            for (size_t i = 0; i < rows.size(); i++) {
+                bool last = i + 1 == rows.size();
+                if (!last && i < reusable && shown[i] == rows[i]) continue;
+                out += "\x1b[" + to_string(i + 1) + ";1H";
+                out += rows[i];
+                out += last ? "\x1b[J" : "\x1b[K";
+            }
+        }
+        emit(out);
+
+        shownValid = fits;
+        shown = move(rows);
+        rowsSincePresent = 0;
+    }
+
+    // Wait up to timeoutMs (-1 = forever) for one key press without echo.
+    // Returns NoKey on timeout, Enter, Backspace, Escape, OtherKey for
+    // non-character keys, or the character.
+    int readKey(int timeoutMs = -1) {
+        // Echo is off, so nothing typed here moves the cursor
+        if (installed) present();
+        else cout.flush();
+        return pollKey(timeoutMs);
+    }
+
+    // readKey without drawing anything first, so a second thread can watch
+    // the keyboard while the main one is busy (see EscapeWatch)
+    int pollKey(int timeoutMs) {
+#ifdef _WIN32
+        auto deadline = chrono::steady_clock::now() + chrono::milliseconds(timeoutMs < 0 ? 0 : timeoutMs);
+        while (timeoutMs >= 0 && !_kbhit()) {
+            if (chrono::steady_clock::now() >= deadline) return NoKey;
+            this_thread::sleep_for(chrono::milliseconds(15));
+        }
+        int c = _getch();
+        if (c == 0 || c == 224) {
+            _getch();
+            return OtherKey;
+        }
+        if (c == '\r') return Enter;
+        if (c == 8) return Backspace;
+        return c;
+#else
+        if (!inputIsTty) {
+            if (timeoutMs >= 0) {
+                pollfd fd = { STDIN_FILENO, POLLIN, 0 };
+                if (poll(&fd, 1, timeoutMs) <= 0) return NoKey;
+            }
+            int c = cin.get();
+            return c == EOF ? NoKey : c;
+        }
+
+        termios saved;
+        tcgetattr(STDIN_FILENO, &saved);
+        termios raw = saved;
+        raw.c_lflag &= ~(tcflag_t)(ICANON | ECHO);
+        raw.c_cc[VMIN] = 1;
+        raw.c_cc[VTIME] = 0;
+        tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+
+        int key = NoKey;
+        pollfd fd = { STDIN_FILENO, POLLIN, 0 };
+        if (poll(&fd, 1, timeoutMs) > 0) {
+            unsigned char c = 0;
+            if (read(STDIN_FILENO, &c, 1) == 1) {
+                key = c;
+                if (c == '\r' || c == '\n') key = Enter;
+                else if (c == 127 || c == 8) key = Backspace;
+                else if (c == 27) {
+                    // Swallow the rest of an escape sequence (arrow keys etc.)
+                    bool sequence = false;
+                    while (poll(&fd, 1, 10) > 0 && read(STDIN_FILENO, &c, 1) == 1) sequence = true;
+                    key = sequence ? OtherKey : Escape;
+                }
+            }
+        }
+        tcsetattr(STDIN_FILENO, TCSANOW, &saved);
+        return key;
+#endif
+    }
+};
+
+// Calls onEscape on a background thread if Esc is pressed while the watch
+// is alive, so work blocking the main thread (a long report) can be
+// abandoned. Does nothing unless stdin and stdout are a terminal.
+class EscapeWatch {
+private:
+    atomic<bool> stopping{ false };
+    thread watcher;
+
+public:
+    explicit EscapeWatch(function<void()> onEscape) {
+        if (!Terminal::instance().isInteractive()) return;
+        watcher = thread([this, onEscape]() {
+            while (!stopping.load()) {
+                if (Terminal::instance().pollKey(100) == Terminal::Escape) {
+                    onEscape();
+                    return;
+                }
+            }
+        });
+    }
+
+    ~EscapeWatch() {
+        stopping = true;
+        if (watcher.joinable()) watcher.join();
+    }
+
+    EscapeWatch(const EscapeWatch&) = delete;
+    EscapeWatch& operator=(const EscapeWatch&) = delete;
+};
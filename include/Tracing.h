@@ -0,0 +1,203 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+
+using namespace std;
+
+// Lightweight span tracing written out as Chrome trace-event JSON
+// (load the file in chrome://tracing or Perfetto).
+//
+//   TRACE_SPAN("OrderModule", "createOrder");
+//
+// records a complete event covering the rest of the enclosing scope.
+// When tracing is off a span costs one relaxed atomic load. When it is on,
+// events go into a fixed-size ring buffer owned by the recording thread,
+// and the oldest events are overwritten once the buffer is full.
+
+struct TraceEvent {
+    const char* category;
+    const char* name;
+    long long startUs;
+    long long durationUs;
+    char detail[120];   // e.g. the SQL text, truncated
+};
+
+class TraceBuffer {
+private:
+    vector<TraceEvent> events;
+    size_t next = 0;
+    bool wrapped = false;
+    mutex lock;   // only contended while a trace is being written out
+
+public:
+    const unsigned threadID;
+
+    TraceBuffer(size_t capacity, unsigned id) : events(capacity), threadID(id) {}
+
+    void record(const char* category, const char* name, long long startUs, long long durationUs,
+        const char* detail) {
+        lock_guard<mutex> guard(lock);
+        TraceEvent& e = events[next];
+        e.category = category;
+        e.name = name;
+        e.startUs = startUs;
+        e.durationUs = durationUs;
+        if (detail) {
+            strncpy(e.detail, detail, sizeof(e.detail) - 1);
+            e.detail[sizeof(e.detail) - 1] = '\0';
+        }
+        else {
+            e.detail[0] = '\0';
+        }
+        if (++next == events.size()) {
+            next = 0;
+            wrapped = true;
+        }
+    }
+
+    // Events oldest first
+    vector<TraceEvent> snapshot() {
+        lock_guard<mutex> guard(lock);
+        vector<TraceEvent> out;
+        if (wrapped) out.insert(out.end(), events.begin() + next, events.end());
+        out.insert(out.end(), events.begin(), events.begin() + next);
+        return out;
+    }
+};
+
+class Tracer {
+private:
+    atomic<bool> enabled;
+    size_t capacity = 16384;
+    mutex registryLock;
+    vector<shared_ptr<TraceBuffer>> buffers;
+    chrono::steady_clock::time_point epoch;
+
+    Tracer() : enabled(false), epoch(chrono::steady_clock::now()) {}
+
+    static void appendEscaped(string& out, const char* text) {
+        for (const char* p = text; *p; p++) {
+            unsigned char c = (unsigned char)*p;
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += (char)c;
+            }
+            else if (c < 0x20) {
+                out += ' ';
+            }
+            else {
+                out += (char)c;
+            }
+        }
+    }
+
+public:
+    static Tracer& instance() {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    // Start recording. capacityPerThread is the ring size for each thread.
+    void enable(size_t capacityPerThread = 16384) {
+        capacity = capacityPerThread;
+        enabled.store(true, memory_order_relaxed);
+    }
+
+    void disable() { enabled.store(false, memory_order_relaxed); }
+
+    bool isEnabled() const { return enabled.load(memory_order_relaxed); }
+
+    long long nowUs() const {
+        return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - epoch).count();
+    }
+
+    // Ring buffer of the calling thread, created on first use
+    TraceBuffer& threadBuffer() {
+        thread_local shared_ptr<TraceBuffer> buffer;
+        if (!buffer) {
+            lock_guard<mutex> guard(registryLock);
+            buffer = make_shared<TraceBuffer>(capacity, (unsigned)buffers.size() + 1);
+            buffers.push_back(buffer);
+        }
+        return *buffer;
+    }
+
+    // Write every thread's events as a Chrome trace-event JSON file
+    bool writeChromeTrace(const string& path) {
+        vector<shared_ptr<TraceBuffer>> all;
+        {
+            lock_guard<mutex> guard(registryLock);
+            all = buffers;
+        }
+
+        ofstream out(path);
+        if (!out) return false;
+
+        string json;
+        json.reserve(1 << 20);
+        json += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        bool first = true;
+        char number[64];
+        for (const auto& buffer : all) {
+            for (const TraceEvent& e : buffer->snapshot()) {
+                if (!first) json += ",\n";
+                first = false;
+                json += "{\"ph\":\"X\",\"pid\":1,\"tid\":";
+                json += to_string(buffer->threadID);
+                json += ",\"cat\":\"";
+                appendEscaped(json, e.category);
+                json += "\",\"name\":\"";
+                appendEscaped(json, e.name);
+                snprintf(number, sizeof(number), "\",\"ts\":%lld,\"dur\":%lld", e.startUs, e.durationUs);
+                json += number;
+                if (e.detail[0]) {
+                    json += ",\"args\":{\"detail\":\"";
+                    appendEscaped(json, e.detail);
+                    json += "\"}";
+                }
+                json += "}";
+            }
+        }
+        json += "]}\n";
+        out.write(json.data(), (streamsize)json.size());
+        return (bool)out;
+    }
+};
+
+// Records one complete event for the lifetime of the object
+class TraceSpan {
+private:
+    const char* category;
+    const char* name;
+    const char* detail;
+    long long startUs;
+    bool active;
+
+public:
+    TraceSpan(const char* spanCategory, const char* spanName, const char* spanDetail = nullptr)
+        : category(spanCategory), name(spanName), detail(spanDetail), startUs(0),
+        active(Tracer::instance().isEnabled()) {
+        if (active) startUs = Tracer::instance().nowUs();
+    }
+
+    ~TraceSpan() {
+        if (!active) return;
+        Tracer& tracer = Tracer::instance();
+        long long endUs = tracer.nowUs();
+        tracer.threadBuffer().record(category, name, startUs, endUs - startUs, detail);
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SPAN(category, name) TraceSpan TRACE_CONCAT(traceSpan_, __LINE__)(category, name)
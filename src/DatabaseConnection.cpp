@@ -1,10 +1,119 @@
 #include "DatabaseConnection.h"
+#include <sstream>
+#include <thread>
+#include <cctype>
+#include <random>
+#include <algorithm>
+#include <cstdio>
+
+// Connection pool and statement metrics shared by every connection
+static Gauge& connectionsOpen() {
+    static Gauge& gauge = Metrics::instance().gauge(
+        "restaurant_db_connections_open", "Open database connections");
+    return gauge;
+}
+
+static Gauge& connectionsBusy() {
+    static Gauge& gauge = Metrics::instance().gauge(
+        "restaurant_db_connections_busy", "Database connections inside a DatabaseConnection call");
+    return gauge;
+}
+
+static Counter& statementsSent(const char* kind) {
+    static Counter& query = Metrics::instance().counter(
+        "restaurant_db_statements_total", "Statements issued; a prepared one counts once, when prepared", "kind=\"query\"");
+    static Counter& update = Metrics::instance().counter(
+        "restaurant_db_statements_total", "Statements issued; a prepared one counts once, when prepared", "kind=\"update\"");
+    static Counter& prepare = Metrics::instance().counter(
+        "restaurant_db_statements_total", "Statements issued; a prepared one counts once, when prepared", "kind=\"prepare\"");
+    static Counter& transaction = Metrics::instance().counter(
+        "restaurant_db_statements_total", "Statements issued; a prepared one counts once, when prepared", "kind=\"transaction\"");
+    return kind[0] == 'q' ? query : kind[0] == 'u' ? update : kind[0] == 't' ? transaction : prepare;
+}
+
+// Report and listing reads, by where reportConnection() sent them
+static Counter& reportReads(bool toReplica) {
+    static Counter& replica = Metrics::instance().counter(
+        "restaurant_db_report_reads_total", "Report and listing reads", "target=\"replica\"");
+    static Counter& primary = Metrics::instance().counter(
+        "restaurant_db_report_reads_total", "Report and listing reads", "target=\"primary\"");
+    return toReplica ? replica : primary;
+}
+
+static Gauge& replicaLagSeconds() {
+    static Gauge& gauge = Metrics::instance().gauge(
+        "restaurant_db_replica_lag_seconds", "Replica lag at the last check (-1 = unknown)");
+    return gauge;
+}
+
+// Statements stopped by their time limit or by a cancelled token
+static Counter& queriesInterrupted(bool timedOut) {
+    static Counter& timeout = Metrics::instance().counter(
+        "restaurant_db_queries_interrupted_total", "Statements stopped before finishing", "reason=\"timeout\"");
+    static Counter& cancelled = Metrics::instance().counter(
+        "restaurant_db_queries_interrupted_total", "Statements stopped before finishing", "reason=\"cancelled\"");
+    return timedOut ? timeout : cancelled;
+}
+
+// Transactions by how they ended, retries by cause
+static Counter& transactionsEnded(const char* result) {
+    static Counter& committed = Metrics::instance().counter(
+        "restaurant_db_transactions_total", "Transactions run through DatabaseConnection::transaction", "result=\"committed\"");
+    static Counter& rolledBack = Metrics::instance().counter(
+        "restaurant_db_transactions_total", "Transactions run through DatabaseConnection::transaction", "result=\"rolled_back\"");
+    static Counter& failed = Metrics::instance().counter(
+        "restaurant_db_transactions_total", "Transactions run through DatabaseConnection::transaction", "result=\"failed\"");
+    return result[0] == 'c' ? committed : result[0] == 'r' ? rolledBack : failed;
+}
+
+static Counter& transactionRetries(bool deadlock) {
+    static Counter& deadlocks = Metrics::instance().counter(
+        "restaurant_db_transaction_retries_total", "Transactions run again after a lock conflict", "reason=\"deadlock\"");
+    static Counter& lockWaits = Metrics::instance().counter(
+        "restaurant_db_transaction_retries_total", "Transactions run again after a lock conflict", "reason=\"lock_wait_timeout\"");
+    return deadlock ? deadlocks : lockWaits;
+}
+
+static Histogram& transactionSeconds() {
+    static Histogram& histogram = Metrics::instance().histogram(
+        "restaurant_db_transaction_duration_seconds", "Transaction time including retries and backoff");
+    return histogram;
+}
+
+// MySQL error codes for a transaction that lost a lock conflict
+static const int ER_LOCK_WAIT_TIMEOUT = 1205;
+static const int ER_LOCK_DEADLOCK = 1213;
+
+// MySQL error codes for a statement that did not run to completion
+static const int ER_QUERY_INTERRUPTED = 1317;
+static const int ER_QUERY_TIMEOUT = 3024;
+static const int ER_STATEMENT_TIMEOUT = 1969;   // MariaDB's max_statement_time
+
+// One line instead of the usual error dump: stopping was what was asked for
+void DatabaseConnection::reportInterrupted(const sql::SQLException& e) {
+    bool timedOut = e.getErrorCode() == ER_QUERY_TIMEOUT || e.getErrorCode() == ER_STATEMENT_TIMEOUT;
+    queriesInterrupted(timedOut).inc();
+    if (timedOut) {
+        cout << "[FAILED] Query stopped: it ran longer than its time limit." << endl;
+    }
+    else {
+        cout << "[INFO] Query cancelled." << endl;
+    }
+}
+
+// Marks the connection busy for the lifetime of a call
+struct BusyScope {
+    BusyScope() { connectionsBusy().inc(); }
+    ~BusyScope() { connectionsBusy().dec(); }
+};
 
 // Constructor
-DatabaseConnection::DatabaseConnection() : driver(nullptr) {
+DatabaseConnection::DatabaseConnection(bool verboseOutput) : driver(nullptr), verbose(verboseOutput) {
     try {
         driver = sql::mysql::get_mysql_driver_instance();
-        cout << "MySQL driver initialized successfully!" << endl;
+        if (verbose) {
+            clog << "MySQL driver initialized successfully!" << endl;
+        }
     }
     catch (sql::SQLException& e) {
         cerr << "Error initializing MySQL driver: " << e.what() << endl;
@@ -19,16 +128,19 @@ DatabaseConnection::~DatabaseConnection() {
 
 // Connect to database
 bool DatabaseConnection::connect() {
+    TraceSpan span("sql", "connect", server.c_str());
     try {
         if (driver == nullptr) {
             cerr << "MySQL driver not initialized!" << endl;
             return false;
         }
 
-        cout << "Attempting to connect to database..." << endl;
-        cout << "Server: " << server << endl;
-        cout << "Username: " << username << endl;
-        cout << "Database: " << database << endl;
+        if (verbose) {
+            cout << "Attempting to connect to database..." << endl;
+            cout << "Server: " << server << endl;
+            cout << "Username: " << username << endl;
+            cout << "Database: " << database << endl;
+        }
 
         // Create connection
         con.reset(driver->connect(server, username, password));
@@ -40,8 +152,12 @@ bool DatabaseConnection::connect() {
 
         // Set schema (database)
         con->setSchema(database);
+        connectionID = -1;
+        connectionsOpen().inc();
 
-        cout << "Successfully connected to database: " << database << endl;
+        if (verbose) {
+            cout << "Successfully connected to database: " << database << endl;
+        }
         return true;
     }
     catch (sql::SQLException& e) {
@@ -62,10 +178,14 @@ bool DatabaseConnection::connect() {
 
 // Disconnect from database
 void DatabaseConnection::disconnect() {
+    if (replica) replica->disconnect();
     try {
-        if (con != nullptr) {
+        if (con != nullptr && !con->isClosed()) {
             con->close();
-            cout << "Database connection closed." << endl;
+            connectionsOpen().dec();
+            if (verbose) {
+                cout << "Database connection closed." << endl;
+            }
         }
     }
     catch (sql::SQLException& e) {
@@ -73,6 +193,148 @@ void DatabaseConnection::disconnect() {
     }
 }
 
+// Quiet connect after a lost connection
+bool DatabaseConnection::reconnect() {
+    // Closing a dead connection and connect() both explain failures at
+    // length; callers print their own one line
+    ostringstream discarded;
+    streambuf* savedOut = cout.rdbuf(discarded.rdbuf());
+    streambuf* savedErr = cerr.rdbuf(discarded.rdbuf());
+    disconnect();
+    bool connected = connect();
+    cout.rdbuf(savedOut);
+    cerr.rdbuf(savedErr);
+    if (connected) lost = false;
+    return connected;
+}
+
+bool DatabaseConnection::connectionLost() const {
+    return lost;
+}
+
+void DatabaseConnection::setServer(const string& url) {
+    server = url;
+}
+
+void DatabaseConnection::setReplica(const string& url, int maxLagSeconds) {
+    replicaServer = url;
+    replicaMaxLag = maxLagSeconds;
+    replica.reset();
+    replicaUsable = false;
+    replicaCheckedAt = chrono::steady_clock::time_point();
+    replicaConnectTriedAt = chrono::steady_clock::time_point();
+}
+
+// Route a report to the replica or back to this connection
+DatabaseConnection& DatabaseConnection::reportConnection() {
+    if (replicaServer.empty()) return *this;
+
+    // Checked at most once a second, so a screen of reports costs one check
+    auto now = chrono::steady_clock::now();
+    bool firstCheck = replicaCheckedAt == chrono::steady_clock::time_point();
+    if (firstCheck || now - replicaCheckedAt >= chrono::seconds(1)) {
+        replicaCheckedAt = now;
+        bool usable = checkReplica();
+        if (!usable && (replicaUsable || firstCheck)) {
+            cerr << "[WARNING] Read replica unavailable or more than " << replicaMaxLag
+                << "s behind; reports use the primary." << endl;
+        }
+        replicaUsable = usable;
+    }
+    reportReads(replicaUsable).inc();
+    return replicaUsable ? *replica : *this;
+}
+
+// Report query with fallback to the primary
+unique_ptr<sql::ResultSet> DatabaseConnection::executeReport(const string& query) {
+    DatabaseConnection& reader = reportConnection();
+    unique_ptr<sql::ResultSet> res = reader.executeQuery(query);
+    if (!res && &reader != this) {
+        replicaUsable = false;
+        res = executeQuery(query);
+    }
+    return res;
+}
+
+// Report query within limits, with fallback to the primary on errors only
+unique_ptr<sql::ResultSet> DatabaseConnection::executeReport(const string& query, const QueryOptions& options) {
+    interrupted = false;
+    DatabaseConnection& reader = reportConnection();
+    unique_ptr<sql::ResultSet> res = reader.executeQuery(query, options);
+    if (!res && &reader != this) {
+        // Running a stopped report again elsewhere would undo the stop
+        if (reader.lastQueryInterrupted()) {
+            interrupted = true;
+            return nullptr;
+        }
+        replicaUsable = false;
+        res = executeQuery(query, options);
+    }
+    return res;
+}
+
+// Connect to the replica if needed and check that it is fresh enough
+bool DatabaseConnection::checkReplica() {
+    auto now = chrono::steady_clock::now();
+    if (!replica) {
+        replica.reset(new DatabaseConnection(false));
+        replica->setServer(replicaServer);
+    }
+
+    bool alive = false;
+    try {
+        alive = replica->isConnected() && replica->getConnection()->isValid();
+    }
+    catch (sql::SQLException&) {
+        alive = false;
+    }
+    if (!alive) {
+        // An unreachable replica is retried every 30 seconds, not on every report
+        if (replicaConnectTriedAt != chrono::steady_clock::time_point()
+            && now - replicaConnectTriedAt < chrono::seconds(30)) {
+            return false;
+        }
+        replicaConnectTriedAt = now;
+        if (!replica->reconnect()) return false;
+
+        // Anything routed here by mistake fails instead of writing to the copy
+        if (replica->executeUpdate("SET SESSION TRANSACTION READ ONLY") < 0) return false;
+    }
+
+    if (replicaMaxLag < 0) return true;
+    int lag = replica->replicationLag();
+    replicaLagSeconds().set(lag);
+    return lag >= 0 && lag <= replicaMaxLag;
+}
+
+// Seconds behind the replication source, from SHOW REPLICA STATUS
+int DatabaseConnection::replicationLag() {
+    if (!isConnected()) return -1;
+
+    // MySQL 8.0.22 renamed the statement and the column; older servers
+    // only know the old names
+    static const char* const forms[][2] = {
+        { "SHOW REPLICA STATUS", "Seconds_Behind_Source" },
+        { "SHOW SLAVE STATUS", "Seconds_Behind_Master" },
+    };
+    for (const auto& form : forms) {
+        TraceSpan span("sql", "replicationLag", form[0]);
+        try {
+            statementCount++;
+            statementsSent("query").inc();
+            unique_ptr<sql::Statement> stmt(con->createStatement());
+            unique_ptr<sql::ResultSet> res(stmt->executeQuery(form[0]));
+            // No row: not a replica. NULL: replication is stopped.
+            if (!res->next() || res->isNull(form[1])) return -1;
+            return res->getInt(form[1]);
+        }
+        catch (sql::SQLException&) {
+            // Unknown statement on this server version; try the older form
+        }
+    }
+    return -1;
+}
+
 // Check if connected
 bool DatabaseConnection::isConnected() {
     try {
@@ -91,16 +353,28 @@ sql::Connection* DatabaseConnection::getConnection() {
 
 // Execute query (SELECT)
 unique_ptr<sql::ResultSet> DatabaseConnection::executeQuery(const string& query) {
+    TraceSpan span("sql", "executeQuery", query.c_str());
     try {
         if (!isConnected()) {
+            if (throwErrors) throw sql::SQLException("Not connected to database");
             cerr << "Not connected to database!" << endl;
             return nullptr;
         }
 
+        statementCount++;
+        statementsSent("query").inc();
+        BusyScope busy;
         unique_ptr<sql::Statement> stmt(con->createStatement());
         return unique_ptr<sql::ResultSet>(stmt->executeQuery(query));
     }
     catch (sql::SQLException& e) {
+        interrupted = isInterrupted(e);
+        if (isConnectionError(e)) lost = true;
+        if (throwErrors) throw;
+        if (interrupted) {
+            reportInterrupted(e);
+            return nullptr;
+        }
         cerr << "Query execution error: " << e.what() << endl;
         cerr << "Error code: " << e.getErrorCode() << endl;
         cerr << "Failed query: " << query << endl;
@@ -110,16 +384,28 @@ unique_ptr<sql::ResultSet> DatabaseConnection::executeQuery(const string& query)
 
 // Execute update (INSERT, UPDATE, DELETE)
 int DatabaseConnection::executeUpdate(const string& query) {
+    TraceSpan span("sql", "executeUpdate", query.c_str());
     try {
         if (!isConnected()) {
+            if (throwErrors) throw sql::SQLException("Not connected to database");
             cerr << "Not connected to database!" << endl;
             return -1;
         }
 
+        statementCount++;
+        statementsSent("update").inc();
+        BusyScope busy;
         unique_ptr<sql::Statement> stmt(con->createStatement());
         return stmt->executeUpdate(query);
     }
     catch (sql::SQLException& e) {
+        interrupted = isInterrupted(e);
+        if (isConnectionError(e)) lost = true;
+        if (throwErrors) throw;
+        if (interrupted) {
+            reportInterrupted(e);
+            return -1;
+        }
         cerr << "Update execution error: " << e.what() << endl;
         cerr << "Error code: " << e.getErrorCode() << endl;
         cerr << "Failed query: " << query << endl;
@@ -129,15 +415,22 @@ int DatabaseConnection::executeUpdate(const string& query) {
 
 // Get prepared statement
 unique_ptr<sql::PreparedStatement> DatabaseConnection::prepareStatement(const string& query) {
+    TraceSpan span("sql", "prepareStatement", query.c_str());
     try {
         if (!isConnected()) {
+            if (throwErrors) throw sql::SQLException("Not connected to database");
             cerr << "Not connected to database!" << endl;
             return nullptr;
         }
 
+        statementCount++;
+        statementsSent("prepare").inc();
+        BusyScope busy;
         return unique_ptr<sql::PreparedStatement>(con->prepareStatement(query));
     }
     catch (sql::SQLException& e) {
+        if (isConnectionError(e)) lost = true;
+        if (throwErrors) throw;
         cerr << "Prepared statement error: " << e.what() << endl;
         cerr << "Error code: " << e.getErrorCode() << endl;
         cerr << "Failed query: " << query << endl;
@@ -145,6 +438,326 @@ unique_ptr<sql::PreparedStatement> DatabaseConnection::prepareStatement(const st
     }
 }
 
+// The server thread ID KILL QUERY needs, and whether the server is
+// MariaDB (for withTimeLimit), read once per connection
+void DatabaseConnection::loadServerInfo() {
+    if (connectionID >= 0 || !isConnected()) return;
+    try {
+        statementCount++;
+        statementsSent("query").inc();
+        unique_ptr<sql::Statement> stmt(con->createStatement());
+        unique_ptr<sql::ResultSet> res(stmt->executeQuery("SELECT CONNECTION_ID(), VERSION()"));
+        if (res->next()) {
+            connectionID = res->getInt64(1);
+            mariaDB = string(res->getString(2)).find("MariaDB") != string::npos;
+        }
+    }
+    catch (sql::SQLException&) {
+        // Without it the statement still runs; it just cannot be killed
+    }
+}
+
+// SELECT within a time limit, stopped early if the token is cancelled
+unique_ptr<sql::ResultSet> DatabaseConnection::executeQuery(const string& query, const QueryOptions& options) {
+    interrupted = false;
+    try {
+        CancelScope scope(*this, options.cancel);
+        return executeQuery(withTimeLimit(query, options.timeout));
+    }
+    catch (sql::SQLException& e) {
+        // Only the scope throws here (or executeQuery in throw-on-error mode)
+        interrupted = isInterrupted(e);
+        if (isConnectionError(e)) lost = true;
+        if (throwErrors) throw;
+        if (interrupted) reportInterrupted(e);
+        else cerr << "Query execution error: " << e.what() << endl;
+        return nullptr;
+    }
+}
+
+bool DatabaseConnection::lastQueryInterrupted() const {
+    return interrupted;
+}
+
+// KILL QUERY for this connection's server thread, sent from a new connection
+bool DatabaseConnection::killRunningQuery() {
+    if (driver == nullptr || connectionID < 0) return false;
+
+    // The driver needs per-thread setup, and the caller (a key watcher,
+    // another worker) may not have done it; a thread of our own is always clean
+    bool sent = false;
+    thread killer([&]() {
+        driver->threadInit();
+        try {
+            unique_ptr<sql::Connection> side(driver->connect(server, username, password));
+            unique_ptr<sql::Statement> stmt(side->createStatement());
+            stmt->execute("KILL QUERY " + to_string(connectionID));
+            sent = true;
+        }
+        catch (sql::SQLException&) {
+            // The statement may simply have finished; nothing to stop
+        }
+        driver->threadEnd();
+    });
+    killer.join();
+    return sent;
+}
+
+// Add /*+ MAX_EXECUTION_TIME(ms) */ after the leading SELECT, or put
+// SET STATEMENT max_statement_time=seconds FOR in front of it on MariaDB
+string DatabaseConnection::withTimeLimit(const string& query, chrono::milliseconds timeout) {
+    if (timeout.count() <= 0) return query;
+    size_t start = 0;
+    while (start < query.size() && isspace((unsigned char)query[start])) start++;
+    static const string select = "SELECT";
+    if (query.size() - start < select.size()) return query;
+    for (size_t i = 0; i < select.size(); i++) {
+        if (toupper((unsigned char)query[start + i]) != select[i]) return query;
+    }
+    loadServerInfo();
+    if (mariaDB) {
+        char seconds[32];
+        snprintf(seconds, sizeof(seconds), "%.3f", timeout.count() / 1000.0);
+        return "SET STATEMENT max_statement_time=" + string(seconds) + " FOR " + query.substr(start);
+    }
+    size_t after = start + select.size();
+    return query.substr(0, after) + " /*+ MAX_EXECUTION_TIME(" + to_string(timeout.count()) + ") */"
+        + query.substr(after);
+}
+
+bool DatabaseConnection::isConnectionError(const sql::SQLException& e) {
+    switch (e.getErrorCode()) {
+    case 2002:   // CR_CONNECTION_ERROR
+    case 2003:   // CR_CONN_HOST_ERROR
+    case 2006:   // CR_SERVER_GONE_ERROR
+    case 2013:   // CR_SERVER_LOST
+    case 2055:   // CR_SERVER_LOST_EXTENDED
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool DatabaseConnection::isInterrupted(const sql::SQLException& e) {
+    return e.getErrorCode() == ER_QUERY_INTERRUPTED || e.getErrorCode() == ER_QUERY_TIMEOUT
+        || e.getErrorCode() == ER_STATEMENT_TIMEOUT;
+}
+
+void DatabaseConnection::setThrowOnError(bool enabled) {
+    throwErrors = enabled;
+}
+
+// Number of statements sent through this connection so far
+unsigned long long DatabaseConnection::getStatementCount() const {
+    return statementCount;
+}
+
+// Add one finished operation to the per-operation totals
+void DatabaseConnection::recordOperation(const string& operation, unsigned long long statements) {
+    OperationQueryStats& stats = operationStats[operation];
+    stats.calls++;
+    stats.statements += statements;
+    if (statements > stats.maxStatements) {
+        stats.maxStatements = statements;
+    }
+}
+
+const map<string, OperationQueryStats>& DatabaseConnection::getOperationStats() const {
+    return operationStats;
+}
+
+void DatabaseConnection::resetOperationStats() {
+    operationStats.clear();
+}
+
+// Transactions
+static const char* isolationName(IsolationLevel level) {
+    switch (level) {
+    case IsolationLevel::ReadUncommitted: return "READ UNCOMMITTED";
+    case IsolationLevel::ReadCommitted:   return "READ COMMITTED";
+    case IsolationLevel::RepeatableRead:  return "REPEATABLE READ";
+    case IsolationLevel::Serializable:    return "SERIALIZABLE";
+    default:                              return nullptr;
+    }
+}
+
+// Full jitter: a random wait up to base * 2^retry, capped at maxBackoff,
+// so tills that collided do not collide again on the same schedule
+static chrono::milliseconds retryDelay(const TransactionOptions& options, int retry) {
+    static thread_local mt19937 random(random_device{}());
+    long long ceiling = options.baseBackoff.count() << min(retry, 16);
+    ceiling = min<long long>(ceiling, options.maxBackoff.count());
+    if (ceiling <= 0) return chrono::milliseconds(0);
+    return chrono::milliseconds(uniform_int_distribution<long long>(0, ceiling)(random));
+}
+
+bool DatabaseConnection::transaction(const string& name, const function<bool()>& body,
+    const TransactionOptions& options) {
+    // Part of the caller's transaction: its commit or rollback decides
+    if (inTransaction) {
+        try {
+            return body();
+        }
+        catch (sql::SQLException& e) {
+            // A deadlock has already rolled back the whole transaction, so
+            // the outermost one must start again even if the module that
+            // called this catches the error and carries on
+            if (e.getErrorCode() == ER_LOCK_DEADLOCK || e.getErrorCode() == ER_LOCK_WAIT_TIMEOUT) {
+                nestedFailure = e.getErrorCode();
+            }
+            throw;
+        }
+    }
+    if (!isConnected()) {
+        if (throwErrors) throw sql::SQLException("Not connected to database");
+        cerr << "Not connected to database!" << endl;
+        return false;
+    }
+
+    TransactionStats& stats = transactionStats[name];
+    stats.calls++;
+    auto start = chrono::steady_clock::now();
+    auto finish = [&](const char* result) {
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        stats.totalMs += ms;
+        stats.maxMs = max(stats.maxMs, ms);
+        transactionSeconds().observeMicros((uint64_t)(ms * 1000));
+        transactionsEnded(result).inc();
+    };
+
+    // SET TRANSACTION, START TRANSACTION, COMMIT and ROLLBACK are round
+    // trips too, and count toward the caller's query budget. The session
+    // stays in autocommit mode, so a transaction costs only two of them.
+    auto control = [&](const string& sql) {
+        statementCount++;
+        statementsSent("transaction").inc();
+        unique_ptr<sql::Statement> stmt(con->createStatement());
+        stmt->execute(sql);
+    };
+
+    bool savedThrow = throwErrors;
+    // Roll back and restore the caller's error mode after a failed attempt
+    auto abandon = [&]() {
+        inTransaction = false;
+        nestedFailure = 0;
+        onCommit.clear();
+        throwErrors = savedThrow;
+        try {
+            control("ROLLBACK");
+        }
+        catch (sql::SQLException&) {
+        }
+    };
+    for (int attempt = 1;; attempt++) {
+        bool committed = false;
+        throwErrors = true;
+        inTransaction = true;
+        nestedFailure = 0;
+        onCommit.clear();
+        try {
+            // Applies to the next transaction on this session only
+            if (const char* level = isolationName(options.isolation)) {
+                control(string("SET TRANSACTION ISOLATION LEVEL ") + level);
+            }
+            control("START TRANSACTION");
+            bool keep = body();
+            if (nestedFailure) {
+                throw sql::SQLException("Transaction " + name + " was rolled back by the server", "40001", nestedFailure);
+            }
+            control(keep ? "COMMIT" : "ROLLBACK");
+            committed = keep;
+            inTransaction = false;
+            throwErrors = savedThrow;
+            if (committed) stats.committed++;
+            else stats.rolledBack++;
+            finish(committed ? "committed" : "rolled_back");
+            vector<function<void()>> actions;
+            actions.swap(onCommit);
+            if (committed) {
+                for (auto& action : actions) action();
+            }
+            return committed;
+        }
+        catch (sql::SQLException& e) {
+            if (isConnectionError(e)) lost = true;
+            // What a nested call swallowed caused whatever failed after it
+            int code = nestedFailure ? nestedFailure : e.getErrorCode();
+            abandon();
+
+            bool deadlock = code == ER_LOCK_DEADLOCK;
+            bool lockWait = code == ER_LOCK_WAIT_TIMEOUT;
+            if (deadlock) stats.deadlocks++;
+            if (lockWait) stats.lockWaitTimeouts++;
+            if ((deadlock || lockWait) && attempt < options.maxAttempts) {
+                stats.retries++;
+                transactionRetries(deadlock).inc();
+                this_thread::sleep_for(retryDelay(options, attempt - 1));
+                continue;
+            }
+            stats.failed++;
+            finish("failed");
+            if (code != e.getErrorCode()) {
+                throw sql::SQLException("Transaction " + name + " was rolled back by the server", "40001", code);
+            }
+            throw;
+        }
+        catch (...) {
+            // Anything else body throws (bad_alloc, a parse error, a
+            // caller's own exception) ends the transaction the same way
+            abandon();
+            stats.failed++;
+            finish("failed");
+            throw;
+        }
+    }
+}
+
+void DatabaseConnection::afterCommit(function<void()> action) {
+    if (inTransaction) onCommit.push_back(move(action));
+    else action();
+}
+
+bool DatabaseConnection::insideTransaction() const {
+    return inTransaction;
+}
+
+const map<string, TransactionStats>& DatabaseConnection::getTransactionStats() const {
+    return transactionStats;
+}
+
+void DatabaseConnection::resetTransactionStats() {
+    transactionStats.clear();
+}
+
+// Cancel scope
+static sql::SQLException cancelledError() {
+    return sql::SQLException("Query execution was interrupted", "70100", ER_QUERY_INTERRUPTED);
+}
+
+CancellationToken::Registration CancelScope::watch(DatabaseConnection& db, CancellationToken& token) {
+    if (token.isCancelled()) throw cancelledError();
+    db.loadServerInfo();
+    return token.onCancel([&db]() { db.killRunningQuery(); });
+}
+
+CancelScope::CancelScope(DatabaseConnection& db, CancellationToken token)
+    : registration(watch(db, token)) {
+    // Cancelled between the check and the registration
+    if (token.isCancelled()) throw cancelledError();
+}
+
+// Query tracker
+QueryTracker::QueryTracker(DatabaseConnection& database, const string& operationName)
+    : db(database), operation(operationName), start(database.getStatementCount()) {}
+
+QueryTracker::~QueryTracker() {
+    db.recordOperation(operation, count());
+}
+
+unsigned long long QueryTracker::count() const {
+    return db.getStatementCount() - start;
+}
+
 // Test connection with sample queries
 bool DatabaseConnection::testConnection() {
     try {
@@ -5,11 +5,26 @@
 #include "TableModule.h"
 #include "OrderModule.h"
 #include "BillingModule.h"
+#include "HeadlessRunner.h"
+#include "RushBenchmark.h"
+#include "FixtureGenerator.h"
+#include "QueryBudgets.h"
+#include "MetricsServer.h"
+#include "BulkImporter.h"
+#include "Snapshot.h"
+#include "Terminal.h"
+#include "QueryPool.h"
+#include "OrderJournal.h"
+#include "JournalReplay.h"
+#include "OrderArchive.h"
+#include "SalesSeries.h"
+#include "SchemaCheck.h"
 #include <iostream>
+#include <fstream>
+#include <vector>
 #include <limits>
 #include <string>
 #include <iomanip>
-#include <conio.h>  // For _getch() on Windows
 
 using namespace std;
 
@@ -21,6 +36,19 @@ MenuModule* menuModule = nullptr;
 TableModule* tableModule = nullptr;
 OrderModule* orderModule = nullptr;
 BillingModule* billingModule = nullptr;
+OrderJournal* orderJournal = nullptr;
+SalesSeries* salesSeries = nullptr;
+
+// Where the till keeps orders taken while the database is unreachable
+// (--journal PATH, "off" = take none)
+string journalPath = "restaurant_journal.log";
+
+// Where payments are recorded per minute for the sales trend
+// (--sales-series PATH, "off" = record none)
+string salesSeriesPath = "restaurant_sales.series";
+
+// Time limit for report queries (--report-timeout SECONDS, 0 = none)
+chrono::milliseconds reportTimeout = chrono::seconds(60);
 
 // Utility functions
 void clearInputBuffer() {
@@ -29,7 +57,7 @@ void clearInputBuffer() {
 }
 
 void clearScreen() {
-    system("cls");  // Clear screen on Windows
+    Terminal::instance().clearScreen();
 }
 
 void pressEnterToContinue() {
@@ -38,6 +66,20 @@ void pressEnterToContinue() {
     clearScreen();  // Clear screen after user presses enter
 }
 
+// Run a report from a menu within reportTimeout; Esc cancels it while it runs
+template <typename Report>
+void runCancellableReport(Report report) {
+    QueryOptions options;
+    options.timeout = reportTimeout;
+    if (Terminal::instance().isInteractive()) {
+        cout << "[INFO] Running report... press Esc to cancel." << endl;
+        Terminal::instance().present();
+    }
+    CancellationToken token = options.cancel;
+    EscapeWatch watch([token]() mutable { token.cancel(); });
+    report(options);
+}
+
 void printHeader(const string& title) {
     cout << "\n" << string(60, '=') << endl;
     cout << title << endl;
@@ -47,23 +89,29 @@ void printHeader(const string& title) {
 // Function to read password with masking (shows * instead of characters)
 string getHiddenPassword() {
     string password = "";
-    char ch;
-    
+    Terminal& terminal = Terminal::instance();
+
+    // Piped input: read a plain line
+    if (!terminal.isInteractive()) {
+        getline(cin, password);
+        return password;
+    }
+
     while (true) {
-        ch = _getch();  // Get character without echoing
+        int ch = terminal.readKey();  // Get character without echoing
         
-        if (ch == 13) {  // Enter key
+        if (ch == Terminal::Enter) {
             cout << endl;
             break;
         }
-        else if (ch == 8) {  // Backspace
+        else if (ch == Terminal::Backspace) {
             if (!password.empty()) {
                 password.pop_back();
                 cout << "\b \b";  // Move back, print space, move back again
             }
         }
         else if (ch >= 32 && ch <= 126) {  // Printable characters
-            password += ch;
+            password += (char)ch;
             cout << '*';  // Display asterisk
         }
     }
@@ -98,6 +146,21 @@ string getPasswordWithConfirmation() {
     } while (true);
 }
 
+// Ask for a CSV file and bulk import it
+void importFromCsv(ImportKind kind, const string& columns) {
+    string path;
+    cout << "CSV columns: " << columns << endl;
+    cout << "Enter CSV file path: ";
+    getline(cin, path);
+    if (path.size() >= 2 && path.front() == '"' && path.back() == '"') {
+        path = path.substr(1, path.size() - 2);
+    }
+
+    BulkImporter importer(db);
+    ImportReport report = importer.importFile(kind, path);
+    BulkImporter::printReport(report, cout);
+}
+
 // ============================================
 // LOGIN MENU
 // ============================================
@@ -126,7 +189,8 @@ void showAdminMainMenu() {
     cout << "5.  View All Bills" << endl;
     cout << "6.  Daily Sales Report" << endl;
     cout << "7.  View Daily Sales History" << endl;
-    cout << "8.  Logout" << endl;
+    cout << "8.  Sales Trend" << endl;
+    cout << "9.  Logout" << endl;
     cout << string(60, '-') << endl;
     cout << "Enter your choice: ";
 }
@@ -141,7 +205,8 @@ void adminStaffManagement() {
         cout << "3. Add New Staff" << endl;
         cout << "4. Update Staff Status" << endl;
         cout << "5. Delete Staff" << endl;
-        cout << "6. Back to Admin Menu" << endl;
+        cout << "6. Import Staff from CSV" << endl;
+        cout << "7. Back to Admin Menu" << endl;
         cout << string(60, '-') << endl;
         cout << "Enter your choice: ";
         cin >> choice;
@@ -191,11 +256,16 @@ void adminStaffManagement() {
             break;
         }
         case 6:
+            importFromCsv(ImportKind::Staff, "name, email, password [, address, status]");
+            staffModule->reloadIndexes();
+            pressEnterToContinue();
+            break;
+        case 7:
             break;
         default:
             cout << "Invalid choice!" << endl;
         }
-    } while (choice != 6);
+    } while (choice != 7);
 }
 
 void adminMenuManagement() {
@@ -211,7 +281,8 @@ void adminMenuManagement() {
         cout << "6. Update Price" << endl;
         cout << "7. Update Availability" << endl;
         cout << "8. Delete Menu Item" << endl;
-        cout << "9. Back to Admin Menu" << endl;
+        cout << "9. Import Menu from CSV" << endl;
+        cout << "10. Back to Admin Menu" << endl;
         cout << string(60, '-') << endl;
         cout << "Enter your choice: ";
         cin >> choice;
@@ -292,11 +363,16 @@ void adminMenuManagement() {
             break;
         }
         case 9:
+            importFromCsv(ImportKind::Menu, "name, price, category [, availability]");
+            menuModule->reloadIndexes();
+            pressEnterToContinue();
+            break;
+        case 10:
             break;
         default:
             cout << "Invalid choice!" << endl;
         }
-    } while (choice != 9);
+    } while (choice != 10);
 }
 
 void adminTableManagement() {
@@ -312,7 +388,8 @@ void adminTableManagement() {
         cout << "6. Update Table Status" << endl;
         cout << "7. Update Table Capacity" << endl;
         cout << "8. Delete Table" << endl;
-        cout << "9. Back to Admin Menu" << endl;
+        cout << "9. Import Tables from CSV" << endl;
+        cout << "10. Back to Admin Menu" << endl;
         cout << string(60, '-') << endl;
         cout << "Enter your choice: ";
         cin >> choice;
@@ -324,15 +401,15 @@ void adminTableManagement() {
             pressEnterToContinue();
             break;
         case 2:
-            tableModule->viewTablesByStatus("Vacant");
+            tableModule->viewTablesByStatus(TableStatus::Vacant);
             pressEnterToContinue();
             break;
         case 3:
-            tableModule->viewTablesByStatus("Occupied");
+            tableModule->viewTablesByStatus(TableStatus::Occupied);
             pressEnterToContinue();
             break;
         case 4:
-            tableModule->viewTablesByStatus("Reserved");
+            tableModule->viewTablesByStatus(TableStatus::Reserved);
             pressEnterToContinue();
             break;
         case 5: {
@@ -383,11 +460,16 @@ void adminTableManagement() {
             break;
         }
         case 9:
+            importFromCsv(ImportKind::Tables, "number, capacity [, status]");
+            tableModule->reloadIndexes();
+            pressEnterToContinue();
+            break;
+        case 10:
             break;
         default:
             cout << "Invalid choice!" << endl;
         }
-    } while (choice != 9);
+    } while (choice != 10);
 }
 
 void adminDashboard() {
@@ -409,11 +491,11 @@ void adminDashboard() {
             adminTableManagement();
             break;
         case 4:
-            orderModule->viewAllOrders();
+            runCancellableReport([](const QueryOptions& options) { orderModule->viewAllOrders(options); });
             pressEnterToContinue();
             break;
         case 5:
-            billingModule->viewAllBills();
+            runCancellableReport([](const QueryOptions& options) { billingModule->viewAllBills(options); });
             pressEnterToContinue();
             break;
         case 6: {
@@ -424,26 +506,50 @@ void adminDashboard() {
                 // Get current date
                 time_t now = time(0);
                 tm ltm;
+#ifdef _WIN32
                 localtime_s(&ltm, &now);
+#else
+                localtime_r(&now, &ltm);
+#endif
                 char buffer[11];
                 strftime(buffer, 11, "%Y-%m-%d", &ltm);
                 date = buffer;
             }
-            adminModule->generateDailySalesReport(date);
+            runCancellableReport([&date](const QueryOptions& options) {
+                adminModule->generateDailySalesReport(date, options);
+            });
             pressEnterToContinue();
             break;
         }
         case 7:
-            adminModule->viewAllDailySales();
+            runCancellableReport([](const QueryOptions& options) { adminModule->viewAllDailySales(options); });
             pressEnterToContinue();
             break;
-        case 8:
+        case 8: {
+            string fromDate, toDate;
+            string today = formatDateTime(localNow()).substr(0, 10);
+            cout << "From date (YYYY-MM-DD): ";
+            getline(cin, fromDate);
+            cout << "To date (YYYY-MM-DD) or press Enter for today: ";
+            getline(cin, toDate);
+            if (toDate.empty()) toDate = today;
+            cout << "Period: 1. 15 minutes  2. Hour  3. Day" << endl;
+            cout << "Enter choice: ";
+            int period;
+            cin >> period;
+            clearInputBuffer();
+            int bucketMinutes = period == 1 ? 15 : period == 2 ? 60 : 1440;
+            adminModule->viewSalesTrend(fromDate, toDate, bucketMinutes);
+            pressEnterToContinue();
+            break;
+        }
+        case 9:
             adminModule->logout();
             break;
         default:
             cout << "Invalid choice!" << endl;
         }
-    } while (choice != 8);
+    } while (choice != 9);
 }
 
 // ============================================
@@ -456,7 +562,7 @@ void showStaffMainMenu() {
     cout << "3.  Create New Order" << endl;
     cout << "4.  Add Items to Order" << endl;
     cout << "5.  View Order Details" << endl;
-    cout << "6.  View Active Orders" << endl;
+    cout << "6.  View Active Orders (live)" << endl;
     cout << "7.  Cancel Order" << endl;
     cout << "8.  Process Payment (Auto-generates bill if needed)" << endl;
     cout << "9.  View Unpaid Bills" << endl;
@@ -474,15 +580,15 @@ void staffCreateOrder() {
     getline(cin, tableID);
 
     // Check table status
-    string status = tableModule->getTableStatus(tableID);
-    if (status.empty()) {
+    TableStatus status = tableModule->getTableStatus(tableID);
+    if (status == TableStatus::Unknown) {
         cout << "[FAILED] Table not found!" << endl;
         return;
     }
 
-    if (status == "Vacant") {
+    if (status == TableStatus::Vacant) {
         cout << "[INFO] Table is vacant. Setting to Occupied..." << endl;
-        tableModule->updateTableStatus(tableID, "Occupied");
+        tableModule->updateTableStatus(tableID, TableStatus::Occupied);
     }
 
     // Check if table already has active order
@@ -595,6 +701,8 @@ void staffAddItemsToOrder() {
 
 void staffProcessPayment() {
     orderModule->viewActiveOrders();
+    // The checks, summary, bill and receipt below share one load of the order
+    OrderAggregateCache::Scope orderCache;
     cout << "\n--- PROCESS PAYMENT ---" << endl;
 
     string orderID;
@@ -613,6 +721,11 @@ void staffProcessPayment() {
         return;
     }
 
+    // The version of the order shown below (the one loaded above), so the
+    // bill is refused if another terminal changes it while the payment
+    // method is chosen
+    optional<RowVersion> shownVersion = orderModule->getOrderVersion(orderID);
+
     // Show order details first
     cout << "\n--- Order Summary ---" << endl;
     orderModule->viewOrderDetails(orderID);
@@ -634,22 +747,34 @@ void staffProcessPayment() {
         cin >> methodChoice;
         clearInputBuffer();
 
-        string paymentMethod;
+        PaymentMethod paymentMethod;
         switch (methodChoice) {
-        case 1: paymentMethod = "Cash"; break;
-        case 2: paymentMethod = "Card"; break;
-        case 3: paymentMethod = "E-Wallet"; break;
+        case 1: paymentMethod = PaymentMethod::Cash; break;
+        case 2: paymentMethod = PaymentMethod::Card; break;
+        case 3: paymentMethod = PaymentMethod::EWallet; break;
         default:
             cout << "[FAILED] Invalid payment method!" << endl;
             return;
         }
 
-        billID = billingModule->generateBill(orderID, staffModule->getStaffID(), paymentMethod);
+        WriteResult bill = billingModule->generateBill(orderID, staffModule->getStaffID(),
+            paymentMethod, shownVersion);
+        while (bill.conflict()) {
+            cout << "\n--- Updated Order ---" << endl;
+            orderModule->viewOrderDetails(orderID);
+            cout << "Generate the bill for the updated order? (Y/N): ";
+            char confirm;
+            cin >> confirm;
+            clearInputBuffer();
+            if (toupper(confirm) != 'Y') return;
+            bill = billingModule->generateBill(orderID, staffModule->getStaffID(), paymentMethod, bill.version);
+        }
         
-        if (billID.empty()) {
+        if (!bill) {
             cout << "[FAILED] Failed to generate bill!" << endl;
             return;
         }
+        billID = bill.id;
     } else {
         // Bill exists, show it
         cout << "\n--- Existing Bill ---" << endl;
@@ -666,9 +791,27 @@ void staffProcessPayment() {
     }
 }
 
+// Active orders, refreshed every few seconds until a key is pressed. Only
+// rows that changed are redrawn.
+void staffWatchActiveOrders() {
+    Terminal& terminal = Terminal::instance();
+    if (!terminal.isInteractive()) {
+        orderModule->viewActiveOrders();
+        pressEnterToContinue();
+        return;
+    }
+    do {
+        terminal.clearScreen();
+        orderModule->viewActiveOrders();
+        cout << "\nRefreshing every 3 seconds. Press any key to return...";
+    } while (terminal.readKey(3000) == Terminal::NoKey);
+}
+
 void staffDashboard() {
     int choice;
     do {
+        // Keep the offline copy current while the database is up
+        if (orderJournal) orderJournal->refresh();
         clearScreen();
         showStaffMainMenu();
         cin >> choice;
@@ -702,20 +845,31 @@ void staffDashboard() {
             break;
         }
         case 6:
-            orderModule->viewActiveOrders();
-            pressEnterToContinue();
+            staffWatchActiveOrders();
             break;
         case 7: {
             orderModule->viewActiveOrders();
             string orderID;
             cout << "\nEnter Order ID to cancel: ";
             getline(cin, orderID);
+            // Show the order and keep the version of what was shown
+            OrderAggregateCache::Scope orderCache;
+            orderModule->viewOrderDetails(orderID);
+            optional<RowVersion> shownVersion = orderModule->getOrderVersion(orderID);
             cout << "Are you sure? (Y/N): ";
             char confirm;
             cin >> confirm;
             clearInputBuffer();
             if (toupper(confirm) == 'Y') {
-                orderModule->cancelOrder(orderID);
+                WriteResult cancelled = orderModule->cancelOrder(orderID, shownVersion);
+                if (cancelled.conflict()) {
+                    cout << "\n--- Updated Order ---" << endl;
+                    orderModule->viewOrderDetails(orderID);
+                    cout << "Cancel it anyway? (Y/N): ";
+                    cin >> confirm;
+                    clearInputBuffer();
+                    if (toupper(confirm) == 'Y') orderModule->cancelOrder(orderID, cancelled.version);
+                }
             }
             pressEnterToContinue();
             break;
@@ -738,9 +892,317 @@ void staffDashboard() {
 }
 
 // ============================================
-// MAIN FUNCTION
+// HEADLESS MODE
+// ============================================
+// restaurant.exe --headless [script|-] [--out results.jsonl] [--query-pool N]
+int runHeadless(const vector<string>& options) {
+    string scriptPath, outPath;
+    int poolSize = 0;
+    for (size_t i = 0; i < options.size(); i++) {
+        if (options[i] == "--out" && i + 1 < options.size()) {
+            outPath = options[++i];
+        }
+        else if (options[i] == "--query-pool" && i + 1 < options.size()) {
+            poolSize = atoi(options[++i].c_str());
+        }
+        else {
+            scriptPath = options[i];
+        }
+    }
+
+    // Keep connection chatter off the results stream
+    streambuf* savedOut = cout.rdbuf(cerr.rdbuf());
+    bool connected = db.connect();
+    if (connected) SchemaCheck::run(db);
+    cout.rdbuf(savedOut);
+    if (!connected) {
+        cerr << "[CRITICAL] Cannot connect to database!" << endl;
+        return 1;
+    }
+
+    ifstream scriptFile;
+    if (!scriptPath.empty() && scriptPath != "-") {
+        scriptFile.open(scriptPath);
+        if (!scriptFile) {
+            cerr << "[CRITICAL] Cannot open script: " << scriptPath << endl;
+            return 1;
+        }
+    }
+    ofstream outFile;
+    if (!outPath.empty()) {
+        outFile.open(outPath);
+        if (!outFile) {
+            cerr << "[CRITICAL] Cannot open output file: " << outPath << endl;
+            return 1;
+        }
+    }
+
+    AdminModule admin(db);
+    StaffModule staff(db);
+    MenuModule menu(db);
+    TableModule table(db);
+    OrderModule order(db);
+    BillingModule billing(db);
+
+    unique_ptr<QueryPool> queryPool;
+    if (poolSize > 0) {
+        streambuf* savedPoolOut = cout.rdbuf(cerr.rdbuf());
+        queryPool.reset(new QueryPool(poolSize));
+        cout.rdbuf(savedPoolOut);
+        if (queryPool->size() > 0) admin.useQueryPool(queryPool.get());
+    }
+
+    HeadlessRunner runner(db, admin, staff, menu, table, order, billing,
+        outFile.is_open() ? (ostream&)outFile : cout);
+    runner.setReportTimeout(reportTimeout);
+    int failed = runner.run(scriptFile.is_open() ? (istream&)scriptFile : cin);
+
+    streambuf* savedClose = cout.rdbuf(cerr.rdbuf());
+    db.disconnect();
+    cout.rdbuf(savedClose);
+    return failed > 0 ? 2 : 0;
+}
+
+// ============================================
+// BENCHMARK MODE
+// ============================================
+// restaurant.exe --bench [tables=20 menu=40 staff=4 workers=4 duration=30 ... pool=0 reserve=1 reports=0 out=bench.json]
+int runBenchmark(const vector<string>& options) {
+    BenchmarkConfig config;
+    for (const string& option : options) {
+        size_t eq = option.find('=');
+        if (eq == string::npos || !config.set(option.substr(0, eq), option.substr(eq + 1))) {
+            cerr << "[FAILED] Unknown benchmark option: " << option << endl;
+            return 1;
+        }
+    }
+    if (!config.valid()) {
+        cerr << "[FAILED] Invalid benchmark settings (need tables >= workers >= 1, and pool > 0 for reports)." << endl;
+        return 1;
+    }
+
+    streambuf* savedOut = cout.rdbuf(cerr.rdbuf());
+    bool connected = db.connect();
+    if (connected) SchemaCheck::run(db);
+    cout.rdbuf(savedOut);
+    if (!connected) {
+        cerr << "[CRITICAL] Cannot connect to database!" << endl;
+        return 1;
+    }
+
+    ofstream outFile;
+    if (!config.outPath.empty()) {
+        outFile.open(config.outPath);
+        if (!outFile) {
+            cerr << "[CRITICAL] Cannot open output file: " << config.outPath << endl;
+            return 1;
+        }
+    }
+
+    RushBenchmark benchmark(db, config);
+    bool ok = benchmark.run(outFile.is_open() ? (ostream&)outFile : cout);
+
+    streambuf* savedClose = cout.rdbuf(cerr.rdbuf());
+    db.disconnect();
+    cout.rdbuf(savedClose);
+    return ok ? 0 : 1;
+}
+
+// ============================================
+// FIXTURE GENERATOR
+// ============================================
+// restaurant.exe --generate-fixtures [years=3 perday=300 orders=... writers=4 batch=1000 ...]
+int runFixtureGenerator(const vector<string>& options) {
+    FixtureConfig config;
+    for (const string& option : options) {
+        size_t eq = option.find('=');
+        if (eq == string::npos || !config.set(option.substr(0, eq), option.substr(eq + 1))) {
+            cerr << "[FAILED] Unknown fixture option: " << option << endl;
+            return 1;
+        }
+    }
+    if (!config.valid()) {
+        cerr << "[FAILED] Invalid fixture settings." << endl;
+        return 1;
+    }
+    if (!db.connect()) {
+        cerr << "[CRITICAL] Cannot connect to database!" << endl;
+        return 1;
+    }
+
+    FixtureGenerator generator(db, config);
+    bool ok = generator.run();
+    db.disconnect();
+    return ok ? 0 : 1;
+}
+
+// ============================================
+// BULK IMPORT
+// ============================================
+// restaurant.exe --import menu|tables|staff <file.csv> [--strict]
+int runImport(const vector<string>& options) {
+    ImportKind kind;
+    vector<string> positional;
+    bool strict = false;
+    for (const string& option : options) {
+        if (option == "--strict") strict = true;
+        else positional.push_back(option);
+    }
+    if (positional.size() != 2 || !BulkImporter::parseKind(positional[0], kind)) {
+        cerr << "Usage: --import menu|tables|staff <file.csv> [--strict]" << endl;
+        return 1;
+    }
+
+    streambuf* savedOut = cout.rdbuf(cerr.rdbuf());
+    bool connected = db.connect();
+    cout.rdbuf(savedOut);
+    if (!connected) {
+        cerr << "[CRITICAL] Cannot connect to database!" << endl;
+        return 1;
+    }
+
+    BulkImporter importer(db);
+    ImportReport report = importer.importFile(kind, positional[1], strict);
+    BulkImporter::printReport(report, cout);
+
+    streambuf* savedClose = cout.rdbuf(cerr.rdbuf());
+    db.disconnect();
+    cout.rdbuf(savedClose);
+    return report.committed && report.errors.empty() ? 0 : 1;
+}
+
+// --export <dir> and --restore <dir>
+int runSnapshot(bool restore, const vector<string>& options) {
+    SnapshotConfig config;
+    string dir;
+    for (const string& option : options) {
+        size_t eq = option.find('=');
+        if (eq == string::npos && dir.empty()) {
+            dir = option;
+        }
+        else if (eq == string::npos || !config.set(option.substr(0, eq), option.substr(eq + 1))) {
+            cerr << "[FAILED] Unknown snapshot option: " << option << endl;
+            return 1;
+        }
+    }
+    if (dir.empty() || !config.valid()) {
+        cerr << "Usage: " << (restore ? "--restore" : "--export")
+            << " <dir> [threads=N] [lock=0] [replace=1] [block=N] [batch=N]" << endl;
+        return 1;
+    }
+
+    streambuf* savedOut = cout.rdbuf(cerr.rdbuf());
+    bool connected = db.connect();
+    cout.rdbuf(savedOut);
+    if (!connected) {
+        cerr << "[CRITICAL] Cannot connect to database!" << endl;
+        return 1;
+    }
+
+    bool ok;
+    if (restore) {
+        SnapshotImporter importer(db, config);
+        ok = importer.run(dir, cout);
+    }
+    else {
+        SnapshotExporter exporter(db, config);
+        ok = exporter.run(dir, cout);
+    }
+
+    streambuf* savedClose = cout.rdbuf(cerr.rdbuf());
+    db.disconnect();
+    cout.rdbuf(savedClose);
+    return ok ? 0 : 1;
+}
+
+// --archive [days=N] [batch=N] [pause=MS] [limit=N]
+int runArchive(const vector<string>& options) {
+    ArchiveConfig config;
+    for (const string& option : options) {
+        size_t eq = option.find('=');
+        if (eq == string::npos || !config.set(option.substr(0, eq), option.substr(eq + 1))) {
+            cerr << "[FAILED] Unknown archive option: " << option << endl;
+            return 1;
+        }
+    }
+    if (!config.valid()) {
+        cerr << "Usage: --archive [days=N] [batch=N] [pause=MS] [limit=N]" << endl;
+        return 1;
+    }
+
+    streambuf* savedOut = cout.rdbuf(cerr.rdbuf());
+    bool connected = db.connect();
+    if (connected) SchemaCheck::run(db);
+    cout.rdbuf(savedOut);
+    if (!connected) {
+        cerr << "[CRITICAL] Cannot connect to database!" << endl;
+        return 1;
+    }
+
+    OrderArchiver archiver(db, config);
+    bool ok = archiver.run(cout);
+
+    streambuf* savedClose = cout.rdbuf(cerr.rdbuf());
+    db.disconnect();
+    cout.rdbuf(savedClose);
+    return ok ? 0 : 1;
+}
+
+// --rebuild-sales-series: fill the sales series file from the paid bills
+int runSalesSeriesRebuild() {
+    SalesSeries series;
+    if (salesSeriesPath == "off" || !series.open(salesSeriesPath)) {
+        cerr << "[FAILED] Cannot open the sales series file (is the program running?)" << endl;
+        return 1;
+    }
+
+    streambuf* savedOut = cout.rdbuf(cerr.rdbuf());
+    bool connected = db.connect();
+    if (connected) SchemaCheck::run(db);
+    cout.rdbuf(savedOut);
+    if (!connected) {
+        cerr << "[CRITICAL] Cannot connect to database!" << endl;
+        return 1;
+    }
+
+    AdminModule admin(db);
+    admin.useSalesSeries(&series);
+    long long bills = admin.rebuildSalesSeries();
+
+    streambuf* savedClose = cout.rdbuf(cerr.rdbuf());
+    db.disconnect();
+    cout.rdbuf(savedClose);
+    return bills >= 0 ? 0 : 1;
+}
+
 // ============================================
-int main() {
+// QUERY BUDGET CHECK
+// ============================================
+// restaurant.exe --check-budgets  (exit code 1 if any operation is over budget)
+int runBudgetCheck() {
+    streambuf* savedOut = cout.rdbuf(cerr.rdbuf());
+    bool connected = db.connect();
+    if (connected) SchemaCheck::run(db);
+    cout.rdbuf(savedOut);
+    if (!connected) {
+        cerr << "[CRITICAL] Cannot connect to database!" << endl;
+        return 1;
+    }
+
+    QueryBudgetCheck check(db);
+    bool passed = check.run(cout);
+
+    streambuf* savedClose = cout.rdbuf(cerr.rdbuf());
+    db.disconnect();
+    cout.rdbuf(savedClose);
+    return passed ? 0 : 1;
+}
+
+// ============================================
+// INTERACTIVE MODE
+// ============================================
+int runInteractive() {
+    Terminal::instance().install();
     cout << "\n";
     cout << "============================================" << endl;
     cout << "   RESTAURANT MANAGEMENT SYSTEM" << endl;
@@ -755,8 +1217,10 @@ int main() {
         cout << "2. Database 'restaurant_management' exists" << endl;
         cout << "3. Run the SQL script to create tables" << endl;
         pressEnterToContinue();
+        Terminal::instance().uninstall();
         return 1;
     }
+    SchemaCheck::run(db);
 
     // Initialize modules
     adminModule = new AdminModule(db);
@@ -766,6 +1230,44 @@ int main() {
     orderModule = new OrderModule(db);
     billingModule = new BillingModule(db);
 
+    // Record payments per minute so trends need no Bill scans
+    // (before the journal, whose replay records offline payments too)
+    if (salesSeriesPath != "off") {
+        salesSeries = new SalesSeries();
+        if (salesSeries->open(salesSeriesPath)) {
+            billingModule->useSalesSeries(salesSeries);
+            adminModule->useSalesSeries(salesSeries);
+        }
+        else {
+            cout << "[WARNING] Cannot open " << salesSeriesPath << "; sales trend is off." << endl;
+            delete salesSeries;
+            salesSeries = nullptr;
+        }
+    }
+
+    // Keep taking orders if the connection drops; send what was taken
+    // offline (now, and whenever the connection comes back)
+    if (journalPath != "off") {
+        orderJournal = new OrderJournal(db);
+        if (orderJournal->open(journalPath) && orderJournal->load()) {
+            OrderJournal* journal = orderJournal;
+            journal->onReconnect([journal]() { JournalReplay(db, *journal, salesSeries).run(); });
+            journal->refresh(chrono::seconds(0));
+            menuModule->useJournal(journal);
+            tableModule->useJournal(journal);
+            orderModule->useJournal(journal);
+            billingModule->useJournal(journal);
+        }
+        else {
+            cout << "[WARNING] Offline order journal is off." << endl;
+        }
+    }
+
+    // Extra connections so reports can send their independent statements
+    // at the same time
+    QueryPool queryPool(2);
+    if (queryPool.size() > 0) adminModule->useQueryPool(&queryPool);
+
     cout << "[SUCCESS] System initialized successfully!" << endl;
 
     // Main loop
@@ -821,6 +1323,8 @@ int main() {
     delete tableModule;
     delete orderModule;
     delete billingModule;
+    delete orderJournal;
+    delete salesSeries;
 
     db.disconnect();
 
@@ -828,5 +1332,103 @@ int main() {
     cout << "   SYSTEM SHUTDOWN COMPLETE" << endl;
     cout << "============================================" << endl;
 
+    Terminal::instance().uninstall();
     return 0;
 }
+
+// ============================================
+// MAIN FUNCTION
+// ============================================
+int runMode(const vector<string>& args) {
+    if (!args.empty()) {
+        const string& mode = args[0];
+        vector<string> options(args.begin() + 1, args.end());
+        if (mode == "--headless") {
+            return runHeadless(options);
+        }
+        if (mode == "--bench") {
+            return runBenchmark(options);
+        }
+        if (mode == "--generate-fixtures") {
+            return runFixtureGenerator(options);
+        }
+        if (mode == "--check-budgets") {
+            return runBudgetCheck();
+        }
+        if (mode == "--import") {
+            return runImport(options);
+        }
+        if (mode == "--export" || mode == "--restore") {
+            return runSnapshot(mode == "--restore", options);
+        }
+        if (mode == "--archive") {
+            return runArchive(options);
+        }
+        if (mode == "--rebuild-sales-series") {
+            return runSalesSeriesRebuild();
+        }
+        cerr << "Unknown option: " << mode << endl;
+        return 1;
+    }
+    return runInteractive();
+}
+
+int main(int argc, char* argv[]) {
+    // Options that apply to every mode
+    string tracePath;
+    int metricsPort = 0;
+    string replicaServer;
+    int replicaMaxLag = 5;
+    vector<string> args;
+    for (int i = 1; i < argc; i++) {
+        string option = argv[i];
+        if (option == "--trace" && i + 1 < argc) {
+            tracePath = argv[++i];
+        }
+        else if (option == "--metrics-port" && i + 1 < argc) {
+            metricsPort = atoi(argv[++i]);
+        }
+        else if (option == "--replica" && i + 1 < argc) {
+            replicaServer = argv[++i];
+        }
+        else if (option == "--replica-max-lag" && i + 1 < argc) {
+            replicaMaxLag = atoi(argv[++i]);
+        }
+        else if (option == "--report-timeout" && i + 1 < argc) {
+            reportTimeout = chrono::seconds(atoi(argv[++i]));
+        }
+        else if (option == "--journal" && i + 1 < argc) {
+            journalPath = argv[++i];
+        }
+        else if (option == "--sales-series" && i + 1 < argc) {
+            salesSeriesPath = argv[++i];
+        }
+        else {
+            args.push_back(option);
+        }
+    }
+
+    if (!tracePath.empty()) {
+        Tracer::instance().enable();
+    }
+
+    // Reports and listings read from the replica; everything else stays on db
+    if (!replicaServer.empty()) {
+        db.setReplica(replicaServer, replicaMaxLag);
+    }
+
+    unique_ptr<MetricsServer> metricsServer;
+    if (metricsPort > 0) {
+        metricsServer.reset(new MetricsServer(metricsPort));
+        if (!metricsServer->start()) return 1;
+    }
+
+    int result = runMode(args);
+
+    if (metricsServer) metricsServer->stop();
+
+    if (!tracePath.empty() && !Tracer::instance().writeChromeTrace(tracePath)) {
+        cerr << "[FAILED] Cannot write trace file: " << tracePath << endl;
+    }
+    return result;
+}